@@ -24,6 +24,8 @@
 
 #include "StudioModelRenderer.h"
 #include "GameStudioModelRenderer.h"
+#include "worker_pool.h"
+#include "studio_bonejob.h"
 
 //
 // Override the StudioModelRender virtual member functions here to implement custom bone
@@ -82,6 +84,29 @@ void R_StudioInit( void )
 	g_StudioRenderer.Init();
 }
 
+/*
+====================
+R_StudioShutdown
+
+====================
+*/
+void R_StudioShutdown( void )
+{
+	g_StudioBoneJob.Shutdown();
+}
+
+/*
+====================
+R_StudioCreateWorker
+
+A renderer with the state of the main one, for a worker thread
+====================
+*/
+CStudioModelRenderer *R_StudioCreateWorker( void )
+{
+	return new CGameStudioModelRenderer( g_StudioRenderer );
+}
+
 // The simple drawing interface we'll pass back to the engine
 r_studio_interface_t studio =
 {
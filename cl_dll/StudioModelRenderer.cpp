@@ -22,10 +22,14 @@
 #include <string.h>
 
 #include "studio_util.h"
+#include "worker_pool.h"
+#include "studio_animcache.h"
 #include "r_studioint.h"
 
 #include "StudioModelRenderer.h"
 #include "GameStudioModelRenderer.h"
+#include "studio_bonejob.h"
+#include "studio_posecache.h"
 
 // Global engine <-> studio model rendering code interface
 engine_studio_api_t IEngineStudio;
@@ -69,6 +73,10 @@ void CStudioModelRenderer::Init( void )
 	m_plighttransform		= (float (*)[MAXSTUDIOBONES][3][4])IEngineStudio.StudioGetLightTransform();
 	m_paliastransform		= (float (*)[3][4])IEngineStudio.StudioGetAliasTransform();
 	m_protationmatrix		= (float (*)[3][4])IEngineStudio.StudioGetRotationMatrix();
+
+	g_StudioAnimCache.Init();
+	g_StudioBoneJob.Init();
+	g_StudioPoseCache.Init();
 }
 
 /*
@@ -607,6 +615,7 @@ void CStudioModelRenderer::StudioCalcRotations( float pos[][3], vec4_t *q, mstud
 	float s;
 	float adj[MAXSTUDIOCONTROLLERS];
 	float dadt;
+	animframe_t animframe;
 
 	if( f > pseqdesc->numframes - 1 )
 	{
@@ -636,13 +645,45 @@ void CStudioModelRenderer::StudioCalcRotations( float pos[][3], vec4_t *q, mstud
 
 	StudioCalcBoneAdj( dadt, adj, m_pCurrentEntity->curstate.controller, m_pCurrentEntity->latched.prevcontroller, m_pCurrentEntity->mouth.mouthopen );
 
-	for( i = 0; i < m_pStudioHeader->numbones; i++, pbone++, panim++ )
+	if( g_StudioAnimCache.Lookup( m_pStudioHeader, pseqdesc, panim, frame, &animframe ) )
+	{
+		// decoded already, lerp the two frames
+		for( i = 0; i < m_pStudioHeader->numbones; i++, pbone++, panim++ )
+		{
+			int j;
+
+			if( pbone->bonecontroller[3] != -1 || pbone->bonecontroller[4] != -1 || pbone->bonecontroller[5] != -1 )
+				StudioCalcBoneQuaterion( frame, s, pbone, panim, adj, q[i] );
+			else if( !memcmp( animframe.q1[i], animframe.q2[i], sizeof( vec4_t ) ) )
+				memcpy( q[i], animframe.q1[i], sizeof( vec4_t ) );
+			else
+			{
+				vec4_t q2;
+
+				// QuaternionSlerp may flip q2, keep the cached one intact
+				memcpy( q2, animframe.q2[i], sizeof( vec4_t ) );
+				QuaternionSlerp( animframe.q1[i], q2, s, q[i] );
+			}
+
+			for( j = 0; j < 3; j++ )
+			{
+				pos[i][j] = pbone->value[j] + ( animframe.pos1[j][i] * ( 1.0f - s ) + s * animframe.pos2[j][i] ) * pbone->scale[j];
+
+				if( pbone->bonecontroller[j] != -1 )
+					pos[i][j] += adj[pbone->bonecontroller[j]];
+			}
+		}
+	}
+	else
 	{
-		StudioCalcBoneQuaterion( frame, s, pbone, panim, adj, q[i] );
+		for( i = 0; i < m_pStudioHeader->numbones; i++, pbone++, panim++ )
+		{
+			StudioCalcBoneQuaterion( frame, s, pbone, panim, adj, q[i] );
 
-		StudioCalcBonePosition( frame, s, pbone, panim, adj, pos[i] );
-		// if( 0 && i == 0 )
-		//	Con_DPrintf( "%d %d %d %d\n", m_pCurrentEntity->curstate.sequence, frame, j, k );
+			StudioCalcBonePosition( frame, s, pbone, panim, adj, pos[i] );
+			// if( 0 && i == 0 )
+			//	Con_DPrintf( "%d %d %d %d\n", m_pCurrentEntity->curstate.sequence, frame, j, k );
+		}
 	}
 
 	if( pseqdesc->motiontype & STUDIO_X )
@@ -780,6 +821,151 @@ float CStudioModelRenderer::StudioEstimateFrame( mstudioseqdesc_t *pseqdesc )
 	return f;
 }
 
+/*
+====================
+StudioPoseKey
+
+====================
+*/
+void CStudioModelRenderer::StudioPoseKey( studioposekey_t *pkey )
+{
+	cl_entity_t *ent = m_pCurrentEntity;
+
+	// bytewise compared, padding included
+	memset( pkey, 0, sizeof( *pkey ) );
+
+	pkey->pstudiohdr = m_pStudioHeader;
+	pkey->time = m_clTime;
+	pkey->interp = m_fDoInterp;
+
+	pkey->sequence = ent->curstate.sequence;
+	pkey->frame = ent->curstate.frame;
+	pkey->animtime = ent->curstate.animtime;
+	pkey->framerate = ent->curstate.framerate;
+
+	pkey->prevsequence = ent->latched.prevsequence;
+	pkey->prevframe = ent->latched.prevframe;
+	pkey->prevanimtime = ent->latched.prevanimtime;
+	pkey->sequencetime = ent->latched.sequencetime;
+
+	if( m_pPlayerInfo && m_pPlayerInfo->gaitsequence != 0 )
+	{
+		pkey->gaitsequence = m_pPlayerInfo->gaitsequence;
+		pkey->gaitframe = m_pPlayerInfo->gaitframe;
+	}
+
+	memcpy( pkey->blending, ent->curstate.blending, sizeof( pkey->blending ) );
+	memcpy( pkey->prevblending, ent->latched.prevblending, sizeof( pkey->prevblending ) );
+	memcpy( pkey->prevseqblending, ent->latched.prevseqblending, sizeof( pkey->prevseqblending ) );
+	memcpy( pkey->controller, ent->curstate.controller, sizeof( pkey->controller ) );
+	memcpy( pkey->prevcontroller, ent->latched.prevcontroller, sizeof( pkey->prevcontroller ) );
+	pkey->mouthopen = ent->mouth.mouthopen;
+}
+
+/*
+====================
+StudioPoseState
+
+====================
+*/
+void CStudioModelRenderer::StudioPoseState( studioposestate_t *pstate )
+{
+	cl_entity_t *ent = m_pCurrentEntity;
+	mstudioseqdesc_t *pseqdesc;
+	float dadt;
+
+	// bytewise compared, padding included
+	memset( pstate, 0, sizeof( *pstate ) );
+
+	pstate->pstudiohdr = m_pStudioHeader;
+	pstate->length = m_pStudioHeader->length;
+
+	pseqdesc = (mstudioseqdesc_t *)( (byte *)m_pStudioHeader + m_pStudioHeader->seqindex ) + ent->curstate.sequence;
+
+	dadt = StudioEstimateInterpolant();
+
+	// the same expressions as StudioCalcBonePose
+	pstate->sequence = ent->curstate.sequence;
+	pstate->frame = StudioEstimateFrame( pseqdesc );
+
+	if( pseqdesc->numblends > 1 )
+	{
+		pstate->blend[0] = ( ent->curstate.blending[0] * dadt + ent->latched.prevblending[0] * ( 1.0 - dadt ) ) / 255.0;
+
+		if( pseqdesc->numblends == 4 )
+			pstate->blend[1] = ( ent->curstate.blending[1] * dadt + ent->latched.prevblending[1] * ( 1.0 - dadt ) ) / 255.0;
+	}
+
+	pstate->prevsequence = -1;
+
+	if( m_fDoInterp && ent->latched.sequencetime &&
+		( ent->latched.sequencetime + 0.2 > m_clTime ) &&
+		( ent->latched.prevsequence < m_pStudioHeader->numseq ) )
+	{
+		pstate->prevsequence = ent->latched.prevsequence;
+		pstate->prevframe = ent->latched.prevframe;
+		pstate->prevweight = 1.0 - ( m_clTime - ent->latched.sequencetime ) / 0.2;
+		memcpy( pstate->prevseqblending, ent->latched.prevseqblending, sizeof( pstate->prevseqblending ) );
+	}
+
+	if( m_pPlayerInfo && m_pPlayerInfo->gaitsequence != 0 )
+	{
+		pstate->gaitsequence = m_pPlayerInfo->gaitsequence;
+		pstate->gaitframe = m_pPlayerInfo->gaitframe;
+	}
+
+	StudioCalcBoneAdj( dadt, pstate->adj, ent->curstate.controller, ent->latched.prevcontroller, ent->mouth.mouthopen );
+}
+
+/*
+====================
+StudioCachedBonePose
+
+====================
+*/
+void CStudioModelRenderer::StudioCachedBonePose( float bonelocal[][3][4] )
+{
+	studioposestate_t state;
+	mstudioseqdesc_t *pseqdesc;
+	int settled;
+
+	if( !g_StudioPoseCache.Enabled() )
+	{
+		StudioCalcBonePose( bonelocal );
+		return;
+	}
+
+	pseqdesc = (mstudioseqdesc_t *)( (byte *)m_pStudioHeader + m_pStudioHeader->seqindex ) + m_pCurrentEntity->curstate.sequence;
+
+	StudioPoseState( &state );
+
+	// only poses that can show up again are worth keeping: not moving,
+	// or held on the last frame of a sequence that does not loop
+	settled = ( m_pCurrentEntity->curstate.framerate == 0.0f || pseqdesc->numframes <= 1 ||
+		( !( pseqdesc->flags & STUDIO_LOOPING ) && state.frame >= pseqdesc->numframes - 1.001f ) );
+
+	// a player's legs keep walking on their own
+	if( state.prevsequence != -1 || state.gaitsequence != 0 )
+		settled = FALSE;
+
+	if( !settled )
+	{
+		StudioCalcBonePose( bonelocal );
+		return;
+	}
+
+	if( g_StudioPoseCache.Lookup( &state, m_pStudioHeader->numbones, bonelocal ) )
+	{
+		// what StudioCalcBonePose leaves behind
+		m_pCurrentEntity->latched.prevframe = state.frame;
+		return;
+	}
+
+	StudioCalcBonePose( bonelocal );
+
+	g_StudioPoseCache.Store( &state, m_pStudioHeader->numbones, bonelocal );
+}
+
 /*
 ====================
 StudioSetupBones
@@ -787,6 +973,76 @@ StudioSetupBones
 ====================
 */
 void CStudioModelRenderer::StudioSetupBones( void )
+{
+	int i;
+	mstudiobone_t *pbones;
+	studioposekey_t key;
+	bonejob_t *pjob;
+	float (*bonelocal)[3][4];
+
+	if( m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq )
+	{
+		m_pCurrentEntity->curstate.sequence = 0;
+	}
+
+	if( m_pPlayerInfo && m_pPlayerInfo->gaitsequence >= m_pStudioHeader->numseq )
+	{
+		m_pPlayerInfo->gaitsequence = 0;
+	}
+
+	// use the pose from the bone job if it was computed from the same state
+	StudioPoseKey( &key );
+	pjob = g_StudioBoneJob.Find( m_pCurrentEntity, &key );
+
+	if( pjob )
+	{
+		bonelocal = pjob->bonelocal;
+		m_pCurrentEntity->latched.prevframe = pjob->prevframe;
+	}
+	else
+	{
+		bonelocal = m_rgBoneLocal;
+		StudioCachedBonePose( bonelocal );
+	}
+
+	pbones = (mstudiobone_t *)( (byte *)m_pStudioHeader + m_pStudioHeader->boneindex );
+
+	for( i = 0; i < m_pStudioHeader->numbones; i++ )
+	{
+		if( pbones[i].parent == -1 )
+		{
+			if( IEngineStudio.IsHardware() )
+			{
+				ConcatTransforms( (*m_protationmatrix), bonelocal[i], (*m_pbonetransform)[i] );
+
+				// MatrixCopy should be faster...
+				//ConcatTransforms( (*m_protationmatrix), bonelocal[i], (*m_plighttransform)[i] );
+				MatrixCopy( (*m_pbonetransform)[i], (*m_plighttransform)[i] );
+			}
+			else
+			{
+				ConcatTransforms( (*m_paliastransform), bonelocal[i], (*m_pbonetransform)[i] );
+				ConcatTransforms( (*m_protationmatrix), bonelocal[i], (*m_plighttransform)[i] );
+			}
+
+			// Apply client-side effects to the transformation matrix
+			StudioFxTransform( m_pCurrentEntity, (*m_pbonetransform)[i] );
+		} 
+		else 
+		{
+			ConcatTransforms( (*m_pbonetransform)[pbones[i].parent], bonelocal[i], (*m_pbonetransform)[i] );
+			ConcatTransforms( (*m_plighttransform)[pbones[i].parent], bonelocal[i], (*m_plighttransform)[i] );
+		}
+	}
+}
+
+/*
+====================
+StudioCalcBonePose
+
+====================
+*/
+void CStudioModelRenderer::StudioCalcBonePose( float bonelocal[][3][4] )
 {
 	int i, j;
 	double f;
@@ -795,16 +1051,15 @@ void CStudioModelRenderer::StudioSetupBones( void )
 	mstudioseqdesc_t *pseqdesc;
 	mstudioanim_t *panim;
 
-	static float pos[MAXSTUDIOBONES][3];
-	static vec4_t q[MAXSTUDIOBONES];
-	float bonematrix[3][4];
+	float (*pos)[3] = m_rgPos;
+	vec4_t *q = m_rgQ;
 
-	static float pos2[MAXSTUDIOBONES][3];
-	static vec4_t q2[MAXSTUDIOBONES];
-	static float pos3[MAXSTUDIOBONES][3];
-	static vec4_t q3[MAXSTUDIOBONES];
-	static float pos4[MAXSTUDIOBONES][3];
-	static vec4_t q4[MAXSTUDIOBONES];
+	float (*pos2)[3] = m_rgPos2;
+	vec4_t *q2 = m_rgQ2;
+	float (*pos3)[3] = m_rgPos3;
+	vec4_t *q3 = m_rgQ3;
+	float (*pos4)[3] = m_rgPos4;
+	vec4_t *q4 = m_rgQ4;
 
 	if( m_pCurrentEntity->curstate.sequence >=  m_pStudioHeader->numseq )
 	{
@@ -857,8 +1112,8 @@ void CStudioModelRenderer::StudioSetupBones( void )
 		( m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq ) )
 	{
 		// blend from last sequence
-		static float pos1b[MAXSTUDIOBONES][3];
-		static vec4_t q1b[MAXSTUDIOBONES];
+		float (*pos1b)[3] = m_rgPos1b;
+		vec4_t *q1b = m_rgQ1b;
 		float s;
 
 		pseqdesc = (mstudioseqdesc_t *)( (byte *)m_pStudioHeader + m_pStudioHeader->seqindex ) + m_pCurrentEntity->latched.prevsequence;
@@ -930,40 +1185,159 @@ void CStudioModelRenderer::StudioSetupBones( void )
 		}
 	}
 
-
 	for( i = 0; i < m_pStudioHeader->numbones; i++ )
 	{
-		QuaternionMatrix( q[i], bonematrix );
+		QuaternionMatrix( q[i], bonelocal[i] );
 
-		bonematrix[0][3] = pos[i][0];
-		bonematrix[1][3] = pos[i][1];
-		bonematrix[2][3] = pos[i][2];
+		bonelocal[i][0][3] = pos[i][0];
+		bonelocal[i][1][3] = pos[i][1];
+		bonelocal[i][2][3] = pos[i][2];
+	}
+}
 
-		if( pbones[i].parent == -1 )
+/*
+====================
+StudioPrepareBoneJob
+
+====================
+*/
+int CStudioModelRenderer::StudioPrepareBoneJob( bonejob_t *pjob )
+{
+	cl_entity_t *ent = pjob->pEntity;
+	mstudioseqdesc_t *pseqdesc;
+
+	if( !ent->model || ent->model->type != mod_studio )
+		return FALSE;
+
+	// drawn from a made up player state, or from the bones of another entity
+	if( ent->curstate.renderfx == kRenderFxDeadPlayer || ent->curstate.movetype == MOVETYPE_FOLLOW )
+		return FALSE;
+
+	IEngineStudio.GetTimes( &m_nFrameCount, &m_clTime, &m_clOldTime );
+
+	pjob->entity = *ent;
+	pjob->isplayer = FALSE;
+
+	m_pCurrentEntity = &pjob->entity;
+	m_pPlayerInfo = NULL;
+
+	if( ent->player )
+	{
+		entity_state_t player;
+
+		// same as StudioDrawPlayer, on copies
+		m_nPlayerIndex = ent->index - 1;
+
+		if( m_nPlayerIndex < 0 || m_nPlayerIndex >= gEngfuncs.GetMaxClients() )
+			return FALSE;
+
+		m_pRenderModel = IEngineStudio.SetupPlayerModel( m_nPlayerIndex );
+		if( m_pRenderModel == NULL )
+			return FALSE;
+
+		m_pStudioHeader = (studiohdr_t *)IEngineStudio.Mod_Extradata( m_pRenderModel );
+		if( !m_pStudioHeader )
+			return FALSE;
+
+		player = *( IEngineStudio.GetPlayerState( m_nPlayerIndex ) );
+		pjob->playerinfo = *( IEngineStudio.PlayerInfo( m_nPlayerIndex ) );
+		pjob->isplayer = TRUE;
+		m_pPlayerInfo = &pjob->playerinfo;
+
+		if( player.gaitsequence )
 		{
-			if( IEngineStudio.IsHardware() )
-			{
-				ConcatTransforms( (*m_protationmatrix), bonematrix, (*m_pbonetransform)[i] );
+			// it is drawn in the next render frame
+			if( m_pPlayerInfo->renderframe == m_nFrameCount )
+				m_nFrameCount++;
 
-				// MatrixCopy should be faster...
-				//ConcatTransforms( (*m_protationmatrix), bonematrix, (*m_plighttransform)[i] );
-				MatrixCopy( (*m_pbonetransform)[i], (*m_plighttransform)[i] );
-			}
-			else
-			{
-				ConcatTransforms( (*m_paliastransform), bonematrix, (*m_pbonetransform)[i] );
-				ConcatTransforms( (*m_protationmatrix), bonematrix, (*m_plighttransform)[i] );
-			}
+			StudioProcessGait( &player );
 
-			// Apply client-side effects to the transformation matrix
-			StudioFxTransform( m_pCurrentEntity, (*m_pbonetransform)[i] );
-		} 
-		else 
+			m_pPlayerInfo->gaitsequence = player.gaitsequence;
+		}
+		else
 		{
-			ConcatTransforms( (*m_pbonetransform)[pbones[i].parent], bonematrix, (*m_pbonetransform)[i] );
-			ConcatTransforms( (*m_plighttransform)[pbones[i].parent], bonematrix, (*m_plighttransform)[i] );
+			m_pCurrentEntity->curstate.controller[0] = 127;
+			m_pCurrentEntity->curstate.controller[1] = 127;
+			m_pCurrentEntity->curstate.controller[2] = 127;
+			m_pCurrentEntity->curstate.controller[3] = 127;
+			m_pCurrentEntity->latched.prevcontroller[0] = m_pCurrentEntity->curstate.controller[0];
+			m_pCurrentEntity->latched.prevcontroller[1] = m_pCurrentEntity->curstate.controller[1];
+			m_pCurrentEntity->latched.prevcontroller[2] = m_pCurrentEntity->curstate.controller[2];
+			m_pCurrentEntity->latched.prevcontroller[3] = m_pCurrentEntity->curstate.controller[3];
+
+			m_pPlayerInfo->gaitsequence = 0;
 		}
 	}
+	else
+	{
+		m_pRenderModel = ent->model;
+		m_pStudioHeader = (studiohdr_t *)IEngineStudio.Mod_Extradata( m_pRenderModel );
+		if( !m_pStudioHeader )
+			return FALSE;
+	}
+
+	if( m_pStudioHeader->numbodyparts == 0 )
+		return FALSE;
+
+	if( m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq )
+	{
+		m_pCurrentEntity->curstate.sequence = 0;
+	}
+
+	if( m_pPlayerInfo && m_pPlayerInfo->gaitsequence >= m_pStudioHeader->numseq )
+	{
+		m_pPlayerInfo->gaitsequence = 0;
+	}
+
+	// sequence groups are paged in through the engine, that has to be the main thread
+	pseqdesc = (mstudioseqdesc_t *)( (byte *)m_pStudioHeader + m_pStudioHeader->seqindex );
+
+	if( pseqdesc[m_pCurrentEntity->curstate.sequence].seqgroup != 0 )
+		return FALSE;
+
+	if( m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq
+		&& pseqdesc[m_pCurrentEntity->latched.prevsequence].seqgroup != 0 )
+		return FALSE;
+
+	if( m_pPlayerInfo && pseqdesc[m_pPlayerInfo->gaitsequence].seqgroup != 0 )
+		return FALSE;
+
+	pjob->pRenderModel = m_pRenderModel;
+	pjob->pStudioHeader = m_pStudioHeader;
+	pjob->time = m_clTime;
+	pjob->oldtime = m_clOldTime;
+	pjob->interp = m_fDoInterp;
+
+	StudioPoseKey( &pjob->key );
+
+	m_pCurrentEntity = NULL;
+	m_pPlayerInfo = NULL;
+
+	return TRUE;
+}
+
+/*
+====================
+StudioRunBoneJob
+
+====================
+*/
+void CStudioModelRenderer::StudioRunBoneJob( bonejob_t *pjob )
+{
+	m_pCurrentEntity = &pjob->entity;
+	m_pPlayerInfo = pjob->isplayer ? &pjob->playerinfo : NULL;
+	m_pRenderModel = pjob->pRenderModel;
+	m_pStudioHeader = pjob->pStudioHeader;
+	m_clTime = pjob->time;
+	m_clOldTime = pjob->oldtime;
+	m_fDoInterp = pjob->interp;
+
+	StudioCachedBonePose( pjob->bonelocal );
+
+	pjob->prevframe = pjob->entity.latched.prevframe;
+
+	m_pCurrentEntity = NULL;
+	m_pPlayerInfo = NULL;
 }
 
 /*
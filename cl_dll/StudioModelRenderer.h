@@ -9,6 +9,58 @@
 #if !defined ( STUDIOMODELRENDERER_H )
 #define STUDIOMODELRENDERER_H
 
+struct bonejob_s;
+
+// Everything the bone pose of an entity depends on, compared bytewise
+typedef struct studioposekey_s
+{
+	studiohdr_t	*pstudiohdr;
+	double		time;
+	int		interp;
+
+	int		sequence;
+	float		frame;
+	float		animtime;
+	float		framerate;
+
+	int		prevsequence;
+	float		prevframe;
+	float		prevanimtime;
+	float		sequencetime;
+
+	int		gaitsequence;	// 0 unless drawn as a player with gait
+	float		gaitframe;
+
+	byte		blending[2];
+	byte		prevblending[2];
+	byte		prevseqblending[2];
+	byte		controller[4];
+	byte		prevcontroller[4];
+	byte		mouthopen;
+} studioposekey_t;
+
+// The evaluated inputs of a pose, equal states give equal bones
+// whatever the entity or the time.  Compared bytewise.
+typedef struct studioposestate_s
+{
+	studiohdr_t	*pstudiohdr;
+	int		length;		// of the header, in case another model is loaded there
+
+	int		sequence;
+	float		frame;		// as estimated for this frame
+	float		blend[2];	// sequence blend weights, if it blends
+
+	int		prevsequence;	// -1 unless blending out of the previous sequence
+	float		prevframe;
+	float		prevweight;
+	byte		prevseqblending[2];
+
+	int		gaitsequence;
+	float		gaitframe;
+
+	float		adj[MAXSTUDIOCONTROLLERS];	// bone controllers
+} studioposestate_t;
+
 /*
 ====================
 CStudioModelRenderer
@@ -43,6 +95,24 @@ public:
 	// Set up model bone positions
 	virtual void StudioSetupBones( void );	
 
+	// Compute bone matrices relative to their parent bones
+	virtual void StudioCalcBonePose( float bonelocal[][3][4] );
+
+	// StudioCalcBonePose, reusing the result of an identical animation state
+	virtual void StudioCachedBonePose( float bonelocal[][3][4] );
+
+	// Fill in what the pose of the current entity depends on
+	virtual void StudioPoseKey( studioposekey_t *pkey );
+
+	// Same, reduced to the values the pose is computed from
+	virtual void StudioPoseState( studioposestate_t *pstate );
+
+	// Snapshot an entity for bone setup ahead of drawing, FALSE if it must be done at draw time
+	virtual int StudioPrepareBoneJob( struct bonejob_s *pjob );
+
+	// Compute the pose of a snapshot, runs on worker threads
+	virtual void StudioRunBoneJob( struct bonejob_s *pjob );
+
 	// Find final attachment points
 	virtual void StudioCalcAttachments( void );
 	
@@ -182,6 +252,19 @@ public:
 	// Concatenated bone and light transforms
 	float			(*m_pbonetransform)[MAXSTUDIOBONES][3][4];
 	float			(*m_plighttransform)[MAXSTUDIOBONES][3][4];
+
+	// Bone setup scratch, per renderer so the bone job copies don't share it
+	float			m_rgPos[MAXSTUDIOBONES][3];
+	vec4_t			m_rgQ[MAXSTUDIOBONES];
+	float			m_rgPos2[MAXSTUDIOBONES][3];
+	vec4_t			m_rgQ2[MAXSTUDIOBONES];
+	float			m_rgPos3[MAXSTUDIOBONES][3];
+	vec4_t			m_rgQ3[MAXSTUDIOBONES];
+	float			m_rgPos4[MAXSTUDIOBONES][3];
+	vec4_t			m_rgQ4[MAXSTUDIOBONES];
+	float			m_rgPos1b[MAXSTUDIOBONES][3];
+	vec4_t			m_rgQ1b[MAXSTUDIOBONES];
+	float			m_rgBoneLocal[MAXSTUDIOBONES][3][4];
 };
 
 #endif // STUDIOMODELRENDERER_H
@@ -404,11 +404,16 @@ int CHudAmmo::MsgFunc_AmmoX( const char *pszName, int iSize, void *pbuf )
 	int iIndex = READ_BYTE();
 	int iCount = READ_BYTE();
 
-	gWR.SetAmmo( iIndex, abs( iCount ) );
+	UpdateAmmoX( iIndex, iCount );
 
 	return 1;
 }
 
+void CHudAmmo::UpdateAmmoX( int iIndex, int iCount )
+{
+	gWR.SetAmmo( iIndex, abs( iCount ) );
+}
+
 int CHudAmmo::MsgFunc_AmmoPickup( const char *pszName, int iSize, void *pbuf )
 {
 	BEGIN_READ( pbuf, iSize );
@@ -448,19 +453,23 @@ int CHudAmmo::MsgFunc_ItemPickup( const char *pszName, int iSize, void *pbuf )
 int CHudAmmo::MsgFunc_HideWeapon( const char *pszName, int iSize, void *pbuf )
 {
 	BEGIN_READ( pbuf, iSize );
-	
-	gHUD.m_iHideHUDDisplay = READ_BYTE();
+	UpdateHideWeapon( READ_BYTE() );
+
+	return 1;
+}
+
+void CHudAmmo::UpdateHideWeapon( int iHide )
+{
+	gHUD.m_iHideHUDDisplay = iHide;
 
 	if( gEngfuncs.IsSpectateOnly() )
-		return 1;
+		return;
 
 	if( gHUD.m_iHideHUDDisplay & ( HIDEHUD_WEAPONS | HIDEHUD_ALL ) )
 	{
 		wrect_t nullrc = {0,};
 		gpActiveSel = NULL;
 	}
-
-	return 1;
 }
 
 // 
@@ -470,15 +479,20 @@ int CHudAmmo::MsgFunc_HideWeapon( const char *pszName, int iSize, void *pbuf )
 //
 int CHudAmmo::MsgFunc_CurWeapon( const char *pszName, int iSize, void *pbuf )
 {
-	wrect_t nullrc = {0,};
-	int fOnTarget = FALSE;
-
 	BEGIN_READ( pbuf, iSize );
 
 	int iState = READ_BYTE();
 	int iId = READ_CHAR();
 	int iClip = READ_CHAR();
 
+	return UpdateCurWeapon( iState, iId, iClip );
+}
+
+int CHudAmmo::UpdateCurWeapon( int iState, int iId, int iClip )
+{
+	wrect_t nullrc = {0,};
+	int fOnTarget = FALSE;
+
 	// detect if we're also on target
 	if( iState > 1 )
 	{
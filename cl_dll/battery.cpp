@@ -55,18 +55,21 @@ int CHudBattery::VidInit( void )
 
 int CHudBattery::MsgFunc_Battery( const char *pszName,  int iSize, void *pbuf )
 {
-	m_iFlags |= HUD_ACTIVE;
-
 	BEGIN_READ( pbuf, iSize );
-	int x = READ_SHORT();
+	UpdateBattery( READ_SHORT() );
+
+	return 1;
+}
+
+void CHudBattery::UpdateBattery( int x )
+{
+	m_iFlags |= HUD_ACTIVE;
 
 	if( x != m_iBat )
 	{
 		m_fFade = FADE_TIME;
 		m_iBat = x;
 	}
-
-	return 1;
 }
 
 int CHudBattery::Draw( float flTime )
@@ -44,6 +44,13 @@ extern "C"
 #include <string.h>
 #include "vcs_info.h"
 
+#include "com_model.h"
+#include "studio.h"
+#include "worker_pool.h"
+#include "studio_animcache.h"
+#include "StudioModelRenderer.h"
+#include "studio_posecache.h"
+
 cl_enginefunc_t gEngfuncs;
 CHud gHUD;
 #if USE_VGUI
@@ -252,6 +259,8 @@ so the HUD can reinitialize itself.
 int DLLEXPORT HUD_VidInit( void )
 {
 	gHUD.VidInit();
+	g_StudioAnimCache.Clear();	// tracks point into the old models
+	g_StudioPoseCache.Clear();
 #if USE_FAKE_VGUI
 	vgui::Panel* root=(vgui::Panel*)gEngfuncs.VGui_GetPanel();
 	if (root) {
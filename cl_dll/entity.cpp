@@ -19,6 +19,11 @@
 #include "pm_defs.h"
 #include "pmtrace.h"	
 #include "pm_shared.h"
+#include "com_model.h"
+#include "studio.h"
+#include "StudioModelRenderer.h"
+#include "worker_pool.h"
+#include "studio_bonejob.h"
 
 void Game_AddObjects( void );
 
@@ -70,6 +75,8 @@ int DLLEXPORT HUD_AddEntity( int type, struct cl_entity_s *ent, const char *mode
 			return 0;	// don't draw the player we are following in eye
 	}
 
+	g_StudioBoneJob.AddEntity( ent );
+
 	return 1;
 }
 
@@ -532,6 +539,9 @@ void DLLEXPORT HUD_CreateEntities( void )
 #if USE_VGUI
 	GetClientVoiceMgr()->CreateEntities();
 #endif
+
+	// everything visible is known now
+	g_StudioBoneJob.Run();
 }
 
 /*
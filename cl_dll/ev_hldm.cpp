@@ -63,6 +63,7 @@ void EV_FireShotGunDouble( struct event_args_s *args );
 void EV_FireMP5( struct event_args_s *args );
 void EV_FireMP52( struct event_args_s *args );
 void EV_FirePython( struct event_args_s *args );
+void EV_FireAwp( struct event_args_s *args );
 void EV_Crowbar( struct event_args_s *args );
 void EV_FireRpg( struct event_args_s *args );
 
@@ -771,59 +772,194 @@ void EV_FirePython( event_args_t *args )
 //======================
 
 //======================
-//	   CROWBAR START
+//	     AWP START
 //======================
-enum crowbar_e
+enum awp_e
 {
-	CROWBAR_IDLE = 0,
-	CROWBAR_DRAW,
-	CROWBAR_HOLSTER,
-	CROWBAR_ATTACK1HIT,
-	CROWBAR_ATTACK1MISS,
-	CROWBAR_ATTACK2MISS,
-	CROWBAR_ATTACK2HIT,
-	CROWBAR_ATTACK3MISS,
-#if !CROWBAR_IDLE_ANIM
-	CROWBAR_ATTACK3HIT
-#else
-	CROWBAR_ATTACK3HIT,
-	CROWBAR_IDLE2,
-	CROWBAR_IDLE3
-#endif
+	AWP_IDLE = 0,
+	AWP_SHOOT,
+	AWP_RELOAD,
+	AWP_DRAW
 };
 
-int g_iSwing;
+void EV_FireAwp( event_args_t *args )
+{
+	int idx;
+	vec3_t origin;
+	vec3_t angles;
+	vec3_t velocity;
+
+	vec3_t vecSrc, vecAiming;
+	vec3_t up, right, forward;
+
+	idx = args->entindex;
+	VectorCopy( args->origin, origin );
+	VectorCopy( args->angles, angles );
+	VectorCopy( args->velocity, velocity );
+
+	AngleVectors( angles, forward, right, up );
+
+	if( EV_IsLocal( idx ) )
+	{
+		// Add muzzle flash to current weapon model
+		EV_MuzzleFlash();
+		gEngfuncs.pEventAPI->EV_WeaponAnimation( AWP_SHOOT, 0 );
+	}
+
+	gEngfuncs.pEventAPI->EV_PlaySound( idx, origin, CHAN_WEAPON, "weapons/awp1.wav", 1, ATTN_NORM, 0, PITCH_NORM );
+
+	EV_GetGunPosition( args, vecSrc, origin );
+
+	VectorCopy( forward, vecAiming );
+
+	EV_HLDM_FireBullets( idx, forward, right, up, 1, vecSrc, vecAiming, 8192, BULLET_PLAYER_357, 0, &g_tracerCount[idx - 1], args->fparam1, args->fparam2 );
+}
+//======================
+//	      AWP END
+//======================
+
+//======================
+//	   CROWBAR START
+//	     ( knife )
+//======================
+
+// The server's swing test from CCrowbar::Swing: a line, then the head hull,
+// and against brushes the nearest corner of the duck hull.  Only the local
+// player needs it, everybody else gets the server's answer in the event.
+static void EV_HLDM_KnifeTrace( int idx, float *vecSrc, float *forward, pmtrace_t *tr )
+{
+	vec3_t vecEnd;
+
+	VectorMA( vecSrc, 32.0f, forward, vecEnd );
+
+	gEngfuncs.pEventAPI->EV_SetUpPlayerPrediction( false, true );
+
+	// Store off the old count
+	gEngfuncs.pEventAPI->EV_PushPMStates();
+
+	// Now add in all of the players.
+	gEngfuncs.pEventAPI->EV_SetSolidPlayers( idx - 1 );
+
+	gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
+	gEngfuncs.pEventAPI->EV_PlayerTrace( vecSrc, vecEnd, PM_NORMAL, -1, tr );
+
+	if( tr->fraction >= 1.0f )
+	{
+		// pmove hull 1 is the ducked player, the engine's head_hull
+		gEngfuncs.pEventAPI->EV_SetTraceHull( 1 );
+		gEngfuncs.pEventAPI->EV_PlayerTrace( vecSrc, vecEnd, PM_NORMAL, -1, tr );
 
-//Only predict the miss sounds, hit sounds are still played 
-//server side, so players don't get the wrong idea.
+		physent_t *pe = tr->fraction < 1.0f ? gEngfuncs.pEventAPI->EV_GetPhysent( tr->ent ) : NULL;
+
+		if( tr->fraction < 1.0f && ( !pe || pe->solid == SOLID_BSP ))
+		{
+			static const float mins[3] = { -16.0f, -16.0f, -18.0f };
+			static const float maxs[3] = { 16.0f, 16.0f, 18.0f };
+			const float *minmaxs[2] = { mins, maxs };
+			vec3_t vecHullEnd, vecCorner;
+			pmtrace_t tmp;
+			float distance = 1e6f;
+
+			for( int i = 0; i < 3; i++ )
+				vecHullEnd[i] = vecSrc[i] + ( tr->endpos[i] - vecSrc[i] ) * 2.0f;
+
+			gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
+			gEngfuncs.pEventAPI->EV_PlayerTrace( vecSrc, vecHullEnd, PM_NORMAL, -1, &tmp );
+
+			if( tmp.fraction < 1.0f )
+			{
+				*tr = tmp;
+			}
+			else
+			{
+				for( int i = 0; i < 8; i++ )
+				{
+					vecCorner[0] = vecHullEnd[0] + minmaxs[i & 1][0];
+					vecCorner[1] = vecHullEnd[1] + minmaxs[( i >> 1 ) & 1][1];
+					vecCorner[2] = vecHullEnd[2] + minmaxs[( i >> 2 ) & 1][2];
+
+					gEngfuncs.pEventAPI->EV_PlayerTrace( vecSrc, vecCorner, PM_NORMAL, -1, &tmp );
+
+					if( tmp.fraction < 1.0f )
+					{
+						vec3_t delta;
+
+						VectorSubtract( tmp.endpos, vecSrc, delta );
+
+						if( Length( delta ) < distance )
+						{
+							*tr = tmp;
+							distance = Length( delta );
+						}
+					}
+				}
+			}
+		}
+	}
+
+	gEngfuncs.pEventAPI->EV_PopPMStates();
+}
+
+//Only predict the world hit sounds, body hit sounds are still played
+//server side, so players don't get the wrong idea.  The swing animations
+//are already predicted by the weapon code.
 void EV_Crowbar( event_args_t *args )
 {
 	int idx;
 	vec3_t origin;
-	//vec3_t angles;
-	//vec3_t velocity;
+	vec3_t angles;
+	vec3_t forward, right, up;
+	vec3_t vecSrc;
+	pmtrace_t tr;
+	float fvolbar;
 
 	idx = args->entindex;
 	VectorCopy( args->origin, origin );
-	
-	//Play Swing sound
-	gEngfuncs.pEventAPI->EV_PlaySound( idx, origin, CHAN_WEAPON, "weapons/cbar_miss1.wav", 1, ATTN_NORM, 0, PITCH_NORM ); 
+	VectorCopy( args->angles, angles );
+
+	fvolbar = 1.0f;
 
 	if( EV_IsLocal( idx ) )
 	{
-		switch( (g_iSwing++) % 3 )
+		// predicted swing, the server's answer never reaches us
+		AngleVectors( angles, forward, right, up );
+		EV_GetGunPosition( args, vecSrc, origin );
+		EV_HLDM_KnifeTrace( idx, vecSrc, forward, &tr );
+
+		if( tr.fraction >= 1.0f )
+			return;
+
+		physent_t *pe = gEngfuncs.pEventAPI->EV_GetPhysent( tr.ent );
+
+		if( !pe || ( pe->solid != SOLID_BSP && pe->movetype != MOVETYPE_PUSHSTEP ))
+			return;
+
+		// we don't play texture sounds in multiplayer
+		if( gEngfuncs.GetMaxClients() == 1 )
 		{
-			case 0:
-				gEngfuncs.pEventAPI->EV_WeaponAnimation( CROWBAR_ATTACK1MISS, 0 );
-				break;
-			case 1:
-				gEngfuncs.pEventAPI->EV_WeaponAnimation( CROWBAR_ATTACK2MISS, 0 );
-				break;
-			case 2:
-				gEngfuncs.pEventAPI->EV_WeaponAnimation( CROWBAR_ATTACK3MISS, 0 );
-				break;
+			vec3_t vecTexEnd;
+
+			VectorSubtract( tr.endpos, vecSrc, vecTexEnd );
+			VectorMA( vecSrc, 2.0f, vecTexEnd, vecTexEnd );
+			fvolbar = EV_HLDM_PlayTextureSound( idx, &tr, vecSrc, vecTexEnd, BULLET_PLAYER_CROWBAR );
 		}
 	}
+	else if( !args->bparam1 )
+	{
+		// the server's hit test says this swing didn't hit the world
+		return;
+	}
+
+	// also play crowbar strike
+	switch( gEngfuncs.pfnRandomLong( 0, 1 ) )
+	{
+	case 0:
+		gEngfuncs.pEventAPI->EV_PlaySound( idx, origin, CHAN_ITEM, "weapons/cbar_hit1.wav", fvolbar, ATTN_NORM, 0, 98 + gEngfuncs.pfnRandomLong( 0, 3 ) );
+		break;
+	case 1:
+		gEngfuncs.pEventAPI->EV_PlaySound( idx, origin, CHAN_ITEM, "weapons/cbar_hit2.wav", fvolbar, ATTN_NORM, 0, 98 + gEngfuncs.pfnRandomLong( 0, 3 ) );
+		break;
+	}
 }
 //======================
 //	   CROWBAR END 
@@ -83,14 +83,19 @@ int CHudFlashlight::MsgFunc_FlashBat( const char *pszName,  int iSize, void *pbu
 int CHudFlashlight::MsgFunc_Flashlight( const char *pszName,  int iSize, void *pbuf )
 {
 	BEGIN_READ( pbuf, iSize );
-	m_fOn = READ_BYTE();
-	int x = READ_BYTE();
-	m_iBat = x;
-	m_flBat = ( (float)x ) / 100.0f;
+	int on = READ_BYTE();
+	UpdateFlashlight( on, READ_BYTE() );
 
 	return 1;
 }
 
+void CHudFlashlight::UpdateFlashlight( int on, int x )
+{
+	m_fOn = on;
+	m_iBat = x;
+	m_flBat = ( (float)x ) / 100.0f;
+}
+
 int CHudFlashlight::Draw( float flTime )
 {
 	static bool show = ( gHUD.m_iHideHUDDisplay & ( HIDEHUD_FLASHLIGHT | HIDEHUD_ALL ) );
@@ -113,8 +113,13 @@ int CHudHealth::MsgFunc_Health( const char *pszName, int iSize, void *pbuf )
 {
 	// TODO: update local health data
 	BEGIN_READ( pbuf, iSize );
-	int x = READ_BYTE();
+	UpdateHealth( READ_BYTE() );
 
+	return 1;
+}
+
+void CHudHealth::UpdateHealth( int x )
+{
 	m_iFlags |= HUD_ACTIVE;
 
 	// Only update the fade if we've changed health
@@ -123,8 +128,6 @@ int CHudHealth::MsgFunc_Health( const char *pszName, int iSize, void *pbuf )
 		m_fFade = FADE_TIME;
 		m_iHealth = x;
 	}
-
-	return 1;
 }
 
 int CHudHealth::MsgFunc_Damage( const char *pszName, int iSize, void *pbuf )
@@ -140,6 +143,13 @@ int CHudHealth::MsgFunc_Damage( const char *pszName, int iSize, void *pbuf )
 	for( int i = 0; i < 3; i++ )
 		vecFrom[i] = READ_COORD();
 
+	UpdateDamage( armor, damageTaken, bitsDamage, vecFrom );
+
+	return 1;
+}
+
+void CHudHealth::UpdateDamage( int armor, int damageTaken, long bitsDamage, vec3_t vecFrom )
+{
 	UpdateTiles( gHUD.m_flTime, bitsDamage );
 
 	// Actually took damage?
@@ -156,8 +166,6 @@ int CHudHealth::MsgFunc_Damage( const char *pszName, int iSize, void *pbuf )
 			gMobileEngfuncs->pfnVibrate( time, 0 );
                 }
 	}
-
-	return 1;
 }
 
 // Returns back a color from the
@@ -107,6 +107,8 @@ public:
 	virtual void Reset( void );
 	int MsgFunc_Health( const char *pszName,  int iSize, void *pbuf );
 	int MsgFunc_Damage( const char *pszName,  int iSize, void *pbuf );
+	void UpdateHealth( int x );
+	void UpdateDamage( int armor, int damageTaken, long bitsDamage, vec3_t vecFrom );
 	void TriggerHealFlash( float duration );
 	int m_iHealth;
 	int m_HUD_dmg_bio;
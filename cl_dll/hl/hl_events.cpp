@@ -27,6 +27,7 @@ void EV_FireShotGunDouble( struct event_args_s *args  );
 void EV_FireMP5( struct event_args_s *args  );
 void EV_FireMP52( struct event_args_s *args  );
 void EV_FirePython( struct event_args_s *args  );
+void EV_FireAwp( struct event_args_s *args );
 void EV_Crowbar( struct event_args_s *args );
 void EV_FireRpg( struct event_args_s *args );
 
@@ -56,6 +57,7 @@ void Game_HookEvents( void )
 	gEngfuncs.pfnHookEvent( "events/mp5.sc", EV_FireMP5 );
 	gEngfuncs.pfnHookEvent( "events/mp52.sc", EV_FireMP52 );
 	gEngfuncs.pfnHookEvent( "events/python.sc", EV_FirePython );
+	gEngfuncs.pfnHookEvent( "events/awp.sc", EV_FireAwp );
 	gEngfuncs.pfnHookEvent( "events/train.sc", EV_TrainPitchAdjust );
 	gEngfuncs.pfnHookEvent( "events/crowbar.sc", EV_Crowbar );
 	gEngfuncs.pfnHookEvent( "events/rpg.sc", EV_FireRpg );
@@ -138,6 +138,11 @@ int __MsgFunc_GameMode( const char *pszName, int iSize, void *pbuf )
 	return gHUD.MsgFunc_GameMode( pszName, iSize, pbuf );
 }
 
+int __MsgFunc_PlayerState( const char *pszName, int iSize, void *pbuf )
+{
+	return gHUD.MsgFunc_PlayerState( pszName, iSize, pbuf );
+}
+
 // TFFree Command Menu
 void __CmdFunc_OpenCommandMenu( void )
 {
@@ -330,6 +335,7 @@ void CHud::Init( void )
 	HOOK_MESSAGE( ViewMode );
 	HOOK_MESSAGE( SetFOV );
 	HOOK_MESSAGE( Concuss );
+	HOOK_MESSAGE( PlayerState );
 
 	// TFFree CommandMenu
 	HOOK_COMMAND( "+commandmenu", OpenCommandMenu );
@@ -375,6 +381,7 @@ void CHud::Init( void )
 
 	CVAR_CREATE( "zoom_sensitivity_ratio", "1.2", FCVAR_ARCHIVE );
 	CVAR_CREATE( "cl_autowepswitch", "1", FCVAR_ARCHIVE | FCVAR_USERINFO );
+	CVAR_CREATE( "cl_playerstate", "1", FCVAR_USERINFO );	// PLAYERSTATE_VERSION we decode, tells the server to send PlayerState
 	default_fov = CVAR_CREATE( "default_fov", "90", FCVAR_ARCHIVE );
 	m_pCvarStealMouse = CVAR_CREATE( "hud_capturemouse", "1", FCVAR_ARCHIVE );
 	m_pCvarDraw = CVAR_CREATE( "hud_draw", "1", FCVAR_ARCHIVE );
@@ -732,8 +739,13 @@ float HUD_GetFOV( void )
 int CHud::MsgFunc_SetFOV( const char *pszName,  int iSize, void *pbuf )
 {
 	BEGIN_READ( pbuf, iSize );
+	UpdateFOV( READ_BYTE() );
 
-	int newfov = READ_BYTE();
+	return 1;
+}
+
+void CHud::UpdateFOV( int newfov )
+{
 	int def_fov = CVAR_GET_FLOAT( "default_fov" );
 
 	g_lastFOV = newfov;
@@ -760,8 +772,6 @@ int CHud::MsgFunc_SetFOV( const char *pszName,  int iSize, void *pbuf )
 		// set a new sensitivity that is proportional to the change from the FOV default
 		m_flMouseSensitivity = sensitivity->value * ((float)newfov / (float)def_fov) * CVAR_GET_FLOAT("zoom_sensitivity_ratio");
 	}
-
-	return 1;
 }
 
 void CHud::AddHudElem( CHudBase *phudelem )
@@ -117,6 +117,9 @@ public:
 	int MsgFunc_WeapPickup( const char *pszName, int iSize, void *pbuf );
 	int MsgFunc_ItemPickup( const char *pszName, int iSize, void *pbuf );
 	int MsgFunc_HideWeapon( const char *pszName, int iSize, void *pbuf );
+	int UpdateCurWeapon( int iState, int iId, int iClip );
+	void UpdateAmmoX( int iIndex, int iCount );
+	void UpdateHideWeapon( int iHide );
 
 	void SlotInput( int iSlot );
 	void _cdecl UserCmd_Slot1( void );
@@ -384,6 +387,7 @@ public:
 	int VidInit( void );
 	int Draw( float flTime );
 	int MsgFunc_Battery( const char *pszName,  int iSize, void *pbuf );
+	void UpdateBattery( int x );
 	
 private:
 	HSPRITE m_hSprite1;
@@ -407,6 +411,7 @@ public:
 	void Reset( void );
 	int MsgFunc_Flashlight( const char *pszName,  int iSize, void *pbuf );
 	int MsgFunc_FlashBat( const char *pszName,  int iSize, void *pbuf );
+	void UpdateFlashlight( int on, int x );
 
 private:
 	HSPRITE m_hSprite1;
@@ -639,6 +644,9 @@ public:
 	void _cdecl MsgFunc_ViewMode( const char *pszName, int iSize, void *pbuf );
 	int _cdecl MsgFunc_SetFOV( const char *pszName,  int iSize, void *pbuf );
 	int  _cdecl MsgFunc_Concuss( const char *pszName, int iSize, void *pbuf );
+	int _cdecl MsgFunc_PlayerState( const char *pszName, int iSize, void *pbuf );
+
+	void UpdateFOV( int newfov );
 
 	// Screen information
 	SCREENINFO	m_scrinfo;
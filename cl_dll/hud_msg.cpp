@@ -124,3 +124,146 @@ int CHud::MsgFunc_Concuss( const char *pszName, int iSize, void *pbuf )
 		this->m_StatusIcons.DisableIcon( "dmg_concuss" );
 	return 1;
 }
+
+static int s_iStateBits;
+static int s_iStateNumBits;
+static int s_fStateBadRead;
+
+static unsigned int READ_STATE_BITS( int bits )
+{
+	unsigned int value = 0;
+
+	for( int i = 0; i < bits; i++ )
+	{
+		if( !s_iStateNumBits )
+		{
+			s_iStateBits = READ_BYTE();
+			s_iStateNumBits = 8;
+
+			if( s_iStateBits < 0 )
+			{
+				s_fStateBadRead = true;
+				s_iStateBits = 0;
+			}
+		}
+
+		value |= (unsigned int)( s_iStateBits & 1 ) << i;
+		s_iStateBits >>= 1;
+		s_iStateNumBits--;
+	}
+
+	return value;
+}
+
+// sign extends a field read with READ_STATE_BITS
+static int SignedStateBits( unsigned int value, int bits )
+{
+	return (int)( value << ( 32 - bits )) >> ( 32 - bits );
+}
+
+//
+// PlayerState: the HUD values that changed in a server frame, bit packed
+// behind a PS_ dirty mask.  Applied in the order the old messages came in.
+//
+int CHud::MsgFunc_PlayerState( const char *pszName, int iSize, void *pbuf )
+{
+	int i, hide = 0, fov = 0, health = 0, battery = 0;
+	int dmgSave = 0, dmgTake = 0, dmgBits = 0;
+	int flashOn = 0, flashBat = 0;
+	int numAmmo = 0, numWeapons = 0;
+	int ammo[MAX_AMMO_SLOTS][2];
+	int weapons[MAX_WEAPONS][3];
+	vec3_t dmgFrom;
+
+	BEGIN_READ( pbuf, iSize );
+
+	// the server only sends our own version, anything else can't be read
+	if( READ_BYTE() != PLAYERSTATE_VERSION )
+		return 0;
+
+	s_iStateBits = 0;
+	s_iStateNumBits = 0;
+	s_fStateBadRead = false;
+
+	int dirty = READ_STATE_BITS( PS_NUM_FIELDS );
+
+	if( dirty & PS_HIDEHUD )
+		hide = READ_STATE_BITS( PS_BITS_BYTE );
+
+	if( dirty & PS_FOV )
+		fov = READ_STATE_BITS( PS_BITS_BYTE );
+
+	if( dirty & PS_HEALTH )
+		health = READ_STATE_BITS( PS_BITS_BYTE );
+
+	if( dirty & PS_BATTERY )
+		battery = SignedStateBits( READ_STATE_BITS( PS_BITS_BATTERY ), PS_BITS_BATTERY );
+
+	if( dirty & PS_DAMAGE )
+	{
+		dmgSave = READ_STATE_BITS( PS_BITS_BYTE );
+		dmgTake = READ_STATE_BITS( PS_BITS_BYTE );
+		dmgBits = READ_STATE_BITS( PS_BITS_DMGTYPE );
+
+		for( i = 0; i < 3; i++ )
+			dmgFrom[i] = SignedStateBits( READ_STATE_BITS( PS_BITS_COORD ), PS_BITS_COORD );
+	}
+
+	if( dirty & PS_FLASHLIGHT )
+	{
+		flashOn = READ_STATE_BITS( 1 );
+		flashBat = READ_STATE_BITS( PS_BITS_FLASHBAT );
+	}
+
+	if( dirty & PS_AMMO )
+	{
+		numAmmo = Q_min( (int)READ_STATE_BITS( PS_BITS_COUNT ), MAX_AMMO_SLOTS );
+
+		for( i = 0; i < numAmmo; i++ )
+		{
+			ammo[i][0] = READ_STATE_BITS( PS_BITS_INDEX );
+			ammo[i][1] = READ_STATE_BITS( PS_BITS_BYTE );
+		}
+	}
+
+	if( dirty & PS_WEAPONS )
+	{
+		numWeapons = Q_min( (int)READ_STATE_BITS( PS_BITS_COUNT ), MAX_WEAPONS );
+
+		for( i = 0; i < numWeapons; i++ )
+		{
+			weapons[i][0] = READ_STATE_BITS( PS_BITS_WEAPONSTATE );
+			weapons[i][1] = READ_STATE_BITS( PS_BITS_INDEX );
+			weapons[i][2] = SignedStateBits( READ_STATE_BITS( PS_BITS_BYTE ), PS_BITS_BYTE );
+		}
+	}
+
+	if( s_fStateBadRead )
+		return 0;
+
+	if( dirty & PS_HIDEHUD )
+		m_Ammo.UpdateHideWeapon( hide );
+
+	if( dirty & PS_FOV )
+		UpdateFOV( fov );
+
+	if( dirty & PS_HEALTH )
+		m_Health.UpdateHealth( health );
+
+	if( dirty & PS_BATTERY )
+		m_Battery.UpdateBattery( battery );
+
+	if( dirty & PS_DAMAGE )
+		m_Health.UpdateDamage( dmgSave, dmgTake, dmgBits, dmgFrom );
+
+	if( dirty & PS_FLASHLIGHT )
+		m_Flash.UpdateFlashlight( flashOn, flashBat );
+
+	for( i = 0; i < numAmmo; i++ )
+		m_Ammo.UpdateAmmoX( ammo[i][0], ammo[i][1] );
+
+	for( i = 0; i < numWeapons; i++ )
+		m_Ammo.UpdateCurWeapon( weapons[i][0], weapons[i][1], weapons[i][2] );
+
+	return 1;
+}
@@ -49,6 +49,7 @@ extern cl_enginefunc_t gEngfuncs;
 extern "C" float anglemod( float a );
 
 void IN_Init( void );
+void R_StudioShutdown( void );
 void IN_Move( float frametime, usercmd_t *cmd );
 void IN_Shutdown( void );
 void V_Init( void );
@@ -1187,4 +1188,5 @@ void ShutdownInput( void )
 void DLLEXPORT HUD_Shutdown( void )
 {
 	ShutdownInput();
+	R_StudioShutdown();
 }
@@ -0,0 +1,433 @@
+//========= Copyright (c) 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Decoded animation frames shared by every entity using a sequence
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "studio_util.h"
+#include "worker_pool.h"
+#include "studio_animcache.h"
+
+// floats per bone in a frame: two quaternions and two positions
+#define ANIMCACHE_BONE_FLOATS	14
+
+CStudioAnimCache g_StudioAnimCache;
+
+static void AnimCacheStats_f( void )
+{
+	g_StudioAnimCache.PrintStats();
+}
+
+/*
+====================
+AnimCache_FindSpan
+
+Same walk as StudioCalcBoneQuaterion and StudioCalcBonePosition,
+returns the span holding the frame and the frame within it in *pk
+====================
+*/
+static mstudioanimvalue_t *AnimCache_FindSpan( mstudioanimvalue_t *panimvalue, int frame, int *pk )
+{
+	int k = frame;
+
+	// DEBUG
+	if( panimvalue->num.total < panimvalue->num.valid )
+		k = 0;
+
+	while( panimvalue->num.total <= k )
+	{
+		k -= panimvalue->num.total;
+		panimvalue += panimvalue->num.valid + 1;
+		// DEBUG
+		if( panimvalue->num.total < panimvalue->num.valid )
+			k = 0;
+	}
+
+	*pk = k;
+	return panimvalue;
+}
+
+/*
+====================
+AnimCache_RotationValues
+
+Raw values at the frame and the next one, like StudioCalcBoneQuaterion
+====================
+*/
+static void AnimCache_RotationValues( mstudioanimvalue_t *panimvalue, int frame, float *v1, float *v2 )
+{
+	int k;
+
+	panimvalue = AnimCache_FindSpan( panimvalue, frame, &k );
+
+	if( panimvalue->num.valid > k )
+	{
+		*v1 = panimvalue[k + 1].value;
+
+		if( panimvalue->num.valid > k + 1 )
+			*v2 = panimvalue[k + 2].value;
+		else if( panimvalue->num.total > k + 1 )
+			*v2 = *v1;
+		else
+			*v2 = panimvalue[panimvalue->num.valid + 2].value;
+	}
+	else
+	{
+		*v1 = panimvalue[panimvalue->num.valid].value;
+
+		if( panimvalue->num.total > k + 1 )
+			*v2 = *v1;
+		else
+			*v2 = panimvalue[panimvalue->num.valid + 2].value;
+	}
+}
+
+/*
+====================
+AnimCache_PositionValues
+
+Raw values at the frame and the next one, like StudioCalcBonePosition.
+That never lerps from the last valid value of a span into the next
+span, so neither does this.
+====================
+*/
+static void AnimCache_PositionValues( mstudioanimvalue_t *panimvalue, int frame, float *v1, float *v2 )
+{
+	int k;
+
+	panimvalue = AnimCache_FindSpan( panimvalue, frame, &k );
+
+	if( panimvalue->num.valid > k )
+	{
+		*v1 = panimvalue[k + 1].value;
+
+		if( panimvalue->num.valid > k + 1 )
+			*v2 = panimvalue[k + 2].value;
+		else
+			*v2 = *v1;
+	}
+	else
+	{
+		*v1 = panimvalue[panimvalue->num.valid].value;
+
+		if( panimvalue->num.total <= k + 1 )
+			*v2 = panimvalue[panimvalue->num.valid + 2].value;
+		else
+			*v2 = *v1;
+	}
+}
+
+CStudioAnimCache::CStudioAnimCache( void )
+{
+	memset( m_pHash, 0, sizeof( m_pHash ) );
+	m_pHead = m_pTail = NULL;
+	m_iNumTracks = m_iBytes = 0;
+	m_iHold = 0;
+	m_iHits = m_iMisses = m_iEvictions = m_iUncached = 0;
+	m_pCvarEnable = m_pCvarBudget = NULL;
+}
+
+void CStudioAnimCache::Init( void )
+{
+	m_pCvarEnable = CVAR_CREATE( "cl_animcache", "1", FCVAR_ARCHIVE );
+	m_pCvarBudget = CVAR_CREATE( "cl_animcache_mb", "16", FCVAR_ARCHIVE );	// megabytes of decoded frames
+
+	gEngfuncs.pfnAddCommand( "cl_animcache_stats", AnimCacheStats_f );
+}
+
+void CStudioAnimCache::Clear( void )
+{
+	while( m_pHead )
+	{
+		animtrack_t *pTrack = m_pHead;
+
+		Unlink( pTrack );
+		free( pTrack );
+	}
+
+	memset( m_pHash, 0, sizeof( m_pHash ) );
+	m_iNumTracks = m_iBytes = 0;
+	m_iHits = m_iMisses = m_iEvictions = m_iUncached = 0;
+}
+
+static inline int AnimCache_Hash( mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim )
+{
+	return (int)( ( ( (size_t)pseqdesc >> 4 ) ^ ( (size_t)panim >> 4 ) ) % ANIMCACHE_HASH_SIZE );
+}
+
+int CStudioAnimCache::Lookup( studiohdr_t *pstudiohdr, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, int frame, animframe_t *pframe )
+{
+	animtrack_t *pTrack;
+	int budget, size, hash;
+
+	if( !m_pCvarEnable || m_pCvarEnable->value <= 0.0f )
+		return FALSE;
+
+	if( pseqdesc->numframes < 1 || frame < 0 || frame >= pseqdesc->numframes )
+		return FALSE;
+
+	budget = Budget();
+
+	m_Lock.Lock();
+
+	// the budget went down
+	if( m_iBytes > budget && !m_iHold )
+		Evict( budget );
+
+	hash = AnimCache_Hash( pseqdesc, panim );
+
+	for( pTrack = m_pHash[hash]; pTrack; pTrack = pTrack->pHashNext )
+	{
+		if( pTrack->pseqdesc == pseqdesc && pTrack->panim == panim )
+			break;
+	}
+
+	if( pTrack && pTrack->numbones == pstudiohdr->numbones && pTrack->numframes == pseqdesc->numframes )
+	{
+		m_iHits++;
+
+		if( pTrack != m_pHead )
+		{
+			Unlink( pTrack );
+			LinkHead( pTrack );
+		}
+	}
+	else
+	{
+		m_iMisses++;
+
+		if( pTrack )
+		{
+			if( m_iHold )
+			{
+				// another thread may still be reading it
+				m_Lock.Unlock();
+				return FALSE;
+			}
+
+			// same address, different model
+			Free( pTrack );
+		}
+
+		size = sizeof( animtrack_t ) + pseqdesc->numframes * pstudiohdr->numbones * ANIMCACHE_BONE_FLOATS * sizeof( float );
+
+		if( size > budget )
+		{
+			m_iUncached++;
+			m_Lock.Unlock();
+			return FALSE;
+		}
+
+		if( !m_iHold )
+			Evict( budget - size );
+
+		pTrack = Decode( pstudiohdr, pseqdesc, panim );
+		if( !pTrack )
+		{
+			m_Lock.Unlock();
+			return FALSE;
+		}
+
+		pTrack->pHashNext = m_pHash[hash];
+		m_pHash[hash] = pTrack;
+		LinkHead( pTrack );
+
+		m_iNumTracks++;
+		m_iBytes += pTrack->size;
+	}
+
+	int numbones = pTrack->numbones;
+	float *block = pTrack->data + frame * numbones * ANIMCACHE_BONE_FLOATS;
+
+	pframe->q1 = (vec4_t *)block;
+	pframe->q2 = (vec4_t *)( block + numbones * 4 );
+	pframe->pos1[0] = block + numbones * 8;
+	pframe->pos1[1] = block + numbones * 9;
+	pframe->pos1[2] = block + numbones * 10;
+	pframe->pos2[0] = block + numbones * 11;
+	pframe->pos2[1] = block + numbones * 12;
+	pframe->pos2[2] = block + numbones * 13;
+
+	m_Lock.Unlock();
+
+	return TRUE;
+}
+
+void CStudioAnimCache::Hold( int hold )
+{
+	m_iHold = hold;
+
+	if( !hold && m_pCvarBudget )
+	{
+		Evict( Budget() );
+	}
+}
+
+/*
+====================
+Decode
+
+Runs the decoding of StudioCalcBoneQuaterion and StudioCalcBonePosition
+once for every frame of the blend, without bone controllers
+====================
+*/
+animtrack_t *CStudioAnimCache::Decode( studiohdr_t *pstudiohdr, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim )
+{
+	animtrack_t *pTrack;
+	mstudiobone_t *pbones;
+	int numbones = pstudiohdr->numbones;
+	int numframes = pseqdesc->numframes;
+	int size, frame, i, j;
+
+	size = sizeof( animtrack_t ) + numframes * numbones * ANIMCACHE_BONE_FLOATS * sizeof( float );
+
+	pTrack = (animtrack_t *)malloc( size );
+	if( !pTrack )
+		return NULL;
+
+	pTrack->pseqdesc = pseqdesc;
+	pTrack->panim = panim;
+	pTrack->numbones = numbones;
+	pTrack->numframes = numframes;
+	pTrack->size = size;
+	pTrack->data = (float *)( pTrack + 1 );
+	pTrack->pHashNext = pTrack->pPrev = pTrack->pNext = NULL;
+
+	pbones = (mstudiobone_t *)( (byte *)pstudiohdr + pstudiohdr->boneindex );
+
+	for( frame = 0; frame < numframes; frame++ )
+	{
+		float *block = pTrack->data + frame * numbones * ANIMCACHE_BONE_FLOATS;
+		vec4_t *q1 = (vec4_t *)block;
+		vec4_t *q2 = (vec4_t *)( block + numbones * 4 );
+		float *pos1 = block + numbones * 8;
+		float *pos2 = block + numbones * 11;
+
+		for( i = 0; i < numbones; i++ )
+		{
+			mstudiobone_t *pbone = &pbones[i];
+			mstudioanim_t *pboneanim = &panim[i];
+			vec3_t angle1, angle2;
+
+			for( j = 0; j < 3; j++ )
+			{
+				if( pboneanim->offset[j + 3] == 0 )
+				{
+					angle2[j] = angle1[j] = pbone->value[j + 3]; // default;
+				}
+				else
+				{
+					AnimCache_RotationValues( (mstudioanimvalue_t *)( (byte *)pboneanim + pboneanim->offset[j + 3] ), frame, &angle1[j], &angle2[j] );
+					angle1[j] = pbone->value[j + 3] + angle1[j] * pbone->scale[j + 3];
+					angle2[j] = pbone->value[j + 3] + angle2[j] * pbone->scale[j + 3];
+				}
+
+				if( pboneanim->offset[j] == 0 )
+				{
+					pos1[j * numbones + i] = pos2[j * numbones + i] = 0.0f;
+				}
+				else
+				{
+					AnimCache_PositionValues( (mstudioanimvalue_t *)( (byte *)pboneanim + pboneanim->offset[j] ), frame, &pos1[j * numbones + i], &pos2[j * numbones + i] );
+				}
+			}
+
+			AngleQuaternion( angle1, q1[i] );
+
+			if( !VectorCompare( angle1, angle2 ) )
+				AngleQuaternion( angle2, q2[i] );
+			else
+				memcpy( q2[i], q1[i], sizeof( vec4_t ) );
+		}
+	}
+
+	return pTrack;
+}
+
+void CStudioAnimCache::Free( animtrack_t *pTrack )
+{
+	animtrack_t **ppLink = &m_pHash[AnimCache_Hash( pTrack->pseqdesc, pTrack->panim )];
+
+	while( *ppLink != pTrack )
+		ppLink = &( *ppLink )->pHashNext;
+	*ppLink = pTrack->pHashNext;
+
+	Unlink( pTrack );
+
+	m_iNumTracks--;
+	m_iBytes -= pTrack->size;
+	free( pTrack );
+}
+
+// cl_animcache_mb in bytes
+int CStudioAnimCache::Budget( void )
+{
+	float mb = m_pCvarBudget->value;
+
+	if( !( mb > 0.0f ))
+		return 0;
+
+	if( mb > ANIMCACHE_MAX_MB )
+		mb = ANIMCACHE_MAX_MB;
+
+	return (int)( mb * 1024.0f * 1024.0f );
+}
+
+// drops least recently used tracks until at most budget bytes are left
+void CStudioAnimCache::Evict( int budget )
+{
+	while( m_pTail && m_iBytes > budget )
+	{
+		Free( m_pTail );
+		m_iEvictions++;
+	}
+}
+
+void CStudioAnimCache::Unlink( animtrack_t *pTrack )
+{
+	if( pTrack->pPrev )
+		pTrack->pPrev->pNext = pTrack->pNext;
+	else
+		m_pHead = pTrack->pNext;
+
+	if( pTrack->pNext )
+		pTrack->pNext->pPrev = pTrack->pPrev;
+	else
+		m_pTail = pTrack->pPrev;
+
+	pTrack->pPrev = pTrack->pNext = NULL;
+}
+
+void CStudioAnimCache::LinkHead( animtrack_t *pTrack )
+{
+	pTrack->pPrev = NULL;
+	pTrack->pNext = m_pHead;
+
+	if( m_pHead )
+		m_pHead->pPrev = pTrack;
+	else
+		m_pTail = pTrack;
+
+	m_pHead = pTrack;
+}
+
+void CStudioAnimCache::PrintStats( void )
+{
+	int lookups = m_iHits + m_iMisses;
+
+	gEngfuncs.Con_Printf( "animation cache: %s, %d tracks, %.2f of %.2f MB\n",
+		( m_pCvarEnable && m_pCvarEnable->value > 0.0f ) ? "on" : "off",
+		m_iNumTracks, m_iBytes / ( 1024.0f * 1024.0f ), m_pCvarBudget ? m_pCvarBudget->value : 0.0f );
+	gEngfuncs.Con_Printf( "%d lookups since level start, %d hits (%.1f%%), %d misses, %d evictions, %d over budget\n",
+		lookups, m_iHits, lookups ? m_iHits * 100.0f / lookups : 0.0f, m_iMisses, m_iEvictions, m_iUncached );
+}
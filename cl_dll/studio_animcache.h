@@ -0,0 +1,100 @@
+//========= Copyright (c) 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Decoded animation frames shared by every entity using a sequence
+//
+// $NoKeywords: $
+//=============================================================================
+#pragma once
+#if !defined( STUDIO_ANIMCACHE_H )
+#define STUDIO_ANIMCACHE_H
+
+#define ANIMCACHE_HASH_SIZE	256
+#define ANIMCACHE_MAX_MB	2047	// the byte counts are ints
+
+// One frame of a decoded track, each array has numbones entries.
+// Rotations are the quaternions at the frame and at the next one,
+// without bone controllers.  Positions are the raw animation values
+// per axis, still to be scaled by the bone like StudioCalcBonePosition does.
+typedef struct animframe_s
+{
+	vec4_t	*q1;
+	vec4_t	*q2;
+	float	*pos1[3];
+	float	*pos2[3];
+} animframe_t;
+
+typedef struct animtrack_s
+{
+	mstudioseqdesc_t	*pseqdesc;	// key, together with panim
+	mstudioanim_t		*panim;		// first bone of the blend
+
+	int			numbones;
+	int			numframes;
+	int			size;		// bytes, data included
+	float			*data;		// numframes blocks of 14 * numbones floats
+
+	struct animtrack_s	*pHashNext;
+	struct animtrack_s	*pPrev;		// LRU list, most recently used first
+	struct animtrack_s	*pNext;
+} animtrack_t;
+
+/*
+====================
+CStudioAnimCache
+
+Bounded LRU cache of run-length decoded animation tracks, one track
+per sequence blend of a model.  The first entity to use a blend pays
+for decoding every frame of it, everyone after that only lerps two
+cached frames.  Tracks point into model data, so the cache is flushed
+on every level change.
+====================
+*/
+class CStudioAnimCache
+{
+public:
+	CStudioAnimCache( void );
+
+	void Init( void );
+	void Clear( void );
+
+	// FALSE when the cache is disabled or the track does not fit in the budget.
+	// Safe from any thread, the frame stays valid until the next Lookup
+	// on the main thread, or until Hold( FALSE ) while held.
+	int Lookup( studiohdr_t *pstudiohdr, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, int frame, animframe_t *pframe );
+
+	// while held nothing is freed, the budget is caught up on release
+	void Hold( int hold );
+
+	void PrintStats( void );
+
+private:
+	animtrack_t *Decode( studiohdr_t *pstudiohdr, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim );
+	void Free( animtrack_t *pTrack );
+	int Budget( void );
+	void Evict( int budget );
+
+	void Unlink( animtrack_t *pTrack );
+	void LinkHead( animtrack_t *pTrack );
+
+	animtrack_t	*m_pHash[ANIMCACHE_HASH_SIZE];
+	animtrack_t	*m_pHead;
+	animtrack_t	*m_pTail;
+
+	int		m_iNumTracks;
+	int		m_iBytes;
+
+	CWorkerMutex	m_Lock;
+	int		m_iHold;
+
+	// since the last level change
+	int		m_iHits;
+	int		m_iMisses;
+	int		m_iEvictions;
+	int		m_iUncached;	// tracks bigger than the whole budget
+
+	struct cvar_s	*m_pCvarEnable;
+	struct cvar_s	*m_pCvarBudget;
+};
+
+extern CStudioAnimCache g_StudioAnimCache;
+#endif // STUDIO_ANIMCACHE_H
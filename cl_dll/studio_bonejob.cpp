@@ -0,0 +1,186 @@
+//========= Copyright (c) 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Bone setup for the visible studio entities ahead of drawing
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+#include "entity_state.h"
+#include "cl_entity.h"
+#include "dlight.h"
+#include "triangleapi.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "studio_util.h"
+#include "worker_pool.h"
+#include "studio_animcache.h"
+#include "r_studioint.h"
+
+#include "StudioModelRenderer.h"
+#include "studio_bonejob.h"
+
+CStudioBoneJob g_StudioBoneJob;
+
+static void BoneJob_Work( void *data, int index, int thread )
+{
+	( (CStudioBoneJob *)data )->Work( index, thread );
+}
+
+CStudioBoneJob::CStudioBoneJob( void )
+{
+	m_pJobs = NULL;
+	m_iNumJobs = 0;
+	m_iReady = FALSE;
+	m_iNumRun = 0;
+	m_iWorkers = -1;
+	memset( m_pRenderers, 0, sizeof( m_pRenderers ) );
+	m_pCvarEnable = m_pCvarThreads = NULL;
+}
+
+void CStudioBoneJob::Init( void )
+{
+	m_pCvarEnable = CVAR_CREATE( "cl_bonejob", "1", FCVAR_ARCHIVE );
+	m_pCvarThreads = CVAR_CREATE( "cl_bonethreads", "-1", FCVAR_ARCHIVE );	// -1 is one less than the number of CPUs
+}
+
+void CStudioBoneJob::Shutdown( void )
+{
+	int i;
+
+	g_WorkerPool.Stop();
+	m_iWorkers = -1;
+
+	for( i = 0; i <= WORKER_MAX_THREADS; i++ )
+	{
+		delete m_pRenderers[i];
+		m_pRenderers[i] = NULL;
+	}
+
+	free( m_pJobs );
+	m_pJobs = NULL;
+	m_iNumJobs = 0;
+	m_iNumRun = 0;
+	m_iReady = FALSE;
+}
+
+int CStudioBoneJob::NumWorkers( void )
+{
+	int count = (int)m_pCvarThreads->value;
+
+	if( count < 0 )
+		count = CWorkerPool::NumCPUs() - 1;
+
+	if( count > WORKER_MAX_THREADS )
+		count = WORKER_MAX_THREADS;
+
+	return count < 0 ? 0 : count;
+}
+
+void CStudioBoneJob::AddEntity( cl_entity_t *ent )
+{
+	// the first entity of a new frame
+	if( m_iReady )
+	{
+		m_iReady = FALSE;
+		m_iNumJobs = 0;
+		m_iNumRun = 0;
+	}
+
+	if( !m_pCvarEnable || m_pCvarEnable->value <= 0.0f )
+		return;
+
+	if( !ent->model || ent->model->type != mod_studio )
+		return;
+
+	if( m_iNumJobs >= BONEJOB_MAX_ENTITIES )
+		return;
+
+	if( !m_pJobs )
+	{
+		m_pJobs = (bonejob_t *)malloc( BONEJOB_MAX_ENTITIES * sizeof( bonejob_t ) );
+		if( !m_pJobs )
+			return;
+	}
+
+	m_pJobs[m_iNumJobs++].pEntity = ent;
+}
+
+void CStudioBoneJob::Run( void )
+{
+	int i, workers;
+
+	if( m_iReady )
+	{
+		// nothing was added this frame
+		m_iNumJobs = 0;
+		m_iNumRun = 0;
+	}
+
+	m_iReady = TRUE;
+
+	if( !m_iNumJobs )
+		return;
+
+	workers = NumWorkers();
+
+	if( workers != m_iWorkers )
+	{
+		g_WorkerPool.Start( workers );
+		m_iWorkers = workers;
+	}
+
+	for( i = 0; i <= g_WorkerPool.NumThreads(); i++ )
+	{
+		if( !m_pRenderers[i] )
+			m_pRenderers[i] = R_StudioCreateWorker();
+	}
+
+	// snapshots need the engine, so they are taken here
+	m_iNumRun = 0;
+
+	for( i = 0; i < m_iNumJobs; i++ )
+	{
+		if( m_pRenderers[0]->StudioPrepareBoneJob( &m_pJobs[i] ) )
+			m_iRun[m_iNumRun++] = i;
+	}
+
+	g_StudioAnimCache.Hold( TRUE );
+	g_WorkerPool.Run( BoneJob_Work, this, m_iNumRun );
+	g_StudioAnimCache.Hold( FALSE );
+}
+
+void CStudioBoneJob::Work( int index, int thread )
+{
+	m_pRenderers[thread]->StudioRunBoneJob( &m_pJobs[m_iRun[index]] );
+}
+
+bonejob_t *CStudioBoneJob::Find( cl_entity_t *ent, const studioposekey_t *pkey )
+{
+	int i;
+
+	if( !m_iReady )
+		return NULL;
+
+	for( i = 0; i < m_iNumRun; i++ )
+	{
+		bonejob_t *pjob = &m_pJobs[m_iRun[i]];
+
+		if( pjob->pEntity != ent )
+			continue;
+
+		// anything else changed since the snapshot, do it the usual way
+		if( memcmp( &pjob->key, pkey, sizeof( *pkey ) ) )
+			return NULL;
+
+		return pjob;
+	}
+
+	return NULL;
+}
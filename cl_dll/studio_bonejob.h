@@ -0,0 +1,81 @@
+//========= Copyright (c) 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Bone setup for the visible studio entities ahead of drawing
+//
+// $NoKeywords: $
+//=============================================================================
+#pragma once
+#if !defined( STUDIO_BONEJOB_H )
+#define STUDIO_BONEJOB_H
+
+#define BONEJOB_MAX_ENTITIES	256
+
+// An entity as it will be drawn, and the pose computed from it
+typedef struct bonejob_s
+{
+	cl_entity_t	*pEntity;	// the real one, as passed to HUD_AddEntity
+	cl_entity_t	entity;		// copy the pose is computed from
+	player_info_t	playerinfo;	// copy, for players
+	int		isplayer;
+
+	model_t		*pRenderModel;
+	studiohdr_t	*pStudioHeader;
+
+	double		time;
+	double		oldtime;
+	int		interp;
+
+	studioposekey_t	key;
+
+	float		prevframe;	// latched.prevframe after the pose, StudioSetupBones updates it
+	float		bonelocal[MAXSTUDIOBONES][3][4];
+} bonejob_t;
+
+/*
+====================
+CStudioBoneJob
+
+Entities that pass HUD_AddEntity are collected, snapshotted on the main
+thread in HUD_CreateEntities and then have their animation evaluated on
+the worker pool, each worker on its own copy of the renderer.  At draw
+time StudioSetupBones takes the precomputed local bone matrices when
+the pose inputs still match, and only does the concatenation itself.
+====================
+*/
+class CStudioBoneJob
+{
+public:
+	CStudioBoneJob( void );
+
+	void Init( void );
+	void Shutdown( void );
+
+	void AddEntity( cl_entity_t *ent );
+	void Run( void );
+
+	bonejob_t *Find( cl_entity_t *ent, const studioposekey_t *pkey );
+
+	void Work( int index, int thread );
+
+private:
+	int NumWorkers( void );
+
+	bonejob_t		*m_pJobs;
+	int			m_iNumJobs;
+	int			m_iReady;	// m_pJobs holds this frame's poses
+
+	int			m_iRun[BONEJOB_MAX_ENTITIES];	// prepared jobs
+	int			m_iNumRun;
+
+	int			m_iWorkers;	// last requested pool size
+	CStudioModelRenderer	*m_pRenderers[WORKER_MAX_THREADS + 1];
+
+	struct cvar_s		*m_pCvarEnable;
+	struct cvar_s		*m_pCvarThreads;
+};
+
+extern CStudioBoneJob g_StudioBoneJob;
+
+// one more renderer of the game's type, for a worker thread
+extern CStudioModelRenderer *R_StudioCreateWorker( void );
+#endif // STUDIO_BONEJOB_H
@@ -0,0 +1,249 @@
+//========= Copyright (c) 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Bone poses shared by entities in the same animation state
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+#include "entity_state.h"
+#include "cl_entity.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "worker_pool.h"
+#include "StudioModelRenderer.h"
+#include "studio_posecache.h"
+
+CStudioPoseCache g_StudioPoseCache;
+
+static void PoseCacheStats_f( void )
+{
+	g_StudioPoseCache.PrintStats();
+}
+
+// FNV-1a over the state, padding is zeroed by StudioPoseState
+static unsigned int PoseCache_Hash( const studioposestate_t *pstate )
+{
+	const byte *p = (const byte *)pstate;
+	unsigned int hash = 2166136261u;
+	size_t i;
+
+	for( i = 0; i < sizeof( *pstate ); i++ )
+	{
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+CStudioPoseCache::CStudioPoseCache( void )
+{
+	m_pPoses = NULL;
+	memset( m_pHash, 0, sizeof( m_pHash ) );
+	m_pHead = m_pTail = NULL;
+	m_iHits = m_iMisses = 0;
+	m_pCvarEnable = NULL;
+}
+
+CStudioPoseCache::~CStudioPoseCache( void )
+{
+	free( m_pPoses );
+}
+
+void CStudioPoseCache::Init( void )
+{
+	m_pCvarEnable = CVAR_CREATE( "cl_posecache", "1", FCVAR_ARCHIVE );
+
+	gEngfuncs.pfnAddCommand( "cl_posecache_stats", PoseCacheStats_f );
+}
+
+void CStudioPoseCache::Clear( void )
+{
+	m_Lock.Lock();
+
+	Reset();
+	m_iHits = m_iMisses = 0;
+
+	m_Lock.Unlock();
+}
+
+// with the lock held
+void CStudioPoseCache::Reset( void )
+{
+	int i;
+
+	memset( m_pHash, 0, sizeof( m_pHash ) );
+	m_pHead = m_pTail = NULL;
+
+	if( !m_pPoses )
+		return;
+
+	// all free, in the LRU list so Store can take the tail
+	for( i = 0; i < POSECACHE_SIZE; i++ )
+	{
+		m_pPoses[i].numbones = 0;
+		m_pPoses[i].pHashNext = NULL;
+		LinkHead( &m_pPoses[i] );
+	}
+}
+
+int CStudioPoseCache::Enabled( void )
+{
+	return m_pCvarEnable && m_pCvarEnable->value > 0.0f;
+}
+
+studiopose_t *CStudioPoseCache::Find( const studioposestate_t *pstate, unsigned int hash )
+{
+	studiopose_t *pPose;
+
+	for( pPose = m_pHash[hash % POSECACHE_HASH_SIZE]; pPose; pPose = pPose->pHashNext )
+	{
+		if( pPose->hash == hash && !memcmp( &pPose->state, pstate, sizeof( *pstate ) ) )
+			return pPose;
+	}
+
+	return NULL;
+}
+
+int CStudioPoseCache::Lookup( const studioposestate_t *pstate, int numbones, float bonelocal[][3][4] )
+{
+	studiopose_t *pPose;
+	unsigned int hash;
+
+	if( !Enabled() )
+		return FALSE;
+
+	hash = PoseCache_Hash( pstate );
+
+	m_Lock.Lock();
+
+	pPose = Find( pstate, hash );
+
+	if( !pPose || pPose->numbones != numbones )
+	{
+		m_iMisses++;
+		m_Lock.Unlock();
+		return FALSE;
+	}
+
+	m_iHits++;
+
+	if( pPose != m_pHead )
+	{
+		Unlink( pPose );
+		LinkHead( pPose );
+	}
+
+	memcpy( bonelocal, pPose->bonelocal, numbones * sizeof( pPose->bonelocal[0] ) );
+
+	m_Lock.Unlock();
+
+	return TRUE;
+}
+
+void CStudioPoseCache::Store( const studioposestate_t *pstate, int numbones, float bonelocal[][3][4] )
+{
+	studiopose_t *pPose;
+	unsigned int hash;
+
+	if( !Enabled() || numbones <= 0 || numbones > MAXSTUDIOBONES )
+		return;
+
+	hash = PoseCache_Hash( pstate );
+
+	m_Lock.Lock();
+
+	if( !m_pPoses )
+	{
+		m_pPoses = (studiopose_t *)calloc( POSECACHE_SIZE, sizeof( studiopose_t ) );
+		if( !m_pPoses )
+		{
+			m_Lock.Unlock();
+			return;
+		}
+
+		Reset();
+	}
+
+	// another thread got there first
+	if( Find( pstate, hash ) )
+	{
+		m_Lock.Unlock();
+		return;
+	}
+
+	// reuse the least recently used one
+	pPose = m_pTail;
+
+	if( pPose->numbones )
+		UnhashPose( pPose );
+
+	memcpy( &pPose->state, pstate, sizeof( *pstate ) );
+	pPose->hash = hash;
+	pPose->numbones = numbones;
+	memcpy( pPose->bonelocal, bonelocal, numbones * sizeof( pPose->bonelocal[0] ) );
+
+	pPose->pHashNext = m_pHash[hash % POSECACHE_HASH_SIZE];
+	m_pHash[hash % POSECACHE_HASH_SIZE] = pPose;
+
+	Unlink( pPose );
+	LinkHead( pPose );
+
+	m_Lock.Unlock();
+}
+
+void CStudioPoseCache::UnhashPose( studiopose_t *pPose )
+{
+	studiopose_t **ppLink = &m_pHash[pPose->hash % POSECACHE_HASH_SIZE];
+
+	while( *ppLink != pPose )
+		ppLink = &( *ppLink )->pHashNext;
+	*ppLink = pPose->pHashNext;
+
+	pPose->pHashNext = NULL;
+	pPose->numbones = 0;
+}
+
+void CStudioPoseCache::Unlink( studiopose_t *pPose )
+{
+	if( pPose->pPrev )
+		pPose->pPrev->pNext = pPose->pNext;
+	else
+		m_pHead = pPose->pNext;
+
+	if( pPose->pNext )
+		pPose->pNext->pPrev = pPose->pPrev;
+	else
+		m_pTail = pPose->pPrev;
+
+	pPose->pPrev = pPose->pNext = NULL;
+}
+
+void CStudioPoseCache::LinkHead( studiopose_t *pPose )
+{
+	pPose->pPrev = NULL;
+	pPose->pNext = m_pHead;
+
+	if( m_pHead )
+		m_pHead->pPrev = pPose;
+	else
+		m_pTail = pPose;
+
+	m_pHead = pPose;
+}
+
+void CStudioPoseCache::PrintStats( void )
+{
+	int lookups = m_iHits + m_iMisses;
+
+	gEngfuncs.Con_Printf( "pose cache: %s, %d poses\n", Enabled() ? "on" : "off", POSECACHE_SIZE );
+	gEngfuncs.Con_Printf( "%d lookups since level start, %d hits (%.1f%%), %d misses\n",
+		lookups, m_iHits, lookups ? m_iHits * 100.0f / lookups : 0.0f, m_iMisses );
+}
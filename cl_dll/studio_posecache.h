@@ -0,0 +1,77 @@
+//========= Copyright (c) 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Bone poses shared by entities in the same animation state
+//
+// $NoKeywords: $
+//=============================================================================
+#pragma once
+#if !defined( STUDIO_POSECACHE_H )
+#define STUDIO_POSECACHE_H
+
+#define POSECACHE_SIZE		256	// poses kept
+#define POSECACHE_HASH_SIZE	512
+
+typedef struct studiopose_s
+{
+	studioposestate_t	state;
+	unsigned int		hash;
+	int			numbones;	// 0 when free
+
+	struct studiopose_s	*pHashNext;
+	struct studiopose_s	*pPrev;		// LRU list, most recently used first
+	struct studiopose_s	*pNext;
+
+	float			bonelocal[MAXSTUDIOBONES][3][4];
+} studiopose_t;
+
+/*
+====================
+CStudioPoseCache
+
+Parent relative bone matrices by the evaluated animation state, so
+settled models like corpses on their last frame and dropped weapons
+cost a copy instead of decoding and blending their animation again.
+The entity transform is applied after this, at draw time.  Poses
+point into model data, so the cache is flushed on every level change.
+====================
+*/
+class CStudioPoseCache
+{
+public:
+	CStudioPoseCache( void );
+	~CStudioPoseCache( void );
+
+	void Init( void );
+	void Clear( void );
+
+	int Enabled( void );
+
+	// Safe from any thread.  Copies the pose out, FALSE if not cached
+	int Lookup( const studioposestate_t *pstate, int numbones, float bonelocal[][3][4] );
+	void Store( const studioposestate_t *pstate, int numbones, float bonelocal[][3][4] );
+
+	void PrintStats( void );
+
+private:
+	void Reset( void );
+	studiopose_t *Find( const studioposestate_t *pstate, unsigned int hash );
+	void Unlink( studiopose_t *pPose );
+	void LinkHead( studiopose_t *pPose );
+	void UnhashPose( studiopose_t *pPose );
+
+	studiopose_t	*m_pPoses;	// POSECACHE_SIZE of them, allocated on first use
+	studiopose_t	*m_pHash[POSECACHE_HASH_SIZE];
+	studiopose_t	*m_pHead;
+	studiopose_t	*m_pTail;
+
+	CWorkerMutex	m_Lock;
+
+	// since the last level change
+	int		m_iHits;
+	int		m_iMisses;
+
+	struct cvar_s	*m_pCvarEnable;
+};
+
+extern CStudioPoseCache g_StudioPoseCache;
+#endif // STUDIO_POSECACHE_H
@@ -15,6 +15,38 @@
 #define XASH_SIMD_NEON 1
 #include <arm_neon.h>
 #include "neon_mathfun.h"
+#elif defined STUDIO_UTIL_SCALAR
+// plain C only, utils/simdtest checks the SIMD versions against it
+#elif defined __SSE2__ || defined _M_X64 || ( defined _M_IX86_FP && _M_IX86_FP >= 2 )
+#define XASH_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined __GNUC__
+// built for every x86 client, only used when cpuid says so
+#define XASH_SIMD_AVX2 1
+#define SIMD_TARGET_AVX2 __attribute__(( target( "avx2,fma" )))
+#include <immintrin.h>
+#endif
+#endif
+
+#if XASH_SIMD_SSE2
+static inline float SSE_HorizontalSum( __m128 v )
+{
+	__m128 t = _mm_add_ps( v, _mm_movehl_ps( v, v ));
+	t = _mm_add_ss( t, _mm_shuffle_ps( t, t, _MM_SHUFFLE( 1, 1, 1, 1 )));
+	return _mm_cvtss_f32( t );
+}
+
+static inline __m128 SSE_SignMask( int x, int y, int z, int w )
+{
+	return _mm_castsi128_ps( _mm_setr_epi32( x ? 0x80000000 : 0, y ? 0x80000000 : 0, z ? 0x80000000 : 0, w ? 0x80000000 : 0 ));
+}
+
+// keeps lane 3 of old, takes the rest from v
+static inline __m128 SSE_KeepW( __m128 v, __m128 old )
+{
+	const __m128 xyz = _mm_castsi128_ps( _mm_setr_epi32( -1, -1, -1, 0 ));
+	return _mm_or_ps( _mm_and_ps( xyz, v ), _mm_andnot_ps( xyz, old ));
+}
 #endif
 
 /*
@@ -180,6 +212,24 @@ void VectorTransform( const float *in1, float in2[3][4], float *out )
 	out_reg = vfmaq_laneq_f32(out_reg, in_t.val[2], in1_reg, 2);
 
 	memcpy(out, &out_reg, sizeof(float) * 3);
+#elif XASH_SIMD_SSE2
+	__m128 c0 = _mm_loadu_ps( in2[0] );
+	__m128 c1 = _mm_loadu_ps( in2[1] );
+	__m128 c2 = _mm_loadu_ps( in2[2] );
+	__m128 c3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS( c0, c1, c2, c3 );
+
+	// columns times ( in1, 1 ), the translation goes last like the scalar code adds it
+	__m128 out_reg = _mm_mul_ps( c0, _mm_set1_ps( in1[0] ));
+	out_reg = _mm_add_ps( out_reg, _mm_mul_ps( c1, _mm_set1_ps( in1[1] )));
+	out_reg = _mm_add_ps( out_reg, _mm_mul_ps( c2, _mm_set1_ps( in1[2] )));
+	out_reg = _mm_add_ps( out_reg, c3 );
+
+	float result[4];
+	_mm_storeu_ps( result, out_reg );
+	out[0] = result[0];
+	out[1] = result[1];
+	out[2] = result[2];
 #else
 	out[0] = DotProduct(in1, in2[0]) + in2[0][3];
 	out[1] = DotProduct(in1, in2[1]) + in2[1][3];
@@ -187,6 +237,75 @@ void VectorTransform( const float *in1, float in2[3][4], float *out )
 #endif
 }
 
+#if XASH_SIMD_SSE2
+// out row = in1[r][0] * in2[0] + in1[r][1] * in2[1] + in1[r][2] * in2[2] + ( 0, 0, 0, in1[r][3] )
+static void ConcatTransforms_SSE2( float in1[3][4], float in2[3][4], float out[3][4] )
+{
+	const __m128 w = _mm_castsi128_ps( _mm_setr_epi32( 0, 0, 0, -1 ));
+	__m128 r0 = _mm_loadu_ps( in2[0] );
+	__m128 r1 = _mm_loadu_ps( in2[1] );
+	__m128 r2 = _mm_loadu_ps( in2[2] );
+	__m128 a[3], o[3];
+	int i;
+
+	for( i = 0; i < 3; i++ )
+		a[i] = _mm_loadu_ps( in1[i] );
+
+	for( i = 0; i < 3; i++ )
+	{
+		o[i] = _mm_mul_ps( _mm_shuffle_ps( a[i], a[i], _MM_SHUFFLE( 0, 0, 0, 0 )), r0 );
+		o[i] = _mm_add_ps( o[i], _mm_mul_ps( _mm_shuffle_ps( a[i], a[i], _MM_SHUFFLE( 1, 1, 1, 1 )), r1 ));
+		o[i] = _mm_add_ps( o[i], _mm_mul_ps( _mm_shuffle_ps( a[i], a[i], _MM_SHUFFLE( 2, 2, 2, 2 )), r2 ));
+		o[i] = _mm_add_ps( o[i], _mm_and_ps( a[i], w ));
+	}
+
+	for( i = 0; i < 3; i++ )
+		_mm_storeu_ps( out[i], o[i] );
+}
+#endif
+
+#if XASH_SIMD_AVX2
+// same as above with rows 0 and 1 side by side in one register
+SIMD_TARGET_AVX2 static void ConcatTransforms_AVX2( float in1[3][4], float in2[3][4], float out[3][4] )
+{
+	const __m256 w = _mm256_castsi256_ps( _mm256_setr_epi32( 0, 0, 0, -1, 0, 0, 0, -1 ));
+	__m256 r0 = _mm256_broadcast_ps( (const __m128 *)in2[0] );
+	__m256 r1 = _mm256_broadcast_ps( (const __m128 *)in2[1] );
+	__m256 r2 = _mm256_broadcast_ps( (const __m128 *)in2[2] );
+	__m256 a01 = _mm256_loadu_ps( in1[0] );
+	__m128 a2 = _mm_loadu_ps( in1[2] );
+
+	__m256 o01 = _mm256_mul_ps( _mm256_permute_ps( a01, _MM_SHUFFLE( 0, 0, 0, 0 )), r0 );
+	o01 = _mm256_fmadd_ps( _mm256_permute_ps( a01, _MM_SHUFFLE( 1, 1, 1, 1 )), r1, o01 );
+	o01 = _mm256_fmadd_ps( _mm256_permute_ps( a01, _MM_SHUFFLE( 2, 2, 2, 2 )), r2, o01 );
+	o01 = _mm256_add_ps( o01, _mm256_and_ps( a01, w ));
+
+	__m128 o2 = _mm_mul_ps( _mm_permute_ps( a2, _MM_SHUFFLE( 0, 0, 0, 0 )), _mm256_castps256_ps128( r0 ));
+	o2 = _mm_fmadd_ps( _mm_permute_ps( a2, _MM_SHUFFLE( 1, 1, 1, 1 )), _mm256_castps256_ps128( r1 ), o2 );
+	o2 = _mm_fmadd_ps( _mm_permute_ps( a2, _MM_SHUFFLE( 2, 2, 2, 2 )), _mm256_castps256_ps128( r2 ), o2 );
+	o2 = _mm_add_ps( o2, _mm_and_ps( a2, _mm256_castps256_ps128( w )));
+
+	_mm256_storeu_ps( out[0], o01 );
+	_mm_storeu_ps( out[2], o2 );
+}
+
+static void ConcatTransforms_Select( float in1[3][4], float in2[3][4], float out[3][4] );
+static void (*pfnConcatTransforms)( float in1[3][4], float in2[3][4], float out[3][4] ) = ConcatTransforms_Select;
+
+// first call picks the version for this cpu
+static void ConcatTransforms_Select( float in1[3][4], float in2[3][4], float out[3][4] )
+{
+	__builtin_cpu_init();
+
+	if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ))
+		pfnConcatTransforms = ConcatTransforms_AVX2;
+	else
+		pfnConcatTransforms = ConcatTransforms_SSE2;
+
+	pfnConcatTransforms( in1, in2, out );
+}
+#endif
+
 /*
 ================
 ConcatTransforms
@@ -217,6 +336,10 @@ void ConcatTransforms( float in1[3][4], float in2[3][4], float out[3][4] )
 	out_reg.val[2] = vfmaq_laneq_f32(out_reg.val[2], in2_reg.val[2], in1_reg.val[2], 2);
 
 	memcpy(out, &out_reg, sizeof(float) * 3 * 4);
+#elif XASH_SIMD_AVX2
+	pfnConcatTransforms( in1, in2, out );
+#elif XASH_SIMD_SSE2
+	ConcatTransforms_SSE2( in1, in2, out );
 #else
 	out[0][0] = in1[0][0] * in2[0][0] + in1[0][1] * in2[1][0] +
 				in1[0][2] * in2[2][0];
@@ -280,6 +403,22 @@ void AngleQuaternion( float *angles, vec4_t quaternion )
 	//quaternion[1] =   A * cp + C * sp; // Y
 	//quaternion[2] =   B * cp - D * sp; // Z
 	//quaternion[3] =   C * cp + A * sp; // W
+#elif XASH_SIMD_SSE2
+	float sr, sp, sy, cr, cp, cy;
+
+	sy = sin( angles[2] * 0.5f );
+	cy = cos( angles[2] * 0.5f );
+	sp = sin( angles[1] * 0.5f );
+	cp = cos( angles[1] * 0.5f );
+	sr = sin( angles[0] * 0.5f );
+	cr = cos( angles[0] * 0.5f );
+
+	// ( sr, cr, cr, cr ) * ( cp, sp, cp, cp ) * ( cy, cy, sy, cy ) + ( -cr, sr, -sr, sr ) * ( sp, cp, sp, sp ) * ( sy, sy, cy, sy )
+	__m128 left = _mm_mul_ps( _mm_mul_ps( _mm_setr_ps( sr, cr, cr, cr ), _mm_setr_ps( cp, sp, cp, cp )), _mm_setr_ps( cy, cy, sy, cy ));
+	__m128 right = _mm_mul_ps( _mm_mul_ps( _mm_setr_ps( cr, sr, sr, sr ), _mm_setr_ps( sp, cp, sp, sp )), _mm_setr_ps( sy, sy, cy, sy ));
+	right = _mm_xor_ps( right, SSE_SignMask( 1, 0, 1, 0 ));
+
+	_mm_storeu_ps( quaternion, _mm_add_ps( left, right ));
 #else
 	float angle;
 	float sr, sp, sy, cr, cp, cy;
@@ -340,6 +479,48 @@ void QuaternionSlerp( vec4_t p, vec4_t q, float t, vec4_t qt )
 	qt_reg = vdivq_f32(qt_reg, vdupq_laneq_f32(x_reg, 2)); // vdivq_laneq_f32 ?
 
 	memcpy(qt, &qt_reg, sizeof(float) * 4);
+#elif XASH_SIMD_SSE2
+	float omega, cosom, sinom, sclp, sclq;
+	__m128 p_reg = _mm_loadu_ps( p );
+	__m128 q_reg = _mm_loadu_ps( q );
+
+	// decide if one of the quaternions is backwards
+	__m128 diff = _mm_sub_ps( p_reg, q_reg );
+	__m128 sum = _mm_add_ps( p_reg, q_reg );
+
+	if( SSE_HorizontalSum( _mm_mul_ps( diff, diff )) > SSE_HorizontalSum( _mm_mul_ps( sum, sum )))
+	{
+		q_reg = _mm_xor_ps( q_reg, SSE_SignMask( 1, 1, 1, 1 ));
+		_mm_storeu_ps( q, q_reg );
+	}
+
+	cosom = SSE_HorizontalSum( _mm_mul_ps( p_reg, q_reg ));
+
+	if( ( 1.0f + cosom ) > 0.000001f )
+	{
+		if( ( 1.0f - cosom ) > 0.000001f )
+		{
+			omega = acos( cosom );
+			sinom = sin( omega );
+			sclp = sin( ( 1.0f - t ) * omega ) / sinom;
+			sclq = sin( t * omega ) / sinom;
+		}
+		else
+		{
+			sclp = 1.0f - t;
+			sclq = t;
+		}
+		_mm_storeu_ps( qt, _mm_add_ps( _mm_mul_ps( _mm_set1_ps( sclp ), p_reg ), _mm_mul_ps( _mm_set1_ps( sclq ), q_reg )));
+	}
+	else
+	{
+		// ( -q[1], q[0], -q[3], q[2] ), w is left alone
+		__m128 perp = _mm_xor_ps( _mm_shuffle_ps( q_reg, q_reg, _MM_SHUFFLE( 2, 3, 0, 1 )), SSE_SignMask( 1, 0, 1, 0 ));
+		sclp = sin( ( 1.0f - t ) * ( 0.5f * M_PI_F ) );
+		sclq = sin( t * ( 0.5f * M_PI_F ) );
+		__m128 qt_reg = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( sclp ), p_reg ), _mm_mul_ps( _mm_set1_ps( sclq ), perp ));
+		_mm_storeu_ps( qt, SSE_KeepW( qt_reg, perp ));
+	}
 #else
 	int i;
 	float omega, cosom, sinom, sclp, sclq;
@@ -447,6 +628,54 @@ void QuaternionSlerpX4( vec4_t p[4], vec4_t q[4], float t, vec4_t qt[4] )
 	qt_reg.val[3] = vfmaq_laneq_f32(vmulq_laneq_f32(p_reg.val[3], sclp, 3), q_reg.val[3], sclq, 3);
 
 	memcpy(qt, &qt_reg, sizeof(float) * 4 * 4);
+#elif XASH_SIMD_SSE2
+	__m128 p_reg[4], q_reg[4];
+	float cosom[4], sclp[4], sclq[4];
+	int i;
+
+	for( i = 0; i < 4; i++ )
+	{
+		p_reg[i] = _mm_loadu_ps( p[i] );
+		q_reg[i] = _mm_loadu_ps( q[i] );
+	}
+
+	// all four dot products at once on the transposed quaternions
+	__m128 px = p_reg[0], py = p_reg[1], pz = p_reg[2], pw = p_reg[3];
+	__m128 qx = q_reg[0], qy = q_reg[1], qz = q_reg[2], qw = q_reg[3];
+	_MM_TRANSPOSE4_PS( px, py, pz, pw );
+	_MM_TRANSPOSE4_PS( qx, qy, qz, qw );
+	__m128 cosom_reg = _mm_mul_ps( px, qx );
+	cosom_reg = _mm_add_ps( cosom_reg, _mm_mul_ps( py, qy ));
+	cosom_reg = _mm_add_ps( cosom_reg, _mm_mul_ps( pz, qz ));
+	cosom_reg = _mm_add_ps( cosom_reg, _mm_mul_ps( pw, qw ));
+	_mm_storeu_ps( cosom, cosom_reg );
+
+	for( i = 0; i < 4; i++ )
+	{
+		// if( cosom < 0 ) q = -q, cosom = -cosom
+		if( cosom[i] < 0.0f )
+		{
+			q_reg[i] = _mm_xor_ps( q_reg[i], SSE_SignMask( 1, 1, 1, 1 ));
+			cosom[i] = -cosom[i];
+		}
+
+		if( ( 1.0f - cosom[i] ) > 0.000001f )
+		{
+			float omega = acos( cosom[i] );
+			float sinom = sin( omega );
+			sclp[i] = sin( ( 1.0f - t ) * omega ) / sinom;
+			sclq[i] = sin( t * omega ) / sinom;
+		}
+		else
+		{
+			sclp[i] = 1.0f - t;
+			sclq[i] = t;
+		}
+	}
+
+	// qt = sclp * p + sclq * q
+	for( i = 0; i < 4; i++ )
+		_mm_storeu_ps( qt[i], _mm_add_ps( _mm_mul_ps( _mm_set1_ps( sclp[i] ), p_reg[i] ), _mm_mul_ps( _mm_set1_ps( sclq[i] ), q_reg[i] )));
 #else
 	QuaternionSlerp(p[0], q[0], t, qt[0]);
 	QuaternionSlerp(p[1], q[1], t, qt[1]);
@@ -511,6 +740,36 @@ void QuaternionMatrix( vec4_t quaternion, float (*matrix)[4] )
 	matrix[2][2] = 1.0 + 2.0 * ( -quaternion[0] *  quaternion[0] + -quaternion[1] * quaternion[1] );
 	matrix[2][3] = 0.0 + 2.0 * ( -quaternion[0] * -quaternion[1] + -quaternion[0] * quaternion[1] );
 */
+#elif XASH_SIMD_SSE2
+	// every row is identity + 2 * ( a * b + c * d ) with a, b, c, d shuffled from
+	// ( x, y, z, w ), the scalar code does not touch column 3 so neither does this
+	const __m128 two = _mm_set1_ps( 2.0f );
+	__m128 q = _mm_loadu_ps( quaternion );
+	__m128 a, b, c, d, row;
+
+	// ( -y, x, x ) * ( y, y, z ) + ( -z, -w, w ) * ( z, z, y )
+	a = _mm_xor_ps( _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 0, 0, 1 )), SSE_SignMask( 1, 0, 0, 0 ));
+	b = _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 2, 1, 1 ));
+	c = _mm_xor_ps( _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 3, 3, 2 )), SSE_SignMask( 1, 1, 0, 0 ));
+	d = _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 1, 2, 2 ));
+	row = _mm_add_ps( _mm_setr_ps( 1.0f, 0.0f, 0.0f, 0.0f ), _mm_mul_ps( two, _mm_add_ps( _mm_mul_ps( a, b ), _mm_mul_ps( c, d ))));
+	_mm_storeu_ps( matrix[0], SSE_KeepW( row, _mm_loadu_ps( matrix[0] )));
+
+	// ( x, -x, y ) * ( y, x, z ) + ( w, -z, -w ) * ( z, z, x )
+	a = _mm_xor_ps( _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 1, 0, 0 )), SSE_SignMask( 0, 1, 0, 0 ));
+	b = _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 2, 0, 1 ));
+	c = _mm_xor_ps( _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 3, 2, 3 )), SSE_SignMask( 0, 1, 1, 0 ));
+	d = _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 0, 2, 2 ));
+	row = _mm_add_ps( _mm_setr_ps( 0.0f, 1.0f, 0.0f, 0.0f ), _mm_mul_ps( two, _mm_add_ps( _mm_mul_ps( a, b ), _mm_mul_ps( c, d ))));
+	_mm_storeu_ps( matrix[1], SSE_KeepW( row, _mm_loadu_ps( matrix[1] )));
+
+	// ( x, y, -x ) * ( z, z, x ) + ( -w, w, -y ) * ( y, x, y )
+	a = _mm_xor_ps( _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 0, 1, 0 )), SSE_SignMask( 0, 0, 1, 0 ));
+	b = _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 0, 2, 2 ));
+	c = _mm_xor_ps( _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 1, 3, 3 )), SSE_SignMask( 1, 0, 1, 0 ));
+	d = _mm_shuffle_ps( q, q, _MM_SHUFFLE( 3, 1, 0, 1 ));
+	row = _mm_add_ps( _mm_setr_ps( 0.0f, 0.0f, 1.0f, 0.0f ), _mm_mul_ps( two, _mm_add_ps( _mm_mul_ps( a, b ), _mm_mul_ps( c, d ))));
+	_mm_storeu_ps( matrix[2], SSE_KeepW( row, _mm_loadu_ps( matrix[2] )));
 #else
 	matrix[0][0] = 1.0f - 2.0f * quaternion[1] * quaternion[1] - 2.0f * quaternion[2] * quaternion[2];
 	matrix[1][0] = 2.0f * quaternion[0] * quaternion[1] + 2.0f * quaternion[3] * quaternion[2];
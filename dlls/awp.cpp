@@ -47,6 +47,8 @@ void CAwp::Precache( void )
 
 	// Weapon Sounds
 	PRECACHE_SOUND( "weapons/awp1.wav" );
+
+	m_usFireAwp = PRECACHE_EVENT( 1, "events/awp.sc" );
 }
 
 int CAwp::GetItemInfo( ItemInfo *p )
@@ -121,10 +123,8 @@ void CAwp::PrimaryAttack( void )
 	m_pPlayer->m_iWeaponVolume = NORMAL_GUN_VOLUME;
 	m_pPlayer->m_iWeaponFlash = BRIGHT_GUN_FLASH;
 
-	// viewmodel + player shoot animations
-	SendWeaponAnim( AWP_SHOOT );
+	// player shoot animation, the viewmodel one is played by the fire event
 	m_pPlayer->SetAnimation( PLAYER_ATTACK1 );
-	EMIT_SOUND( ENT( m_pPlayer->pev ), CHAN_WEAPON, "weapons/awp1.wav", 1, ATTN_NORM );
 
 	Vector vecSrc = m_pPlayer->GetGunPosition();
 	Vector vecAiming;
@@ -142,6 +142,14 @@ void CAwp::PrimaryAttack( void )
 	Vector vecDir;
 	vecDir = m_pPlayer->FireBulletsPlayer( 1, vecSrc, vecAiming, VECTOR_CONE_1DEGREES, 8192, BULLET_PLAYER_357, 0, 0, m_pPlayer->pev, m_pPlayer->random_seed );
 
+	int flags;
+#if CLIENT_WEAPONS
+	flags = FEV_NOTHOST;
+#else
+	flags = 0;
+#endif
+	PLAYBACK_EVENT_FULL( flags, m_pPlayer->edict(), m_usFireAwp, 0.0, g_vecZero, g_vecZero, vecDir.x, vecDir.y, 0, 0, 0, 0 );
+
 	// Apply recoil (view punch) – stronger when not scoped, slightly softer when scoped
 	float flRecoil = ( m_pPlayer->pev->fov != 0 ) ? 4.0f : 6.0f;
 	m_pPlayer->pev->punchangle.x -= flRecoil;
@@ -62,6 +62,8 @@ public:
 	float m_moveWaitTime;			// How long I should wait for something to move
 
 	Vector m_vecMoveGoal; // kept around for node graph moves, so we know our ultimate goal
+	int m_iRouteRequest;	// g_RouteQueue serial of the node route being searched for, 0 if none
+	Vector m_vecRouteGoal;	// where that node route ends
 	Activity m_movementActivity;	// When moving, set this activity
 
 	int m_iAudibleList; // first index of a linked list of sounds that the monster can hear.
@@ -209,7 +211,9 @@ public:
 	void PushEnemy( CBaseEntity *pEnemy, Vector &vecLastKnownPos );
 	BOOL PopEnemy( void );
 
-	BOOL FGetNodeRoute( Vector vecDest );
+	BOOL FGetNodeRoute( Vector vecDest, BOOL fQueue = FALSE );
+	void RouteFromNodePath( const int *piPath, int cPathNodes, const Vector &vecDest );
+	BOOL FRouteQueued( void );
 	
 	inline void TaskComplete( void ) { if ( !HasConditions( bits_COND_TASK_FAILED ) ) m_iTaskStatus = TASKSTATUS_COMPLETE; }
 	void MovementComplete( void );
@@ -227,7 +231,7 @@ public:
 	virtual BOOL FTriangulate( const Vector &vecStart , const Vector &vecEnd, float flDist, CBaseEntity *pTargetEnt, Vector *pApex );
 	void MakeIdealYaw( Vector vecTarget );
 	virtual void SetYawSpeed( void ) { return; };// allows different yaw_speeds for each activity
-	BOOL BuildRoute( const Vector &vecGoal, int iMoveFlag, CBaseEntity *pTarget );
+	BOOL BuildRoute( const Vector &vecGoal, int iMoveFlag, CBaseEntity *pTarget, BOOL fQueue = FALSE );
 	virtual BOOL BuildNearestRoute( Vector vecThreat, Vector vecViewOffset, float flMinDist, float flMaxDist );
 	int RouteClassify( int iMoveFlag );
 	void InsertWaypoint( Vector vecLocation, int afMoveFlags );
@@ -0,0 +1,434 @@
+/***
+*
+*   Fake client load generator
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "client.h"
+#include "game.h"
+#include "gamerules.h"
+#include "playerroster.h"
+#include "bot.h"
+
+CBotManager g_BotManager;
+
+static const botprofile_t s_BotProfiles[BOT_NUM_PROFILES] =
+{
+	// name		speed	strafe	bhop	fire	alt	switch	chat
+	{ "idle",	0.0f,	0.0f,	FALSE,	0.0f,	0.0f,	0.0f,	0.0f },
+	{ "roam",	0.8f,	2.0f,	FALSE,	0.0f,	0.0f,	0.0f,	20.0f },
+	{ "combat",	1.0f,	1.0f,	FALSE,	0.5f,	0.1f,	10.0f,	30.0f },
+	{ "stress",	1.0f,	0.5f,	TRUE,	0.9f,	0.25f,	2.0f,	5.0f },
+};
+
+typedef struct botweapon_s
+{
+	const char	*weapon;
+	const char	*ammo;		// item given twice with the weapon
+} botweapon_t;
+
+static const botweapon_t s_BotWeapons[] =
+{
+	{ "weapon_mp5", "ammo_mp5clip" },
+	{ "weapon_awp", "ammo_awp" },
+	{ "weapon_shotgun", "ammo_buckshot" },
+	{ "weapon_handgrenade", NULL },
+};
+
+#define BOT_NUM_WEAPONS		( sizeof( s_BotWeapons ) / sizeof( s_BotWeapons[0] ))
+
+static const char *s_szBotChat[] =
+{
+	"gg",
+	"nice shot",
+	"lag?",
+	"who has the awp",
+	"one more round",
+	"brb",
+	"rush b",
+	"that was close",
+};
+
+#define BOT_NUM_CHAT		( sizeof( s_szBotChat ) / sizeof( s_szBotChat[0] ))
+
+#define BOT_LOOK_AHEAD		64.0f	// turn around when a wall is closer than this
+#define BOT_ENEMY_RANGE		2048.0f
+
+CBotManager::CBotManager()
+{
+	memset( m_Bots, 0, sizeof( m_Bots ));
+	m_iPending = 0;
+}
+
+// a bot's own sequence, the engine's random numbers depend on everything else going on
+int CBotManager::RandomLong( bot_t *pBot, int lLow, int lHigh )
+{
+	pBot->seed = pBot->seed * 1664525 + 1013904223;
+
+	if( lHigh <= lLow )
+		return lLow;
+
+	return lLow + (int)(( pBot->seed >> 8 ) % (unsigned int)( lHigh - lLow + 1 ));
+}
+
+float CBotManager::RandomFloat( bot_t *pBot, float flLow, float flHigh )
+{
+	pBot->seed = pBot->seed * 1664525 + 1013904223;
+
+	return flLow + ( flHigh - flLow ) * (( pBot->seed >> 8 ) / 16777216.0f );
+}
+
+unsigned int CBotManager::Seed( int slot )
+{
+	return (unsigned int)bot_seed.value * 2654435761U + slot * 40503U;
+}
+
+int CBotManager::Count( void )
+{
+	int count = 0;
+
+	for( int i = 0; i < BOT_MAX_BOTS; i++ )
+	{
+		if( m_Bots[i].pEdict )
+			count++;
+	}
+
+	return count;
+}
+
+void CBotManager::Add( int count )
+{
+	m_iPending = Q_min( m_iPending + count, BOT_MAX_BOTS );
+}
+
+void CBotManager::Kick( const char *pszName )
+{
+	m_iPending = 0;
+
+	for( int i = 0; i < BOT_MAX_BOTS; i++ )
+	{
+		edict_t *pEdict = m_Bots[i].pEdict;
+
+		if( !pEdict || ( pszName && stricmp( STRING( pEdict->v.netname ), pszName )))
+			continue;
+
+		SERVER_COMMAND( UTIL_VarArgs( "kick \"%s\"\n", STRING( pEdict->v.netname )));
+	}
+}
+
+void CBotManager::Remove( edict_t *pEdict )
+{
+	for( int i = 0; i < BOT_MAX_BOTS; i++ )
+	{
+		if( m_Bots[i].pEdict == pEdict )
+			m_Bots[i].pEdict = NULL;
+	}
+}
+
+void CBotManager::NewMap( void )
+{
+	for( int i = 0; i < BOT_MAX_BOTS; i++ )
+	{
+		bot_t *pBot = &m_Bots[i];
+
+		pBot->nextStrafe = pBot->nextTurn = 0.0f;
+		pBot->burstEnd = pBot->nextBurst = 0.0f;
+		pBot->nextSwitch = pBot->nextChat = 0.0f;
+		pBot->equipped = FALSE;
+		pBot->seed = Seed( i );
+	}
+}
+
+BOOL CBotManager::Create( void )
+{
+	bot_t *pBot = NULL;
+	char name[BOT_NAME_LENGTH], reject[128];
+	int i;
+
+	// name, colours and seed all come from the slot
+	for( i = 0; i < BOT_MAX_BOTS; i++ )
+	{
+		if( !m_Bots[i].pEdict )
+		{
+			pBot = &m_Bots[i];
+			break;
+		}
+	}
+
+	if( !pBot )
+		return FALSE;
+
+	safe_snprintf( name, sizeof( name ), "bot%02d", i + 1 );
+
+	edict_t *pEdict = ( *g_engfuncs.pfnCreateFakeClient )( name );
+
+	if( FNullEnt( pEdict ))
+	{
+		ALERT( at_console, "bot_add: server is full\n" );
+		return FALSE;
+	}
+
+	// the engine may hand back a slot that still has a player in it
+	if( pEdict->pvPrivateData )
+		FREE_PRIVATE( pEdict );
+	pEdict->pvPrivateData = NULL;
+	pEdict->v.frags = 0;
+
+	char *infobuffer = g_engfuncs.pfnGetInfoKeyBuffer( pEdict );
+
+	g_engfuncs.pfnSetClientKeyValue( ENTINDEX( pEdict ), infobuffer, "model", "gordon" );
+	g_engfuncs.pfnSetClientKeyValue( ENTINDEX( pEdict ), infobuffer, "topcolor", UTIL_VarArgs( "%d", i * 37 % 256 ));
+	g_engfuncs.pfnSetClientKeyValue( ENTINDEX( pEdict ), infobuffer, "bottomcolor", UTIL_VarArgs( "%d", i * 71 % 256 ));
+
+	reject[0] = '\0';
+
+	if( !ClientConnect( pEdict, name, "127.0.0.1", reject ))
+	{
+		ALERT( at_console, "bot_add: %s rejected: %s\n", name, reject );
+		SERVER_COMMAND( UTIL_VarArgs( "kick \"%s\"\n", name ));
+		return FALSE;
+	}
+
+	ClientPutInServer( pEdict );
+	pEdict->v.flags |= FL_FAKECLIENT;
+
+	memset( pBot, 0, sizeof( *pBot ));
+	pBot->pEdict = pEdict;
+	pBot->seed = Seed( i );
+	pBot->yaw = RandomFloat( pBot, 0.0f, 360.0f );
+	pBot->nextChat = gpGlobals->time + RandomFloat( pBot, 1.0f, 10.0f );
+
+	return TRUE;
+}
+
+void CBotManager::StartFrame( void )
+{
+	// one at a time, so a big bot_add doesn't show up as one long frame
+	if( m_iPending > 0 )
+	{
+		if( Create() )
+			m_iPending--;
+		else
+			m_iPending = 0;
+	}
+
+	for( int i = 0; i < BOT_MAX_BOTS; i++ )
+	{
+		bot_t *pBot = &m_Bots[i];
+
+		if( !pBot->pEdict )
+			continue;
+
+		// dropped without a ClientDisconnect, a map change can do that
+		if( pBot->pEdict->free || !pBot->pEdict->pvPrivateData )
+		{
+			pBot->pEdict = NULL;
+			continue;
+		}
+
+		Think( pBot );
+	}
+}
+
+void CBotManager::Equip( bot_t *pBot, CBasePlayer *pPlayer )
+{
+	for( int i = 0; i < (int)BOT_NUM_WEAPONS; i++ )
+	{
+		if( !pPlayer->HasNamedPlayerItem( s_BotWeapons[i].weapon ))
+			pPlayer->GiveNamedItem( s_BotWeapons[i].weapon );
+
+		if( s_BotWeapons[i].ammo )
+		{
+			pPlayer->GiveNamedItem( s_BotWeapons[i].ammo );
+			pPlayer->GiveNamedItem( s_BotWeapons[i].ammo );
+		}
+	}
+
+	pBot->equipped = TRUE;
+}
+
+CBasePlayer *CBotManager::FindEnemy( bot_t *pBot, CBasePlayer *pPlayer )
+{
+	CBasePlayer *pBest = NULL;
+	float flBest = BOT_ENEMY_RANGE * BOT_ENEMY_RANGE;
+	Vector vecEyes = pPlayer->pev->origin + pPlayer->pev->view_ofs;
+
+	for( int i = 0; i < g_PlayerRoster.ActiveCount(); i++ )
+	{
+		CBasePlayer *pOther = g_PlayerRoster.ActivePlayer( i );
+
+		if( pOther == pPlayer || !pOther->IsAlive() || pOther->pev->flags & FL_NOTARGET )
+			continue;
+
+		if( g_pGameRules->PlayerRelationship( pPlayer, pOther ) == GR_TEAMMATE )
+			continue;
+
+		float flDist = ( pOther->pev->origin - pPlayer->pev->origin ).Length2D();
+
+		if( flDist * flDist >= flBest )
+			continue;
+
+		TraceResult tr;
+
+		UTIL_TraceLine( vecEyes, pOther->pev->origin + pOther->pev->view_ofs, ignore_monsters, pPlayer->edict(), &tr );
+
+		if( tr.flFraction != 1.0f )
+			continue;
+
+		pBest = pOther;
+		flBest = flDist * flDist;
+	}
+
+	return pBest;
+}
+
+void CBotManager::Think( bot_t *pBot )
+{
+	const botprofile_t *pProfile = &s_BotProfiles[Q_min( Q_max( (int)bot_profile.value, 0 ), BOT_NUM_PROFILES - 1 )];
+	CBasePlayer *pPlayer = (CBasePlayer *)CBaseEntity::Instance( pBot->pEdict );
+	entvars_t *pev = &pBot->pEdict->v;
+	float forwardmove = 0.0f, sidemove = 0.0f;
+	unsigned short buttons = 0;
+	Vector vecAngles;
+
+	if( !pPlayer )
+		return;
+
+	// commands carry whole milliseconds, the rest goes into the next one
+	pBot->msec += gpGlobals->frametime * 1000.0f;
+
+	byte msec = (byte)Q_min( (int)pBot->msec, 255 );
+
+	pBot->msec -= msec;
+
+	vecAngles = pev->v_angle;
+
+	if( !pPlayer->IsAlive() )
+	{
+		// press and release fire until respawned
+		pBot->equipped = FALSE;
+
+		if( !( pBot->buttons & IN_ATTACK ) && pPlayer->m_fDeadTime + 1.0f < gpGlobals->time )
+			buttons = IN_ATTACK;
+	}
+	else if( pProfile->speed > 0.0f )
+	{
+		if( !pBot->equipped )
+			Equip( pBot, pPlayer );
+
+		if( pProfile->switchTime && pBot->nextSwitch <= gpGlobals->time )
+		{
+			pPlayer->SelectItem( s_BotWeapons[RandomLong( pBot, 0, BOT_NUM_WEAPONS - 1 )].weapon );
+			pBot->altFire = RandomFloat( pBot, 0.0f, 1.0f ) < pProfile->altFireFraction;
+			pBot->nextSwitch = gpGlobals->time + RandomFloat( pBot, 0.5f, 1.5f ) * pProfile->switchTime;
+		}
+
+		// wander, and turn around in front of walls
+		if( pBot->nextTurn <= gpGlobals->time )
+		{
+			pBot->yaw = UTIL_AngleMod( pBot->yaw + RandomFloat( pBot, -45.0f, 45.0f ));
+			pBot->nextTurn = gpGlobals->time + RandomFloat( pBot, 0.5f, 3.0f );
+		}
+
+		TraceResult tr;
+
+		UTIL_MakeVectors( Vector( 0, pBot->yaw, 0 ));
+		UTIL_TraceLine( pev->origin, pev->origin + gpGlobals->v_forward * BOT_LOOK_AHEAD, ignore_monsters, pBot->pEdict, &tr );
+
+		if( tr.flFraction != 1.0f )
+			pBot->yaw = UTIL_AngleMod( pBot->yaw + RandomFloat( pBot, 90.0f, 270.0f ));
+
+		if( pProfile->strafeTime && pBot->nextStrafe <= gpGlobals->time )
+		{
+			pBot->strafe = (float)RandomLong( pBot, -1, 1 );
+			pBot->nextStrafe = gpGlobals->time + RandomFloat( pBot, 0.5f, 1.5f ) * pProfile->strafeTime;
+		}
+
+		float speed = pev->maxspeed * pProfile->speed;
+
+		forwardmove = speed;
+		sidemove = speed * pBot->strafe;
+		vecAngles = Vector( 0, pBot->yaw, 0 );
+
+		// aim at the closest enemy in sight, keep running the same way
+		CBasePlayer *pEnemy = pProfile->fireFraction > 0.0f ? FindEnemy( pBot, pPlayer ) : NULL;
+
+		if( pEnemy )
+		{
+			vecAngles = UTIL_VecToAngles( pEnemy->pev->origin + pEnemy->pev->view_ofs - ( pev->origin + pev->view_ofs ));
+			vecAngles.x = -vecAngles.x;
+
+			float delta = ( pBot->yaw - vecAngles.y ) * ( M_PI / 180.0f );
+
+			forwardmove = speed * ( cos( delta ) + pBot->strafe * sin( delta ));
+			sidemove = speed * ( pBot->strafe * cos( delta ) - sin( delta ));
+		}
+
+		// bursts that add up to fireFraction of the time
+		if( pBot->nextBurst <= gpGlobals->time && ( pEnemy || pProfile->fireFraction > 0.75f ))
+		{
+			float flBurst = RandomFloat( pBot, 0.2f, 1.0f );
+
+			pBot->burstEnd = gpGlobals->time + flBurst;
+			pBot->nextBurst = pBot->burstEnd + flBurst * ( 1.0f - pProfile->fireFraction ) / pProfile->fireFraction;
+		}
+
+		if( pBot->burstEnd > gpGlobals->time )
+			buttons |= pBot->altFire ? IN_ATTACK2 : IN_ATTACK;
+
+		// the shared movement code does the hopping, jump has to be let go in between
+		if( pProfile->bunnyHop && ( pev->flags & FL_ONGROUND ) && !( pBot->buttons & IN_JUMP ))
+			buttons |= IN_JUMP;
+
+		if( forwardmove > 0 )
+			buttons |= IN_FORWARD;
+		else if( forwardmove < 0 )
+			buttons |= IN_BACK;
+
+		if( sidemove > 0 )
+			buttons |= IN_MOVERIGHT;
+		else if( sidemove < 0 )
+			buttons |= IN_MOVELEFT;
+	}
+
+	if( pProfile->chatTime && pBot->nextChat <= gpGlobals->time )
+	{
+		char text[128];
+
+		strlcpy( text, s_szBotChat[RandomLong( pBot, 0, BOT_NUM_CHAT - 1 )], sizeof( text ));
+		Host_SayText( pBot->pEdict, 0, text );
+
+		pBot->nextChat = gpGlobals->time + RandomFloat( pBot, 0.5f, 1.5f ) * pProfile->chatTime;
+	}
+
+	pBot->buttons = buttons;
+
+	( *g_engfuncs.pfnRunPlayerMove )( pBot->pEdict, vecAngles, forwardmove, sidemove, 0.0f, buttons, 0, msec );
+}
+
+// bot_add [count]
+void BotAdd_f( void )
+{
+	int count = CMD_ARGC() > 1 ? atoi( CMD_ARGV( 1 )) : 1;
+
+	if( count < 1 )
+	{
+		ALERT( at_console, "Usage: bot_add [count]\n" );
+		return;
+	}
+
+	g_BotManager.Add( count );
+
+	ALERT( at_console, "Adding %d bots, profile %s\n", count,
+		s_BotProfiles[Q_min( Q_max( (int)bot_profile.value, 0 ), BOT_NUM_PROFILES - 1 )].name );
+}
+
+// bot_kick [name]
+void BotKick_f( void )
+{
+	g_BotManager.Kick( CMD_ARGC() > 1 ? CMD_ARGV( 1 ) : NULL );
+}
@@ -0,0 +1,99 @@
+/***
+*
+*   Fake client load generator
+*
+***/
+#pragma once
+#if !defined(BOT_H)
+#define BOT_H
+
+#define BOT_MAX_BOTS		32	// engine MAX_CLIENTS
+#define BOT_NAME_LENGTH		32
+
+class CBasePlayer;
+
+enum
+{
+	BOT_PROFILE_IDLE = 0,	// connected, standing still
+	BOT_PROFILE_ROAM,	// running around and talking
+	BOT_PROFILE_COMBAT,	// fighting whoever is closest
+	BOT_PROFILE_STRESS,	// bunny hopping, firing and switching all the time
+	BOT_NUM_PROFILES
+};
+
+typedef struct botprofile_s
+{
+	const char	*name;
+	float		speed;		// fraction of maxspeed
+	float		strafeTime;	// seconds between strafe changes, 0 for none
+	BOOL		bunnyHop;
+	float		fireFraction;	// of the time the trigger is held
+	float		altFireFraction;	// of the shots that are secondary attacks
+	float		switchTime;	// seconds between weapon switches, 0 for none
+	float		chatTime;	// seconds between chat lines, 0 for none
+} botprofile_t;
+
+typedef struct bot_s
+{
+	edict_t		*pEdict;	// NULL for a free slot
+	unsigned int	seed;
+
+	float		yaw;
+	float		strafe;		// -1, 0 or 1
+	float		nextStrafe;
+	float		nextTurn;
+	float		burstEnd;
+	float		nextBurst;
+	BOOL		altFire;
+	float		nextSwitch;
+	float		nextChat;
+	float		msec;		// frame time not yet given to a command
+	unsigned short	buttons;	// of the last command
+	BOOL		equipped;	// got the loadout since the last spawn
+} bot_t;
+
+//=========================================================
+// CBotManager - fake clients that fill a server with a
+// repeatable load for capacity tests.  They connect through
+// the engine like players do and run their commands through
+// pfnRunPlayerMove every frame, so everything behind that,
+// player movement included, costs what it costs for people.
+//
+// What the bots do comes from bot_profile.  Each bot has its
+// own random sequence seeded from bot_seed and its slot, and
+// reseeded on every map, so the same seed and profile give the
+// same inputs every run, whatever was added or kicked before.
+//=========================================================
+class CBotManager
+{
+public:
+	CBotManager();
+
+	void StartFrame( void );
+	void NewMap( void );		// times started over
+
+	void Add( int count );		// connected over the next frames
+	void Kick( const char *pszName );	// NULL kicks them all
+	void Remove( edict_t *pEdict );	// disconnected
+
+	int Count( void );
+
+private:
+	BOOL Create( void );
+	void Think( bot_t *pBot );
+	void Equip( bot_t *pBot, CBasePlayer *pPlayer );
+	CBasePlayer *FindEnemy( bot_t *pBot, CBasePlayer *pPlayer );
+
+	float RandomFloat( bot_t *pBot, float flLow, float flHigh );
+	int RandomLong( bot_t *pBot, int lLow, int lHigh );
+	unsigned int Seed( int slot );
+
+	bot_t m_Bots[BOT_MAX_BOTS];
+	int m_iPending;
+};
+
+extern CBotManager g_BotManager;
+
+extern void BotAdd_f( void );
+extern void BotKick_f( void );
+#endif // BOT_H
@@ -244,14 +244,14 @@ void CMultiSource::Register( void )
 		pentTarget = FIND_ENTITY_BY_STRING( pentTarget, "target", STRING( pev->targetname ) );
 	}
 
-	pentTarget = FIND_ENTITY_BY_STRING( NULL, "classname", "multi_manager" );
+	pentTarget = FIND_ENTITY_BY_CLASSNAME( NULL, "multi_manager" );
 	while( !FNullEnt( pentTarget ) && ( m_iTotal < MS_MAX_TARGETS ) )
 	{
 		CBaseEntity *pTarget = CBaseEntity::Instance( pentTarget );
 		if( pTarget && pTarget->HasTarget( pev->targetname ) )
 			m_rgEntities[m_iTotal++] = pTarget;
 
-		pentTarget = FIND_ENTITY_BY_STRING( pentTarget, "classname", "multi_manager" );
+		pentTarget = FIND_ENTITY_BY_CLASSNAME( pentTarget, "multi_manager" );
 	}
 	pev->spawnflags &= ~SF_MULTI_INIT;
 }
@@ -21,6 +21,10 @@
 #include	"decals.h"
 #include	"gamerules.h"
 #include	"game.h"
+#include	"spatialindex.h"
+#include	"nameregistry.h"
+#include	"playerroster.h"
+#include	"frameprof.h"
 
 bool g_fIsXash3D = false;
 
@@ -98,6 +102,15 @@ static DLL_FUNCTIONS gFunctionTable =
 	AllowLagCompensation,		//pfnAllowLagCompensation
 };
 
+static NEW_DLL_FUNCTIONS gNewDLLFunctionTable =
+{
+	OnFreeEntPrivateData,		//pfnOnFreeEntPrivateData
+	NULL,						//pfnGameShutdown
+	NULL,						//pfnShouldCollide
+	NULL,						//pfnCvarValue
+	NULL,						//pfnCvarValue2
+};
+
 static void SetObjectCollisionBox( entvars_t *pev );
 
 #if !XASH_WIN32
@@ -127,6 +140,18 @@ int GetEntityAPI2( DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion )
 	return TRUE;
 }
 
+int GetNewDLLFunctions( NEW_DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion )
+{
+	if( !pFunctionTable || *interfaceVersion != NEW_DLL_FUNCTIONS_VERSION )
+	{
+		*interfaceVersion = NEW_DLL_FUNCTIONS_VERSION;
+		return FALSE;
+	}
+
+	memcpy( pFunctionTable, &gNewDLLFunctionTable, sizeof(NEW_DLL_FUNCTIONS) );
+	return TRUE;
+}
+
 int Server_GetPhysicsInterface( int version, server_physics_api_t *api, physics_interface_t *interface )
 {
 	g_fIsXash3D = true;
@@ -153,6 +178,9 @@ int DispatchSpawn( edict_t *pent )
 		// that would touch too much code for me to do that right now.
 		pEntity = (CBaseEntity *)GET_PRIVATE( pent );
 
+		// Spawn() likes to override the classname
+		g_NameRegistry.Update( pent );
+
 		if( pEntity )
 		{
 			if( g_pGameRules && !g_pGameRules->IsAllowedToSpawn( pEntity ) )
@@ -197,7 +225,10 @@ void DispatchKeyValue( edict_t *pentKeyvalue, KeyValueData *pkvd )
 	// If the key was an entity variable, or there's no class set yet, don't look for the object, it may
 	// not exist yet.
 	if ( pkvd->fHandled || pkvd->szClassName == NULL )
+	{
+		g_NameRegistry.Update( pentKeyvalue );
 		return;
+	}
 
 	// Get the actualy entity object
 	CBaseEntity *pEntity = (CBaseEntity *)GET_PRIVATE( pentKeyvalue );
@@ -221,7 +252,11 @@ void DispatchTouch( edict_t *pentTouched, edict_t *pentOther )
 	CBaseEntity *pOther = (CBaseEntity *)GET_PRIVATE( pentOther );
 
 	if( pEntity && pOther && ! ( ( pEntity->pev->flags | pOther->pev->flags ) & FL_KILLME ) )
+	{
+		CProfScope prof( PROF_TOUCH, pEntity->pev->classname );
+
 		pEntity->Touch( pOther );
+	}
 }
 
 void DispatchUse( edict_t *pentUsed, edict_t *pentOther )
@@ -230,7 +265,11 @@ void DispatchUse( edict_t *pentUsed, edict_t *pentOther )
 	CBaseEntity *pOther = (CBaseEntity *)GET_PRIVATE( pentOther );
 
 	if( pEntity && !( pEntity->pev->flags & FL_KILLME ) )
+	{
+		CProfScope prof( PROF_USE, pEntity->pev->classname );
+
 		pEntity->Use( pOther, pOther, USE_TOGGLE, 0 );
+	}
 }
 
 void DispatchThink( edict_t *pent )
@@ -241,6 +280,8 @@ void DispatchThink( edict_t *pent )
 		if( FBitSet( pEntity->pev->flags, FL_DORMANT ) )
 			ALERT( at_error, "Dormant entity %s is thinking!!\n", STRING( pEntity->pev->classname ) );
 
+		CProfScope prof( PROF_THINK, pEntity->pev->classname );
+
 		pEntity->Think();
 	}
 }
@@ -251,7 +292,11 @@ void DispatchBlocked( edict_t *pentBlocked, edict_t *pentOther )
 	CBaseEntity *pOther = (CBaseEntity *)GET_PRIVATE( pentOther );
 
 	if( pEntity )
+	{
+		CProfScope prof( PROF_BLOCKED, pEntity->pev->classname );
+
 		pEntity->Blocked( pOther );
+	}
 }
 
 void DispatchSave( edict_t *pent, SAVERESTOREDATA *pSaveData )
@@ -374,6 +419,8 @@ int DispatchRestore( edict_t *pent, SAVERESTOREDATA *pSaveData, int globalEntity
 
 		// Again, could be deleted, get the pointer again.
 		pEntity = (CBaseEntity *)GET_PRIVATE( pent );
+
+		g_NameRegistry.Update( pent );
 #if 0
 		if( pEntity && pEntity->pev->globalname && globalEntity ) 
 		{
@@ -425,6 +472,16 @@ void DispatchObjectCollsionBox( edict_t *pent )
 	}
 	else
 		SetObjectCollisionBox( &pent->v );
+
+	// the engine calls this every time it relinks the edict
+	g_SpatialIndex.Link( pent );
+}
+
+void OnFreeEntPrivateData( edict_t *pent )
+{
+	g_SpatialIndex.Unlink( pent );
+	g_NameRegistry.Remove( pent );
+	g_PlayerRoster.Remove( pent );
 }
 
 void SaveWriteFields( SAVERESTOREDATA *pSaveData, const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount )
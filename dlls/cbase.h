@@ -58,6 +58,7 @@ CBaseEntity
 
 extern "C" EXPORT int GetEntityAPI( DLL_FUNCTIONS *pFunctionTable, int interfaceVersion );
 extern "C" EXPORT int GetEntityAPI2( DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion );
+extern "C" EXPORT int GetNewDLLFunctions( NEW_DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion );
 // TODO: replace this by actual definitions from physint.h
 typedef void *server_physics_api_t;
 typedef void *physics_interface_t;
@@ -73,6 +74,7 @@ extern void DispatchBlocked( edict_t *pentBlocked, edict_t *pentOther );
 extern void DispatchSave( edict_t *pent, SAVERESTOREDATA *pSaveData );
 extern int DispatchRestore( edict_t *pent, SAVERESTOREDATA *pSaveData, int globalEntity );
 extern void DispatchObjectCollsionBox( edict_t *pent );
+extern void OnFreeEntPrivateData( edict_t *pent );
 extern void SaveWriteFields( SAVERESTOREDATA *pSaveData, const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount );
 extern void SaveReadFields( SAVERESTOREDATA *pSaveData, const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount );
 extern void SaveGlobalState( SAVERESTOREDATA *pSaveData );
@@ -749,6 +751,9 @@ template <class T> T * GetClassPtr( T *a )
 		// allocate private data 
 		a = new( pev ) T;
 		a->pev = pev;
+
+		// the classname is often set by hand after this, keep the name lookup in sync
+		UTIL_NameRegistryTouch( ENT( pev ) );
 	}
 	return a;
 }
@@ -42,4 +42,29 @@
 
 
 #define WEAPON_SUIT		31
+
+// PlayerState message, carries the HUD updates of a frame in one bit packed
+// message to clients whose cl_playerstate userinfo is exactly this version
+#define PLAYERSTATE_VERSION	1
+
+// dirty fields, written and read in this order
+#define PS_HIDEHUD		( 1<<0 )
+#define PS_FOV			( 1<<1 )
+#define PS_HEALTH		( 1<<2 )
+#define PS_BATTERY		( 1<<3 )
+#define PS_DAMAGE		( 1<<4 )
+#define PS_FLASHLIGHT		( 1<<5 )
+#define PS_AMMO			( 1<<6 )
+#define PS_WEAPONS		( 1<<7 )
+#define PS_NUM_FIELDS		8
+
+// field widths in bits
+#define PS_BITS_BYTE		8
+#define PS_BITS_BATTERY		16
+#define PS_BITS_COORD		16	// signed, whole units
+#define PS_BITS_DMGTYPE		32
+#define PS_BITS_FLASHBAT	7	// 0-100
+#define PS_BITS_COUNT		6	// ammo and weapon list lengths
+#define PS_BITS_INDEX		5	// ammo index, weapon id
+#define PS_BITS_WEAPONSTATE	2	// 0 holstered, 1 active, 2 on target
 #endif
@@ -39,6 +39,17 @@
 #include "usercmd.h"
 #include "netadr.h"
 #include "pm_shared.h"
+#include "spatialindex.h"
+#include "nameregistry.h"
+#include "spawnpoints.h"
+#include "playerroster.h"
+#include "lagcomp.h"
+#include "packcache.h"
+#include "netlod.h"
+#include "routequeue.h"
+#include "msgstats.h"
+#include "frameprof.h"
+#include "bot.h"
 
 extern DLL_GLOBAL ULONG		g_ulModelIndexPlayer;
 extern DLL_GLOBAL BOOL		g_fGameOver;
@@ -100,6 +111,9 @@ GLOBALS ASSUMED SET:  g_fGameOver
 */
 void ClientDisconnect( edict_t *pEntity )
 {
+	g_PlayerRoster.Remove( pEntity );
+	g_BotManager.Remove( pEntity );
+
 	if( g_fGameOver )
 		return;
 
@@ -204,6 +218,9 @@ void ClientPutInServer( edict_t *pEntity )
 
 	pPlayer->pev->iuser1 = 0;
 	pPlayer->pev->iuser2 = 0;
+
+	g_PlayerRoster.Add( pPlayer );
+	g_NetLOD.ClearHost( pEntity );
 }
 
 #if !NO_VOICEGAMEMGR
@@ -314,10 +331,7 @@ bool Q_UnicodeValidate( const char *pUTF8 )
 //
 void Host_Say( edict_t *pEntity, int teamonly )
 {
-	CBasePlayer *client;
-	int		j;
 	char	*p; //, *pc;
-	char	text[128];
 	char    szTemp[256];
 	const char *cpSay = "say";
 	const char *cpSayTeam = "say_team";
@@ -327,13 +341,6 @@ void Host_Say( edict_t *pEntity, int teamonly )
 	if( CMD_ARGC() == 0 )
 		return;
 
-	entvars_t *pev = &pEntity->v;
-	CBasePlayer* player = GetClassPtr( (CBasePlayer *)pev );
-
-	//Not yet.
-	if( player->m_flNextChatTime > gpGlobals->time )
-		 return;
-
 	if( !stricmp( pcmd, cpSay ) || !stricmp( pcmd, cpSayTeam ) )
 	{
 		if( CMD_ARGC() >= 2 )
@@ -371,6 +378,23 @@ void Host_Say( edict_t *pEntity, int teamonly )
 	if( !p || !p[0] || !Q_UnicodeValidate ( p ) )
 		return;  // no character found, so say nothing
 
+	Host_SayText( pEntity, teamonly, p );
+}
+
+// sends p as pEntity's chat, for typed says and for the bots
+void Host_SayText( edict_t *pEntity, int teamonly, char *p )
+{
+	CBasePlayer *client;
+	char	text[128];
+	int		j;
+
+	entvars_t *pev = &pEntity->v;
+	CBasePlayer* player = GetClassPtr( (CBasePlayer *)pev );
+
+	//Not yet.
+	if( player->m_flNextChatTime > gpGlobals->time )
+		 return;
+
 	// turn on color set 2  (color on,  no sound)
 	if( player->IsObserver() && ( teamonly ) )
 		safe_snprintf( text, sizeof( text ), "%c(SPEC) %s: ", 2, STRING( pEntity->v.netname ) );
@@ -745,6 +769,7 @@ void ServerDeactivate( void )
 
 	// Peform any shutdown operations here...
 	//
+	g_RouteQueue.Clear();
 }
 
 void ServerActivate( edict_t *pEdictList, int edictCount, int clientMax )
@@ -779,6 +804,11 @@ void ServerActivate( edict_t *pEdictList, int edictCount, int clientMax )
 		}
 	}
 
+	// Rebuild the lookup tables now that the map entities are in place
+	g_SpatialIndex.Reset();
+	g_NameRegistry.Reset();
+	g_SpawnPoints.Build();
+
 	// Link user messages here to make sure first client can get them...
 	LinkUserMessages();
 }
@@ -797,7 +827,11 @@ void PlayerPreThink( edict_t *pEntity )
 	CBasePlayer *pPlayer = (CBasePlayer *)GET_PRIVATE( pEntity );
 
 	if( pPlayer )
+	{
+		CProfScope prof( PROF_PRETHINK, pPlayer->pev->classname );
+
 		pPlayer->PreThink();
+	}
 }
 
 /*
@@ -814,7 +848,11 @@ void PlayerPostThink( edict_t *pEntity )
 	CBasePlayer *pPlayer = (CBasePlayer *)GET_PRIVATE( pEntity );
 
 	if( pPlayer )
+	{
+		CProfScope prof( PROF_POSTTHINK, pPlayer->pev->classname );
+
 		pPlayer->PostThink();
+	}
 }
 
 void ParmsNewLevel( void )
@@ -837,6 +875,18 @@ void StartFrame( void )
 {
 	//ALERT( at_console, "SV_Physics( %g, frametime %g )\n", gpGlobals->time, gpGlobals->frametime );
 
+	g_FrameProf.StartFrame();
+
+	CProfScope prof( PROF_STARTFRAME, 0 );
+
+	g_MessageStats.StartFrame();
+	g_NameRegistry.StartFrame();
+	g_LagCompensation.RecordFrame();
+	g_PackCache.StartFrame();
+	g_NetLOD.StartFrame();
+	g_BotManager.StartFrame();
+	g_RouteQueue.StartFrame();
+
 	if( g_pGameRules )
 		g_pGameRules->Think();
 
@@ -1150,9 +1200,6 @@ we could also use the pas/ pvs that we set in SetupVisibility, if we wanted to.
 */
 int AddToFullPack( struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet )
 {
-	int i;
-	CBaseEntity *Entity;
-
 	// don't send if flagged for NODRAW and it's not the host getting the message
 	if( ( ent->v.effects & EF_NODRAW ) && ( ent != host ) )
 		return 0;
@@ -1174,7 +1221,7 @@ int AddToFullPack( struct entity_state_s *state, int e, edict_t *ent, edict_t *h
 		if( !ENGINE_CHECK_VISIBILITY( (const struct edict_s *)ent, pSet ) )
 		{
 			// env_sky is visible always
-			if( !FClassnameIs( ent, "env_sky" ) )
+			if( !g_PackCache.IsSky( e, ent, player ) )
 			{
 				return 0;
 			}
@@ -1213,140 +1260,12 @@ int AddToFullPack( struct entity_state_s *state, int e, edict_t *ent, edict_t *h
 		UTIL_UnsetGroupTrace();
 	}
 
-	memset( state, 0, sizeof(*state) );
-
-	// Assign index so we can track this entity from frame to frame and
-	//  delta from it.
-	state->number = e;
-	state->entityType = ENTITY_NORMAL;
-
-	// Flag custom entities.
-	if( ent->v.flags & FL_CUSTOMENTITY )
-	{
-		state->entityType = ENTITY_BEAM;
-	}
-
-	// 
-	// Copy state data
-	//
-
-	// Round animtime to nearest millisecond
-	state->animtime = (int)( 1000.0f * ent->v.animtime ) / 1000.0f;
-
-	memcpy( state->origin, ent->v.origin, 3 * sizeof(float) );
-	memcpy( state->angles, ent->v.angles, 3 * sizeof(float) );
-	memcpy( state->mins, ent->v.mins, 3 * sizeof(float) );
-	memcpy( state->maxs, ent->v.maxs, 3 * sizeof(float) );
-
-	memcpy( state->startpos, ent->v.startpos, 3 * sizeof(float) );
-	memcpy( state->endpos, ent->v.endpos, 3 * sizeof(float) );
-	memcpy( state->velocity, ent->v.velocity, 3 * sizeof(float) );
-
-	state->impacttime = ent->v.impacttime;
-	state->starttime = ent->v.starttime;
-
-	state->modelindex = ent->v.modelindex;
-
-	state->frame = ent->v.frame;
-
-	state->skin = ent->v.skin;
-	state->effects = ent->v.effects;
-
-	// This non-player entity is being moved by the game .dll and not the physics simulation system
-	//  make sure that we interpolate it's position on the client if it moves
-	if( !player &&
-		 ent->v.animtime &&
-		 ent->v.velocity[0] == 0 && 
-		 ent->v.velocity[1] == 0 && 
-		 ent->v.velocity[2] == 0 )
-	{
-		state->eflags |= EFLAG_SLERP;
-	}
-
-	state->scale		= ent->v.scale;
-	state->solid		= ent->v.solid;
-	state->colormap		= ent->v.colormap;
-
-	state->movetype		= ent->v.movetype;
-	state->sequence		= ent->v.sequence;
-	state->framerate	= ent->v.framerate;
-	state->body		= ent->v.body;
-
-	for( i = 0; i < 4; i++ )
-	{
-		state->controller[i] = ent->v.controller[i];
-	}
-
-	for( i = 0; i < 2; i++ )
-	{
-		state->blending[i] = ent->v.blending[i];
-	}
-
-	state->rendermode	= ent->v.rendermode;
-	state->renderamt	= (int)ent->v.renderamt; 
-	state->renderfx		= ent->v.renderfx;
-	state->rendercolor.r	= (byte)ent->v.rendercolor.x;
-	state->rendercolor.g	= (byte)ent->v.rendercolor.y;
-	state->rendercolor.b	= (byte)ent->v.rendercolor.z;
-
-	state->aiment = 0;
-	if( ent->v.aiment )
-	{
-		state->aiment = ENTINDEX( ent->v.aiment );
-	}
-
-	state->owner = 0;
-	if( ent->v.owner )
-	{
-		int owner = ENTINDEX( ent->v.owner );
-
-		// Only care if owned by a player
-		if( owner >= 1 && owner <= gpGlobals->maxClients )
-		{
-			state->owner = owner;	
-		}
-	}
-
-	state->onground = 0;
-	if( ent->v.groundentity )
-	{
-		state->onground = ENTINDEX( ent->v.groundentity );
-	}
-
-	// HACK:  Somewhat...
-	// Class is overridden for non-players to signify a breakable glass object ( sort of a class? )
-	if( !player )
-	{
-		state->playerclass  = ent->v.playerclass;
-	}
-
-	// Special stuff for players only
-	if( player )
-	{
-		memcpy( state->basevelocity, ent->v.basevelocity, 3 * sizeof(float) );
+	// the state itself is the same for every host, only pack it once a frame
+	if( !g_PackCache.Copy( state, e, ent, player ))
+		PackEntityState( state, e, ent, player );
 
-		state->weaponmodel	= MODEL_INDEX( STRING( ent->v.weaponmodel ) );
-		state->gaitsequence	= ent->v.gaitsequence;
-		state->spectator	= ent->v.flags & FL_SPECTATOR;
-		state->friction		= ent->v.friction;
-
-		state->gravity		= ent->v.gravity;
-		//state->team		= ent->v.team;
-
-		state->usehull		= ( ent->v.flags & FL_DUCKING ) ? 1 : 0;
-		state->health		= (int)ent->v.health;
-	}
-
-	if( ( Entity = CBaseEntity::Instance( ent ))
-	    && Entity->Classify() != CLASS_NONE
-	    && Entity->Classify() != CLASS_MACHINE )
-	{
-		SetBits( state->eflags, EFLAG_FLESH_SOUND );
-	}
-	else
-	{
-		ClearBits( state->eflags, EFLAG_FLESH_SOUND );
-	}
+	// far away and small entities are only refreshed every so often
+	g_NetLOD.Apply( state, e, ent, host );
 
 	return 1;
 }
@@ -1855,6 +1774,8 @@ void CmdStart( const edict_t *player, const struct usercmd_s *cmd, unsigned int
 	}
 
 	pl->random_seed = random_seed;
+
+	g_LagCompensation.SetCommandTime( pl, cmd->lerp_msec );
 }
 
 /*
@@ -1988,5 +1909,6 @@ AllowLagCompensation
 */
 int AllowLagCompensation( void )
 {
-	return 1;
+	// the engine must not rewind players on top of our own lag compensation
+	return sv_lagcomp.value ? 0 : 1;
 }
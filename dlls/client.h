@@ -22,6 +22,7 @@ extern void ClientDisconnect( edict_t *pEntity );
 extern void ClientKill( edict_t *pEntity );
 extern void ClientPutInServer( edict_t *pEntity );
 extern void ClientCommand( edict_t *pEntity );
+extern void Host_SayText( edict_t *pEntity, int teamonly, char *p );
 extern void ClientUserInfoChanged( edict_t *pEntity, char *infobuffer );
 extern void ServerActivate( edict_t *pEdictList, int edictCount, int clientMax );
 extern void ServerDeactivate( void );
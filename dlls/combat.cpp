@@ -30,6 +30,8 @@
 #include "weapons.h"
 #include "func_break.h"
 #include "game.h"
+#include "playerroster.h"
+#include "lagcomp.h"
 
 extern DLL_GLOBAL Vector		g_vecAttackDir;
 extern DLL_GLOBAL int			g_iSkillLevel;
@@ -1017,6 +1019,9 @@ void RadiusDamage( Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacke
 	if( !pevAttacker )
 		pevAttacker = pevInflictor;
 
+	// everyone in the blast is hurt once, after the search is done
+	ClearMultiDamage();
+
 	// iterate on all entities in the vicinity.
 	while( ( pEntity = UTIL_FindEntityInSphere( pEntity, vecSrc, flRadius ) ) != NULL )
 	{
@@ -1061,17 +1066,17 @@ void RadiusDamage( Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacke
 				// ALERT( at_console, "hit %s\n", STRING( pEntity->pev->classname ) );
 				if( tr.flFraction != 1.0f )
 				{
-					ClearMultiDamage();
 					pEntity->TraceAttack( pevInflictor, flAdjustedDamage, ( tr.vecEndPos - vecSrc ).Normalize(), &tr, bitsDamageType );
-					ApplyMultiDamage( pevInflictor, pevAttacker );
 				}
 				else
 				{
-					pEntity->TakeDamage ( pevInflictor, pevAttacker, flAdjustedDamage, bitsDamageType );
+					AddMultiDamage( pevInflictor, pEntity, flAdjustedDamage, bitsDamageType );
 				}
 			}
 		}
 	}
+
+	ApplyMultiDamage( pevInflictor, pevAttacker );
 }
 
 void CBaseMonster::RadiusDamage( entvars_t *pevInflictor, entvars_t *pevAttacker, float flDamage, int iClassIgnore, int bitsDamageType )
@@ -1477,6 +1482,9 @@ Vector CBaseEntity::FireBulletsPlayer( ULONG cShots, Vector vecSrc, Vector vecDi
 	ClearMultiDamage();
 	gMultiDamage.type = DMG_BULLET | DMG_NEVERGIB;
 
+	// trace against other players where the shooter saw them
+	g_LagCompensation.Start( IsPlayer() ? (CBasePlayer *)this : NULL );
+
 	for( ULONG iShot = 1; iShot <= cShots; iShot++ )
 	{
 		//Use player's random seed.
@@ -1544,6 +1552,9 @@ Vector CBaseEntity::FireBulletsPlayer( ULONG cShots, Vector vecSrc, Vector vecDi
 		// make bullet trails
 		UTIL_BubbleTrail( vecSrc, tr.vecEndPos, (int)( ( flDistance * tr.flFraction ) / 64.0f ) );
 	}
+
+	g_LagCompensation.Finish();
+
 	ApplyMultiDamage( pev, pevAttacker );
 
 	return Vector( x * vecSpread.x, y * vecSpread.y, 0.0 );
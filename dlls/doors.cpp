@@ -22,6 +22,7 @@
 #include "util.h"
 #include "cbase.h"
 #include "doors.h"
+#include "nodes.h"
 #include "game.h"
 #include "weapons.h"
 
@@ -651,6 +652,10 @@ void CBaseDoor::DoorHitTop( void )
 	ASSERT( m_toggle_state == TS_GOING_UP );
 	m_toggle_state = TS_AT_TOP;
 
+	// monsters that can't open doors may path through it now
+	if( FBitSet( pev->flags, FL_GRAPHED ) )
+		WorldGraph.InvalidatePathCache();
+
 	// toggle-doors don't come down automatically, they wait for refire.
 	if( FBitSet( pev->spawnflags, SF_DOOR_NO_AUTO_RETURN ) )
 	{
@@ -690,6 +695,9 @@ void CBaseDoor::DoorGoDown( void )
 #endif // DOOR_ASSERT
 	m_toggle_state = TS_GOING_DOWN;
 
+	if( FBitSet( pev->flags, FL_GRAPHED ) )
+		WorldGraph.InvalidatePathCache();
+
 	SetMoveDone( &CBaseDoor::DoorHitBottom );
 	if( FClassnameIs( pev, "func_door_rotating" ) )//rotating door
 		AngularMove( m_vecAngle1, pev->speed );
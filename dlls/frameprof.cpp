@@ -0,0 +1,364 @@
+/***
+*
+*   Server frame profiler, timings per entry point and classname
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "frameprof.h"
+
+#if !XASH_WIN32
+#include <time.h>
+#endif
+
+CFrameProfiler g_FrameProf;
+
+static const char *s_szHookNames[PROF_NUM_HOOKS] =
+{
+	"StartFrame",
+	"PlayerPreThink",
+	"PlayerPostThink",
+	"Think",
+	"Touch",
+	"Use",
+	"Blocked",
+};
+
+CFrameProfiler::CFrameProfiler()
+{
+	m_fActive = FALSE;
+	m_iFrame = 0;
+	m_iChildTime = 0;
+	m_iFrameTime = 0;
+	m_iDepth = 0;
+	m_iNumEntries = 0;
+
+	Reset();
+	ResetStats();
+}
+
+// nanoseconds from an arbitrary start
+unsigned long long CFrameProfiler::Clock( void )
+{
+#if XASH_WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if( !frequency.QuadPart )
+		QueryPerformanceFrequency( &frequency );
+
+	QueryPerformanceCounter( &counter );
+
+	return (unsigned long long)( counter.QuadPart / frequency.QuadPart ) * 1000000000ULL
+		+ (unsigned long long)( counter.QuadPart % frequency.QuadPart ) * 1000000000ULL / frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+void CFrameProfiler::Reset( void )
+{
+	for( int i = 0; i < PROF_HASH_SIZE; i++ )
+		m_Index[i].entry = -1;
+
+	m_iNumIndexed = 0;
+}
+
+void CFrameProfiler::StartFrame( void )
+{
+	if( m_fActive && m_iFrameTime )
+	{
+		AddTime( &m_Frame, (unsigned int)Q_min( m_iFrameTime, 0xFFFFFFFFULL ));
+		m_iSampledFrames++;
+	}
+
+	m_iFrameTime = 0;
+	m_iChildTime = 0;
+	m_iDepth = 0;
+
+	// the entry points only look at this, so it can't change in the middle of a frame
+	int sample = Q_max( (int)sv_prof_sample.value, 1 );
+
+	m_iFrame++;
+	m_fActive = ( sv_prof_enable.value && !( m_iFrame % sample )) ? TRUE : FALSE;
+
+	if( !sv_prof_enable.value || sv_prof_log.value <= 0.0f )
+		return;
+
+	if( m_flNextLog > gpGlobals->time + sv_prof_log.value )
+		m_flNextLog = gpGlobals->time;	// new map, time started over
+
+	if( m_flNextLog > gpGlobals->time )
+		return;
+
+	if( m_flNextLog )
+	{
+		Log();
+		ResetStats();
+	}
+
+	m_flNextLog = gpGlobals->time + sv_prof_log.value;
+}
+
+int CFrameProfiler::Lookup( int hook, string_t classname )
+{
+	unsigned int hash = ( (unsigned int)classname * 31 + hook ) * 2654435761U;
+	int slot = ( hash >> 16 ) & ( PROF_HASH_SIZE - 1 );
+	int i;
+
+	for( ; m_Index[slot].entry != -1; slot = ( slot + 1 ) & ( PROF_HASH_SIZE - 1 ))
+	{
+		if( m_Index[slot].classname == classname && m_Index[slot].hook == hook )
+			return m_Index[slot].entry;
+	}
+
+	// first time this string is seen, keep the probe chains short
+	if( m_iNumIndexed >= PROF_HASH_SIZE * 3 / 4 )
+	{
+		m_iDropped++;
+		return -1;
+	}
+
+	const char *pszName = classname ? STRING( classname ) : "";
+	int entry = -1;
+
+	for( i = 0; i < m_iNumEntries; i++ )
+	{
+		if( m_Entries[i].hook == hook && !strncmp( m_Entries[i].name, pszName, PROF_NAME_LENGTH - 1 ))
+		{
+			entry = i;
+			break;
+		}
+	}
+
+	if( entry == -1 )
+	{
+		if( m_iNumEntries >= PROF_MAX_ENTRIES )
+		{
+			m_iDropped++;
+			return -1;
+		}
+
+		entry = m_iNumEntries++;
+
+		memset( &m_Entries[entry], 0, sizeof( profentry_t ));
+		m_Entries[entry].hook = hook;
+		strlcpy( m_Entries[entry].name, pszName, PROF_NAME_LENGTH );
+	}
+
+	m_Index[slot].classname = classname;
+	m_Index[slot].hook = hook;
+	m_Index[slot].entry = entry;
+	m_iNumIndexed++;
+
+	return entry;
+}
+
+unsigned long long CFrameProfiler::Begin( void )
+{
+	unsigned long long savedChild = m_iChildTime;
+
+	m_iChildTime = 0;
+	m_iDepth++;
+
+	return savedChild;
+}
+
+void CFrameProfiler::End( int entry, unsigned long long start, unsigned long long savedChild )
+{
+	unsigned long long elapsed = Clock() - start;
+	unsigned long long self = elapsed > m_iChildTime ? elapsed - m_iChildTime : 0;
+
+	AddTime( &m_Entries[entry].stat, (unsigned int)Q_min( self, 0xFFFFFFFFULL ));
+
+	// the caller doesn't get charged for this call
+	m_iChildTime = savedChild + elapsed;
+
+	if( --m_iDepth == 0 )
+		m_iFrameTime += elapsed;
+}
+
+void CFrameProfiler::AddTime( profstat_t *pStat, unsigned int ns )
+{
+	int bucket = ns;
+
+	// two buckets per power of two
+	if( ns >= 2 )
+	{
+		int msb = 0;
+
+		for( unsigned int v = ns; v >>= 1; )
+			msb++;
+
+		bucket = msb * 2 + (( ns >> ( msb - 1 )) & 1 );
+	}
+
+	pStat->count++;
+	pStat->total += ns;
+	pStat->buckets[bucket]++;
+
+	if( ns > pStat->max )
+		pStat->max = ns;
+}
+
+// upper end of the bucket holding the given fraction of the calls
+unsigned int CFrameProfiler::Percentile( profstat_t *pStat, float fraction )
+{
+	unsigned int target = (unsigned int)( pStat->count * fraction );
+	unsigned int seen = 0;
+
+	for( int i = 0; i < PROF_BUCKETS; i++ )
+	{
+		seen += pStat->buckets[i];
+
+		if( seen > target )
+		{
+			if( i < 2 )
+				return i;
+
+			int msb = i / 2;
+			unsigned long long upper = ( 1ULL << msb ) + ( (unsigned long long)( i & 1 ) + 1 ) * ( 1ULL << ( msb - 1 ));
+
+			return (unsigned int)Q_min( upper, (unsigned long long)pStat->max );
+		}
+	}
+
+	return pStat->max;
+}
+
+void CFrameProfiler::ResetStats( void )
+{
+	for( int i = 0; i < m_iNumEntries; i++ )
+		memset( &m_Entries[i].stat, 0, sizeof( profstat_t ));
+
+	memset( &m_Frame, 0, sizeof( m_Frame ));
+	m_iSampledFrames = 0;
+	m_iDropped = 0;
+
+	m_flResetTime = gpGlobals ? gpGlobals->time : 0.0f;
+	m_flNextLog = 0.0f;
+}
+
+// fills pEntries with the entries of a hook, or all of them for -1, most time first
+int CFrameProfiler::SortEntries( int *pEntries, int hook )
+{
+	int i, j, count = 0;
+
+	for( i = 0; i < m_iNumEntries; i++ )
+	{
+		profentry_t *pEntry = &m_Entries[i];
+
+		if( !pEntry->stat.count || ( hook != -1 && pEntry->hook != hook ))
+			continue;
+
+		for( j = count; j > 0 && m_Entries[pEntries[j - 1]].stat.total < pEntry->stat.total; j-- )
+			pEntries[j] = pEntries[j - 1];
+
+		pEntries[j] = i;
+		count++;
+	}
+
+	return count;
+}
+
+void CFrameProfiler::Log( void )
+{
+	int entries[PROF_MAX_ENTRIES];
+	int count = SortEntries( entries, -1 );
+
+	UTIL_LogPrintf( "Frame profile: %u frames, p50 %.0f us, p99 %.0f us, max %.0f us\n", m_iSampledFrames,
+		Percentile( &m_Frame, 0.5f ) / 1000.0f, Percentile( &m_Frame, 0.99f ) / 1000.0f, m_Frame.max / 1000.0f );
+
+	for( int i = 0; i < count && i < PROF_LOG_TOP; i++ )
+	{
+		profentry_t *pEntry = &m_Entries[entries[i]];
+
+		UTIL_LogPrintf( "Frame profile: %s \"%s\" %u calls, %.2f ms, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+			s_szHookNames[pEntry->hook], pEntry->name, pEntry->stat.count, pEntry->stat.total / 1000000.0,
+			Percentile( &pEntry->stat, 0.5f ) / 1000.0f, Percentile( &pEntry->stat, 0.99f ) / 1000.0f,
+			pEntry->stat.max / 1000.0f );
+	}
+}
+
+void CFrameProfiler::ReportStats( int hook )
+{
+	int entries[PROF_MAX_ENTRIES];
+	float elapsed = Q_max( gpGlobals->time - m_flResetTime, 0.001f );
+
+	ALERT( at_console, "Frame profile: %s, 1 in %d frames, %.1f seconds, %u frames timed, %u calls not recorded\n",
+		sv_prof_enable.value ? "enabled" : "disabled", Q_max( (int)sv_prof_sample.value, 1 ), elapsed,
+		m_iSampledFrames, m_iDropped );
+
+	if( m_Frame.count )
+	{
+		ALERT( at_console, "  game dll per frame: avg %.1f us, p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+			m_Frame.total / m_Frame.count / 1000.0, Percentile( &m_Frame, 0.5f ) / 1000.0f,
+			Percentile( &m_Frame, 0.9f ) / 1000.0f, Percentile( &m_Frame, 0.99f ) / 1000.0f, m_Frame.max / 1000.0f );
+	}
+
+	for( int h = 0; h < PROF_NUM_HOOKS; h++ )
+	{
+		if( hook != -1 && h != hook )
+			continue;
+
+		int count = SortEntries( entries, h );
+
+		if( !count )
+			continue;
+
+		ALERT( at_console, "  %s:%*s calls   total ms    avg us    p50 us    p90 us    p99 us    max us\n",
+			s_szHookNames[h], (int)( 24 - strlen( s_szHookNames[h] )), "" );
+
+		// a single entry point is listed in full
+		for( int i = 0; i < count && ( hook != -1 || i < PROF_REPORT_TOP ); i++ )
+		{
+			profstat_t *pStat = &m_Entries[entries[i]].stat;
+
+			ALERT( at_console, "    %-24s %8u %10.2f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+				m_Entries[entries[i]].name[0] ? m_Entries[entries[i]].name : "-", pStat->count,
+				pStat->total / 1000000.0, pStat->total / pStat->count / 1000.0,
+				Percentile( pStat, 0.5f ) / 1000.0f, Percentile( pStat, 0.9f ) / 1000.0f,
+				Percentile( pStat, 0.99f ) / 1000.0f, pStat->max / 1000.0f );
+		}
+
+		if( hook == -1 && count > PROF_REPORT_TOP )
+			ALERT( at_console, "    (%d more, sv_prof %s lists them all)\n", count - PROF_REPORT_TOP, s_szHookNames[h] );
+	}
+}
+
+// sv_prof [reset | <entry point>]
+void FrameProf_f( void )
+{
+	int hook = -1;
+
+	if( CMD_ARGC() > 1 )
+	{
+		if( FStrEq( CMD_ARGV( 1 ), "reset" ))
+		{
+			g_FrameProf.ResetStats();
+			ALERT( at_console, "Frame profile reset\n" );
+			return;
+		}
+
+		for( hook = 0; hook < PROF_NUM_HOOKS; hook++ )
+		{
+			if( !stricmp( CMD_ARGV( 1 ), s_szHookNames[hook] ))
+				break;
+		}
+
+		if( hook == PROF_NUM_HOOKS )
+		{
+			ALERT( at_console, "Usage: sv_prof [reset | StartFrame | PlayerPreThink | PlayerPostThink | Think | Touch | Use | Blocked]\n" );
+			return;
+		}
+	}
+
+	g_FrameProf.ReportStats( hook );
+}
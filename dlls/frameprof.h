@@ -0,0 +1,144 @@
+/***
+*
+*   Server frame profiler, timings per entry point and classname
+*
+***/
+#pragma once
+#if !defined(FRAMEPROF_H)
+#define FRAMEPROF_H
+
+#define PROF_MAX_ENTRIES	512	// classname and entry point pairs
+#define PROF_HASH_SIZE		4096	// power of two, entities may each have their own classname string
+#define PROF_BUCKETS		64	// half octaves of nanoseconds, up to about 4 seconds
+#define PROF_NAME_LENGTH	32
+#define PROF_REPORT_TOP		10	// entries per entry point in sv_prof
+#define PROF_LOG_TOP		8	// entries written per periodic log
+
+enum
+{
+	PROF_STARTFRAME = 0,
+	PROF_PRETHINK,
+	PROF_POSTTHINK,
+	PROF_THINK,
+	PROF_TOUCH,
+	PROF_USE,
+	PROF_BLOCKED,
+	PROF_NUM_HOOKS
+};
+
+typedef struct profstat_s
+{
+	unsigned int	count;
+	unsigned int	max;		// nanoseconds
+	double		total;		// nanoseconds
+	unsigned int	buckets[PROF_BUCKETS];
+} profstat_t;
+
+typedef struct profentry_s
+{
+	int		hook;
+	char		name[PROF_NAME_LENGTH];
+	profstat_t	stat;
+} profentry_t;
+
+// classname strings of the current map to their entry
+typedef struct profindex_s
+{
+	string_t	classname;
+	short		hook;
+	short		entry;		// -1 for a free slot
+} profindex_t;
+
+//=========================================================
+// CFrameProfiler - times the calls the engine makes into
+// the game dll each frame and adds them up per entry point
+// and classname in a fixed table, with a histogram of call
+// times for the percentiles.
+//
+// Times are exclusive, a touch that happens inside a think
+// is charged to the touch only.  With sv_prof_sample set to
+// N only every Nth frame is timed, the other frames cost a
+// test of one flag per call.
+//=========================================================
+class CFrameProfiler
+{
+public:
+	CFrameProfiler();
+
+	void StartFrame( void );
+	void Reset( void );		// new map, classnames are allocated again
+
+	BOOL IsActive( void ) { return m_fActive; }
+	int Lookup( int hook, string_t classname );
+
+	unsigned long long Begin( void );
+	void End( int entry, unsigned long long start, unsigned long long savedChild );
+
+	void ReportStats( int hook );
+	void ResetStats( void );
+
+	static unsigned long long Clock( void );
+
+private:
+	void AddTime( profstat_t *pStat, unsigned int ns );
+	unsigned int Percentile( profstat_t *pStat, float fraction );
+	int SortEntries( int *pEntries, int hook );
+	void Log( void );
+
+	BOOL m_fActive;
+	unsigned int m_iFrame;
+	float m_flResetTime;
+	float m_flNextLog;
+
+	unsigned long long m_iChildTime;	// time spent in calls nested in the current one
+	unsigned long long m_iFrameTime;	// time spent in the game dll this frame
+	int m_iDepth;
+
+	profentry_t m_Entries[PROF_MAX_ENTRIES];
+	int m_iNumEntries;
+	profindex_t m_Index[PROF_HASH_SIZE];
+	int m_iNumIndexed;
+	unsigned int m_iDropped;
+
+	profstat_t m_Frame;
+	unsigned int m_iSampledFrames;
+};
+
+extern CFrameProfiler g_FrameProf;
+
+//=========================================================
+// CProfScope - times the rest of the enclosing block when
+// the profiler is running.
+//=========================================================
+class CProfScope
+{
+public:
+	CProfScope( int hook, string_t classname )
+	{
+		m_iEntry = -1;
+
+		if( !g_FrameProf.IsActive() )
+			return;
+
+		m_iEntry = g_FrameProf.Lookup( hook, classname );
+		if( m_iEntry == -1 )
+			return;
+
+		m_iSavedChild = g_FrameProf.Begin();
+		m_iStart = CFrameProfiler::Clock();
+	}
+
+	~CProfScope()
+	{
+		if( m_iEntry != -1 )
+			g_FrameProf.End( m_iEntry, m_iStart, m_iSavedChild );
+	}
+
+private:
+	int m_iEntry;
+	unsigned long long m_iStart;
+	unsigned long long m_iSavedChild;
+};
+
+extern void FrameProf_f( void );
+#endif // FRAMEPROF_H
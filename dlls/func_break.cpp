@@ -738,6 +738,7 @@ void CBreakable::Die( void )
 
 	// Don't fire something that could fire myself
 	pev->targetname = 0;
+	UTIL_NameRegistryTouch( edict() );
 
 	pev->solid = SOLID_NOT;
 
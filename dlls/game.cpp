@@ -16,6 +16,15 @@
 #include "eiface.h"
 #include "util.h"
 #include "game.h"
+#include "spatialindex.h"
+#include "cbase.h"
+#include "nodes.h"
+#include "nameregistry.h"
+#include "packcache.h"
+#include "netlod.h"
+#include "msgstats.h"
+#include "frameprof.h"
+#include "bot.h"
 #include "vcs_info.h"
 
 static cvar_t build_commit = { "sv_game_build_commit", g_VCSInfo_Commit };
@@ -40,6 +49,7 @@ cvar_t monsteryawspeedfix	= { "monsteryawspeedfix", "1", FCVAR_SERVER };
 cvar_t corpsephysics = { "corpsephysics", "0", FCVAR_SERVER };
 cvar_t pushablemode = { "pushablemode", "0", FCVAR_SERVER };
 cvar_t forcerespawn	= { "mp_forcerespawn","1", FCVAR_SERVER };
+cvar_t spawnweighted	= { "mp_spawnweighted","1", FCVAR_SERVER };
 cvar_t flashlight	= { "mp_flashlight","0", FCVAR_SERVER };
 cvar_t aimcrosshair	= { "mp_autocrosshair","1", FCVAR_SERVER };
 cvar_t decalfrequency	= { "decalfrequency","30", FCVAR_SERVER };
@@ -404,6 +414,27 @@ cvar_t	sk_player_leg3	= { "sk_player_leg3","1" };
 
 cvar_t sv_pushable_fixed_tick_fudge = { "sv_pushable_fixed_tick_fudge", "15" };
 cvar_t sv_busters = { "sv_busters", "0" };
+cvar_t sv_spatialindex = { "sv_spatialindex", "1" };
+cvar_t sv_nodegrid = { "sv_nodegrid", "1" };
+cvar_t sv_routethreads = { "sv_routethreads", "-1" };	// -1 is one less than the number of CPUs
+cvar_t sv_routequeue = { "sv_routequeue", "1" };
+cvar_t sv_nameregistry = { "sv_nameregistry", "1" };
+cvar_t sv_lagcomp = { "sv_lagcomp", "1", FCVAR_SERVER };
+cvar_t sv_lagcomp_maxunlag = { "sv_lagcomp_maxunlag", "0.5" };
+cvar_t sv_lagcomp_debug = { "sv_lagcomp_debug", "0" };
+cvar_t sv_packcache = { "sv_packcache", "1" };
+cvar_t sv_netlod = { "sv_netlod", "1", FCVAR_SERVER };
+cvar_t sv_netlod_budget = { "sv_netlod_budget", "64" };
+cvar_t sv_netlod_near = { "sv_netlod_near", "512" };
+cvar_t sv_netlod_maxinterval = { "sv_netlod_maxinterval", "0.5" };
+cvar_t sv_playerstate = { "sv_playerstate", "1" };
+cvar_t sv_msgstats_enable = { "sv_msgstats_enable", "0" };
+cvar_t sv_msgstats_log = { "sv_msgstats_log", "0" };
+cvar_t sv_prof_enable = { "sv_prof_enable", "0" };
+cvar_t sv_prof_sample = { "sv_prof_sample", "1" };
+cvar_t sv_prof_log = { "sv_prof_log", "0" };
+cvar_t bot_profile = { "bot_profile", "2" };
+cvar_t bot_seed = { "bot_seed", "1" };
 
 // Register your console variables here
 // This gets called one time when the game is initialied
@@ -440,6 +471,7 @@ void GameDLLInit( void )
 	CVAR_REGISTER( &corpsephysics );
 	CVAR_REGISTER( &pushablemode );
 	CVAR_REGISTER( &forcerespawn );
+	CVAR_REGISTER( &spawnweighted );
 	CVAR_REGISTER( &flashlight );
 	CVAR_REGISTER( &aimcrosshair );
 	CVAR_REGISTER( &decalfrequency );
@@ -453,6 +485,47 @@ void GameDLLInit( void )
 	CVAR_REGISTER( &mp_chattime );
 	CVAR_REGISTER( &sv_busters );
 
+	CVAR_REGISTER( &sv_spatialindex );
+	ADD_SERVER_COMMAND( "sv_spatialstats", SpatialIndex_Stats_f );
+
+	CVAR_REGISTER( &sv_nodegrid );
+	CVAR_REGISTER( &sv_routethreads );
+	CVAR_REGISTER( &sv_routequeue );
+	ADD_SERVER_COMMAND( "sv_nodestats", NodeGraph_Stats_f );
+
+	CVAR_REGISTER( &sv_nameregistry );
+	ADD_SERVER_COMMAND( "sv_namestats", NameRegistry_Stats_f );
+
+	CVAR_REGISTER( &sv_lagcomp );
+	CVAR_REGISTER( &sv_lagcomp_maxunlag );
+	CVAR_REGISTER( &sv_lagcomp_debug );
+
+	CVAR_REGISTER( &sv_packcache );
+	ADD_SERVER_COMMAND( "sv_packstats", PackCache_Stats_f );
+
+	CVAR_REGISTER( &sv_netlod );
+	CVAR_REGISTER( &sv_netlod_budget );
+	CVAR_REGISTER( &sv_netlod_near );
+	CVAR_REGISTER( &sv_netlod_maxinterval );
+	ADD_SERVER_COMMAND( "sv_netlodstats", NetLOD_Stats_f );
+
+	CVAR_REGISTER( &sv_playerstate );
+
+	g_MessageStats.Init();
+	CVAR_REGISTER( &sv_msgstats_enable );
+	CVAR_REGISTER( &sv_msgstats_log );
+	ADD_SERVER_COMMAND( "sv_msgstats", MessageStats_f );
+
+	CVAR_REGISTER( &sv_prof_enable );
+	CVAR_REGISTER( &sv_prof_sample );
+	CVAR_REGISTER( &sv_prof_log );
+	ADD_SERVER_COMMAND( "sv_prof", FrameProf_f );
+
+	CVAR_REGISTER( &bot_profile );
+	CVAR_REGISTER( &bot_seed );
+	ADD_SERVER_COMMAND( "bot_add", BotAdd_f );
+	ADD_SERVER_COMMAND( "bot_kick", BotKick_f );
+
 
 // REGISTER CVARS FOR SKILL LEVEL STUFF
 	// Agrunt
@@ -33,6 +33,7 @@ extern cvar_t monsteryawspeedfix;
 extern cvar_t corpsephysics;
 extern cvar_t pushablemode;
 extern cvar_t forcerespawn;
+extern cvar_t spawnweighted;
 extern cvar_t flashlight;
 extern cvar_t aimcrosshair;
 extern cvar_t decalfrequency;
@@ -43,6 +44,27 @@ extern cvar_t allowmonsters;
 extern cvar_t bhopcap;
 extern cvar_t sv_pushable_fixed_tick_fudge;
 extern cvar_t sv_busters;
+extern cvar_t sv_spatialindex;
+extern cvar_t sv_nodegrid;
+extern cvar_t sv_routethreads;
+extern cvar_t sv_routequeue;
+extern cvar_t sv_nameregistry;
+extern cvar_t sv_lagcomp;
+extern cvar_t sv_lagcomp_maxunlag;
+extern cvar_t sv_lagcomp_debug;
+extern cvar_t sv_packcache;
+extern cvar_t sv_netlod;
+extern cvar_t sv_netlod_budget;
+extern cvar_t sv_netlod_near;
+extern cvar_t sv_netlod_maxinterval;
+extern cvar_t sv_playerstate;
+extern cvar_t sv_msgstats_enable;
+extern cvar_t sv_msgstats_log;
+extern cvar_t sv_prof_enable;
+extern cvar_t sv_prof_sample;
+extern cvar_t sv_prof_log;
+extern cvar_t bot_profile;
+extern cvar_t bot_seed;
 
 // Engine Cvars
 extern cvar_t *g_psv_gravity;
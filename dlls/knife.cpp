@@ -21,6 +21,8 @@
 #include "nodes.h"
 #include "player.h"
 #include "gamerules.h"
+#include "playerroster.h"
+#include "lagcomp.h"
 
 #define	CROWBAR_BODYHIT_VOLUME 128
 #define	CROWBAR_WALLHIT_VOLUME 512
@@ -194,6 +196,7 @@ void CCrowbar::SwingAgain( void )
 int CCrowbar::Swing( int fFirst )
 {
 	int fDidHit = FALSE;
+	int fHitWorld = FALSE;
 
 	TraceResult tr;
 
@@ -201,6 +204,9 @@ int CCrowbar::Swing( int fFirst )
 	Vector vecSrc = m_pPlayer->GetGunPosition();
 	Vector vecEnd = vecSrc + gpGlobals->v_forward * 32.0f;
 
+#if !CLIENT_DLL
+	g_LagCompensation.Start( m_pPlayer );
+#endif
 	UTIL_TraceLine( vecSrc, vecEnd, dont_ignore_monsters, ENT( m_pPlayer->pev ), &tr );
 
 #if !CLIENT_DLL
@@ -217,7 +223,23 @@ int CCrowbar::Swing( int fFirst )
 			vecEnd = tr.vecEndPos;	// This is the point on the actual surface (the hull could have hit space)
 		}
 	}
+
+	g_LagCompensation.Finish();
+
+	if( tr.flFraction < 1.0f )
+	{
+		CBaseEntity *pHit = CBaseEntity::Instance( tr.pHit );
+		fHitWorld = !pHit || pHit->Classify() == CLASS_NONE || pHit->Classify() == CLASS_MACHINE;
+	}
+#endif
+	int flags;
+#if CLIENT_WEAPONS
+	flags = FEV_NOTHOST;
+#else
+	flags = 0;
 #endif
+	PLAYBACK_EVENT_FULL( flags, m_pPlayer->edict(), m_usCrowbar, 0.0, g_vecZero, g_vecZero, 0, 0, 0, 0, fHitWorld, 0 );
+
 	if( tr.flFraction >= 1.0f )
 	{
 		if( fFirst )
@@ -259,9 +281,8 @@ int CCrowbar::Swing( int fFirst )
 		fDidHit = TRUE;
 		CBaseEntity *pEntity = CBaseEntity::Instance( tr.pHit );
 
-		// play thwack, smack, or dong sound
-                float flVol = 1.0f;
-                int fHitWorld = TRUE;
+		// play thwack or smack sound, the world hit sound comes from the swing event
+		float flVol = 1.0f;
 
 		if( pEntity )
 		{
@@ -317,32 +338,8 @@ int CCrowbar::Swing( int fFirst )
 			}
 		}
 
-		// play texture hit sound
-		// UNDONE: Calculate the correct point of intersection when we hit with the hull instead of the line
-
 		if( fHitWorld )
 		{
-			float fvolbar = TEXTURETYPE_PlaySound( &tr, vecSrc, vecSrc + ( vecEnd - vecSrc ) * 2.0f, BULLET_PLAYER_CROWBAR );
-
-			if( g_pGameRules->IsMultiplayer() )
-			{
-				// override the volume here, cause we don't play texture sounds in multiplayer, 
-				// and fvolbar is going to be 0 from the above call.
-
-				fvolbar = 1.0f;
-			}
-
-			// also play crowbar strike
-			switch( RANDOM_LONG( 0, 1 ) )
-			{
-			case 0:
-				EMIT_SOUND_DYN( ENT( m_pPlayer->pev ), CHAN_ITEM, "weapons/cbar_hit1.wav", fvolbar, ATTN_NORM, 0, 98 + RANDOM_LONG( 0, 3 ) ); 
-				break;
-			case 1:
-				EMIT_SOUND_DYN( ENT( m_pPlayer->pev ), CHAN_ITEM, "weapons/cbar_hit2.wav", fvolbar, ATTN_NORM, 0, 98 + RANDOM_LONG( 0, 3 ) );
-				break;
-			}
-
 			// delay the decal a bit
 			m_trHit = tr;
 		}
@@ -367,6 +364,7 @@ int CCrowbar::Swing( int fFirst )
 int CCrowbar::HeavySwing( void )
 {
 	int fDidHit = FALSE;
+	int fHitWorld = FALSE;
 
 	TraceResult tr;
 
@@ -374,6 +372,9 @@ int CCrowbar::HeavySwing( void )
 	Vector vecSrc = m_pPlayer->GetGunPosition();
 	Vector vecEnd = vecSrc + gpGlobals->v_forward * 32.0f;
 
+#if !CLIENT_DLL
+	g_LagCompensation.Start( m_pPlayer );
+#endif
 	UTIL_TraceLine( vecSrc, vecEnd, dont_ignore_monsters, ENT( m_pPlayer->pev ), &tr );
 
 #if !CLIENT_DLL
@@ -388,7 +389,22 @@ int CCrowbar::HeavySwing( void )
 			vecEnd = tr.vecEndPos;
 		}
 	}
+
+	g_LagCompensation.Finish();
+
+	if( tr.flFraction < 1.0f )
+	{
+		CBaseEntity *pHit = CBaseEntity::Instance( tr.pHit );
+		fHitWorld = !pHit || pHit->Classify() == CLASS_NONE || pHit->Classify() == CLASS_MACHINE;
+	}
+#endif
+	int flags;
+#if CLIENT_WEAPONS
+	flags = FEV_NOTHOST;
+#else
+	flags = 0;
 #endif
+	PLAYBACK_EVENT_FULL( flags, m_pPlayer->edict(), m_usCrowbar, 0.0, g_vecZero, g_vecZero, 0, 0, 0, 0, fHitWorld, 1 );
 
 	if( tr.flFraction >= 1.0f )
 	{
@@ -410,7 +426,6 @@ int CCrowbar::HeavySwing( void )
 		CBaseEntity *pEntity = CBaseEntity::Instance( tr.pHit );
 
 		float flVol = 1.0f;
-		int fHitWorld = TRUE;
 
 		if( pEntity )
 		{
@@ -453,23 +468,6 @@ int CCrowbar::HeavySwing( void )
 
 		if( fHitWorld )
 		{
-			float fvolbar = TEXTURETYPE_PlaySound( &tr, vecSrc, vecSrc + ( vecEnd - vecSrc ) * 2.0f, BULLET_PLAYER_CROWBAR );
-
-			if( g_pGameRules->IsMultiplayer() )
-			{
-				fvolbar = 1.0f;
-			}
-
-			switch( RANDOM_LONG( 0, 1 ) )
-			{
-			case 0:
-				EMIT_SOUND_DYN( ENT( m_pPlayer->pev ), CHAN_ITEM, "weapons/cbar_hit1.wav", fvolbar, ATTN_NORM, 0, 98 + RANDOM_LONG( 0, 3 ) );
-				break;
-			case 1:
-				EMIT_SOUND_DYN( ENT( m_pPlayer->pev ), CHAN_ITEM, "weapons/cbar_hit2.wav", fvolbar, ATTN_NORM, 0, 98 + RANDOM_LONG( 0, 3 ) );
-				break;
-			}
-
 			m_trHit = tr;
 		}
 
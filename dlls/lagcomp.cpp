@@ -0,0 +1,217 @@
+/***
+*
+*   Server side lag compensation for player hitscan attacks
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "game.h"
+#include "playerroster.h"
+#include "lagcomp.h"
+
+CLagCompensation g_LagCompensation;
+
+static inline BOOL IsHittable( CBasePlayer *pPlayer )
+{
+	return pPlayer->IsAlive() && pPlayer->pev->solid != SOLID_NOT;
+}
+
+void CLagCompensation::Clear( void )
+{
+	memset( m_iHead, 0, sizeof( m_iHead ));
+	memset( m_iCount, 0, sizeof( m_iCount ));
+	memset( m_pOwner, 0, sizeof( m_pOwner ));
+	memset( m_flCommandTime, 0, sizeof( m_flCommandTime ));
+	m_iNumMoved = 0;
+	m_fActive = FALSE;
+}
+
+void CLagCompensation::RecordFrame( void )
+{
+	if( !sv_lagcomp.value )
+		return;
+
+	for( int i = 0; i < g_PlayerRoster.Count(); i++ )
+	{
+		CBasePlayer *pPlayer = g_PlayerRoster.Player( i );
+		int index = pPlayer->entindex();
+
+		// a new player in this slot, forget the old one's history
+		if( m_pOwner[index] != pPlayer )
+		{
+			m_pOwner[index] = pPlayer;
+			m_iCount[index] = 0;
+		}
+
+		if( m_iCount[index] && gpGlobals->time - m_Records[index][m_iHead[index]].time < LAGCOMP_INTERVAL )
+			continue;
+
+		m_iHead[index] = ( m_iHead[index] + 1 ) % LAGCOMP_HISTORY;
+		if( m_iCount[index] < LAGCOMP_HISTORY )
+			m_iCount[index]++;
+
+		lagrecord_t *pRecord = &m_Records[index][m_iHead[index]];
+
+		pRecord->time = gpGlobals->time;
+		pRecord->origin = pPlayer->pev->origin;
+		pRecord->angles = pPlayer->pev->angles;
+		pRecord->mins = pPlayer->pev->mins;
+		pRecord->maxs = pPlayer->pev->maxs;
+		pRecord->hittable = IsHittable( pPlayer );
+	}
+}
+
+void CLagCompensation::SetCommandTime( CBasePlayer *pPlayer, int lerp_msec )
+{
+	int index = pPlayer->entindex();
+	int ping, loss;
+
+	if( index < 1 || index > MAX_CLIENTS )
+		return;
+
+	PLAYER_CNX_STATS( pPlayer->edict(), &ping, &loss );
+
+	float window = Q_min( sv_lagcomp_maxunlag.value, LAGCOMP_MAX_WINDOW );
+	float latency = ( ping + lerp_msec ) * 0.001f;
+
+	if( latency > window )
+		latency = window;
+	if( latency < 0.0f )
+		latency = 0.0f;
+
+	m_flCommandTime[index] = gpGlobals->time - latency;
+}
+
+BOOL CLagCompensation::Rewind( CBasePlayer *pPlayer, int index, float time )
+{
+	lagrecord_t *pHistory = m_Records[index];
+	int count = m_iCount[index];
+	int newer = m_iHead[index];
+
+	if( !count || m_pOwner[index] != pPlayer || time >= pHistory[newer].time )
+		return FALSE;
+
+	// walk back to the first snapshot taken at or before the view time
+	int older = newer;
+
+	for( int i = 1; i < count; i++ )
+	{
+		if( pHistory[older].time <= time )
+			break;
+
+		newer = older;
+		older = ( older + LAGCOMP_HISTORY - 1 ) % LAGCOMP_HISTORY;
+	}
+
+	lagrecord_t *pOlder = &pHistory[older];
+	lagrecord_t *pNewer = &pHistory[newer];
+
+	// they weren't there to be hit, leave them alone
+	if( !pOlder->hittable )
+		return FALSE;
+
+	Vector origin = pOlder->origin;
+	Vector angles = pOlder->angles;
+
+	if( pNewer != pOlder && pNewer->hittable && pOlder->time < time
+		&& ( pNewer->origin - pOlder->origin ).Length() < LAGCOMP_TELEPORT_DIST )
+	{
+		float frac = ( time - pOlder->time ) / ( pNewer->time - pOlder->time );
+
+		origin = pOlder->origin + ( pNewer->origin - pOlder->origin ) * frac;
+		angles.y = UTIL_AngleMod( pOlder->angles.y + UTIL_AngleDiff( pNewer->angles.y, pOlder->angles.y ) * frac );
+	}
+
+	if( ( origin - pPlayer->pev->origin ).Length() < 0.1f && pOlder->mins == pPlayer->pev->mins )
+		return FALSE;
+
+	lagrecord_t *pSaved = &m_Saved[m_iNumMoved];
+
+	pSaved->origin = pPlayer->pev->origin;
+	pSaved->angles = pPlayer->pev->angles;
+	pSaved->mins = pPlayer->pev->mins;
+	pSaved->maxs = pPlayer->pev->maxs;
+	m_pMoved[m_iNumMoved++] = pPlayer;
+
+	pPlayer->pev->angles = angles;
+	if( pOlder->mins != pPlayer->pev->mins || pOlder->maxs != pPlayer->pev->maxs )
+		UTIL_SetSize( pPlayer->pev, pOlder->mins, pOlder->maxs );
+	UTIL_SetOrigin( pPlayer->pev, origin );
+
+	return TRUE;
+}
+
+void CLagCompensation::ShowBox( CBasePlayer *pShooter, const Vector &origin, const Vector &mins, const Vector &maxs )
+{
+	MESSAGE_BEGIN( MSG_ONE, SVC_TEMPENTITY, NULL, pShooter->pev );
+		WRITE_BYTE( TE_BOX );
+		WRITE_COORD( origin.x + mins.x );
+		WRITE_COORD( origin.y + mins.y );
+		WRITE_COORD( origin.z + mins.z );
+		WRITE_COORD( origin.x + maxs.x );
+		WRITE_COORD( origin.y + maxs.y );
+		WRITE_COORD( origin.z + maxs.z );
+		WRITE_SHORT( 20 );	// life in 0.1's
+		WRITE_BYTE( 255 );
+		WRITE_BYTE( 64 );
+		WRITE_BYTE( 64 );
+	MESSAGE_END();
+}
+
+void CLagCompensation::Start( CBasePlayer *pShooter )
+{
+	// nested attacks use the rewind that's already in place
+	if( m_fActive )
+		return;
+
+	m_iNumMoved = 0;
+
+	if( !sv_lagcomp.value || !pShooter || gpGlobals->maxClients <= 1 )
+		return;
+
+	int shooter = pShooter->entindex();
+
+	if( shooter < 1 || shooter > MAX_CLIENTS )
+		return;
+
+	float time = m_flCommandTime[shooter];
+
+	m_fActive = TRUE;
+
+	for( int i = 0; i < g_PlayerRoster.ActiveCount(); i++ )
+	{
+		CBasePlayer *pPlayer = g_PlayerRoster.ActivePlayer( i );
+
+		if( pPlayer == pShooter || !IsHittable( pPlayer ))
+			continue;
+
+		if( !Rewind( pPlayer, pPlayer->entindex(), time ))
+			continue;
+
+		if( sv_lagcomp_debug.value )
+			ShowBox( pShooter, pPlayer->pev->origin, pPlayer->pev->mins, pPlayer->pev->maxs );
+	}
+}
+
+void CLagCompensation::Finish( void )
+{
+	if( !m_fActive )
+		return;
+
+	for( int i = 0; i < m_iNumMoved; i++ )
+	{
+		CBasePlayer *pPlayer = m_pMoved[i];
+		lagrecord_t *pSaved = &m_Saved[i];
+
+		pPlayer->pev->angles = pSaved->angles;
+		if( pSaved->mins != pPlayer->pev->mins || pSaved->maxs != pPlayer->pev->maxs )
+			UTIL_SetSize( pPlayer->pev, pSaved->mins, pSaved->maxs );
+		UTIL_SetOrigin( pPlayer->pev, pSaved->origin );
+	}
+
+	m_iNumMoved = 0;
+	m_fActive = FALSE;
+}
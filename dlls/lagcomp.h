@@ -0,0 +1,62 @@
+/***
+*
+*   Server side lag compensation for player hitscan attacks
+*
+***/
+#pragma once
+#if !defined(LAGCOMP_H)
+#define LAGCOMP_H
+
+#define LAGCOMP_HISTORY			128		// snapshots kept per player
+#define LAGCOMP_INTERVAL		0.01f	// record at most this often, so the history covers over a second at any tickrate
+#define LAGCOMP_MAX_WINDOW		1.0f	// hard limit for sv_lagcomp_maxunlag
+#define LAGCOMP_TELEPORT_DIST	64.0f	// don't interpolate across a jump bigger than this between two snapshots
+
+typedef struct lagrecord_s
+{
+	float	time;
+	Vector	origin;
+	Vector	angles;
+	Vector	mins;
+	Vector	maxs;
+	BOOL	hittable;	// alive and solid
+} lagrecord_t;
+
+//=========================================================
+// CLagCompensation - ring buffer of player positions, one
+// per client slot, recorded from StartFrame.  Start() moves
+// every other player back to where the shooter saw them
+// when the usercmd was made, Finish() puts them back.
+//
+// The shooter's view time is set from CmdStart using the
+// engine's ping for the client and the usercmd lerp time.
+//=========================================================
+class CLagCompensation
+{
+public:
+	void Clear( void );
+	void RecordFrame( void );
+	void SetCommandTime( CBasePlayer *pPlayer, int lerp_msec );
+
+	void Start( CBasePlayer *pShooter );
+	void Finish( void );
+
+private:
+	BOOL Rewind( CBasePlayer *pPlayer, int index, float time );
+	void ShowBox( CBasePlayer *pShooter, const Vector &origin, const Vector &mins, const Vector &maxs );
+
+	lagrecord_t m_Records[MAX_CLIENTS + 1][LAGCOMP_HISTORY];
+	int m_iHead[MAX_CLIENTS + 1];	// newest record
+	int m_iCount[MAX_CLIENTS + 1];
+	CBasePlayer *m_pOwner[MAX_CLIENTS + 1];	// the history belongs to this player
+	float m_flCommandTime[MAX_CLIENTS + 1];
+
+	// players moved by the current Start()
+	lagrecord_t m_Saved[MAX_CLIENTS];
+	CBasePlayer *m_pMoved[MAX_CLIENTS];
+	int m_iNumMoved;
+	BOOL m_fActive;
+};
+
+extern CLagCompensation g_LagCompensation;
+#endif // LAGCOMP_H
@@ -221,6 +221,7 @@ void CMonsterMaker::MakeMonster( void )
 	{
 		// if I have a netname (overloaded), give the child monster that name as a targetname
 		pevCreate->targetname = pev->netname;
+		UTIL_NameRegistryTouch( ENT( pevCreate ) );
 	}
 
 	m_cLiveChildren++;// count this monster
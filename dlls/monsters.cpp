@@ -34,6 +34,7 @@
 #include "soundent.h"
 #include "gamerules.h"
 #include "game.h"
+#include "routequeue.h"
 
 #define MONSTER_CUT_CORNER_DIST		8 // 8 means the monster's bounding box is contained without the box of the node in WC
 
@@ -520,6 +521,9 @@ void CBaseMonster::MonsterThink( void )
 {
 	pev->nextthink = gpGlobals->time + 0.1f;// keep monster thinking.
 
+	// pick up the node route searched since the last think
+	FRouteQueued();
+
 	RunAI();
 
 	float flInterval = StudioFrameAdvance( ); // animate
@@ -554,7 +558,9 @@ void CBaseMonster::MonsterThink( void )
 
 	if( !MovementIsComplete() )
 	{
-		Move( flInterval );
+		// a node route that is still being searched for can't be followed yet
+		if( !FRouteQueued() )
+			Move( flInterval );
 	}
 #if _DEBUG	
 	else 
@@ -617,6 +623,13 @@ void CBaseMonster::RouteNew( void )
 {
 	m_Route[0].iType = 0;
 	m_iRouteIndex = 0;
+
+	// a route still being searched for is out of date too
+	if( m_iRouteRequest )
+	{
+		g_RouteQueue.Cancel( m_iRouteRequest );
+		m_iRouteRequest = 0;
+	}
 }
 
 //=========================================================
@@ -670,19 +683,19 @@ BOOL CBaseMonster::FRefreshRoute( void )
 			returnCode = TRUE;
 			break;
 		case MOVEGOAL_ENEMY:
-			returnCode = BuildRoute( m_vecEnemyLKP, bits_MF_TO_ENEMY, m_hEnemy );
+			returnCode = BuildRoute( m_vecEnemyLKP, bits_MF_TO_ENEMY, m_hEnemy, TRUE );
 			break;
 		case MOVEGOAL_LOCATION:
-			returnCode = BuildRoute( m_vecMoveGoal, bits_MF_TO_LOCATION, NULL );
+			returnCode = BuildRoute( m_vecMoveGoal, bits_MF_TO_LOCATION, NULL, TRUE );
 			break;
 		case MOVEGOAL_TARGETENT:
 			if( m_hTargetEnt != 0 )
 			{
-				returnCode = BuildRoute( m_hTargetEnt->pev->origin, bits_MF_TO_TARGETENT, m_hTargetEnt );
+				returnCode = BuildRoute( m_hTargetEnt->pev->origin, bits_MF_TO_TARGETENT, m_hTargetEnt, TRUE );
 			}
 			break;
 		case MOVEGOAL_NODE:
-			returnCode = FGetNodeRoute( m_vecMoveGoal );
+			returnCode = FGetNodeRoute( m_vecMoveGoal, TRUE );
 			//if( returnCode )
 			//	RouteSimplify( NULL );
 			break;
@@ -1464,13 +1477,13 @@ void CBaseMonster::AdvanceRoute( float distance )
 				int iLink;
 				WorldGraph.HashSearch( iSrcNode, iDestNode, iLink );
 
-				if( iLink >= 0 && WorldGraph.m_pLinkPool[iLink].m_pLinkEnt != NULL )
+				if( iLink >= 0 && WorldGraph.m_pLinkPool[iLink].m_iLinkEnt != 0 )
 				{
 					//ALERT( at_aiconsole, "A link. " );
-					if( WorldGraph.HandleLinkEnt( iSrcNode, WorldGraph.m_pLinkPool[iLink].m_pLinkEnt, m_afCapability, CGraph::NODEGRAPH_DYNAMIC ) )
+					if( WorldGraph.HandleLinkEnt( iSrcNode, WorldGraph.LinkEnt( WorldGraph.m_pLinkPool[iLink] ), m_afCapability, CGraph::NODEGRAPH_DYNAMIC ) )
 					{
 						//ALERT( at_aiconsole, "usable." );
-						entvars_t *pevDoor = WorldGraph.m_pLinkPool[iLink].m_pLinkEnt;
+						entvars_t *pevDoor = WorldGraph.LinkEnt( WorldGraph.m_pLinkPool[iLink] );
 						if( pevDoor )
 						{
 							m_flMoveWaitFinished = OpenDoorAndWait( pevDoor );
@@ -1513,9 +1526,10 @@ int CBaseMonster::RouteClassify( int iMoveFlag )
 }
 
 //=========================================================
-// BuildRoute
+// BuildRoute - with fQueue, the node route may be searched
+// for between frames, see FGetNodeRoute.
 //=========================================================
-BOOL CBaseMonster::BuildRoute( const Vector &vecGoal, int iMoveFlag, CBaseEntity *pTarget )
+BOOL CBaseMonster::BuildRoute( const Vector &vecGoal, int iMoveFlag, CBaseEntity *pTarget, BOOL fQueue )
 {
 	float flDist;
 	Vector vecApex;
@@ -1561,11 +1575,14 @@ BOOL CBaseMonster::BuildRoute( const Vector &vecGoal, int iMoveFlag, CBaseEntity
 	}
 
 	// last ditch, try nodes
-	if( FGetNodeRoute( vecGoal ) )
+	if( FGetNodeRoute( vecGoal, fQueue ) )
 	{
 		//ALERT( at_console, "Can get there on nodes\n" );
 		m_vecMoveGoal = vecGoal;
-		RouteSimplify( pTarget );
+
+		// a queued route is simplified by FRouteQueued
+		if( !m_iRouteRequest )
+			RouteSimplify( pTarget );
 		return TRUE;
 	}
 
@@ -1782,6 +1799,10 @@ void CBaseMonster::Move( float flInterval )
 	Vector		vecApex;
 	CBaseEntity	*pTargetEnt;
 
+	// Wait for a node route that is being searched for
+	if( FRouteQueued() )
+		return;
+
 	// Don't move if no valid route
 	if( FRouteClear() )
 	{
@@ -1793,6 +1814,9 @@ void CBaseMonster::Move( float flInterval )
 			TaskFail();
 			return;
 		}
+
+		if( FRouteQueued() )
+			return;
 	}
 
 	if( m_flMoveWaitFinished > gpGlobals->time )
@@ -1890,7 +1914,7 @@ void CBaseMonster::Move( float flInterval )
 				if( m_moveWaitTime > 0 && !( m_afMemory & bits_MEMORY_MOVE_FAILED ) )
 				{
 					FRefreshRoute();
-					if( FRouteClear() )
+					if( FRouteClear() && !m_iRouteRequest )
 					{
 						TaskFail();
 					}
@@ -2721,14 +2745,17 @@ Vector CBaseMonster::GetGunPosition()
 // callers m_Route. TRUE is returned if the operation 
 // succeeds (path is valid) or FALSE if failed (no path 
 // exists )
+//
+// With fQueue, a path that would have to be searched for
+// is handed to g_RouteQueue instead. TRUE is returned, and
+// m_Route stays empty until FRouteQueued picks the path up
+// on the next think.
 //=========================================================
-BOOL CBaseMonster::FGetNodeRoute( Vector vecDest )
+BOOL CBaseMonster::FGetNodeRoute( Vector vecDest, BOOL fQueue )
 {
 	int iPath[ MAX_PATH_SIZE ];
 	int iSrcNode, iDestNode;
 	int iResult;
-	int i;
-	int iNumToCopy;
 
 	iSrcNode = WorldGraph.FindNearestNode( pev->origin, this );
 	iDestNode = WorldGraph.FindNearestNode( vecDest, this );
@@ -2749,7 +2776,25 @@ BOOL CBaseMonster::FGetNodeRoute( Vector vecDest )
 	// valid src and dest nodes were found, so it's safe to proceed with
 	// find shortest path
 	int iNodeHull = WorldGraph.HullIndex( this ); // make this a monster virtual function
-	iResult = WorldGraph.FindShortestPath( iPath, iSrcNode, iDestNode, iNodeHull, m_afCapability );
+
+	iResult = -1;
+	if( fQueue && sv_routequeue.value )
+	{
+		// only what the routing tables and the path cache know is answered right away
+		iResult = WorldGraph.FindKnownPath( iPath, iSrcNode, iDestNode, iNodeHull, m_afCapability );
+		if( iResult < 0 )
+		{
+			m_iRouteRequest = g_RouteQueue.Queue( this, iSrcNode, iDestNode, iNodeHull, m_afCapability );
+			if( m_iRouteRequest )
+			{
+				m_vecRouteGoal = vecDest;
+				return TRUE;
+			}
+		}
+	}
+
+	if( iResult < 0 )
+		iResult = WorldGraph.FindShortestPath( iPath, iSrcNode, iDestNode, iNodeHull, m_afCapability );
 
 	if( !iResult )
 	{
@@ -2773,14 +2818,26 @@ BOOL CBaseMonster::FGetNodeRoute( Vector vecDest )
 #endif
 	}
 
-	// there's a valid path within iPath now, so now we will fill the route array
-	// up with as many of the waypoints as it will hold.
-	
+	RouteFromNodePath( iPath, iResult, vecDest );
+
+	return TRUE;
+}
+
+//=========================================================
+// RouteFromNodePath - there's a valid path within piPath,
+// so fill the route array up with as many of the waypoints
+// as it will hold.
+//=========================================================
+void CBaseMonster::RouteFromNodePath( const int *piPath, int cPathNodes, const Vector &vecDest )
+{
+	int i;
+	int iNumToCopy;
+
 	// don't copy ROUTE_SIZE entries if the path returned is shorter
 	// than ROUTE_SIZE!!!
-	if( iResult < ROUTE_SIZE )
+	if( cPathNodes < ROUTE_SIZE )
 	{
-		iNumToCopy = iResult;
+		iNumToCopy = cPathNodes;
 	}
 	else
 	{
@@ -2789,7 +2846,7 @@ BOOL CBaseMonster::FGetNodeRoute( Vector vecDest )
 
 	for( i = 0 ; i < iNumToCopy; i++ )
 	{
-		m_Route[i].vecLocation = WorldGraph.m_pNodes[iPath[i]].m_vecOrigin;
+		m_Route[i].vecLocation = WorldGraph.m_pNodes[piPath[i]].m_vecOrigin;
 		m_Route[i].iType = bits_MF_TO_NODE;
 	}
 
@@ -2798,8 +2855,54 @@ BOOL CBaseMonster::FGetNodeRoute( Vector vecDest )
 		m_Route[iNumToCopy].vecLocation = vecDest;
 		m_Route[iNumToCopy].iType |= bits_MF_IS_GOAL;
 	}
+}
 
-	return TRUE;
+//=========================================================
+// FRouteQueued - returns TRUE while the node route queued
+// by FGetNodeRoute is still being searched for, and the
+// monster has to wait for it. Once it has been searched
+// it goes into m_Route, simplified the way BuildRoute
+// would have, or the task fails if there is no path.
+//=========================================================
+BOOL CBaseMonster::FRouteQueued( void )
+{
+	int iPath[ MAX_PATH_SIZE ];
+	int iResult;
+
+	if( !m_iRouteRequest )
+		return FALSE;
+
+	iResult = g_RouteQueue.Fetch( m_iRouteRequest, iPath );
+	if( iResult < 0 )
+		return TRUE;
+
+	m_iRouteRequest = 0;
+
+	if( !iResult )
+	{
+		ALERT( at_aiconsole, "No Path for %s!\n", STRING( pev->classname ) );
+		RouteClear();
+		TaskFail();
+		return FALSE;
+	}
+
+	RouteFromNodePath( iPath, iResult, m_vecRouteGoal );
+
+	// BuildRoute's target for the goal FRefreshRoute was building
+	switch( m_movementGoal )
+	{
+	case MOVEGOAL_ENEMY:
+		RouteSimplify( m_hEnemy );
+		break;
+	case MOVEGOAL_TARGETENT:
+		RouteSimplify( m_hTargetEnt );
+		break;
+	case MOVEGOAL_LOCATION:
+		RouteSimplify( NULL );
+		break;
+	}
+
+	return FALSE;
 }
 
 //=========================================================
@@ -0,0 +1,416 @@
+/***
+*
+*   Network message counters per message type, destination and client
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "game.h"
+#include "playerroster.h"
+#include "msgstats.h"
+
+CMessageStats g_MessageStats;
+
+static const char *s_szDestNames[MSGSTATS_DESTS] =
+{
+	"broadcast",
+	"one",
+	"all",
+	"init",
+	"pvs",
+	"pas",
+	"pvs_r",
+	"pas_r",
+	"one_unreliable",
+	"spec",
+};
+
+// the engine's own functions while the counting ones are in g_engfuncs
+static int ( *s_pfnRegUserMsg )( const char *pszName, int iSize );
+static void ( *s_pfnMessageBegin )( int msg_dest, int msg_type, const float *pOrigin, edict_t *ed );
+static void ( *s_pfnMessageEnd )( void );
+static void ( *s_pfnWriteByte )( int iValue );
+static void ( *s_pfnWriteChar )( int iValue );
+static void ( *s_pfnWriteShort )( int iValue );
+static void ( *s_pfnWriteLong )( int iValue );
+static void ( *s_pfnWriteAngle )( float flValue );
+static void ( *s_pfnWriteCoord )( float flValue );
+static void ( *s_pfnWriteString )( const char *sz );
+static void ( *s_pfnWriteEntity )( int iValue );
+
+static int Stats_RegUserMsg( const char *pszName, int iSize )
+{
+	int type = s_pfnRegUserMsg( pszName, iSize );
+
+	g_MessageStats.RegisterName( type, pszName, iSize );
+
+	return type;
+}
+
+static void Stats_MessageBegin( int msg_dest, int msg_type, const float *pOrigin, edict_t *ed )
+{
+	g_MessageStats.Begin( msg_dest, msg_type, pOrigin, ed );
+	s_pfnMessageBegin( msg_dest, msg_type, pOrigin, ed );
+}
+
+static void Stats_MessageEnd( void )
+{
+	s_pfnMessageEnd();
+	g_MessageStats.End();
+}
+
+static void Stats_WriteByte( int iValue )
+{
+	g_MessageStats.Write( 1 );
+	s_pfnWriteByte( iValue );
+}
+
+static void Stats_WriteChar( int iValue )
+{
+	g_MessageStats.Write( 1 );
+	s_pfnWriteChar( iValue );
+}
+
+static void Stats_WriteShort( int iValue )
+{
+	g_MessageStats.Write( 2 );
+	s_pfnWriteShort( iValue );
+}
+
+static void Stats_WriteLong( int iValue )
+{
+	g_MessageStats.Write( 4 );
+	s_pfnWriteLong( iValue );
+}
+
+static void Stats_WriteAngle( float flValue )
+{
+	g_MessageStats.Write( 1 );
+	s_pfnWriteAngle( flValue );
+}
+
+static void Stats_WriteCoord( float flValue )
+{
+	g_MessageStats.Write( 2 );
+	s_pfnWriteCoord( flValue );
+}
+
+static void Stats_WriteString( const char *sz )
+{
+	g_MessageStats.Write( ( sz ? strlen( sz ) : 0 ) + 1 );
+	s_pfnWriteString( sz );
+}
+
+static void Stats_WriteEntity( int iValue )
+{
+	g_MessageStats.Write( 2 );
+	s_pfnWriteEntity( iValue );
+}
+
+void CMessageStats::Init( void )
+{
+	m_fEnabled = FALSE;
+	memset( m_szNames, 0, sizeof( m_szNames ));
+	memset( m_fVariableSize, 0, sizeof( m_fVariableSize ));
+
+	s_pfnRegUserMsg = g_engfuncs.pfnRegUserMsg;
+	g_engfuncs.pfnRegUserMsg = Stats_RegUserMsg;
+
+	ResetStats();
+}
+
+void CMessageStats::RegisterName( int type, const char *pszName, int size )
+{
+	if( type <= 0 || type >= MSGSTATS_TYPES )
+		return;
+
+	strlcpy( m_szNames[type], pszName, sizeof( m_szNames[type] ));
+	m_fVariableSize[type] = ( size == -1 ) ? TRUE : FALSE;
+}
+
+const char *CMessageStats::TypeName( int type )
+{
+	if( m_szNames[type][0] )
+		return m_szNames[type];
+
+	switch( type )
+	{
+	case SVC_TEMPENTITY:
+		return "svc_temp_entity";
+	case SVC_INTERMISSION:
+		return "svc_intermission";
+	case SVC_CDTRACK:
+		return "svc_cdtrack";
+	case SVC_WEAPONANIM:
+		return "svc_weaponanim";
+	case SVC_ROOMTYPE:
+		return "svc_roomtype";
+	}
+
+	return UTIL_VarArgs( "svc_%d", type );
+}
+
+void CMessageStats::Enable( BOOL enable )
+{
+	if( enable == m_fEnabled )
+		return;
+
+	if( enable )
+	{
+		s_pfnMessageBegin = g_engfuncs.pfnMessageBegin;
+		s_pfnMessageEnd = g_engfuncs.pfnMessageEnd;
+		s_pfnWriteByte = g_engfuncs.pfnWriteByte;
+		s_pfnWriteChar = g_engfuncs.pfnWriteChar;
+		s_pfnWriteShort = g_engfuncs.pfnWriteShort;
+		s_pfnWriteLong = g_engfuncs.pfnWriteLong;
+		s_pfnWriteAngle = g_engfuncs.pfnWriteAngle;
+		s_pfnWriteCoord = g_engfuncs.pfnWriteCoord;
+		s_pfnWriteString = g_engfuncs.pfnWriteString;
+		s_pfnWriteEntity = g_engfuncs.pfnWriteEntity;
+
+		g_engfuncs.pfnMessageBegin = Stats_MessageBegin;
+		g_engfuncs.pfnMessageEnd = Stats_MessageEnd;
+		g_engfuncs.pfnWriteByte = Stats_WriteByte;
+		g_engfuncs.pfnWriteChar = Stats_WriteChar;
+		g_engfuncs.pfnWriteShort = Stats_WriteShort;
+		g_engfuncs.pfnWriteLong = Stats_WriteLong;
+		g_engfuncs.pfnWriteAngle = Stats_WriteAngle;
+		g_engfuncs.pfnWriteCoord = Stats_WriteCoord;
+		g_engfuncs.pfnWriteString = Stats_WriteString;
+		g_engfuncs.pfnWriteEntity = Stats_WriteEntity;
+
+		m_iMsgType = -1;
+	}
+	else
+	{
+		g_engfuncs.pfnMessageBegin = s_pfnMessageBegin;
+		g_engfuncs.pfnMessageEnd = s_pfnMessageEnd;
+		g_engfuncs.pfnWriteByte = s_pfnWriteByte;
+		g_engfuncs.pfnWriteChar = s_pfnWriteChar;
+		g_engfuncs.pfnWriteShort = s_pfnWriteShort;
+		g_engfuncs.pfnWriteLong = s_pfnWriteLong;
+		g_engfuncs.pfnWriteAngle = s_pfnWriteAngle;
+		g_engfuncs.pfnWriteCoord = s_pfnWriteCoord;
+		g_engfuncs.pfnWriteString = s_pfnWriteString;
+		g_engfuncs.pfnWriteEntity = s_pfnWriteEntity;
+	}
+
+	m_fEnabled = enable;
+}
+
+void CMessageStats::StartFrame( void )
+{
+	// no message is open between frames, so the functions can be swapped here
+	Enable( sv_msgstats_enable.value ? TRUE : FALSE );
+
+	if( !m_fEnabled || sv_msgstats_log.value <= 0.0f )
+		return;
+
+	if( m_flNextLog > gpGlobals->time )
+		return;
+
+	if( m_flNextLog )
+		Log();
+
+	m_flNextLog = gpGlobals->time + sv_msgstats_log.value;
+}
+
+void CMessageStats::Begin( int dest, int type, const float *pOrigin, edict_t *ed )
+{
+	m_iMsgDest = dest;
+	m_iMsgType = type;
+	m_iMsgClient = 0;
+	m_fMsgOrigin = pOrigin ? TRUE : FALSE;
+	if( pOrigin )
+		m_vecMsgOrigin = Vector( pOrigin[0], pOrigin[1], pOrigin[2] );
+
+	// svc number, variable sized user messages also carry their size
+	m_iMsgBytes = 1;
+	if( type >= 0 && type < MSGSTATS_TYPES && m_fVariableSize[type] )
+		m_iMsgBytes++;
+
+	if( ( dest == MSG_ONE || dest == MSG_ONE_UNRELIABLE ) && ed )
+		m_iMsgClient = ENTINDEX( ed );
+}
+
+void CMessageStats::End( void )
+{
+	int type = m_iMsgType;
+	int dest = m_iMsgDest;
+	int bytes = m_iMsgBytes;
+	int client, charged = 0;
+	unsigned char *pSet;
+
+	m_iMsgType = -1;
+
+	if( type < 0 || type >= MSGSTATS_TYPES )
+		return;
+
+	m_Types[type].count++;
+	m_Types[type].bytes += bytes;
+	m_Total.count++;
+	m_Total.bytes += bytes;
+
+	if( dest >= 0 && dest < MSGSTATS_DESTS )
+	{
+		m_Dests[dest].count++;
+		m_Dests[dest].bytes += bytes;
+	}
+
+	if( dest == MSG_ALL || dest == MSG_BROADCAST )
+	{
+		for( int i = 0; i < g_PlayerRoster.Count(); i++ )
+		{
+			client = g_PlayerRoster.Player( i )->entindex();
+
+			m_Clients[client].count++;
+			m_Clients[client].bytes += bytes;
+			charged++;
+		}
+	}
+	else if( ( dest == MSG_PVS || dest == MSG_PAS || dest == MSG_PVS_R || dest == MSG_PAS_R ) && m_fMsgOrigin )
+	{
+		// the engine has sent it by now, so its fat PVS buffer is free
+		if( dest == MSG_PAS || dest == MSG_PAS_R )
+			pSet = ENGINE_SET_PAS( m_vecMsgOrigin );
+		else
+			pSet = ENGINE_SET_PVS( m_vecMsgOrigin );
+
+		for( int i = 0; i < g_PlayerRoster.Count(); i++ )
+		{
+			CBasePlayer *pPlayer = g_PlayerRoster.Player( i );
+
+			if( !ENGINE_CHECK_VISIBILITY( pPlayer->edict(), pSet ))
+				continue;
+
+			client = pPlayer->entindex();
+			m_Clients[client].count++;
+			m_Clients[client].bytes += bytes;
+			charged++;
+		}
+	}
+	else if( m_iMsgClient >= 1 && m_iMsgClient <= MSGSTATS_MAX_CLIENTS )
+	{
+		m_Clients[m_iMsgClient].count++;
+		m_Clients[m_iMsgClient].bytes += bytes;
+		charged++;
+	}
+
+	if( !charged )
+	{
+		m_Unattributed.count++;
+		m_Unattributed.bytes += bytes;
+	}
+}
+
+void CMessageStats::ResetStats( void )
+{
+	memset( m_Types, 0, sizeof( m_Types ));
+	memset( m_Dests, 0, sizeof( m_Dests ));
+	memset( m_Clients, 0, sizeof( m_Clients ));
+	memset( &m_Unattributed, 0, sizeof( m_Unattributed ));
+	memset( &m_Total, 0, sizeof( m_Total ));
+
+	m_flResetTime = gpGlobals ? gpGlobals->time : 0.0f;
+	m_flNextLog = 0.0f;
+}
+
+// fills pTypes with the message types seen, most bytes first
+int CMessageStats::SortTypes( int *pTypes )
+{
+	int i, j, count = 0;
+
+	for( i = 0; i < MSGSTATS_TYPES; i++ )
+	{
+		if( !m_Types[i].count )
+			continue;
+
+		for( j = count; j > 0 && m_Types[pTypes[j - 1]].bytes < m_Types[i].bytes; j-- )
+			pTypes[j] = pTypes[j - 1];
+
+		pTypes[j] = i;
+		count++;
+	}
+
+	return count;
+}
+
+void CMessageStats::Log( void )
+{
+	int types[MSGSTATS_TYPES];
+	int count = SortTypes( types );
+	float elapsed = Q_max( gpGlobals->time - m_flResetTime, 0.001f );
+
+	UTIL_LogPrintf( "Message stats: %llu messages, %llu bytes, %.0f bytes/s\n",
+		m_Total.count, m_Total.bytes, m_Total.bytes / elapsed );
+
+	for( int i = 0; i < count && i < MSGSTATS_LOG_TOP; i++ )
+	{
+		msgcounter_t *pCounter = &m_Types[types[i]];
+
+		UTIL_LogPrintf( "Message stats: \"%s\" %llu messages, %llu bytes, %.0f bytes/s\n",
+			TypeName( types[i] ), pCounter->count, pCounter->bytes, pCounter->bytes / elapsed );
+	}
+}
+
+void CMessageStats::ReportStats( void )
+{
+	int i, types[MSGSTATS_TYPES];
+	int count = SortTypes( types );
+	float elapsed = Q_max( gpGlobals->time - m_flResetTime, 0.001f );
+
+	ALERT( at_console, "Message stats: %s, %.1f seconds, %llu messages, %llu bytes, %.0f bytes/s\n",
+		m_fEnabled ? "enabled" : "disabled", elapsed, m_Total.count, m_Total.bytes, m_Total.bytes / elapsed );
+
+	ALERT( at_console, "  by message:\n" );
+	for( i = 0; i < count; i++ )
+	{
+		msgcounter_t *pCounter = &m_Types[types[i]];
+
+		ALERT( at_console, "    %-16s %3d %8llu msgs %10llu bytes %8.0f bytes/s\n",
+			TypeName( types[i] ), types[i], pCounter->count, pCounter->bytes, pCounter->bytes / elapsed );
+	}
+
+	ALERT( at_console, "  by destination:\n" );
+	for( i = 0; i < MSGSTATS_DESTS; i++ )
+	{
+		if( !m_Dests[i].count )
+			continue;
+
+		ALERT( at_console, "    %-16s %8llu msgs %10llu bytes\n", s_szDestNames[i], m_Dests[i].count, m_Dests[i].bytes );
+	}
+
+	ALERT( at_console, "  by client (directed, all, broadcast, PVS and PAS):\n" );
+	for( i = 1; i <= MSGSTATS_MAX_CLIENTS; i++ )
+	{
+		if( !m_Clients[i].count )
+			continue;
+
+		CBaseEntity *pPlayer = UTIL_PlayerByIndex( i );
+
+		ALERT( at_console, "    %2d %-16s %8llu msgs %10llu bytes %8.0f bytes/s\n", i,
+			pPlayer ? STRING( pPlayer->pev->netname ) : "", m_Clients[i].count, m_Clients[i].bytes, m_Clients[i].bytes / elapsed );
+	}
+
+	if( m_Unattributed.count )
+	{
+		ALERT( at_console, "    unattributed        %8llu msgs %10llu bytes %8.0f bytes/s\n",
+			m_Unattributed.count, m_Unattributed.bytes, m_Unattributed.bytes / elapsed );
+	}
+}
+
+// sv_msgstats [reset]
+void MessageStats_f( void )
+{
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ))
+	{
+		g_MessageStats.ResetStats();
+		ALERT( at_console, "Message statistics reset\n" );
+		return;
+	}
+
+	g_MessageStats.ReportStats();
+}
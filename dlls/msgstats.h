@@ -0,0 +1,84 @@
+/***
+*
+*   Network message counters per message type, destination and client
+*
+***/
+#pragma once
+#if !defined(MSGSTATS_H)
+#define MSGSTATS_H
+
+#define MSGSTATS_TYPES		256	// svc_ and user message numbers fit in a byte
+#define MSGSTATS_DESTS		( MSG_SPEC + 1 )
+#define MSGSTATS_MAX_CLIENTS	32
+#define MSGSTATS_LOG_TOP	8	// message types written per periodic log
+
+typedef struct msgcounter_s
+{
+	unsigned long long	count;	// 32 bits wrap within days on a busy server
+	unsigned long long	bytes;
+} msgcounter_t;
+
+//=========================================================
+// CMessageStats - counts the messages the game dll writes
+// and their size.  While sv_msgstats_enable is set, the
+// MESSAGE_BEGIN, WRITE_* and MESSAGE_END engine functions
+// in g_engfuncs are swapped for counting wrappers, when it
+// is off the engine's own functions are back in place, so
+// messages cost nothing extra.
+//
+// Sizes are what the game writes plus the message header,
+// the engine's own packet overhead isn't included.  Messages
+// to one client are charged to that client, MSG_ALL and
+// MSG_BROADCAST to every connected client, and MSG_PVS and
+// MSG_PAS to the clients whose PVS or PAS holds the origin.
+// Those without an origin, MSG_INIT and MSG_SPEC only show
+// in the totals and are counted as unattributed.
+//=========================================================
+class CMessageStats
+{
+public:
+	void Init( void );		// wraps REG_USER_MSG to learn the message names
+	void NewMap( void ) { ResetStats(); }	// the clock starts over
+	void StartFrame( void );
+
+	void RegisterName( int type, const char *pszName, int size );
+
+	void Begin( int dest, int type, const float *pOrigin, edict_t *ed );
+	void Write( int bytes ) { m_iMsgBytes += bytes; }
+	void End( void );
+
+	void ReportStats( void );
+	void ResetStats( void );
+
+private:
+	void Enable( BOOL enable );
+	void Log( void );
+	const char *TypeName( int type );
+	int SortTypes( int *pTypes );
+
+	BOOL m_fEnabled;
+	float m_flResetTime;
+	float m_flNextLog;
+
+	char m_szNames[MSGSTATS_TYPES][16];
+	BOOL m_fVariableSize[MSGSTATS_TYPES];
+
+	// message being written
+	int m_iMsgDest;
+	int m_iMsgType;
+	int m_iMsgClient;
+	int m_iMsgBytes;
+	BOOL m_fMsgOrigin;
+	Vector m_vecMsgOrigin;
+
+	msgcounter_t m_Types[MSGSTATS_TYPES];
+	msgcounter_t m_Dests[MSGSTATS_DESTS];
+	msgcounter_t m_Clients[MSGSTATS_MAX_CLIENTS + 1];
+	msgcounter_t m_Unattributed;	// charged to no client
+	msgcounter_t m_Total;
+};
+
+extern CMessageStats g_MessageStats;
+
+extern void MessageStats_f( void );
+#endif // MSGSTATS_H
@@ -25,6 +25,7 @@
  
 #include	"skill.h"
 #include	"game.h"
+#include	"playerroster.h"
 #include	"items.h"
 #if !NO_VOICEGAMEMGR
 #include	"voice_gamemgr.h"
@@ -65,6 +66,17 @@ public:
 
 		return true;
 	}
+
+	virtual int GetPlayerVoiceGroup(CBasePlayer *pPlayer)
+	{
+		if( !g_teamplay )
+			return VOICE_GROUP_ALL;
+
+		// players without a known team only match by name
+		int team = g_pGameRules->GetTeamIndex( pPlayer->TeamID() );
+
+		return team >= 0 ? team : VOICE_GROUP_NONE;
+	}
 };
 
 static CMultiplayGameMgrHelper g_GameMgrHelper;
@@ -229,23 +241,20 @@ void CHalfLifeMultiplay::Think( void )
 		int remain;
 
 		// check if any player is over the frag limit
-		for( int i = 1; i <= gpGlobals->maxClients; i++ )
+		for( int i = 0; i < g_PlayerRoster.Count(); i++ )
 		{
-			CBaseEntity *pPlayer = UTIL_PlayerByIndex( i );
+			CBasePlayer *pPlayer = g_PlayerRoster.Player( i );
 
-			if( pPlayer && pPlayer->pev->frags >= flFragLimit )
+			if( pPlayer->pev->frags >= flFragLimit )
 			{
 				GoToIntermission();
 				return;
 			}
 
-			if( pPlayer )
+			remain = (int)( flFragLimit - pPlayer->pev->frags );
+			if( remain < bestfrags )
 			{
-				remain = (int)( flFragLimit - pPlayer->pev->frags );
-				if( remain < bestfrags )
-				{
-					bestfrags = remain;
-				}
+				bestfrags = remain;
 			}
 		}
 		frags_remaining = bestfrags;
@@ -396,21 +405,17 @@ void CHalfLifeMultiplay::InitHUD( CBasePlayer *pl )
 	SendMOTDToClient( pl->edict() );
 
 	// loop through all active players and send their score info to the new client
-	for( int i = 1; i <= gpGlobals->maxClients; i++ )
+	for( int i = 0; i < g_PlayerRoster.Count(); i++ )
 	{
-		// FIXME:  Probably don't need to cast this just to read m_iDeaths
-		CBasePlayer *plr = (CBasePlayer *)UTIL_PlayerByIndex( i );
+		CBasePlayer *plr = g_PlayerRoster.Player( i );
 
-		if( plr )
-		{
-			MESSAGE_BEGIN( MSG_ONE, gmsgScoreInfo, NULL, pl->edict() );
-				WRITE_BYTE( i );	// client number
-				WRITE_SHORT( (int)plr->pev->frags );
-				WRITE_SHORT( plr->m_iDeaths );
-				WRITE_SHORT( 0 );
-				WRITE_SHORT( GetTeamIndex( plr->m_szTeamName ) + 1 );
-			MESSAGE_END();
-		}
+		MESSAGE_BEGIN( MSG_ONE, gmsgScoreInfo, NULL, pl->edict() );
+			WRITE_BYTE( plr->entindex() );	// client number
+			WRITE_SHORT( (int)plr->pev->frags );
+			WRITE_SHORT( plr->m_iDeaths );
+			WRITE_SHORT( 0 );
+			WRITE_SHORT( GetTeamIndex( plr->m_szTeamName ) + 1 );
+		MESSAGE_END();
 	}
 
 	if( g_fGameOver )
@@ -1396,19 +1401,7 @@ Determine the current # of active players on the server for map cycling logic
 */
 int CountPlayers( void )
 {
-	int num = 0;
-
-	for( int i = 1; i <= gpGlobals->maxClients; i++ )
-	{
-		CBaseEntity *pEnt = UTIL_PlayerByIndex( i );
-
-		if( pEnt )
-		{
-			num = num + 1;
-		}
-	}
-
-	return num;
+	return g_PlayerRoster.Count();
 }
 
 /*
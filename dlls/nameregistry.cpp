@@ -0,0 +1,417 @@
+/***
+*
+*   DLL side classname/targetname lookup tables
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "nameregistry.h"
+
+CNameRegistry g_NameRegistry;
+
+static const char *s_szFieldNames[NAMEREG_FIELDS] = { "classname", "targetname" };
+
+static inline unsigned int HashName( const char *pszName )
+{
+	unsigned int hash = 2166136261u;
+
+	while( *pszName )
+	{
+		hash ^= (byte)*pszName++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static inline string_t FieldValue( edict_t *pent, int field )
+{
+	return field == NAMEREG_CLASSNAME ? pent->v.classname : pent->v.targetname;
+}
+
+CNameRegistry::CNameRegistry()
+{
+	for( int i = 0; i < NAMEREG_FIELDS; i++ )
+	{
+		m_pHead[i] = NULL;
+		m_pNext[i] = NULL;
+		m_pPrev[i] = NULL;
+		m_pHash[i] = NULL;
+		m_pKey[i] = NULL;
+	}
+
+	m_pPending = NULL;
+	m_pIsPending = NULL;
+	m_iNumPending = 0;
+	m_pEdicts = NULL;
+	m_iMaxEntities = 0;
+	m_iSweep = 0;
+	m_iLookups = 0;
+	m_iVisited = 0;
+	m_iLateSyncs = 0;
+}
+
+CNameRegistry::~CNameRegistry()
+{
+	Free();
+}
+
+void CNameRegistry::Free( void )
+{
+	for( int i = 0; i < NAMEREG_FIELDS; i++ )
+	{
+		free( m_pHead[i] );
+		free( m_pNext[i] );
+		free( m_pPrev[i] );
+		free( m_pHash[i] );
+		free( m_pKey[i] );
+		m_pHead[i] = NULL;
+		m_pNext[i] = NULL;
+		m_pPrev[i] = NULL;
+		m_pHash[i] = NULL;
+		m_pKey[i] = NULL;
+	}
+
+	free( m_pPending );
+	free( m_pIsPending );
+	m_pPending = NULL;
+	m_pIsPending = NULL;
+	m_iNumPending = 0;
+	m_pEdicts = NULL;
+	m_iMaxEntities = 0;
+}
+
+BOOL CNameRegistry::Init( void )
+{
+	int i, j, maxEntities = gpGlobals->maxEntities;
+	edict_t *pEdicts = ENT( 0 );
+
+	if( maxEntities <= 0 || !pEdicts )
+		return FALSE;
+
+	if( maxEntities != m_iMaxEntities )
+	{
+		Free();
+
+		BOOL failed = FALSE;
+
+		for( i = 0; i < NAMEREG_FIELDS; i++ )
+		{
+			m_pHead[i] = (int *)malloc( NAMEREG_HASH_SIZE * sizeof( int ));
+			m_pNext[i] = (int *)malloc( maxEntities * sizeof( int ));
+			m_pPrev[i] = (int *)malloc( maxEntities * sizeof( int ));
+			m_pHash[i] = (unsigned int *)malloc( maxEntities * sizeof( unsigned int ));
+			m_pKey[i] = (string_t *)malloc( maxEntities * sizeof( string_t ));
+
+			if( !m_pHead[i] || !m_pNext[i] || !m_pPrev[i] || !m_pHash[i] || !m_pKey[i] )
+				failed = TRUE;
+		}
+
+		m_pPending = (int *)malloc( maxEntities * sizeof( int ));
+		m_pIsPending = (byte *)malloc( maxEntities * sizeof( byte ));
+
+		if( failed || !m_pPending || !m_pIsPending )
+		{
+			ALERT( at_error, "CNameRegistry: out of memory for %d entities\n", maxEntities );
+			Free();
+			return FALSE;
+		}
+
+		m_iMaxEntities = maxEntities;
+	}
+
+	m_pEdicts = pEdicts;
+
+	for( i = 0; i < NAMEREG_FIELDS; i++ )
+	{
+		for( j = 0; j < NAMEREG_HASH_SIZE; j++ )
+			m_pHead[i][j] = -1;
+
+		memset( m_pKey[i], 0, m_iMaxEntities * sizeof( string_t ));
+	}
+
+	memset( m_pIsPending, 0, m_iMaxEntities * sizeof( byte ));
+	m_iNumPending = 0;
+	m_iSweep = 0;
+
+	return TRUE;
+}
+
+void CNameRegistry::Reset( void )
+{
+	if( !Init() )
+		return;
+
+	// the engine never returns the world from a string search, so it isn't registered
+	for( int i = 1; i < m_iMaxEntities; i++ )
+	{
+		if( !m_pEdicts[i].free )
+			SyncIndex( i );
+	}
+}
+
+int CNameRegistry::EntityIndex( edict_t *pent )
+{
+	if( !pent )
+		return -1;
+
+	if( !m_pEdicts && !Init() )
+		return -1;
+
+	int index = pent - m_pEdicts;
+
+	if( index < 0 || index >= m_iMaxEntities )
+		return -1;
+
+	return index;
+}
+
+void CNameRegistry::LinkIndex( int field, int ent, string_t name )
+{
+	const char *pszName = STRING( name );
+
+	m_pKey[field][ent] = 0;
+
+	if( !name || !pszName || !*pszName )
+		return;
+
+	unsigned int hash = HashName( pszName );
+	int *pHead = &m_pHead[field][hash & ( NAMEREG_HASH_SIZE - 1 )];
+	int *pNext = m_pNext[field];
+	int *pPrev = m_pPrev[field];
+	int prev = -1, cur = *pHead;
+
+	// keep the chain in edict order
+	while( cur >= 0 && cur < ent )
+	{
+		prev = cur;
+		cur = pNext[cur];
+	}
+
+	pNext[ent] = cur;
+	pPrev[ent] = prev;
+
+	if( cur >= 0 )
+		pPrev[cur] = ent;
+
+	if( prev >= 0 )
+		pNext[prev] = ent;
+	else
+		*pHead = ent;
+
+	m_pHash[field][ent] = hash;
+	m_pKey[field][ent] = name;
+}
+
+void CNameRegistry::UnlinkIndex( int field, int ent )
+{
+	if( !m_pKey[field][ent] )
+		return;
+
+	int next = m_pNext[field][ent];
+	int prev = m_pPrev[field][ent];
+
+	if( next >= 0 )
+		m_pPrev[field][next] = prev;
+
+	if( prev >= 0 )
+		m_pNext[field][prev] = next;
+	else
+		m_pHead[field][m_pHash[field][ent] & ( NAMEREG_HASH_SIZE - 1 )] = next;
+
+	m_pKey[field][ent] = 0;
+}
+
+void CNameRegistry::SyncIndex( int ent )
+{
+	edict_t *pent = &m_pEdicts[ent];
+
+	for( int field = 0; field < NAMEREG_FIELDS; field++ )
+	{
+		string_t name = pent->free ? 0 : FieldValue( pent, field );
+
+		if( name == m_pKey[field][ent] )
+			continue;
+
+		UnlinkIndex( field, ent );
+		LinkIndex( field, ent, name );
+	}
+}
+
+void CNameRegistry::SyncPending( void )
+{
+	for( int i = 0; i < m_iNumPending; i++ )
+		SyncIndex( m_pPending[i] );
+}
+
+void CNameRegistry::Update( edict_t *pent )
+{
+	int ent = EntityIndex( pent );
+
+	if( ent > 0 )
+		SyncIndex( ent );
+}
+
+void CNameRegistry::Remove( edict_t *pent )
+{
+	int ent = EntityIndex( pent );
+
+	if( ent <= 0 )
+		return;
+
+	for( int field = 0; field < NAMEREG_FIELDS; field++ )
+		UnlinkIndex( field, ent );
+}
+
+void CNameRegistry::Touch( edict_t *pent )
+{
+	int ent = EntityIndex( pent );
+
+	if( ent <= 0 || m_pIsPending[ent] )
+		return;
+
+	m_pIsPending[ent] = 1;
+	m_pPending[m_iNumPending++] = ent;
+}
+
+void CNameRegistry::StartFrame( void )
+{
+	if( !m_pEdicts )
+		return;
+
+	for( int i = 0; i < m_iNumPending; i++ )
+	{
+		SyncIndex( m_pPending[i] );
+		m_pIsPending[m_pPending[i]] = 0;
+	}
+	m_iNumPending = 0;
+
+	// Every rename in the game code goes through Touch(), but walk a few
+	// edicts per frame anyway so a missed one can't stay stale for long
+	for( int i = 0; i < NAMEREG_SWEEP_EDICTS; i++ )
+	{
+		if( ++m_iSweep >= m_iMaxEntities )
+			m_iSweep = 1;
+
+		edict_t *pent = &m_pEdicts[m_iSweep];
+		string_t classname = pent->free ? 0 : pent->v.classname;
+		string_t targetname = pent->free ? 0 : pent->v.targetname;
+
+		if( classname == m_pKey[NAMEREG_CLASSNAME][m_iSweep] && targetname == m_pKey[NAMEREG_TARGETNAME][m_iSweep] )
+			continue;
+
+		m_iLateSyncs++;
+		ALERT( at_aiconsole, "CNameRegistry: %s (edict %d) was renamed without UTIL_NameRegistryTouch\n",
+			classname ? STRING( classname ) : "free edict", m_iSweep );
+		SyncIndex( m_iSweep );
+	}
+}
+
+edict_t *CNameRegistry::Find( int field, edict_t *pStart, const char *pszName )
+{
+	int start = 0;
+
+	if( !sv_nameregistry.value || !pszName || !*pszName || ( !m_pEdicts && !Init() ))
+		return FIND_ENTITY_BY_STRING( pStart, s_szFieldNames[field], pszName );
+
+	if( pStart )
+	{
+		start = EntityIndex( pStart );
+		if( start < 0 )
+			return FIND_ENTITY_BY_STRING( pStart, s_szFieldNames[field], pszName );
+	}
+
+	SyncPending();
+
+	m_iLookups++;
+
+	unsigned int hash = HashName( pszName );
+	int *pNext = m_pNext[field];
+	int ent;
+
+	if( start > 0 && m_pKey[field][start] && m_pHash[field][start] == hash )
+	{
+		// usual iteration case, the previous result sits in this chain
+		ent = pNext[start];
+	}
+	else
+	{
+		ent = m_pHead[field][hash & ( NAMEREG_HASH_SIZE - 1 )];
+		while( ent >= 0 && ent <= start )
+			ent = pNext[ent];
+	}
+
+	for( ; ent >= 0; ent = pNext[ent] )
+	{
+		m_iVisited++;
+
+		if( m_pHash[field][ent] != hash )
+			continue;
+
+		edict_t *pent = &m_pEdicts[ent];
+
+		if( pent->free )
+			continue;
+
+		// the registered name may be stale, always compare the live one
+		string_t name = FieldValue( pent, field );
+
+		if( name && !strcmp( STRING( name ), pszName ))
+			return pent;
+	}
+
+	// same as the engine, which returns the world when nothing is found
+	return m_pEdicts;
+}
+
+void CNameRegistry::ReportStats( void )
+{
+	if( !m_pEdicts )
+	{
+		ALERT( at_console, "Name registry is not initialized\n" );
+		return;
+	}
+
+	ALERT( at_console, "Name registry: %s, %d edicts\n", sv_nameregistry.value ? "enabled" : "disabled", m_iMaxEntities );
+
+	for( int field = 0; field < NAMEREG_FIELDS; field++ )
+	{
+		int usedBuckets = 0, maxChain = 0, registered = 0;
+
+		for( int i = 0; i < NAMEREG_HASH_SIZE; i++ )
+		{
+			int chain = 0;
+
+			for( int ent = m_pHead[field][i]; ent >= 0; ent = m_pNext[field][ent] )
+				chain++;
+
+			if( chain )
+				usedBuckets++;
+			if( chain > maxChain )
+				maxChain = chain;
+			registered += chain;
+		}
+
+		ALERT( at_console, "  %s: %d registered, buckets used %d/%d, longest chain %d\n",
+			s_szFieldNames[field], registered, usedBuckets, NAMEREG_HASH_SIZE, maxChain );
+	}
+
+	ALERT( at_console, "  lookups %u, avg edicts visited %.2f\n", m_iLookups, m_iLookups ? (float)m_iVisited / m_iLookups : 0.0f );
+	ALERT( at_console, "  renames caught by the sweep %u\n", m_iLateSyncs );
+}
+
+// sv_namestats [reset]
+void NameRegistry_Stats_f( void )
+{
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ))
+	{
+		g_NameRegistry.ResetStats();
+		ALERT( at_console, "Name registry statistics reset\n" );
+		return;
+	}
+
+	g_NameRegistry.ReportStats();
+}
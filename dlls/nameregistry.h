@@ -0,0 +1,79 @@
+/***
+*
+*   DLL side classname/targetname lookup tables
+*
+***/
+#pragma once
+#if !defined(NAMEREGISTRY_H)
+#define NAMEREGISTRY_H
+
+#define NAMEREG_HASH_SIZE	1024	// must be power of two
+#define NAMEREG_SWEEP_EDICTS	32	// edicts rechecked per frame
+
+//=========================================================
+// CNameRegistry - hashes every edict by the contents of its
+// classname and targetname, so FIND_ENTITY_BY_CLASSNAME and
+// FIND_ENTITY_BY_TARGETNAME don't have to strcmp every edict.
+// Each hash chain is kept sorted by edict index, which gives
+// the same iteration order as the engine's linear search.
+//
+// Names are synced from DispatchKeyValue, DispatchSpawn,
+// DispatchRestore and UTIL_Remove.  Edicts whose private data
+// was allocated during this frame are resynced before every
+// lookup as well, because plenty of code sets the classname
+// of a freshly created entity by hand after Spawn().  Any
+// other code that writes classname or targetname must call
+// UTIL_NameRegistryTouch() afterwards, or lookups of the new
+// name will miss the edict until the StartFrame sweep gets
+// to it.
+//=========================================================
+class CNameRegistry
+{
+public:
+	CNameRegistry();
+	~CNameRegistry();
+
+	void Reset( void );		// drop everything and register all edicts in use
+	void Update( edict_t *pent );	// resync both names of the edict
+	void Remove( edict_t *pent );
+	void Touch( edict_t *pent );	// edict was created or renamed, keep it in sync until next frame
+	void StartFrame( void );
+
+	edict_t *Find( int field, edict_t *pStart, const char *pszName );
+
+	void ReportStats( void );
+	void ResetStats( void ) { m_iLookups = m_iVisited = m_iLateSyncs = 0; }
+
+private:
+	BOOL Init( void );
+	void Free( void );
+	int EntityIndex( edict_t *pent );
+	void SyncIndex( int ent );
+	void LinkIndex( int field, int ent, string_t name );
+	void UnlinkIndex( int field, int ent );
+	void SyncPending( void );
+
+	int *m_pHead[NAMEREG_FIELDS];		// NAMEREG_HASH_SIZE chain heads
+	int *m_pNext[NAMEREG_FIELDS];		// per edict chain links
+	int *m_pPrev[NAMEREG_FIELDS];
+	unsigned int *m_pHash[NAMEREG_FIELDS];	// per edict name hash
+	string_t *m_pKey[NAMEREG_FIELDS];	// per edict registered name, 0 when unlinked
+
+	int *m_pPending;
+	byte *m_pIsPending;
+	int m_iNumPending;
+	int m_iSweep;			// last edict checked by StartFrame
+
+	edict_t *m_pEdicts;
+	int m_iMaxEntities;
+
+	// statistics
+	unsigned int m_iLookups;
+	unsigned int m_iVisited;
+	unsigned int m_iLateSyncs;
+};
+
+extern CNameRegistry g_NameRegistry;
+
+extern void NameRegistry_Stats_f( void );
+#endif // NAMEREGISTRY_H
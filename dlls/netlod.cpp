@@ -0,0 +1,285 @@
+/***
+*
+*   Distance and relevance based update rate for networked entities
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "entity_state.h"
+#include "pm_shared.h"
+#include "netlod.h"
+
+CNetLOD g_NetLOD;
+
+CNetLOD::CNetLOD()
+{
+	m_pRecords = NULL;
+	m_pHostFrame = NULL;
+	m_pHostBudget = NULL;
+	m_pHostView = NULL;
+	m_pEdicts = NULL;
+	m_iMaxClients = 0;
+	m_iMaxEntities = 0;
+	m_iFrame = 1;
+
+	ResetStats();
+}
+
+CNetLOD::~CNetLOD()
+{
+	Free();
+}
+
+void CNetLOD::Free( void )
+{
+	free( m_pRecords );
+	free( m_pHostFrame );
+	free( m_pHostBudget );
+	free( m_pHostView );
+
+	m_pRecords = NULL;
+	m_pHostFrame = NULL;
+	m_pHostBudget = NULL;
+	m_pHostView = NULL;
+	m_pEdicts = NULL;
+	m_iMaxClients = 0;
+	m_iMaxEntities = 0;
+}
+
+BOOL CNetLOD::Init( void )
+{
+	int maxClients = gpGlobals->maxClients;
+	int maxEntities = gpGlobals->maxEntities;
+	edict_t *pEdicts = ENT( 0 );
+
+	if( maxClients <= 0 || maxEntities <= 0 || !pEdicts )
+		return FALSE;
+
+	if( maxClients != m_iMaxClients || maxEntities != m_iMaxEntities )
+	{
+		Free();
+
+		m_pRecords = (netlodrecord_t *)malloc( maxClients * maxEntities * sizeof( netlodrecord_t ));
+		m_pHostFrame = (int *)malloc( maxClients * sizeof( int ));
+		m_pHostBudget = (int *)malloc( maxClients * sizeof( int ));
+		m_pHostView = (Vector *)malloc( maxClients * sizeof( Vector ));
+
+		if( !m_pRecords || !m_pHostFrame || !m_pHostBudget || !m_pHostView )
+		{
+			ALERT( at_error, "CNetLOD: out of memory for %d clients, %d entities\n", maxClients, maxEntities );
+			Free();
+			return FALSE;
+		}
+
+		m_iMaxClients = maxClients;
+		m_iMaxEntities = maxEntities;
+	}
+
+	m_pEdicts = pEdicts;
+
+	return TRUE;
+}
+
+void CNetLOD::Clear( void )
+{
+	if( !Init() )
+		return;
+
+	memset( m_pRecords, 0, m_iMaxClients * m_iMaxEntities * sizeof( netlodrecord_t ));
+	memset( m_pHostFrame, 0, m_iMaxClients * sizeof( int ));
+	m_iFrame = 1;
+}
+
+void CNetLOD::ClearHost( edict_t *host )
+{
+	if( !m_pRecords )
+		return;
+
+	int client = host - m_pEdicts - 1;
+
+	if( client < 0 || client >= m_iMaxClients )
+		return;
+
+	memset( &m_pRecords[client * m_iMaxEntities], 0, m_iMaxEntities * sizeof( netlodrecord_t ));
+	m_pHostFrame[client] = 0;
+}
+
+// entities the client needs every update of, or that it moves by itself
+BOOL CNetLOD::IsThrottled( edict_t *ent, edict_t *host )
+{
+	if( ent->v.flags & ( FL_CLIENT | FL_CUSTOMENTITY ))
+		return FALSE;
+
+	if( ent->v.owner == host || ent->v.aiment )
+		return FALSE;
+
+	// doors, trains and platforms are stood on and predicted against
+	if( ent->v.solid == SOLID_BSP || ent->v.movetype == MOVETYPE_PUSH || ent->v.movetype == MOVETYPE_PUSHSTEP )
+		return FALSE;
+
+	switch( ent->v.movetype )
+	{
+	case MOVETYPE_FOLLOW:
+		return FALSE;
+	case MOVETYPE_FLY:
+	case MOVETYPE_FLYMISSILE:
+	case MOVETYPE_TOSS:
+	case MOVETYPE_BOUNCE:
+	case MOVETYPE_BOUNCEMISSILE:
+		// grenades, rockets and gibs in flight
+		if( ent->v.velocity != g_vecZero )
+			return FALSE;
+		break;
+	}
+
+	return TRUE;
+}
+
+void CNetLOD::StartHost( int client, edict_t *host )
+{
+	edict_t *pView = host;
+
+	m_pHostFrame[client] = m_iFrame;
+	m_pHostBudget[client] = (int)sv_netlod_budget.value;
+
+	// spectators see from whoever they're following
+	switch( host->v.iuser1 )
+	{
+	case OBS_CHASE_LOCKED:
+	case OBS_CHASE_FREE:
+	case OBS_IN_EYE:
+		if( host->v.iuser2 > 0 && host->v.iuser2 < m_iMaxEntities )
+			pView = m_pEdicts + host->v.iuser2;
+		break;
+	}
+
+	m_pHostView[client] = pView->v.origin + pView->v.view_ofs;
+}
+
+// seconds between fresh updates of ent for this client, 0 for every packet
+float CNetLOD::Interval( edict_t *ent, int client )
+{
+	Vector center = ( ent->v.absmin + ent->v.absmax ) * 0.5f;
+	Vector delta = center - m_pHostView[client];
+	Vector extent = ent->v.absmax - ent->v.absmin;
+
+	// squared, most entities are near or big enough without a sqrt
+	float dist2 = DotProduct( delta, delta );
+
+	if( dist2 < sv_netlod_near.value * sv_netlod_near.value )
+		return 0.0f;
+
+	float radius2 = DotProduct( extent, extent ) * 0.25f;
+
+	if( radius2 >= NETLOD_FULL_SIZE * NETLOD_FULL_SIZE * dist2 )
+		return 0.0f;
+
+	float size = sqrt( radius2 / dist2 );
+
+	float interval = sv_netlod_maxinterval.value * ( 1.0f - size / NETLOD_FULL_SIZE );
+
+	if( ent->v.flags & FL_MONSTER )
+		interval *= 0.5f;
+
+	return interval;
+}
+
+void CNetLOD::Apply( struct entity_state_s *state, int e, edict_t *ent, edict_t *host )
+{
+	if( !sv_netlod.value || !m_pRecords || gpGlobals->maxClients <= 1 )
+		return;
+
+	// the spectator proxy records everything for its own clients
+	if( ent == host || ( host->v.flags & FL_PROXY ))
+		return;
+
+	int client = host - m_pEdicts - 1;
+
+	if( client < 0 || client >= m_iMaxClients || e < 1 || e >= m_iMaxEntities )
+		return;
+
+	if( !IsThrottled( ent, host ))
+		return;
+
+	if( m_pHostFrame[client] != m_iFrame )
+		StartHost( client, host );
+
+	netlodrecord_t *pRecord = &m_pRecords[client * m_iMaxEntities + e];
+	float interval = Interval( ent, client );
+	float age = gpGlobals->time - pRecord->time;
+	BOOL fresh = TRUE;
+
+	if( pRecord->time && pRecord->serial == ent->serialnumber && interval > 0.0f && age >= 0.0f
+		&& pRecord->sequence == state->sequence )
+	{
+		Vector moved = Vector( state->origin ) - Vector( pRecord->origin );
+
+		if( moved.Length() < NETLOD_JUMP_DIST )
+		{
+			if( age < interval )
+				fresh = FALSE;
+			else if( m_pHostBudget[client] <= 0 && age < interval * NETLOD_OVERDUE )
+			{
+				fresh = FALSE;
+				m_iDeferred++;
+			}
+		}
+	}
+
+	if( !fresh )
+	{
+		// resend what the client already has, the delta stays empty
+		state->animtime = pRecord->animtime;
+		state->frame = pRecord->frame;
+		memcpy( state->origin, pRecord->origin, 3 * sizeof(float) );
+		memcpy( state->angles, pRecord->angles, 3 * sizeof(float) );
+		memcpy( state->velocity, pRecord->velocity, 3 * sizeof(float) );
+		m_iThrottled++;
+		return;
+	}
+
+	if( interval > 0.0f )
+		m_pHostBudget[client]--;
+
+	pRecord->serial = ent->serialnumber;
+	pRecord->time = gpGlobals->time;
+	pRecord->sequence = state->sequence;
+	pRecord->animtime = state->animtime;
+	pRecord->frame = state->frame;
+	memcpy( pRecord->origin, state->origin, 3 * sizeof(float) );
+	memcpy( pRecord->angles, state->angles, 3 * sizeof(float) );
+	memcpy( pRecord->velocity, state->velocity, 3 * sizeof(float) );
+	m_iFresh++;
+}
+
+void CNetLOD::ReportStats( void )
+{
+	if( !m_pRecords )
+	{
+		ALERT( at_console, "Network LOD is not initialized\n" );
+		return;
+	}
+
+	unsigned int total = m_iFresh + m_iThrottled;
+
+	ALERT( at_console, "Network LOD: %s, %d clients, %d edicts, budget %d\n", sv_netlod.value ? "enabled" : "disabled",
+		m_iMaxClients, m_iMaxEntities, (int)sv_netlod_budget.value );
+	ALERT( at_console, "  fresh %u, throttled %u (%.1f%%), over budget %u\n",
+		m_iFresh, m_iThrottled, total ? 100.0f * m_iThrottled / total : 0.0f, m_iDeferred );
+}
+
+// sv_netlodstats [reset]
+void NetLOD_Stats_f( void )
+{
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ))
+	{
+		g_NetLOD.ResetStats();
+		ALERT( at_console, "Network LOD statistics reset\n" );
+		return;
+	}
+
+	g_NetLOD.ReportStats();
+}
@@ -0,0 +1,79 @@
+/***
+*
+*   Distance and relevance based update rate for networked entities
+*
+***/
+#pragma once
+#if !defined(NETLOD_H)
+#define NETLOD_H
+
+#define NETLOD_FULL_SIZE	0.05f	// radius / distance, anything looking bigger than this is always fresh
+#define NETLOD_JUMP_DIST	64.0f	// moved more than this since the last update, send it now
+#define NETLOD_OVERDUE		2.0f	// past this many intervals an update ignores the budget
+
+// what the client saw of a throttled entity the last time it was updated
+typedef struct netlodrecord_s
+{
+	int	serial;		// edict serial number, a new entity in the slot starts over
+	float	time;
+	int	sequence;
+	float	animtime;
+	float	frame;
+	float	origin[3];
+	float	angles[3];
+	float	velocity[3];
+} netlodrecord_t;
+
+//=========================================================
+// CNetLOD - interest management for AddToFullPack.  Small
+// or far away entities only get a fresh position every so
+// often, in between the client is sent the motion fields it
+// already has, so the delta against its last frame is empty
+// and the entity stays in the packet.
+//
+// Players, the host, projectiles, brush entities and
+// attachments are always fresh.  Monsters refresh twice as
+// often as other models.  Each client gets at most
+// sv_netlod_budget throttled refreshes per packet.
+//=========================================================
+class CNetLOD
+{
+public:
+	CNetLOD();
+	~CNetLOD();
+
+	void Clear( void );
+	void ClearHost( edict_t *host );	// a new client in the slot has seen none of it
+	void StartFrame( void ) { m_iFrame++; }
+
+	void Apply( struct entity_state_s *state, int e, edict_t *ent, edict_t *host );
+
+	void ReportStats( void );
+	void ResetStats( void ) { m_iFresh = m_iThrottled = m_iDeferred = 0; }
+
+private:
+	BOOL Init( void );
+	void Free( void );
+	BOOL IsThrottled( edict_t *ent, edict_t *host );
+	void StartHost( int client, edict_t *host );
+	float Interval( edict_t *ent, int client );
+
+	netlodrecord_t *m_pRecords;	// m_iMaxClients rows of m_iMaxEntities
+	int *m_pHostFrame;		// frame the host's budget was last reset
+	int *m_pHostBudget;
+	Vector *m_pHostView;
+	edict_t *m_pEdicts;
+	int m_iMaxClients;
+	int m_iMaxEntities;
+	int m_iFrame;
+
+	// statistics
+	unsigned int m_iFresh;
+	unsigned int m_iThrottled;
+	unsigned int m_iDeferred;
+};
+
+extern CNetLOD g_NetLOD;
+
+extern void NetLOD_Stats_f( void );
+#endif // NETLOD_H
@@ -24,6 +24,9 @@
 #include	"nodes_compat.h"
 #include	"animation.h"
 #include	"doors.h"
+#include	"game.h"
+#include	"worker_pool.h"
+#include	"routequeue.h"
 
 #define	HULL_STEP_SIZE 16// how far the test hull moves on each step
 #define	NODE_HEIGHT	8	// how high to lift nodes off the ground after we drop them all (make stair/ramp mapping easier)
@@ -47,7 +50,9 @@ LINK_ENTITY_TO_CLASS( info_node_air, CNodeEnt )
 #define CreateDirectoryA(p, n) mkdir(p)
 #elif !_WIN32
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #define CreateDirectoryA(p, n) mkdir(p, 0777)
 #endif
 
@@ -64,6 +69,18 @@ void CGraph::InitGraph( void )
 	m_fGraphPointersSet = FALSE;
 	m_fRoutingComplete = FALSE;
 
+	// A loaded graph's arrays are in its file
+	//
+	if( m_pGraphFile )
+	{
+		m_pLinkPool = NULL;
+		m_pNodes = NULL;
+		m_di = NULL;
+		m_pRouteInfo = NULL;
+		m_pHashLinks = NULL;
+		FreeGraphFile();
+	}
+
 	// Free the link pool
 	//
 	if( m_pLinkPool )
@@ -100,6 +117,10 @@ void CGraph::InitGraph( void )
 		m_pHashLinks = NULL;
 	}
 
+	FreeNodeGrid();
+	FreePathSearch();
+	InvalidatePathCache();
+
 	// Zero node and link counts
 	//
 	m_cNodes = 0;
@@ -151,7 +172,7 @@ entvars_t *CGraph::LinkEntForLink( CLink *pLink, CNode *pNode )
 	entvars_t *pevLinkEnt;
 	TraceResult tr;
 
-	pevLinkEnt = pLink->m_pLinkEnt;
+	pevLinkEnt = LinkEnt( *pLink );
 	if( !pevLinkEnt )
 		return NULL;
 
@@ -585,10 +606,31 @@ int CGraph::NextNodeInRoute( int iCurrentNode, int iDest, int iHull, int iCap )
 //=========================================================
 int CGraph::FindShortestPath( int *piPath, int iStart, int iDest, int iHull, int afCapMask )
 {
-	int iVisitNode;
+	int iNumPathNodes;
+
+	iNumPathNodes = FindKnownPath( piPath, iStart, iDest, iHull, afCapMask );
+
+	if( iNumPathNodes < 0 )
+	{
+		iNumPathNodes = SearchPath( &m_PathSearch[0], piPath, iStart, iDest, iHull, afCapMask, NULL );
+
+		// failures are kept too, they cost the most to find
+		StorePath( piPath, iNumPathNodes, iStart, iDest, iHull, afCapMask );
+	}
+
+	return iNumPathNodes;
+}
+
+//=========================================================
+// CGraph - FindKnownPath - FindShortestPath without the
+// search. The path comes from the routing tables or the
+// path cache, and -1 is returned if it has to be searched
+// for instead.
+//=========================================================
+int CGraph::FindKnownPath( int *piPath, int iStart, int iDest, int iHull, int afCapMask )
+{
 	int iCurrentNode;
 	int iNumPathNodes;
-	int iHullMask = 0;
 
 	if( !m_fGraphPresent || !m_fGraphPointersSet )
 	{
@@ -647,104 +689,28 @@ int CGraph::FindShortestPath( int *piPath, int iStart, int iDest, int iHull, int
 	}
 	else
 	{
+		PATH_CACHE_ENTRY *pEntry;
 		int i;
-		CQueuePriority queue;
 
-		switch( iHull )
-		{
-		case NODE_SMALL_HULL:
-			iHullMask = bits_LINK_SMALL_HULL;
-			break;
-		case NODE_HUMAN_HULL:
-			iHullMask = bits_LINK_HUMAN_HULL;
-			break;
-		case NODE_LARGE_HULL:
-			iHullMask = bits_LINK_LARGE_HULL;
-			break;
-		case NODE_FLY_HULL:
-			iHullMask = bits_LINK_FLY_HULL;
-			break;
-		}
+		m_cPathQueries++;
 
-		// Mark all the nodes as unvisited.
+		// Have we been asked this since the doors last moved?
 		//
-		for ( i = 0; i < m_cNodes; i++)
-		{
-			m_pNodes[i].m_flClosestSoFar = -1.0f;
-		}
-
-		m_pNodes[iStart].m_flClosestSoFar = 0.0;
-		m_pNodes[iStart].m_iPreviousNode = iStart;// tag this as the origin node
-		queue.Insert( iStart, 0.0 );// insert start node 
-
-		while( !queue.Empty() )
+		for( i = 0; i < PATHCACHE_SIZE; i++ )
 		{
-			// now pull a node out of the queue
-			float flCurrentDistance;
-			iCurrentNode = queue.Remove( flCurrentDistance );
-
-			// For straight-line weights, the following Shortcut works. For arbitrary weights,
-			// it doesn't.
-			//
-			if( iCurrentNode == iDest )
-				break;
+			pEntry = &m_PathCache[i];
 
-			CNode *pCurrentNode = &m_pNodes[iCurrentNode];
-
-			for( i = 0; i < pCurrentNode->m_cNumLinks; i++ )
+			if( pEntry->cPathNodes >= 0 && pEntry->iStart == iStart && pEntry->iDest == iDest
+			   && pEntry->iHull == iHull && pEntry->afCapMask == afCapMask )
 			{
-				// run through all of this node's neighbors
-				iVisitNode = INodeLink( iCurrentNode, i );
-				if( ( m_pLinkPool[m_pNodes[iCurrentNode].m_iFirstLink + i].m_afLinkInfo & iHullMask ) != iHullMask )
-				{
-					// monster is too large to walk this connection
-					//ALERT( at_aiconsole, "fat ass %d/%d\n",m_pLinkPool[m_pNodes[iCurrentNode].m_iFirstLink + i].m_afLinkInfo, iMonsterHull );
-					continue;
-				}
-				// check the connection from the current node to the node we're about to mark visited and push into the queue				
-				if( m_pLinkPool[m_pNodes[iCurrentNode].m_iFirstLink + i].m_pLinkEnt != NULL )
-				{
-					// there's a brush ent in the way! Don't mark this node or put it into the queue unless the monster can negotiate it
-					if( !HandleLinkEnt( iCurrentNode, m_pLinkPool[m_pNodes[iCurrentNode].m_iFirstLink + i].m_pLinkEnt, afCapMask, NODEGRAPH_STATIC ) )
-					{
-						// monster should not try to go this way.
-						continue;
-					}
-				}
-				float flOurDistance = flCurrentDistance + m_pLinkPool[m_pNodes[iCurrentNode].m_iFirstLink + i].m_flWeight;
-				if(  m_pNodes[iVisitNode].m_flClosestSoFar < -0.5f
-				   || flOurDistance < m_pNodes[iVisitNode].m_flClosestSoFar - 0.001f )
-				{
-					m_pNodes[iVisitNode].m_flClosestSoFar = flOurDistance;
-					m_pNodes[iVisitNode].m_iPreviousNode = iCurrentNode;
-
-					queue.Insert( iVisitNode, flOurDistance );
-				}
+				m_cPathCacheHits++;
+				pEntry->iLastUsed = ++m_iPathCacheTick;
+				memcpy( piPath, pEntry->iPath, pEntry->cPathNodes * sizeof(int) );
+				return pEntry->cPathNodes;
 			}
 		}
-		if( m_pNodes[iDest].m_flClosestSoFar < -0.5f )
-		{
-			// Destination is unreachable, no path found.
-			return 0;
-		}
-
-		// the queue is not empty
-		// now we must walk backwards through the m_iPreviousNode field, and count how many connections there are in the path
-		iCurrentNode = iDest;
-		iNumPathNodes = 1;// count the dest
-
-		while( iCurrentNode != iStart )
-		{
-			iNumPathNodes++;
-			iCurrentNode = m_pNodes[iCurrentNode].m_iPreviousNode;
-		}
 
-		iCurrentNode = iDest;
-		for( i = iNumPathNodes - 1; i >= 0; i-- )
-		{
-			piPath[i] = iCurrentNode;
-			iCurrentNode = m_pNodes[iCurrentNode].m_iPreviousNode;
-		}
+		return -1;
 	}
 #if 0
 	if( m_fRoutingComplete )
@@ -782,6 +748,41 @@ int CGraph::FindShortestPath( int *piPath, int iStart, int iDest, int iHull, int
 	return iNumPathNodes;
 }
 
+//=========================================================
+// CGraph - StorePath - keeps a searched path in the path
+// cache, in place of the least recently used entry.
+//=========================================================
+void CGraph::StorePath( const int *piPath, int cPathNodes, int iStart, int iDest, int iHull, int afCapMask )
+{
+	PATH_CACHE_ENTRY *pEntry, *pOldest;
+	int i;
+
+	pOldest = &m_PathCache[0];
+	for( i = 0; i < PATHCACHE_SIZE; i++ )
+	{
+		pEntry = &m_PathCache[i];
+
+		if( pEntry->cPathNodes >= 0 && pEntry->iStart == iStart && pEntry->iDest == iDest
+		   && pEntry->iHull == iHull && pEntry->afCapMask == afCapMask )
+		{
+			// searched twice in one batch of g_RouteQueue
+			pOldest = pEntry;
+			break;
+		}
+
+		if( pEntry->cPathNodes < 0 || ( pOldest->cPathNodes >= 0 && pEntry->iLastUsed < pOldest->iLastUsed ) )
+			pOldest = pEntry;
+	}
+
+	pOldest->iStart = iStart;
+	pOldest->iDest = iDest;
+	pOldest->iHull = iHull;
+	pOldest->afCapMask = afCapMask;
+	pOldest->cPathNodes = cPathNodes;
+	pOldest->iLastUsed = ++m_iPathCacheTick;
+	memcpy( pOldest->iPath, piPath, cPathNodes * sizeof(int) );
+}
+
 inline ULONG Hash( void *p, int len )
 {
 	CRC32_t ulCrc;
@@ -862,6 +863,304 @@ void CGraph::CheckNode( Vector vecOrigin, int iNode )
 	}
 }
 
+
+//=========================================================
+// CGraph - SearchPath - A* over the links a monster of this
+// hull and capability can take. Link weights are 2D lengths,
+// so the 2D distance to iDest never overestimates and the
+// first time iDest is closed its path is a shortest one.
+// Long paths are cut to MAX_PATH_SIZE nodes, the same as the
+// routing tables give them.
+//
+// With pLinkUsable (from LinkUsable) instead of NULL, the
+// search doesn't call the engine, and any number of threads
+// can search at once, each with its own pSearch.
+//=========================================================
+int CGraph::SearchPath( PATH_SEARCH *pSearch, int *piPath, int iStart, int iDest, int iHull, int afCapMask, const byte *pLinkUsable )
+{
+	int i;
+	int iVisitNode;
+	int iCurrentNode;
+	int iNumPathNodes;
+	int iHullMask = 0;
+	unsigned int iOpen, iClosed;
+
+	if( iStart < 0 || iStart >= m_cNodes || iDest < 0 || iDest >= m_cNodes || !AllocPathSearch( pSearch ) )
+		return 0;
+
+	pSearch->cSearches++;
+
+	switch( iHull )
+	{
+	case NODE_SMALL_HULL:
+		iHullMask = bits_LINK_SMALL_HULL;
+		break;
+	case NODE_HUMAN_HULL:
+		iHullMask = bits_LINK_HUMAN_HULL;
+		break;
+	case NODE_LARGE_HULL:
+		iHullMask = bits_LINK_LARGE_HULL;
+		break;
+	case NODE_FLY_HULL:
+		iHullMask = bits_LINK_FLY_HULL;
+		break;
+	}
+
+	// A new generation marks every node unvisited.
+	//
+	pSearch->iGeneration += 2;
+	if( pSearch->iGeneration < 2 )
+	{
+		// wrapped, old stamps could look current
+		memset( pSearch->pVisit, 0, pSearch->cNodes * sizeof(unsigned int) );
+		pSearch->iGeneration = 2;
+	}
+	iOpen = pSearch->iGeneration;
+	iClosed = pSearch->iGeneration + 1;
+
+	float *pCost = pSearch->pCost;
+	int *pPrev = pSearch->pPrev;
+	unsigned int *pVisit = pSearch->pVisit;
+	CPathHeap &heap = pSearch->Heap;
+
+	Vector2D vecDest = m_pNodes[iDest].m_vecOrigin.Make2D();
+
+	heap.Clear();
+	pCost[iStart] = 0.0f;
+	pPrev[iStart] = iStart;
+	pVisit[iStart] = iOpen;
+	heap.Insert( iStart, ( m_pNodes[iStart].m_vecOrigin.Make2D() - vecDest ).Length() );
+
+	while( !heap.Empty() )
+	{
+		float flEstimate;
+		iCurrentNode = heap.Remove( flEstimate );
+
+		// already reached through a shorter path
+		if( pVisit[iCurrentNode] == iClosed )
+			continue;
+
+		pVisit[iCurrentNode] = iClosed;
+		pSearch->cExpanded++;
+
+		if( iCurrentNode == iDest )
+			break;
+
+		CNode *pCurrentNode = &m_pNodes[iCurrentNode];
+
+		for( i = 0; i < pCurrentNode->m_cNumLinks; i++ )
+		{
+			CLink *pLink = &m_pLinkPool[pCurrentNode->m_iFirstLink + i];
+
+			if( ( pLink->m_afLinkInfo & iHullMask ) != iHullMask )
+			{
+				// monster is too large to walk this connection
+				continue;
+			}
+
+			iVisitNode = pLink->m_iDestNode;
+			if( pVisit[iVisitNode] == iClosed )
+				continue;
+
+			if( pLink->m_iLinkEnt != 0 )
+			{
+				// there's a brush ent in the way! Don't go this way unless the monster can negotiate it
+				if( pLinkUsable )
+				{
+					if( !pLinkUsable[pCurrentNode->m_iFirstLink + i] )
+						continue;
+				}
+				else if( !HandleLinkEnt( iCurrentNode, LinkEnt( *pLink ), afCapMask, NODEGRAPH_STATIC ) )
+					continue;
+			}
+
+			float flOurCost = pCost[iCurrentNode] + pLink->m_flWeight;
+			if( pVisit[iVisitNode] != iOpen || flOurCost < pCost[iVisitNode] )
+			{
+				pCost[iVisitNode] = flOurCost;
+				pPrev[iVisitNode] = iCurrentNode;
+				pVisit[iVisitNode] = iOpen;
+
+				if( !heap.Insert( iVisitNode, flOurCost + ( m_pNodes[iVisitNode].m_vecOrigin.Make2D() - vecDest ).Length() ) )
+					return 0;
+			}
+		}
+	}
+
+	if( pVisit[iDest] != iClosed )
+	{
+		// Destination is unreachable, no path found.
+		return 0;
+	}
+
+	// walk backwards through the previous nodes, and count how many connections there are in the path
+	iCurrentNode = iDest;
+	iNumPathNodes = 1;// count the dest
+
+	while( iCurrentNode != iStart )
+	{
+		iNumPathNodes++;
+		iCurrentNode = pPrev[iCurrentNode];
+	}
+
+	// skip the end of a long path
+	iCurrentNode = iDest;
+	for( i = iNumPathNodes - 1; i >= MAX_PATH_SIZE; i-- )
+	{
+		iCurrentNode = pPrev[iCurrentNode];
+	}
+
+	for( ; i >= 0; i-- )
+	{
+		piPath[i] = iCurrentNode;
+		iCurrentNode = pPrev[iCurrentNode];
+	}
+
+	return iNumPathNodes < MAX_PATH_SIZE ? iNumPathNodes : MAX_PATH_SIZE;
+}
+
+BOOL CGraph::AllocPathSearch( PATH_SEARCH *pSearch )
+{
+	if( pSearch->pVisit && pSearch->cNodes == m_cNodes )
+		return TRUE;
+
+	free( pSearch->pCost );
+	free( pSearch->pPrev );
+	free( pSearch->pVisit );
+	pSearch->cNodes = 0;
+
+	if( m_cNodes <= 0 )
+		return FALSE;
+
+	pSearch->pCost = (float *)malloc( sizeof(float) * m_cNodes );
+	pSearch->pPrev = (int *)malloc( sizeof(int) * m_cNodes );
+	pSearch->pVisit = (unsigned int *)calloc( sizeof(unsigned int), m_cNodes );
+
+	if( !pSearch->pCost || !pSearch->pPrev || !pSearch->pVisit )
+	{
+		free( pSearch->pCost );
+		free( pSearch->pPrev );
+		free( pSearch->pVisit );
+		pSearch->pCost = NULL;
+		pSearch->pPrev = NULL;
+		pSearch->pVisit = NULL;
+		return FALSE;
+	}
+
+	pSearch->cNodes = m_cNodes;
+	pSearch->iGeneration = 0;
+	return TRUE;
+}
+
+void CGraph::FreePathSearch( void )
+{
+	for( int i = 0; i <= WORKER_MAX_THREADS; i++ )
+	{
+		PATH_SEARCH *pSearch = &m_PathSearch[i];
+
+		free( pSearch->pCost );
+		free( pSearch->pPrev );
+		free( pSearch->pVisit );
+
+		pSearch->pCost = NULL;
+		pSearch->pPrev = NULL;
+		pSearch->pVisit = NULL;
+		pSearch->cNodes = 0;
+	}
+
+	free( m_pLinkUsable );
+	m_pLinkUsable = NULL;
+	m_fLinkUsableValid = FALSE;
+}
+
+//=========================================================
+// CGraph - LinkUsable - what HandleLinkEnt says about each
+// link for a static query with afCapMask, which only looks
+// at bits_CAP_OPEN_DOORS. Main thread only. The table is
+// filled again after the next InvalidatePathCache, and is
+// NULL if the graph isn't ready.
+//=========================================================
+const byte *CGraph::LinkUsable( int afCapMask )
+{
+	int i;
+
+	if( !m_fGraphPresent || !m_fGraphPointersSet || m_cLinks <= 0 )
+		return NULL;
+
+	if( !m_fLinkUsableValid )
+	{
+		if( !m_pLinkUsable )
+		{
+			m_pLinkUsable = (byte *)malloc( m_cLinks * 2 );
+			if( !m_pLinkUsable )
+				return NULL;
+		}
+
+		for( i = 0; i < m_cLinks; i++ )
+		{
+			CLink &link = m_pLinkPool[i];
+
+			if( link.m_iLinkEnt == 0 )
+			{
+				m_pLinkUsable[i] = m_pLinkUsable[m_cLinks + i] = 1;
+				continue;
+			}
+
+			m_pLinkUsable[i] = HandleLinkEnt( link.m_iSrcNode, LinkEnt( link ), 0, NODEGRAPH_STATIC ) ? 1 : 0;
+			m_pLinkUsable[m_cLinks + i] = HandleLinkEnt( link.m_iSrcNode, LinkEnt( link ), bits_CAP_OPEN_DOORS, NODEGRAPH_STATIC ) ? 1 : 0;
+		}
+
+		m_fLinkUsableValid = TRUE;
+	}
+
+	if( afCapMask & bits_CAP_OPEN_DOORS )
+		return m_pLinkUsable + m_cLinks;
+
+	return m_pLinkUsable;
+}
+
+//=========================================================
+// CGraph - InvalidatePathCache - something changed what
+// HandleLinkEnt says about a link.
+//=========================================================
+void CGraph::InvalidatePathCache( void )
+{
+	for( int i = 0; i < PATHCACHE_SIZE; i++ )
+	{
+		m_PathCache[i].cPathNodes = -1;
+	}
+
+	m_fLinkUsableValid = FALSE;
+}
+
+void CGraph::ResetPathStats( void )
+{
+	m_cPathQueries = 0;
+	m_cPathCacheHits = 0;
+
+	for( int i = 0; i <= WORKER_MAX_THREADS; i++ )
+	{
+		m_PathSearch[i].cSearches = 0;
+		m_PathSearch[i].cExpanded = 0;
+	}
+}
+
+void CGraph::ReportPathStats( void )
+{
+	unsigned int cSearches = 0;
+	double flExpanded = 0.0;
+
+	for( int i = 0; i <= WORKER_MAX_THREADS; i++ )
+	{
+		cSearches += m_PathSearch[i].cSearches;
+		flExpanded += m_PathSearch[i].cExpanded;
+	}
+
+	ALERT( at_console, "Path search: %s, queries %u, cache hits %u, searches %u, avg nodes expanded %.1f\n",
+		m_fRoutingComplete ? "routing tables" : "A*", m_cPathQueries, m_cPathCacheHits, cSearches,
+		cSearches ? flExpanded / cSearches : 0.0 );
+}
+
 //=========================================================
 // CGraph - FindNearestNode - returns the index of the node nearest
 // the given vector -1 is failure (couldn't find a valid
@@ -886,10 +1185,13 @@ int CGraph::FindNearestNode( const Vector &vecOrigin, int afNodeTypes )
 
 	// Check with the cache
 	//
+	m_cNearQueries++;
+
 	ULONG iHash = ( CACHE_SIZE - 1 ) & Hash( (void *)(const float *)vecOrigin, sizeof(vecOrigin) );
 	if( m_Cache[iHash].v == vecOrigin )
 	{
 		//ALERT( at_aiconsole, "Cache Hit.\n" );
+		m_cNearExactHits++;
 		return m_Cache[iHash].n;
 	}
 /*	else
@@ -897,6 +1199,15 @@ int CGraph::FindNearestNode( const Vector &vecOrigin, int afNodeTypes )
 		//ALERT( at_aiconsole, "Cache Miss.\n" );
 	}
 */
+	if( m_pGridNodes && sv_nodegrid.value )
+	{
+		m_iNearest = FindNearestNodeInGrid( vecOrigin, afNodeTypes );
+
+		m_Cache[iHash].v = vecOrigin;
+		m_Cache[iHash].n = m_iNearest;
+		return m_iNearest;
+	}
+
 	// Mark all points as unchecked.
 	//
 	m_CheckedCounter++;
@@ -1124,49 +1435,239 @@ int CGraph::FindNearestNode( const Vector &vecOrigin, int afNodeTypes )
 }
 
 //=========================================================
-// CGraph - ShowNodeConnections - draws a line from the given node
-// to all connected nodes
+// CGraph - FindNearestNodeInGrid - same answer as the range
+// search, from the node grid. A position quantised into the
+// same cell as an earlier query only needs its old answer
+// confirmed by a trace.
 //=========================================================
-void CGraph::ShowNodeConnections( int iNode )
+int CGraph::FindNearestNodeInGrid( const Vector &vecOrigin, int afNodeTypes )
 {
-	Vector vecSpot;
-	CNode *pNode;
-	CNode *pLinkNode;
-	int i;
+	int q[3];
+	int iNearest;
 
-	if( !m_fGraphPresent || !m_fGraphPointersSet )
+	q[0] = (int)floor( vecOrigin.x / NEARCACHE_QUANTUM );
+	q[1] = (int)floor( vecOrigin.y / NEARCACHE_QUANTUM );
+	q[2] = (int)floor( vecOrigin.z / NEARCACHE_QUANTUM );
+
+	ULONG iHash = ( NEARCACHE_SIZE - 1 ) & ( ( (ULONG)q[0] * 73856093 ) ^ ( (ULONG)q[1] * 19349663 ) ^ ( (ULONG)q[2] * 83492791 ) ^ (ULONG)afNodeTypes );
+	NEAR_CACHE_ENTRY *pEntry = &m_NearCache[iHash];
+
+	if( pEntry->n != -1 && pEntry->afNodeTypes == afNodeTypes &&
+		pEntry->q[0] == q[0] && pEntry->q[1] == q[1] && pEntry->q[2] == q[2] )
 	{
-		// protect us in the case that the node graph isn't available or built
-		ALERT( at_aiconsole, "Graph not ready!\n" );
-		return;
+		if( NodeVisibleFrom( vecOrigin, q, pEntry->n ) )
+		{
+			m_cNearCacheHits++;
+			return pEntry->n;
+		}
 	}
 
-	if( iNode < 0 )
+	m_cNearSearches++;
+	iNearest = SearchNodeGrid( vecOrigin, q, afNodeTypes );
+
+	if( iNearest != -1 )
 	{
-		ALERT( at_aiconsole, "Can't show connections for node %d\n", iNode );
-		return;
+		pEntry->q[0] = q[0];
+		pEntry->q[1] = q[1];
+		pEntry->q[2] = q[2];
+		pEntry->afNodeTypes = afNodeTypes;
+		pEntry->n = iNearest;
 	}
 
-	pNode = &m_pNodes[iNode];
+	return iNearest;
+}
 
-	UTIL_ParticleEffect( pNode->m_vecOrigin, g_vecZero, 255, 20 );// show node position
+//=========================================================
+// CGraph - SearchNodeGrid - walks shells of cells outward from
+// vecOrigin. Nodes that can't be beaten by anything outside
+// the cells seen so far are traced nearest first, the first
+// visible one is the answer.
+//=========================================================
+int CGraph::SearchNodeGrid( const Vector &vecOrigin, const int *q, int afNodeTypes )
+{
+	int c[3], lo[3], hi[3];
+	int x, y, z, i, j, r, maxr;
+	int cCandidates = 0;
 
-	if( pNode->m_cNumLinks <= 0 )
+	maxr = 0;
+	for( j = 0; j < 3; j++ )
 	{
-		// no connections!
-		ALERT ( at_aiconsole, "**No Connections!\n" );
+		c[j] = GridCoord( vecOrigin[j], j );
+		maxr = Q_max( maxr, Q_max( c[j], m_GridSize[j] - 1 - c[j] ) );
 	}
 
-	for( i = 0; i < pNode->m_cNumLinks; i++ )
+	for( r = 0; r <= maxr; r++ )
 	{
-		pLinkNode = &Node( NodeLink( iNode, i ).m_iDestNode );
-		vecSpot = pLinkNode->m_vecOrigin;
+		for( j = 0; j < 3; j++ )
+		{
+			lo[j] = Q_max( 0, c[j] - r );
+			hi[j] = Q_min( m_GridSize[j] - 1, c[j] + r );
+		}
 
-		MESSAGE_BEGIN( MSG_BROADCAST, SVC_TEMPENTITY );
-			WRITE_BYTE( TE_SHOWLINE );
+		// gather the shell
+		for( z = lo[2]; z <= hi[2]; z++ )
+		{
+			for( y = lo[1]; y <= hi[1]; y++ )
+			{
+				for( x = lo[0]; x <= hi[0]; x++ )
+				{
+					if( abs( x - c[0] ) != r && abs( y - c[1] ) != r && abs( z - c[2] ) != r )
+						continue;
 
-			WRITE_COORD( m_pNodes[iNode].m_vecOrigin.x );
-			WRITE_COORD( m_pNodes[iNode].m_vecOrigin.y );
+					int iCell = ( z * m_GridSize[1] + y ) * m_GridSize[0] + x;
+
+					for( i = m_pGridStart[iCell]; i < m_pGridStart[iCell + 1]; i++ )
+					{
+						int iNode = m_pGridNodes[i];
+
+						if( !( m_pNodes[iNode].m_afNodeInfo & afNodeTypes ) )
+							continue;
+
+						m_pNearCandidates[cCandidates] = iNode;
+						m_pNearDist[cCandidates] = ( vecOrigin - m_pNodes[iNode].m_vecOriginPeek ).Length();
+						cCandidates++;
+					}
+				}
+			}
+		}
+
+		float flBound = GridShellBound( vecOrigin, c, r );
+
+		for( ;; )
+		{
+			int iBest = -1;
+
+			for( i = 0; i < cCandidates; i++ )
+			{
+				if( m_pNearDist[i] <= flBound && ( iBest == -1 || m_pNearDist[i] < m_pNearDist[iBest] ) )
+					iBest = i;
+			}
+
+			if( iBest == -1 )
+				break;
+
+			if( NodeVisibleFrom( vecOrigin, q, m_pNearCandidates[iBest] ) )
+				return m_pNearCandidates[iBest];
+
+			// can't see it from here, forget it
+			cCandidates--;
+			m_pNearCandidates[iBest] = m_pNearCandidates[cCandidates];
+			m_pNearDist[iBest] = m_pNearDist[cCandidates];
+		}
+	}
+
+	return -1;
+}
+
+//=========================================================
+// CGraph - NodeVisibleFrom - the trace FindNearestNode needs,
+// skipped if the node was seen from the same quantised
+// position a moment ago.
+//=========================================================
+BOOL CGraph::NodeVisibleFrom( const Vector &vecOrigin, const int *q, int iNode )
+{
+	NODE_SEEN *pSeen = &m_pNodeSeen[iNode];
+	TraceResult tr;
+
+	if( pSeen->q[0] == q[0] && pSeen->q[1] == q[1] && pSeen->q[2] == q[2] &&
+		pSeen->time <= gpGlobals->time && gpGlobals->time < pSeen->time + NODESEEN_LIFETIME )
+	{
+		m_cNearSeenHits++;
+		return TRUE;
+	}
+
+	m_cNearTraces++;
+
+	// make sure that vecOrigin can trace to this node!
+	UTIL_TraceLine( vecOrigin, m_pNodes[iNode].m_vecOriginPeek, ignore_monsters, 0, &tr );
+
+	if( tr.flFraction != 1.0f )
+		return FALSE;
+
+	pSeen->q[0] = q[0];
+	pSeen->q[1] = q[1];
+	pSeen->q[2] = q[2];
+	pSeen->time = gpGlobals->time;
+	return TRUE;
+}
+
+//=========================================================
+// CGraph - GridShellBound - how close a node outside the cells
+// within r of cell c can be to vecOrigin. Sides of that box
+// at the edge of the grid have nothing past them.
+//=========================================================
+float CGraph::GridShellBound( const Vector &vecOrigin, const int *c, int r )
+{
+	float flBound = 1e30f;
+	int j;
+
+	for( j = 0; j < 3; j++ )
+	{
+		if( c[j] - r > 0 )
+			flBound = Q_min( flBound, vecOrigin[j] - ( m_vecGridMins[j] + ( c[j] - r ) * m_flGridCell ) );
+
+		if( c[j] + r < m_GridSize[j] - 1 )
+			flBound = Q_min( flBound, ( m_vecGridMins[j] + ( c[j] + r + 1 ) * m_flGridCell ) - vecOrigin[j] );
+	}
+
+	return Q_max( flBound, 0.0f );
+}
+
+int CGraph::GridCoord( float value, int axis )
+{
+	int c = (int)floor( ( value - m_vecGridMins[axis] ) / m_flGridCell );
+
+	if( c < 0 )
+		return 0;
+	if( c >= m_GridSize[axis] )
+		return m_GridSize[axis] - 1;
+	return c;
+}
+
+//=========================================================
+// CGraph - ShowNodeConnections - draws a line from the given node
+// to all connected nodes
+//=========================================================
+void CGraph::ShowNodeConnections( int iNode )
+{
+	Vector vecSpot;
+	CNode *pNode;
+	CNode *pLinkNode;
+	int i;
+
+	if( !m_fGraphPresent || !m_fGraphPointersSet )
+	{
+		// protect us in the case that the node graph isn't available or built
+		ALERT( at_aiconsole, "Graph not ready!\n" );
+		return;
+	}
+
+	if( iNode < 0 )
+	{
+		ALERT( at_aiconsole, "Can't show connections for node %d\n", iNode );
+		return;
+	}
+
+	pNode = &m_pNodes[iNode];
+
+	UTIL_ParticleEffect( pNode->m_vecOrigin, g_vecZero, 255, 20 );// show node position
+
+	if( pNode->m_cNumLinks <= 0 )
+	{
+		// no connections!
+		ALERT ( at_aiconsole, "**No Connections!\n" );
+	}
+
+	for( i = 0; i < pNode->m_cNumLinks; i++ )
+	{
+		pLinkNode = &Node( NodeLink( iNode, i ).m_iDestNode );
+		vecSpot = pLinkNode->m_vecOrigin;
+
+		MESSAGE_BEGIN( MSG_BROADCAST, SVC_TEMPENTITY );
+			WRITE_BYTE( TE_SHOWLINE );
+
+			WRITE_COORD( m_pNodes[iNode].m_vecOrigin.x );
+			WRITE_COORD( m_pNodes[iNode].m_vecOrigin.y );
 			WRITE_COORD( m_pNodes[iNode].m_vecOrigin.z + NODE_HEIGHT );
 
 			WRITE_COORD( vecSpot.x );
@@ -1241,7 +1742,7 @@ int CGraph::LinkVisibleNodes( CLink *pLinkPool, FILE *file, int *piBadNode )
 			// clear out the important fields in the link pool for this node
 			pLinkPool[cTotalLinks + z].m_iSrcNode = i;// so each link knows which node it originates from
 			pLinkPool[cTotalLinks + z].m_iDestNode = 0;
-			pLinkPool[cTotalLinks + z].m_pLinkEnt = NULL;
+			pLinkPool[cTotalLinks + z].m_iLinkEnt = 0;
 		}
 
 		m_pNodes[i].m_iFirstLink = cTotalLinks;
@@ -1296,8 +1797,8 @@ int CGraph::LinkVisibleNodes( CLink *pLinkPool, FILE *file, int *piBadNode )
 // graphs are prepared for use.
 				if( tr.pHit == pTraceEnt && !FClassnameIs( tr.pHit, "worldspawn" ) )
 				{
-					// get a pointer
-					pLinkPool[cTotalLinks].m_pLinkEnt = VARS( tr.pHit );
+					// get an index
+					pLinkPool[cTotalLinks].m_iLinkEnt = ENTINDEX( tr.pHit );
 
 					// record the modelname, so that we can save/load node trees
 					memcpy( pLinkPool[cTotalLinks].m_szLinkEntModelname, STRING( VARS( tr.pHit )->model ), 4 );
@@ -1321,7 +1822,7 @@ int CGraph::LinkVisibleNodes( CLink *pLinkPool, FILE *file, int *piBadNode )
 			{
 				fprintf( file, "%4d", j );
 
-				if( !FNullEnt( pLinkPool[cTotalLinks].m_pLinkEnt ) )
+				if( pLinkPool[cTotalLinks].m_iLinkEnt != 0 )
 				{
 					// record info about the ent in the way, if any.
 					fprintf( file, "  Entity on connection: %s, name: %s  Model: %s", STRING( VARS( pTraceEnt )->classname ), STRING( VARS( pTraceEnt )->targetname ), STRING( VARS( tr.pHit )->model ) );
@@ -2360,6 +2861,254 @@ void CQueuePriority::Heap_SiftUp( void )
 	}
 }
 
+CPathHeap::CPathHeap( void )
+{
+	m_cSize = 0;
+	m_cMaxSize = 0;
+	m_heap = NULL;
+}
+
+CPathHeap::~CPathHeap( void )
+{
+	free( m_heap );
+}
+
+//=========================================================
+// inserts a value, FALSE if the heap couldn't grow
+//=========================================================
+BOOL CPathHeap::Insert( int iValue, float fPriority )
+{
+	if( m_cSize == m_cMaxSize )
+	{
+		int cNewSize = m_cMaxSize ? m_cMaxSize * 2 : 256;
+		struct tag_HEAP_NODE *pNew = (struct tag_HEAP_NODE *)realloc( m_heap, cNewSize * sizeof(struct tag_HEAP_NODE) );
+
+		if( !pNew )
+			return FALSE;
+
+		m_heap = pNew;
+		m_cMaxSize = cNewSize;
+	}
+
+	int child = m_cSize++;
+
+	// sift up
+	while( child )
+	{
+		int parent = HEAP_PARENT( child );
+		if( m_heap[parent].Priority <= fPriority )
+			break;
+
+		m_heap[child] = m_heap[parent];
+		child = parent;
+	}
+
+	m_heap[child].Id = iValue;
+	m_heap[child].Priority = fPriority;
+	return TRUE;
+}
+
+//=========================================================
+// removes the smallest item
+//=========================================================
+int CPathHeap::Remove( float &fPriority )
+{
+	int iReturn = m_heap[0].Id;
+	fPriority = m_heap[0].Priority;
+
+	struct tag_HEAP_NODE Ref = m_heap[--m_cSize];
+	int parent = 0;
+	int child = HEAP_LEFT_CHILD( parent );
+
+	// sift down
+	while( child < m_cSize )
+	{
+		int rightchild = HEAP_RIGHT_CHILD( parent );
+		if( rightchild < m_cSize && m_heap[rightchild].Priority < m_heap[child].Priority )
+			child = rightchild;
+
+		if( Ref.Priority <= m_heap[child].Priority )
+			break;
+
+		m_heap[parent] = m_heap[child];
+		parent = child;
+		child = HEAP_LEFT_CHILD( parent );
+	}
+	m_heap[parent] = Ref;
+
+	return iReturn;
+}
+
+//=========================================================
+// .NOD file helpers. Graph files are mapped copy-on-write:
+// the few pages the server writes to (link entities, range
+// search marks) become private, the rest stay shared.
+//=========================================================
+static byte *Graph_MapFile( const char *szFilename, int *pLength )
+{
+#if _WIN32
+	HANDLE hFile, hMap;
+	DWORD dwSize;
+	byte *pFile;
+
+	hFile = CreateFileA( szFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( hFile == INVALID_HANDLE_VALUE )
+		return NULL;
+
+	dwSize = GetFileSize( hFile, NULL );
+	if( dwSize == INVALID_FILE_SIZE || dwSize == 0 || dwSize > 0x7fffffff )
+	{
+		CloseHandle( hFile );
+		return NULL;
+	}
+
+	hMap = CreateFileMappingA( hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+	CloseHandle( hFile );
+	if( !hMap )
+		return NULL;
+
+	// the view keeps the mapping alive
+	pFile = (byte *)MapViewOfFile( hMap, FILE_MAP_COPY, 0, 0, 0 );
+	CloseHandle( hMap );
+	if( !pFile )
+		return NULL;
+
+	*pLength = (int)dwSize;
+	return pFile;
+#elif __DOS__
+	return NULL;
+#else
+	struct stat st;
+	void *pFile;
+	int fd;
+
+	fd = open( szFilename, O_RDONLY );
+	if( fd < 0 )
+		return NULL;
+
+	if( fstat( fd, &st ) < 0 || st.st_size <= 0 || st.st_size > 0x7fffffff )
+	{
+		close( fd );
+		return NULL;
+	}
+
+	pFile = mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( pFile == MAP_FAILED )
+		return NULL;
+
+	*pLength = (int)st.st_size;
+	return (byte *)pFile;
+#endif
+}
+
+static void Graph_FreeFile( byte *pFile, int length, BOOL fMapped )
+{
+	if( !pFile )
+		return;
+
+	if( !fMapped )
+	{
+		FREE_FILE( pFile );
+		return;
+	}
+#if _WIN32
+	UnmapViewOfFile( pFile );
+#elif !__DOS__
+	munmap( pFile, length );
+#endif
+}
+
+// servers sharing a graphs directory may save the same map at once
+static int Graph_ProcessId( void )
+{
+#if _WIN32
+	return (int)GetCurrentProcessId();
+#elif __DOS__
+	return 0;
+#else
+	return (int)getpid();
+#endif
+}
+
+// readers that have the old file mapped keep it
+static BOOL Graph_ReplaceFile( const char *szFrom, const char *szTo )
+{
+#if _WIN32
+	return MoveFileExA( szFrom, szTo, MOVEFILE_REPLACE_EXISTING ) ? TRUE : FALSE;
+#else
+#if __DOS__
+	remove( szTo );
+#endif
+	return rename( szFrom, szTo ) == 0;
+#endif
+}
+
+static unsigned int Graph_Checksum( void *pData, int length )
+{
+	CRC32_t crc;
+
+	CRC32_INIT( &crc );
+	CRC32_PROCESS_BUFFER( &crc, pData, length );
+	return CRC32_FINAL( crc );
+}
+
+// 0 when the .bsp can't be read, which then only matches itself.
+// The graph is loaded and saved on every map start, so the CRC is kept
+// until the map name or the size of its .bsp changes.
+static unsigned int Graph_BSPChecksum( const char *szMapName )
+{
+	static char s_szMapName[64];
+	static int s_iLength = -1;
+	static unsigned int s_iChecksum;
+	char szBspFilename[MAX_PATH];
+	byte *pFile;
+	int length;
+
+	strcpy( szBspFilename, "maps/" );
+	strcat( szBspFilename, szMapName );
+	strcat( szBspFilename, ".bsp" );
+
+	length = g_engfuncs.pfnGetFileSize( szBspFilename );
+	if( length == s_iLength && !strcmp( szMapName, s_szMapName ))
+		return s_iChecksum;
+
+	s_iChecksum = 0;
+	pFile = LOAD_FILE_FOR_ME( szBspFilename, &length );
+	if( pFile )
+	{
+		s_iChecksum = Graph_Checksum( pFile, length );
+		FREE_FILE( pFile );
+	}
+
+	strncpy( s_szMapName, szMapName, sizeof( s_szMapName ) - 1 );
+	s_szMapName[sizeof( s_szMapName ) - 1] = '\0';
+	s_iLength = pFile ? length : -1;
+
+	return s_iChecksum;
+}
+
+static int Graph_Align( int ofs )
+{
+	return ( ofs + GRAPHFILE_ALIGN - 1 ) & ~( GRAPHFILE_ALIGN - 1 );
+}
+
+static BOOL Graph_LumpValid( const graphheader_t *pHeader, int iLump, int count, int size )
+{
+	const graphlump_t *pLump = &pHeader->lumps[iLump];
+
+	if( count < 0 || count > ( pHeader->filelength / size ) )
+		return FALSE;
+
+	if( pLump->filelen != count * size )
+		return FALSE;
+
+	if( pLump->fileofs < (int)sizeof( graphheader_t ) || ( pLump->fileofs & ( GRAPHFILE_ALIGN - 1 ) ) )
+		return FALSE;
+
+	return pLump->fileofs <= pHeader->filelength - pLump->filelen;
+}
+
 //=========================================================
 // CGraph - FLoadGraph - attempts to load a node graph from disk.
 // if the current level is maps/snar.bsp, maps/graphs/snar.nod
@@ -2369,10 +3118,15 @@ void CQueuePriority::Heap_SiftUp( void )
 int CGraph::FLoadGraph( const char *szMapName )
 {
 	char szFilename[MAX_PATH];
+	char szPath[MAX_PATH];
 	int iVersion;
 	int length;
-	byte *aMemFile;
-	byte *pMemFile;
+	byte *pFile;
+	BOOL fMapped;
+
+	// nothing of the node grid or the near cache comes from the file,
+	// they are built again for the new nodes in FSetGraphPointers
+	FreeNodeGrid();
 
 	// make sure the directories have been made
 	char szDirName[MAX_PATH];
@@ -2386,188 +3140,294 @@ int CGraph::FLoadGraph( const char *szMapName )
 	strcat( szFilename, szMapName );
 	strcat( szFilename, ".nod" );
 
-	pMemFile = aMemFile = LOAD_FILE_FOR_ME( szFilename, &length );
+	// map the copy FSaveGraph writes, or let the engine search for one
+	strcpy( szPath, szDirName );
+	strcat( szPath, "/" );
+	strcat( szPath, szMapName );
+	strcat( szPath, ".nod" );
+
+	fMapped = TRUE;
+	pFile = Graph_MapFile( szPath, &length );
+
+	if( !pFile )
+	{
+		fMapped = FALSE;
+		pFile = LOAD_FILE_FOR_ME( szFilename, &length );
+	}
 
-	if( !aMemFile )
+	if( !pFile )
 		return FALSE;
 
 	// Read the graph version number
 	//
-	length -= sizeof(int);
-	if( length < 0 )
-		goto ShortFile;
-	iVersion = *(int *) pMemFile;
-	pMemFile += sizeof(int);
+	if( length < (int)sizeof(int) )
+	{
+		Graph_FreeFile( pFile, length, fMapped );
+		return FALSE;
+	}
+	iVersion = *(int *)pFile;
 
-	if( iVersion == GRAPH_VERSION || iVersion == GRAPH_VERSION_RETAIL )
+	if( iVersion == GRAPH_VERSION )
 	{
-		// Read the graph class
-		//
-		if ( iVersion == GRAPH_VERSION )
+		if( FLoadGraphSections( pFile, length, szMapName ) )
 		{
-			length -= sizeof(CGraph);
-			if( length < 0 )
-				goto ShortFile;
-			memcpy( this, pMemFile, sizeof(CGraph) );
-			pMemFile += sizeof(CGraph);
-
-			// Set the pointers to zero, just in case we run out of memory.
-			//
-			m_pNodes = NULL;
-			m_pLinkPool = NULL;
-			m_di = NULL;
-			m_pRouteInfo = NULL;
-			m_pHashLinks = NULL;
+			// the graph lives in the file from now on
+			m_pGraphFile = pFile;
+			m_nGraphFile = length;
+			m_fGraphFileMapped = fMapped;
+			return TRUE;
 		}
-#if _GRAPH_VERSION != _GRAPH_VERSION_RETAIL
-		else
+	}
+	else if( iVersion == GRAPH_VERSION_RETAIL )
+	{
+		// copied out into arrays of its own
+		if( FLoadRetailGraph( pFile, length ) )
 		{
-			ALERT( at_aiconsole, "Loading CGraph in GRAPH_VERSION 16 compatibility mode\n" );
-			length -= sizeof(CGraph_Retail);
-			if( length < 0 )
-				goto ShortFile;
-			reinterpret_cast<CGraph_Retail*>(pMemFile) -> copyOverTo(this);
-			pMemFile += sizeof(CGraph_Retail);
+			Graph_FreeFile( pFile, length, fMapped );
+			return TRUE;
 		}
-#endif
-
-		// Malloc for the nodes
+	}
+	else
+	{
+		// This file was written by a different build of the dll!
 		//
-		m_pNodes = (CNode *)calloc( sizeof(CNode), m_cNodes );
+		ALERT( at_aiconsole, "**ERROR** Graph version is %d, expected %d\n", iVersion, GRAPH_VERSION );
+	}
 
-		if( !m_pNodes )
-		{
-			ALERT( at_aiconsole, "**ERROR**\nCouldn't malloc %d nodes!\n", m_cNodes );
-			goto NoMemory;
-		}
+	Graph_FreeFile( pFile, length, fMapped );
+	return FALSE;
+}
 
-		// Read in all the nodes
-		//
-		length -= sizeof(CNode) * m_cNodes;
-		if( length < 0 )
-			goto ShortFile;
-		memcpy( m_pNodes, pMemFile, sizeof(CNode) * m_cNodes );
-		pMemFile += sizeof(CNode) * m_cNodes;
+//=========================================================
+// CGraph - FLoadGraphSections - points the graph at the
+// arrays in a GRAPH_VERSION file. Nothing is copied, the
+// file must stay around until InitGraph.
+//=========================================================
+int CGraph::FLoadGraphSections( byte *pFile, int length, const char *szMapName )
+{
+	graphheader_t header;
+	unsigned int checksum;
 
-		// Malloc for the link pool
-		//
-		m_pLinkPool = (CLink *)calloc( sizeof(CLink), m_cLinks );
+	if( length < (int)sizeof(graphheader_t) )
+	{
+		ALERT( at_aiconsole, "**ERROR** Graph file is too short\n" );
+		return FALSE;
+	}
 
-		if( !m_pLinkPool )
-		{
-			ALERT( at_aiconsole, "**ERROR**\nCouldn't malloc %d link!\n", m_cLinks );
-			goto NoMemory;
-		}
+	memcpy( &header, pFile, sizeof(graphheader_t) );
 
-		// Read in all the links
-		//
-		if( iVersion == GRAPH_VERSION )
-		{
-			length -= sizeof(CLink) * m_cLinks;
-			if( length < 0 )
-				goto ShortFile;
-			memcpy( m_pLinkPool, pMemFile, sizeof(CLink) * m_cLinks );
-			pMemFile += sizeof(CLink) * m_cLinks;
-		}
-#if _GRAPH_VERSION != _GRAPH_VERSION_RETAIL
-		else
-		{
-			ALERT( at_aiconsole, "Loading CLink array in GRAPH_VERSION 16 compatibility mode\n" );
-			length -= sizeof(CLink_Retail) * m_cLinks;
-			if( length < 0 )
-				goto ShortFile;
-			for (int j = 0; j < m_cLinks; ++j)
-			{
-				reinterpret_cast<CLink_Retail*>(pMemFile + sizeof(CLink_Retail) * j) -> copyOverTo(m_pLinkPool + j);
-			}
-			pMemFile += sizeof(CLink_Retail) * m_cLinks;
-		}
-#endif
+	checksum = header.headerchecksum;
+	header.headerchecksum = 0;
 
-		// Malloc for the sorting info.
-		//
-		m_di = (DIST_INFO *)calloc( sizeof(DIST_INFO), m_cNodes );
-		if( !m_di )
-		{
-			ALERT( at_aiconsole, "***ERROR**\nCouldn't malloc %d entries sorting nodes!\n", m_cNodes );
-			goto NoMemory;
-		}
+	if( header.ident != GRAPHFILE_IDENT || header.filelength != length
+	   || Graph_Checksum( &header, sizeof(graphheader_t) ) != checksum )
+	{
+		ALERT( at_aiconsole, "**ERROR** Graph file is damaged\n" );
+		return FALSE;
+	}
 
-		// Read it in.
-		//
-		length -= sizeof(DIST_INFO) * m_cNodes;
-		if( length < 0 )
-			goto ShortFile;
-		memcpy( m_di, pMemFile, sizeof(DIST_INFO) * m_cNodes );
-		pMemFile += sizeof(DIST_INFO) * m_cNodes;
+	if( header.bspchecksum != Graph_BSPChecksum( szMapName ) )
+	{
+		ALERT( at_aiconsole, "Graph was built for a different %s.bsp\n", szMapName );
+		return FALSE;
+	}
 
-		// Malloc for the routing info.
-		//
-		m_fRoutingComplete = FALSE;
-		m_pRouteInfo = (signed char *)calloc( sizeof(signed char), m_nRouteInfo );
-		if( !m_pRouteInfo )
-		{
-			ALERT( at_aiconsole, "***ERROR**\nCouldn't malloc %d route bytes!\n", m_nRouteInfo );
-			goto NoMemory;
-		}
-		m_CheckedCounter = 0;
-		for(int i = 0; i < m_cNodes; i++ )
-		{
-			m_di[i].m_CheckedEvent = 0;
-		}
+	if( header.cNodes > MAX_NODES
+	   || !Graph_LumpValid( &header, GRAPHLUMP_NODES, header.cNodes, sizeof(CNode) )
+	   || !Graph_LumpValid( &header, GRAPHLUMP_LINKS, header.cLinks, sizeof(CLink) )
+	   || !Graph_LumpValid( &header, GRAPHLUMP_DISTINFO, header.cNodes, sizeof(DIST_INFO) )
+	   || !Graph_LumpValid( &header, GRAPHLUMP_ROUTEINFO, header.nRouteInfo, sizeof(signed char) )
+	   || !Graph_LumpValid( &header, GRAPHLUMP_HASHLINKS, header.nHashLinks, sizeof(short) ) )
+	{
+		ALERT( at_aiconsole, "**ERROR** Graph file has bad sections\n" );
+		return FALSE;
+	}
 
-		// Read in the route information.
-		//
-		length -= sizeof(char) * m_nRouteInfo;
-		if( length < 0 )
-			goto ShortFile;
-		memcpy( m_pRouteInfo, pMemFile, sizeof(char) * m_nRouteInfo );
-		pMemFile += sizeof(char) * m_nRouteInfo;
-		m_fRoutingComplete = TRUE;
-
-		// malloc for the hash links
-		//
-		m_pHashLinks = (short *)calloc( sizeof(short), m_nHashLinks );
-		if( !m_pHashLinks )
-		{
-			ALERT( at_aiconsole, "***ERROR**\nCouldn't malloc %d hash link bytes!\n", m_nHashLinks );
-			goto NoMemory;
-		}
+	m_cNodes = header.cNodes;
+	m_cLinks = header.cLinks;
+	m_nRouteInfo = header.nRouteInfo;
+	m_nHashLinks = header.nHashLinks;
+
+	memcpy( m_RangeStart, header.RangeStart, sizeof(m_RangeStart) );
+	memcpy( m_RangeEnd, header.RangeEnd, sizeof(m_RangeEnd) );
+	memcpy( m_RegionMin, header.RegionMin, sizeof(m_RegionMin) );
+	memcpy( m_RegionMax, header.RegionMax, sizeof(m_RegionMax) );
+	memcpy( m_HashPrimes, header.HashPrimes, sizeof(m_HashPrimes) );
+
+	m_pNodes = (CNode *)( pFile + header.lumps[GRAPHLUMP_NODES].fileofs );
+	m_pLinkPool = (CLink *)( pFile + header.lumps[GRAPHLUMP_LINKS].fileofs );
+	m_di = (DIST_INFO *)( pFile + header.lumps[GRAPHLUMP_DISTINFO].fileofs );
+	m_pRouteInfo = (signed char *)( pFile + header.lumps[GRAPHLUMP_ROUTEINFO].fileofs );
+	m_pHashLinks = (short *)( pFile + header.lumps[GRAPHLUMP_HASHLINKS].fileofs );
+
+	// FSaveGraph clears m_CheckedEvent, so m_di needs no pass here
+	m_CheckedCounter = 0;
+	memset( m_Cache, 0, sizeof(m_Cache) );
+	m_fRoutingComplete = TRUE;
 
-		// Read in the hash link information
-		//
-		length -= sizeof(short) * m_nHashLinks;
-		if( length < 0 )
-			goto ShortFile;
-		memcpy( m_pHashLinks, pMemFile, sizeof(short) * m_nHashLinks );
-		// pMemFile += sizeof(short) * m_nHashLinks;
+	// Set the graph present flag, clear the pointers set flag
+	//
+	m_fGraphPresent = TRUE;
+	m_fGraphPointersSet = FALSE;
 
-		// Set the graph present flag, clear the pointers set flag
-		//
-		m_fGraphPresent = TRUE;
-		m_fGraphPointersSet = FALSE;
+	return TRUE;
+}
 
-		FREE_FILE( aMemFile );
+//=========================================================
+// CGraph - FLoadRetailGraph - reads a GRAPH_VERSION_RETAIL
+// file, as written by the 32 bit retail dll.
+//=========================================================
+int CGraph::FLoadRetailGraph( byte *pFile, int length )
+{
+	byte *pMemFile = pFile + sizeof(int);
 
-		if( length != 0 )
-		{
-			ALERT( at_aiconsole, "***WARNING***:Node graph was longer than expected by %d bytes.!\n", length );
-		}
+	length -= sizeof(int);
 
-		return TRUE;
+	// Read the graph class
+	//
+	ALERT( at_aiconsole, "Loading CGraph in GRAPH_VERSION 16 compatibility mode\n" );
+	length -= sizeof(CGraph_Retail);
+	if( length < 0 )
+		return FALSE;
+	reinterpret_cast<CGraph_Retail*>(pMemFile) -> copyOverTo(this);
+	pMemFile += sizeof(CGraph_Retail);
+
+	// Malloc for the nodes
+	//
+	m_pNodes = (CNode *)calloc( sizeof(CNode), m_cNodes );
+
+	if( !m_pNodes )
+	{
+		ALERT( at_aiconsole, "**ERROR**\nCouldn't malloc %d nodes!\n", m_cNodes );
+		return FALSE;
 	}
-	else
+
+	// Read in all the nodes
+	//
+	length -= sizeof(CNode) * m_cNodes;
+	if( length < 0 )
+		return FALSE;
+	memcpy( m_pNodes, pMemFile, sizeof(CNode) * m_cNodes );
+	pMemFile += sizeof(CNode) * m_cNodes;
+
+	// Malloc for the link pool
+	//
+	m_pLinkPool = (CLink *)calloc( sizeof(CLink), m_cLinks );
+
+	if( !m_pLinkPool )
 	{
-		// This file was written by a different build of the dll!
-		//
-		ALERT( at_aiconsole, "**ERROR** Graph version is %d, expected %d\n", iVersion, GRAPH_VERSION );
-		goto ShortFile;
+		ALERT( at_aiconsole, "**ERROR**\nCouldn't malloc %d link!\n", m_cLinks );
+		return FALSE;
 	}
 
-ShortFile:
-NoMemory:
-	FREE_FILE( aMemFile );
-	return FALSE;
+	// Read in all the links
+	//
+	ALERT( at_aiconsole, "Loading CLink array in GRAPH_VERSION 16 compatibility mode\n" );
+	length -= sizeof(CLink_Retail) * m_cLinks;
+	if( length < 0 )
+		return FALSE;
+	for (int j = 0; j < m_cLinks; ++j)
+	{
+		reinterpret_cast<CLink_Retail*>(pMemFile + sizeof(CLink_Retail) * j) -> copyOverTo(m_pLinkPool + j);
+	}
+	pMemFile += sizeof(CLink_Retail) * m_cLinks;
+
+	// Malloc for the sorting info.
+	//
+	m_di = (DIST_INFO *)calloc( sizeof(DIST_INFO), m_cNodes );
+	if( !m_di )
+	{
+		ALERT( at_aiconsole, "***ERROR**\nCouldn't malloc %d entries sorting nodes!\n", m_cNodes );
+		return FALSE;
+	}
+
+	// Read it in.
+	//
+	length -= sizeof(DIST_INFO) * m_cNodes;
+	if( length < 0 )
+		return FALSE;
+	memcpy( m_di, pMemFile, sizeof(DIST_INFO) * m_cNodes );
+	pMemFile += sizeof(DIST_INFO) * m_cNodes;
+
+	// Malloc for the routing info.
+	//
+	m_fRoutingComplete = FALSE;
+	m_pRouteInfo = (signed char *)calloc( sizeof(signed char), m_nRouteInfo );
+	if( !m_pRouteInfo )
+	{
+		ALERT( at_aiconsole, "***ERROR**\nCouldn't malloc %d route bytes!\n", m_nRouteInfo );
+		return FALSE;
+	}
+	m_CheckedCounter = 0;
+	for(int i = 0; i < m_cNodes; i++ )
+	{
+		m_di[i].m_CheckedEvent = 0;
+	}
+	memset( m_Cache, 0, sizeof(m_Cache) );
+
+	// Read in the route information.
+	//
+	length -= sizeof(char) * m_nRouteInfo;
+	if( length < 0 )
+		return FALSE;
+	memcpy( m_pRouteInfo, pMemFile, sizeof(char) * m_nRouteInfo );
+	pMemFile += sizeof(char) * m_nRouteInfo;
+	m_fRoutingComplete = TRUE;
+
+	// malloc for the hash links
+	//
+	m_pHashLinks = (short *)calloc( sizeof(short), m_nHashLinks );
+	if( !m_pHashLinks )
+	{
+		ALERT( at_aiconsole, "***ERROR**\nCouldn't malloc %d hash link bytes!\n", m_nHashLinks );
+		return FALSE;
+	}
+
+	// Read in the hash link information
+	//
+	length -= sizeof(short) * m_nHashLinks;
+	if( length < 0 )
+		return FALSE;
+	memcpy( m_pHashLinks, pMemFile, sizeof(short) * m_nHashLinks );
+	// pMemFile += sizeof(short) * m_nHashLinks;
+
+	// Set the graph present flag, clear the pointers set flag
+	//
+	m_fGraphPresent = TRUE;
+	m_fGraphPointersSet = FALSE;
+
+	if( length != 0 )
+	{
+		// some builds wrote their own, larger CGraph with version 16 too,
+		// everything after it would be read from the wrong place
+		ALERT( at_aiconsole, "***ERROR***:Node graph was longer than expected by %d bytes.!\n", length );
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+//=========================================================
+// CGraph - FreeGraphFile - releases the file a loaded graph
+// points into. The arrays go with it.
+//=========================================================
+void CGraph::FreeGraphFile( void )
+{
+	Graph_FreeFile( m_pGraphFile, m_nGraphFile, m_fGraphFileMapped );
+
+	m_pGraphFile = NULL;
+	m_nGraphFile = 0;
+	m_fGraphFileMapped = FALSE;
+}
+
+// zeros up to ofs, the sections start aligned
+static void Graph_WritePadding( FILE *file, int ofs )
+{
+	static const byte zeros[GRAPHFILE_ALIGN] = { 0 };
+	int pad = ofs - (int)ftell( file );
+
+	if( pad > 0 )
+		fwrite( zeros, 1, pad, file );
 }
 
 //=========================================================
@@ -2576,9 +3436,11 @@ NoMemory:
 //=========================================================
 int CGraph::FSaveGraph( const char *szMapName )
 {
-	int iVersion = GRAPH_VERSION;
 	char szFilename[MAX_PATH];
+	char szTempname[MAX_PATH + 16];
+	graphheader_t header;
 	FILE *file;
+	int ofs, i;
 
 	if( !m_fGraphPresent || !m_fGraphPointersSet )
 	{
@@ -2598,9 +3460,10 @@ int CGraph::FSaveGraph( const char *szMapName )
 	strcat( szFilename, szMapName );
 	strcat( szFilename, ".nod" );
 
-	file = fopen( szFilename, "wb" );
+	// written aside and moved into place, other servers may have the old one mapped
+	sprintf( szTempname, "%s.%d", szFilename, Graph_ProcessId() );
 
-	ALERT( at_aiconsole, "Created: %s\n", szFilename );
+	file = fopen( szTempname, "wb" );
 
 	if( !file )
 	{
@@ -2608,36 +3471,85 @@ int CGraph::FSaveGraph( const char *szMapName )
 		ALERT( at_aiconsole, "Couldn't Create: %s\n", szFilename );
 		return FALSE;
 	}
-	else
+
+	memset( &header, 0, sizeof(header) );
+	header.version = GRAPH_VERSION;
+	header.ident = GRAPHFILE_IDENT;
+	header.bspchecksum = Graph_BSPChecksum( szMapName );
+
+	header.cNodes = m_cNodes;
+	header.cLinks = m_cLinks;
+	header.nRouteInfo = m_pRouteInfo ? m_nRouteInfo : 0;
+	header.nHashLinks = m_pHashLinks ? m_nHashLinks : 0;
+
+	memcpy( header.RangeStart, m_RangeStart, sizeof(header.RangeStart) );
+	memcpy( header.RangeEnd, m_RangeEnd, sizeof(header.RangeEnd) );
+	memcpy( header.RegionMin, m_RegionMin, sizeof(header.RegionMin) );
+	memcpy( header.RegionMax, m_RegionMax, sizeof(header.RegionMax) );
+	memcpy( header.HashPrimes, m_HashPrimes, sizeof(header.HashPrimes) );
+
+	header.lumps[GRAPHLUMP_NODES].filelen = sizeof(CNode) * header.cNodes;
+	header.lumps[GRAPHLUMP_LINKS].filelen = sizeof(CLink) * header.cLinks;
+	header.lumps[GRAPHLUMP_DISTINFO].filelen = sizeof(DIST_INFO) * header.cNodes;
+	header.lumps[GRAPHLUMP_ROUTEINFO].filelen = sizeof(signed char) * header.nRouteInfo;
+	header.lumps[GRAPHLUMP_HASHLINKS].filelen = sizeof(short) * header.nHashLinks;
+
+	ofs = Graph_Align( sizeof(header) );
+	for( i = 0; i < GRAPHLUMP_COUNT; i++ )
 	{
-		// write the version
-		fwrite( &iVersion, sizeof(int), 1, file );
+		header.lumps[i].fileofs = ofs;
+		ofs = Graph_Align( ofs + header.lumps[i].filelen );
+	}
+	header.filelength = ofs;
 
-		// write the CGraph class
-		fwrite( this, sizeof(CGraph), 1, file );
+	header.headerchecksum = Graph_Checksum( &header, sizeof(header) );
 
-		// write the nodes
-		fwrite( m_pNodes, sizeof(CNode), m_cNodes, file );
+	// write the header
+	fwrite( &header, sizeof(header), 1, file );
 
-		// write the links
-		fwrite( m_pLinkPool, sizeof(CLink), m_cLinks, file );
+	// write the nodes
+	Graph_WritePadding( file, header.lumps[GRAPHLUMP_NODES].fileofs );
+	fwrite( m_pNodes, sizeof(CNode), header.cNodes, file );
 
-		fwrite( m_di, sizeof(DIST_INFO), m_cNodes, file );
+	// write the links, the entity indices only mean "look it up by model name" to FSetGraphPointers
+	Graph_WritePadding( file, header.lumps[GRAPHLUMP_LINKS].fileofs );
+	fwrite( m_pLinkPool, sizeof(CLink), header.cLinks, file );
 
-		// Write the route info.
-		//
-		if( m_pRouteInfo && m_nRouteInfo )
-		{
-			fwrite( m_pRouteInfo, sizeof(signed char), m_nRouteInfo, file );
-		}
+	// write the sorting info, unchecked
+	Graph_WritePadding( file, header.lumps[GRAPHLUMP_DISTINFO].fileofs );
+	for( i = 0; i < header.cNodes; i++ )
+	{
+		DIST_INFO di = m_di[i];
 
-		if( m_pHashLinks && m_nHashLinks )
-		{
-			fwrite( m_pHashLinks, sizeof(short), m_nHashLinks, file );
-		}
-		fclose( file );
-		return TRUE;
+		di.m_CheckedEvent = 0;
+		fwrite( &di, sizeof(DIST_INFO), 1, file );
+	}
+
+	// Write the route info.
+	//
+	Graph_WritePadding( file, header.lumps[GRAPHLUMP_ROUTEINFO].fileofs );
+	if( header.nRouteInfo )
+	{
+		fwrite( m_pRouteInfo, sizeof(signed char), header.nRouteInfo, file );
+	}
+
+	Graph_WritePadding( file, header.lumps[GRAPHLUMP_HASHLINKS].fileofs );
+	if( header.nHashLinks )
+	{
+		fwrite( m_pHashLinks, sizeof(short), header.nHashLinks, file );
+	}
+
+	Graph_WritePadding( file, header.filelength );
+
+	if( fclose( file ) || !Graph_ReplaceFile( szTempname, szFilename ) )
+	{
+		ALERT( at_aiconsole, "Couldn't Create: %s\n", szFilename );
+		remove( szTempname );
+		return FALSE;
 	}
+
+	ALERT( at_aiconsole, "Created: %s\n", szFilename );
+	return TRUE;
 }
 
 //=========================================================
@@ -2655,7 +3567,7 @@ int CGraph::FSetGraphPointers( void )
 	for( i = 0; i < m_cLinks; i++ )
 	{
 		// go through all of the links
-		if( m_pLinkPool[i].m_pLinkEnt != NULL )
+		if( m_pLinkPool[i].m_iLinkEnt != 0 )
 		{
 			char name[5];
 			// when graphs are saved, any valid pointers are will be non-zero, signifying that we should
@@ -2672,25 +3584,192 @@ int CGraph::FSetGraphPointers( void )
 				// the ent isn't around anymore? Either there is a major problem, or it was removed from the world
 				// ( like a func_breakable that's been destroyed or something ). Make sure that LinkEnt is null.
 				ALERT( at_aiconsole, "**Could not find model %s\n", name );
-				m_pLinkPool[i].m_pLinkEnt = NULL;
+				m_pLinkPool[i].m_iLinkEnt = 0;
 			}
 			else
 			{
-				m_pLinkPool[i].m_pLinkEnt = VARS( pentLinkEnt );
+				// the pool may be a shared mapping of the graph file, writing
+				// the same index again would still give this process its own copy
+				int iLinkEnt = ENTINDEX( pentLinkEnt );
+
+				if( m_pLinkPool[i].m_iLinkEnt != iLinkEnt )
+					m_pLinkPool[i].m_iLinkEnt = iLinkEnt;
 
-				if( !FBitSet( m_pLinkPool[i].m_pLinkEnt->flags, FL_GRAPHED ) )
+				if( !FBitSet( VARS( pentLinkEnt )->flags, FL_GRAPHED ) )
 				{
-					m_pLinkPool[i].m_pLinkEnt->flags += FL_GRAPHED;
+					VARS( pentLinkEnt )->flags += FL_GRAPHED;
 				}
 			}
 		}
 	}
 
+	BuildNodeGrid();
+	InvalidatePathCache();
+
 	// the pointers are now set.
 	m_fGraphPointersSet = TRUE;
 	return TRUE;
 }
 
+//=========================================================
+// CGraph - BuildNodeGrid - buckets the nodes into a uniform
+// grid for FindNearestNode. The cells grow until the grid
+// covering all nodes is small enough.
+//=========================================================
+void CGraph::BuildNodeGrid( void )
+{
+	int i, j;
+	int *pFill;
+	Vector vecMins, vecMaxs;
+
+	FreeNodeGrid();
+
+	if( m_cNodes <= 0 )
+		return;
+
+	vecMins = vecMaxs = m_pNodes[0].m_vecOriginPeek;
+
+	for( i = 1; i < m_cNodes; i++ )
+	{
+		for( j = 0; j < 3; j++ )
+		{
+			vecMins[j] = Q_min( vecMins[j], m_pNodes[i].m_vecOriginPeek[j] );
+			vecMaxs[j] = Q_max( vecMaxs[j], m_pNodes[i].m_vecOriginPeek[j] );
+		}
+	}
+
+	m_vecGridMins = vecMins;
+	m_flGridCell = NODEGRID_CELL_SIZE;
+
+	for( ;; )
+	{
+		for( j = 0; j < 3; j++ )
+			m_GridSize[j] = (int)( ( vecMaxs[j] - vecMins[j] ) / m_flGridCell ) + 1;
+
+		if( m_GridSize[0] * m_GridSize[1] * m_GridSize[2] <= NODEGRID_MAX_CELLS )
+			break;
+
+		m_flGridCell *= 2.0f;
+	}
+
+	m_nGridCells = m_GridSize[0] * m_GridSize[1] * m_GridSize[2];
+
+	m_pGridStart = (int *)calloc( sizeof(int), m_nGridCells + 1 );
+	m_pGridNodes = (int *)calloc( sizeof(int), m_cNodes );
+	m_pNodeSeen = (NODE_SEEN *)calloc( sizeof(NODE_SEEN), m_cNodes );
+	m_pNearCandidates = (int *)calloc( sizeof(int), m_cNodes );
+	m_pNearDist = (float *)calloc( sizeof(float), m_cNodes );
+	pFill = (int *)calloc( sizeof(int), m_nGridCells );
+
+	if( !m_pGridStart || !m_pGridNodes || !m_pNodeSeen || !m_pNearCandidates || !m_pNearDist || !pFill )
+	{
+		ALERT( at_aiconsole, "Couldn't allocate the node grid.\n" );
+		free( pFill );
+		FreeNodeGrid();
+		return;
+	}
+
+	// count, then place each node after the ones of the cells before it
+	for( i = 0; i < m_cNodes; i++ )
+	{
+		const Vector &vecOrigin = m_pNodes[i].m_vecOriginPeek;
+		int iCell = ( GridCoord( vecOrigin.z, 2 ) * m_GridSize[1] + GridCoord( vecOrigin.y, 1 ) ) * m_GridSize[0] + GridCoord( vecOrigin.x, 0 );
+
+		m_pGridStart[iCell + 1]++;
+	}
+
+	for( i = 0; i < m_nGridCells; i++ )
+	{
+		m_pGridStart[i + 1] += m_pGridStart[i];
+		pFill[i] = m_pGridStart[i];
+	}
+
+	for( i = 0; i < m_cNodes; i++ )
+	{
+		const Vector &vecOrigin = m_pNodes[i].m_vecOriginPeek;
+		int iCell = ( GridCoord( vecOrigin.z, 2 ) * m_GridSize[1] + GridCoord( vecOrigin.y, 1 ) ) * m_GridSize[0] + GridCoord( vecOrigin.x, 0 );
+
+		m_pGridNodes[pFill[iCell]++] = i;
+	}
+
+	free( pFill );
+
+	for( i = 0; i < m_cNodes; i++ )
+		m_pNodeSeen[i].time = -NODESEEN_LIFETIME;
+
+	for( i = 0; i < NEARCACHE_SIZE; i++ )
+		m_NearCache[i].n = -1;
+
+	ResetNodeGridStats();
+
+	ALERT( at_aiconsole, "Node grid: %d x %d x %d cells of %.0f units\n", m_GridSize[0], m_GridSize[1], m_GridSize[2], m_flGridCell );
+}
+
+void CGraph::FreeNodeGrid( void )
+{
+	free( m_pGridStart );
+	free( m_pGridNodes );
+	free( m_pNodeSeen );
+	free( m_pNearCandidates );
+	free( m_pNearDist );
+
+	m_pGridStart = NULL;
+	m_pGridNodes = NULL;
+	m_pNodeSeen = NULL;
+	m_pNearCandidates = NULL;
+	m_pNearDist = NULL;
+	m_nGridCells = 0;
+
+	// the cached answers are indices of the nodes the grid was built for
+	for( int i = 0; i < NEARCACHE_SIZE; i++ )
+		m_NearCache[i].n = -1;
+}
+
+void CGraph::ResetNodeGridStats( void )
+{
+	m_cNearQueries = 0;
+	m_cNearExactHits = 0;
+	m_cNearCacheHits = 0;
+	m_cNearSearches = 0;
+	m_cNearTraces = 0;
+	m_cNearSeenHits = 0;
+}
+
+void CGraph::ReportNodeGridStats( void )
+{
+	if( !m_pGridNodes )
+	{
+		ALERT( at_console, "Node grid: not built (%d nodes)\n", m_cNodes );
+		return;
+	}
+
+	unsigned int looked = m_cNearQueries - m_cNearExactHits;
+
+	ALERT( at_console, "Node grid: %s, %d nodes, %d x %d x %d cells of %.0f units\n",
+		sv_nodegrid.value ? "enabled" : "disabled", m_cNodes, m_GridSize[0], m_GridSize[1], m_GridSize[2], m_flGridCell );
+	ALERT( at_console, "  queries %u, exact cache hits %u, quantised cache hits %u, searches %u\n",
+		m_cNearQueries, m_cNearExactHits, m_cNearCacheHits, m_cNearSearches );
+	ALERT( at_console, "  traces %u, seen from memo hits %u, avg traces per lookup %.2f\n",
+		m_cNearTraces, m_cNearSeenHits, looked ? (double)m_cNearTraces / looked : 0.0 );
+}
+
+// sv_nodestats [reset]
+void NodeGraph_Stats_f( void )
+{
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ))
+	{
+		WorldGraph.ResetNodeGridStats();
+		WorldGraph.ResetPathStats();
+		g_RouteQueue.ResetStats();
+		ALERT( at_console, "Node graph statistics reset\n" );
+		return;
+	}
+
+	WorldGraph.ReportNodeGridStats();
+	WorldGraph.ReportPathStats();
+	g_RouteQueue.ReportStats();
+}
+
 //=========================================================
 // CGraph - CheckNODFile - this function checks the date of 
 // the BSP file that was just loaded and the date of the a
@@ -3129,22 +4208,374 @@ void CGraph::BuildRegionTables( void )
 	memset( m_Cache, 0, sizeof(m_Cache) );
 }
 
+//=========================================================
+// Static routing tables are built from one shortest path
+// tree per source node. The trees are independent, so they
+// are grown on the worker pool, each thread with its own
+// scratch distances. Routes is then filled in the same
+// order the original path by path search used, and each
+// row is compressed on the pool into its own buffer. The
+// rows are merged into m_pRouteInfo in node order, so the
+// result is the same whatever the number of threads.
+//=========================================================
+typedef struct routejob_s
+{
+	CGraph		*pGraph;
+	const byte	*pLinkUsable;	// per link, for the hull and capability being built
+	float		*pflClosest[WORKER_MAX_THREADS + 1];	// per thread scratch
+	short		*pPrevious;	// m_cNodes trees, m_cNodes each
+	const short	*pRoutes;
+	signed char	*pRoute;	// m_cNodes * 2 bytes per row
+	int		*pRouteSize;
+	int		*pCompressedSize;
+	int		*pUnsorted;
+} routejob_t;
+
+static void Route_TreeJob( void *data, int index, int thread )
+{
+	routejob_t *pJob = (routejob_t *)data;
+	CGraph *pGraph = pJob->pGraph;
+
+	pGraph->BuildRouteTree( index, pJob->pLinkUsable, pJob->pflClosest[thread], pJob->pPrevious + index * pGraph->m_cNodes );
+}
+
+static void Route_CompressJob( void *data, int index, int thread )
+{
+	routejob_t *pJob = (routejob_t *)data;
+	CGraph *pGraph = pJob->pGraph;
+
+	pJob->pRouteSize[index] = pGraph->CompressRoutes( index, pJob->pRoutes + index * pGraph->m_cNodes,
+		pJob->pRoute + index * pGraph->m_cNodes * 2, &pJob->pCompressedSize[index], &pJob->pUnsorted[index] );
+}
+
+//=========================================================
+// CGraph - BuildRouteTree - FindShortestPath's search run
+// to completion from one node, so pPrevious holds the path
+// it would find to every other node. A node's previous
+// node no longer changes once it leaves the queue, which is
+// also where FindShortestPath stops for its destination.
+// Safe to call from the worker threads, the brush entities
+// are looked at beforehand in pLinkUsable.
+//=========================================================
+void CGraph::BuildRouteTree( int iStart, const byte *pLinkUsable, float *pflClosest, short *pPrevious )
+{
+	int i;
+	int iVisitNode;
+	int iCurrentNode;
+	CQueuePriority queue;
+
+	for( i = 0; i < m_cNodes; i++ )
+	{
+		pflClosest[i] = -1.0f;
+	}
+
+	pflClosest[iStart] = 0.0;
+	pPrevious[iStart] = iStart;
+	queue.Insert( iStart, 0.0 );
+
+	while( !queue.Empty() )
+	{
+		float flCurrentDistance;
+		iCurrentNode = queue.Remove( flCurrentDistance );
+
+		CNode *pCurrentNode = &m_pNodes[iCurrentNode];
+
+		for( i = 0; i < pCurrentNode->m_cNumLinks; i++ )
+		{
+			CLink *pLink = &m_pLinkPool[pCurrentNode->m_iFirstLink + i];
+
+			if( !pLinkUsable[pCurrentNode->m_iFirstLink + i] )
+				continue;
+
+			iVisitNode = pLink->m_iDestNode;
+
+			float flOurDistance = flCurrentDistance + pLink->m_flWeight;
+			if( pflClosest[iVisitNode] < -0.5f
+			   || flOurDistance < pflClosest[iVisitNode] - 0.001f )
+			{
+				pflClosest[iVisitNode] = flOurDistance;
+				pPrevious[iVisitNode] = iCurrentNode;
+
+				queue.Insert( iVisitNode, flOurDistance );
+			}
+		}
+	}
+
+	for( i = 0; i < m_cNodes; i++ )
+	{
+		if( pflClosest[i] < -0.5f )
+			pPrevious[i] = -1;
+	}
+}
+
+//=========================================================
+// CGraph - RouteTreePath - the path from iStart to iDest in
+// iStart's tree, as FindShortestPath would return it.
+//=========================================================
+int CGraph::RouteTreePath( int *piPath, int iStart, int iDest, const short *pPrevious )
+{
+	int i;
+	int iCurrentNode;
+	int iNumPathNodes;
+
+	if( iStart == iDest )
+	{
+		piPath[0] = iStart;
+		piPath[1] = iDest;
+		return 2;
+	}
+
+	if( pPrevious[iDest] == -1 )
+	{
+		// Destination is unreachable, no path found.
+		return 0;
+	}
+
+	iCurrentNode = iDest;
+	iNumPathNodes = 1;// count the dest
+
+	while( iCurrentNode != iStart )
+	{
+		iNumPathNodes++;
+		iCurrentNode = pPrevious[iCurrentNode];
+	}
+
+	iCurrentNode = iDest;
+	for( i = iNumPathNodes - 1; i >= 0; i-- )
+	{
+		piPath[i] = iCurrentNode;
+		iCurrentNode = pPrevious[iCurrentNode];
+	}
+
+	return iNumPathNodes;
+}
+
+//=========================================================
+// CGraph - CompressRoutes - run length encodes one row of
+// the routing table into pRoute, which must hold
+// m_cNodes * 2 bytes. Returns the number of bytes written.
+// Entries too far from iFrom to be encoded are counted in
+// piUnsorted rather than reported from here, as this runs
+// on the worker threads.
+//=========================================================
+int CGraph::CompressRoutes( int iFrom, const short *pRoutes, signed char *pRoute, int *piCompressedSize, int *piUnsorted )
+{
+	int iLastNode = 9999999; // just really big.
+	int cSequence = 0;
+	int cRepeats = 0;
+	int CompressedSize = 0;
+	int cUnsorted = 0;
+	signed char *p = pRoute;
+	for( int i = 0; i < m_cNodes; i++ )
+	{
+		unsigned short iBestNextNode = pRoutes[i];
+		BOOL CanRepeat = ( ( iBestNextNode == iLastNode ) && cRepeats < 127 );
+		BOOL CanSequence = ( iBestNextNode == i && cSequence < 128 );
+
+		if( cRepeats )
+		{
+			if( CanRepeat )
+			{
+				cRepeats++;
+			}
+			else
+			{
+				// Emit the repeat phrase.
+				//
+				CompressedSize += 2; // (count-1, iLastNode-i)
+				*p++ = cRepeats - 1;
+				int a = iLastNode - iFrom;
+				int b = iLastNode - iFrom + m_cNodes;
+				int c = iLastNode - iFrom - m_cNodes;
+				if( -128 <= a && a <= 127 )
+				{
+					*p++ = a;
+				}
+				else if( -128 <= b && b <= 127 )
+				{
+					*p++ = b;
+				}
+				else if( -128 <= c && c <= 127 )
+				{
+					*p++ = c;
+				}
+				else
+				{
+					cUnsorted++;
+				}
+				cRepeats = 0;
+
+				if( CanSequence )
+				{
+					// Start a sequence.
+					//
+					cSequence++;
+				}
+				else
+				{
+					// Start another repeat.
+					//
+					cRepeats++;
+				}
+			}
+		}
+		else if( cSequence )
+		{
+			if( CanSequence )
+			{
+				cSequence++;
+			}
+			else
+			{
+				// It may be advantageous to combine
+				// a single-entry sequence phrase with the
+				// next repeat phrase.
+				//
+				if( cSequence == 1 && CanRepeat )
+				{
+					// Combine with repeat phrase.
+					//
+					cRepeats = 2;
+					cSequence = 0;
+				}
+				else
+				{
+					// Emit the sequence phrase.
+					//
+					CompressedSize += 1; // (-count)
+					*p++ = -cSequence;
+					cSequence = 0;
+
+					// Start a repeat sequence.
+					//
+					cRepeats++;
+				}
+			}
+		}
+		else
+		{
+			if( CanSequence )
+			{
+				// Start a sequence phrase.
+				//
+				cSequence++;
+			}
+			else
+			{
+				// Start a repeat sequence.
+				//
+				cRepeats++;
+			}
+		}
+		iLastNode = iBestNextNode;
+	}
+	if( cRepeats )
+	{
+		// Emit the repeat phrase.
+		//
+		CompressedSize += 2;
+		*p++ = cRepeats - 1;
+#if 0
+		iLastNode = iFrom + *pRoute;
+		if( iLastNode >= m_cNodes )
+			iLastNode -= m_cNodes;
+		else if( iLastNode < 0 )
+			iLastNode += m_cNodes;
+#endif
+		int a = iLastNode - iFrom;
+		int b = iLastNode - iFrom + m_cNodes;
+		int c = iLastNode - iFrom - m_cNodes;
+		if( -128 <= a && a <= 127 )
+		{
+			*p++ = a;
+		}
+		else if( -128 <= b && b <= 127 )
+		{
+			*p++ = b;
+		}
+		else if( -128 <= c && c <= 127 )
+		{
+			*p++ = c;
+		}
+		else
+		{
+			cUnsorted++;
+		}
+	}
+	if( cSequence )
+	{
+		// Emit the Sequence phrase.
+		//
+		CompressedSize += 1;
+		*p++ = -cSequence;
+	}
+
+	*piCompressedSize = CompressedSize;
+	*piUnsorted = cUnsorted;
+	return p - pRoute;
+}
+
 void CGraph::ComputeStaticRoutingTables( void )
 {
 	int iFrom;
 	int nRoutes = m_cNodes * m_cNodes;
 #define FROM_TO(x,y) ( ( x ) * m_cNodes + ( y ) )
 	short *Routes = new short[nRoutes];
+	short *Previous = new short[nRoutes];
+	signed char *pRoutes = new signed char[nRoutes * 2];
 
 	int *pMyPath = new int[m_cNodes];
-	unsigned short *BestNextNodes = new unsigned short[m_cNodes];
-	signed char *pRoute = new signed char[m_cNodes*2];
+	int *pRouteSize = new int[m_cNodes * 3];
+	byte *pLinkUsable = new byte[m_cLinks > 0 ? m_cLinks : 1];
 
-	if( Routes && pMyPath && BestNextNodes && pRoute )
+	routejob_t job;
+	int cThreads;
+	int i;
+
+	memset( &job, 0, sizeof( job ) );
+
+	// -1 is one less than the number of CPUs, the caller works too
+	cThreads = (int)sv_routethreads.value;
+	if( cThreads < 0 )
+		cThreads = CWorkerPool::NumCPUs() - 1;
+	g_WorkerPool.Start( cThreads );
+
+	for( i = 0; i <= g_WorkerPool.NumThreads(); i++ )
 	{
+		job.pflClosest[i] = new float[m_cNodes];
+	}
+
+	if( Routes && Previous && pRoutes && pMyPath && pRouteSize && pLinkUsable )
+	{
+		job.pGraph = this;
+		job.pLinkUsable = pLinkUsable;
+		job.pPrevious = Previous;
+		job.pRoutes = Routes;
+		job.pRoute = pRoutes;
+		job.pRouteSize = pRouteSize;
+		job.pCompressedSize = pRouteSize + m_cNodes;
+		job.pUnsorted = pRouteSize + m_cNodes * 2;
+
 		int nTotalCompressedSize = 0;
 		for( int iHull = 0; iHull < MAX_NODE_HULLS; iHull++ )
 		{
+			int iHullMask = 0;
+			switch( iHull )
+			{
+			case NODE_SMALL_HULL:
+				iHullMask = bits_LINK_SMALL_HULL;
+				break;
+			case NODE_HUMAN_HULL:
+				iHullMask = bits_LINK_HUMAN_HULL;
+				break;
+			case NODE_LARGE_HULL:
+				iHullMask = bits_LINK_LARGE_HULL;
+				break;
+			case NODE_FLY_HULL:
+				iHullMask = bits_LINK_FLY_HULL;
+				break;
+			}
+
 			for( int iCap = 0; iCap < 2; iCap++ )
 			{
 				int iCapMask;
@@ -3158,6 +4589,25 @@ void CGraph::ComputeStaticRoutingTables( void )
 					break;
 				}
 
+				// Which links this hull and capability can take. Brush entities
+				// need the engine, so they are checked here and not on the workers.
+				//
+				for( iFrom = 0; iFrom < m_cNodes; iFrom++ )
+				{
+					for( i = 0; i < m_pNodes[iFrom].m_cNumLinks; i++ )
+					{
+						CLink *pLink = &m_pLinkPool[m_pNodes[iFrom].m_iFirstLink + i];
+						byte fUsable = ( pLink->m_afLinkInfo & iHullMask ) == iHullMask;
+
+						if( fUsable && pLink->m_iLinkEnt != 0 )
+							fUsable = HandleLinkEnt( iFrom, LinkEnt( *pLink ), iCapMask, NODEGRAPH_STATIC ) ? 1 : 0;
+
+						pLinkUsable[m_pNodes[iFrom].m_iFirstLink + i] = fUsable;
+					}
+				}
+
+				g_WorkerPool.Run( Route_TreeJob, &job, m_cNodes );
+
 				// Initialize Routing table to uncalculated.
 				//
 				for( iFrom = 0; iFrom < m_cNodes; iFrom++ )
@@ -3175,7 +4625,7 @@ void CGraph::ComputeStaticRoutingTables( void )
 						if( Routes[FROM_TO( iFrom, iTo )] != -1 )
 							continue;
 
-						int cPathSize = FindShortestPath( pMyPath, iFrom, iTo, iHull, iCapMask );
+						int cPathSize = RouteTreePath( pMyPath, iFrom, iTo, &Previous[FROM_TO( iFrom, 0 )] );
 
 						// Use the computed path to update the routing table.
 						//
@@ -3217,166 +4667,23 @@ void CGraph::ComputeStaticRoutingTables( void )
 					}
 				}
 
+				// Compress every node's routing table.
+				//
+				g_WorkerPool.Run( Route_CompressJob, &job, m_cNodes );
+
 				for( iFrom = 0; iFrom < m_cNodes; iFrom++ )
 				{
-					for( int iTo = 0; iTo < m_cNodes; iTo++ )
-					{
-						BestNextNodes[iTo] = Routes[FROM_TO( iFrom, iTo )];
-					}
+					signed char *pRoute = &pRoutes[iFrom * m_cNodes * 2];
+					int nRoute = job.pRouteSize[iFrom];
+					int CompressedSize = job.pCompressedSize[iFrom];
 
-					// Compress this node's routing table.
-					//
-					int iLastNode = 9999999; // just really big.
-					int cSequence = 0;
-					int cRepeats = 0;
-					int CompressedSize = 0;
-					signed char *p = pRoute;
-					for( int i = 0; i < m_cNodes; i++ )
+					if( job.pUnsorted[iFrom] )
 					{
-						BOOL CanRepeat = ( ( BestNextNodes[i] == iLastNode ) && cRepeats < 127 );
-						BOOL CanSequence = ( BestNextNodes[i] == i && cSequence < 128 );
-
-						if( cRepeats )
-						{
-							if( CanRepeat )
-							{
-								cRepeats++;
-							}
-							else
-							{
-								// Emit the repeat phrase.
-								//
-								CompressedSize += 2; // (count-1, iLastNode-i)
-								*p++ = cRepeats - 1;
-								int a = iLastNode - iFrom;
-								int b = iLastNode - iFrom + m_cNodes;
-								int c = iLastNode - iFrom - m_cNodes;
-								if( -128 <= a && a <= 127 )
-								{
-									*p++ = a;
-								}
-								else if( -128 <= b && b <= 127 )
-								{
-									*p++ = b;
-								}
-								else if( -128 <= c && c <= 127 )
-								{
-									*p++ = c;
-								}
-								else
-								{
-									ALERT( at_aiconsole, "Nodes need sorting (%d,%d)!\n", iLastNode, iFrom );
-								}
-								cRepeats = 0;
-
-								if( CanSequence )
-								{
-									// Start a sequence.
-									//
-									cSequence++;
-								}
-								else
-								{
-									// Start another repeat.
-									//
-									cRepeats++;
-								}
-							}
-						}
-						else if( cSequence )
-						{
-							if( CanSequence )
-							{
-								cSequence++;
-							}
-							else
-							{
-								// It may be advantageous to combine
-								// a single-entry sequence phrase with the
-								// next repeat phrase.
-								//
-								if( cSequence == 1 && CanRepeat )
-								{
-									// Combine with repeat phrase.
-									//
-									cRepeats = 2;
-									cSequence = 0;
-								}
-								else
-								{
-									// Emit the sequence phrase.
-									//
-									CompressedSize += 1; // (-count)
-									*p++ = -cSequence;
-									cSequence = 0;
-
-									// Start a repeat sequence.
-									//
-									cRepeats++;
-								}
-							}
-						}
-						else
-						{
-							if( CanSequence )
-							{
-								// Start a sequence phrase.
-								//
-								cSequence++;
-							}
-							else
-							{
-								// Start a repeat sequence.
-								//
-								cRepeats++;
-							}
-						}
-						iLastNode = BestNextNodes[i];
-					}
-					if( cRepeats )
-					{
-						// Emit the repeat phrase.
-						//
-						CompressedSize += 2;
-						*p++ = cRepeats - 1;
-#if 0
-						iLastNode = iFrom + *pRoute;
-						if( iLastNode >= m_cNodes )
-							iLastNode -= m_cNodes;
-						else if( iLastNode < 0 )
-							iLastNode += m_cNodes;
-#endif
-						int a = iLastNode - iFrom;
-						int b = iLastNode - iFrom + m_cNodes;
-						int c = iLastNode - iFrom - m_cNodes;
-						if( -128 <= a && a <= 127 )
-						{
-							*p++ = a;
-						}
-						else if( -128 <= b && b <= 127 )
-						{
-							*p++ = b;
-						}
-						else if( -128 <= c && c <= 127 )
-						{
-							*p++ = c;
-						}
-						else
-						{
-							ALERT( at_aiconsole, "Nodes need sorting (%d,%d)!\n", iLastNode, iFrom );
-						}
-					}
-					if( cSequence )
-					{
-						// Emit the Sequence phrase.
-						//
-						CompressedSize += 1;
-						*p++ = -cSequence;
+						ALERT( at_aiconsole, "Nodes need sorting (%d entries from %d)!\n", job.pUnsorted[iFrom], iFrom );
 					}
 
 					// Go find a place to store this thing and point to it.
 					//
-					int nRoute = p - pRoute;
 					if( m_pRouteInfo )
 					{
 						int i;
@@ -3416,17 +4723,32 @@ void CGraph::ComputeStaticRoutingTables( void )
 		}
 		ALERT( at_aiconsole, "Size of Routes = %d\n", nTotalCompressedSize );
 	}
+
+	// graphs are built once per level, don't keep the threads around
+	g_WorkerPool.Stop();
+
+	for( i = 0; i <= WORKER_MAX_THREADS; i++ )
+	{
+		if( job.pflClosest[i] )
+			delete[] job.pflClosest[i];
+	}
 	if( Routes )
 		delete[] Routes;
-	if( BestNextNodes )
-		delete[] BestNextNodes;
-	if( pRoute )
-		delete[] pRoute;
+	if( Previous )
+		delete[] Previous;
+	if( pRoutes )
+		delete[] pRoutes;
+	if( pRouteSize )
+		delete[] pRouteSize;
+	if( pLinkUsable )
+		delete[] pLinkUsable;
 	if( pMyPath )
 		delete[] pMyPath;
 	Routes = 0;
-	BestNextNodes = 0;
-	pRoute = 0;
+	Previous = 0;
+	pRoutes = 0;
+	pRouteSize = 0;
+	pLinkUsable = 0;
 	pMyPath = 0;
 #if 0
 	TestRoutingTables();
@@ -18,6 +18,9 @@
 #pragma once
 #if !defined(NODES_H)
 #define NODES_H
+
+#include "worker_pool.h"
+
 //=========================================================
 // DEFINE
 //=========================================================
@@ -81,7 +84,7 @@ public:
 	int		m_iSrcNode;// the node that 'owns' this link ( keeps us from having to make reverse lookups )
 	int		m_iDestNode;// the node on the other end of the link. 
 	
-	entvars_t	*m_pLinkEnt;// the entity that blocks this connection (doors, etc)
+	int		m_iLinkEnt;// edict index of the entity that blocks this connection (doors, etc), 0 for none
 
 	// m_szLinkEntModelname is not necessarily NULL terminated (so we can store it in a more alignment-friendly 4 bytes)
 	char	m_szLinkEntModelname[ 4 ];// the unique name of the brush model that blocks the connection (this is kept for save/restore)
@@ -102,18 +105,133 @@ typedef struct
 	short n;		// Nearest node or -1 if no node found.
 } CACHE_ENTRY;
 
+typedef struct
+{
+	int q[3];		// quantised position
+	int afNodeTypes;
+	short n;		// Nearest node or -1 if unused.
+} NEAR_CACHE_ENTRY;
+
+typedef struct
+{
+	int q[3];		// quantised position the node was last traced visible from
+	float time;
+} NODE_SEEN;
+
+//=========================================================
+// CPathHeap - binary min-heap for the path search, grows
+// as needed and keeps its memory between searches
+//=========================================================
+class CPathHeap
+{
+public:
+	CPathHeap( void );
+	~CPathHeap( void );
+
+	inline int Empty ( void ) { return ( m_cSize == 0 ); }
+	inline void Clear ( void ) { m_cSize = 0; }
+	BOOL Insert( int iValue, float fPriority );
+	int Remove( float &fPriority );
+
+private:
+	int	m_cSize;
+	int	m_cMaxSize;
+	struct tag_HEAP_NODE
+	{
+		int   Id;
+		float Priority;
+	} *m_heap;
+};
+
+#define PATHCACHE_SIZE	32
+
+typedef struct
+{
+	int iStart;
+	int iDest;
+	int iHull;
+	int afCapMask;
+	int cPathNodes;		// 0 if no path, -1 if unused
+	int iPath[MAX_PATH_SIZE];
+	unsigned int iLastUsed;
+} PATH_CACHE_ENTRY;
+
+//=========================================================
+// PATH_SEARCH - scratch for one A* search, cNodes long. A
+// node's entries are only meaningful when its pVisit is
+// iGeneration (open) or one more (closed), so nothing is
+// cleared between searches.
+//=========================================================
+typedef struct
+{
+	float *pCost;
+	int *pPrev;
+	unsigned int *pVisit;
+	int cNodes;
+	unsigned int iGeneration;
+	CPathHeap Heap;
+
+	// statistics
+	unsigned int cSearches;
+	unsigned int cExpanded;
+} PATH_SEARCH;
+
 //=========================================================
 // CGraph 
 //=========================================================
 #define _GRAPH_VERSION_RETAIL 16 // Retail Half-Life graph version. Don't increment this
-#if XASH_64BIT
-#define	_GRAPH_VERSION	(16 * 10)
-#else
-#define	_GRAPH_VERSION	(16) // !!!increment this whenever graph/node/link classes change, to obsolesce older disk files.
-#endif
+#define	_GRAPH_VERSION	(17) // !!!increment this whenever graph/node/link classes change, to obsolesce older disk files.
 #define GRAPH_VERSION (int)_GRAPH_VERSION
 #define GRAPH_VERSION_RETAIL (int)_GRAPH_VERSION_RETAIL
 
+//=========================================================
+// .NOD file layout. Nothing in the file is a pointer, and
+// every array sits at an aligned offset given in the header,
+// so a loaded graph points straight into the mapped file.
+// Pages nobody writes to are shared by every server on the
+// host that runs the same map.
+//=========================================================
+#define GRAPHFILE_IDENT		(('H'<<24)+('P'<<16)+('R'<<8)+'G') // little-endian "GRPH"
+#define GRAPHFILE_ALIGN		16
+
+enum
+{
+	GRAPHLUMP_NODES = 0,
+	GRAPHLUMP_LINKS,
+	GRAPHLUMP_DISTINFO,
+	GRAPHLUMP_ROUTEINFO,
+	GRAPHLUMP_HASHLINKS,
+	GRAPHLUMP_COUNT
+};
+
+typedef struct
+{
+	int fileofs;
+	int filelen;
+} graphlump_t;
+
+typedef struct
+{
+	int version;		// GRAPH_VERSION, first so older dlls reject the file
+	int ident;		// GRAPHFILE_IDENT
+	unsigned int bspchecksum;	// CRC of the .bsp the graph was built for
+	unsigned int headerchecksum;	// CRC of this header with this field zero
+	int filelength;
+
+	int cNodes;
+	int cLinks;
+	int nRouteInfo;
+	int nHashLinks;
+
+	int RangeStart[3][256];	// NUM_RANGES
+	int RangeEnd[3][256];
+	float RegionMin[3];
+	float RegionMax[3];
+	int HashPrimes[16];
+
+	graphlump_t lumps[GRAPHLUMP_COUNT];
+} graphheader_t;
+
 class CGraph
 {
 public:
@@ -153,11 +271,65 @@ public:
 	float m_RegionMin[3], m_RegionMax[3]; // The range of nodes.
 	CACHE_ENTRY m_Cache[CACHE_SIZE];
 
+	// Uniform grid over the node origins. FindNearestNode walks the cells
+	// outward from the query and traces the nodes nearest first, so it
+	// stops at the first visible one. Positions are also quantised into a
+	// cache, and each node remembers the quantised position it was last
+	// seen from, which saves most of the remaining traces.
+#define NODEGRID_CELL_SIZE	128.0f
+#define NODEGRID_MAX_CELLS	65536
+#define NEARCACHE_QUANTUM	16.0f
+#define NEARCACHE_SIZE		1024	// must be power of two
+#define NODESEEN_LIFETIME	2.0f	// doors open and close
+	int *m_pGridStart;	// m_nGridCells + 1 offsets into m_pGridNodes
+	int *m_pGridNodes;	// node indices, grouped by cell
+	int m_nGridCells;
+	int m_GridSize[3];
+	float m_flGridCell;
+	Vector m_vecGridMins;
+	NODE_SEEN *m_pNodeSeen;
+	int *m_pNearCandidates;	// search scratch, m_cNodes long
+	float *m_pNearDist;
+	NEAR_CACHE_ENTRY m_NearCache[NEARCACHE_SIZE];
+
+	// FindNearestNode statistics
+	unsigned int m_cNearQueries;
+	unsigned int m_cNearExactHits;
+	unsigned int m_cNearCacheHits;
+	unsigned int m_cNearSearches;
+	unsigned int m_cNearTraces;
+	unsigned int m_cNearSeenHits;
+
 
 	int m_HashPrimes[16];
 	short *m_pHashLinks;
 	int m_nHashLinks;
 
+	// the .NOD file the arrays above point into when the graph was loaded,
+	// NULL when they were allocated one by one
+	byte *m_pGraphFile;
+	int m_nGraphFile;
+	BOOL m_fGraphFileMapped;
+
+	// A* scratch for when there are no routing tables, one per thread
+	// of g_WorkerPool. [0] is also FindShortestPath's on the main thread.
+	PATH_SEARCH m_PathSearch[WORKER_MAX_THREADS + 1];
+
+	// HandleLinkEnt's static answer for every link, m_cLinks entries for
+	// monsters that can't open doors followed by m_cLinks for those that
+	// can, so the workers can search without calling the engine
+	byte *m_pLinkUsable;
+	BOOL m_fLinkUsableValid;
+
+	// recent search results. Doors opening and closing and link ents
+	// going away change what HandleLinkEnt allows, and clear it.
+	PATH_CACHE_ENTRY m_PathCache[PATHCACHE_SIZE];
+	unsigned int m_iPathCacheTick;
+
+	// FindShortestPath statistics
+	unsigned int m_cPathQueries;
+	unsigned int m_cPathCacheHits;
+
 
 	// kinda sleazy. In order to allow variety in active idles for monster groups in a room with more than one node, 
 	// we keep track of the last node we searched from and store it here. Subsequent searches by other monsters will pick
@@ -171,8 +343,22 @@ public:
 	int		LinkVisibleNodes ( CLink *pLinkPool, FILE *file, int *piBadNode );
 	int		RejectInlineLinks ( CLink *pLinkPool, FILE *file );
 	int		FindShortestPath ( int *piPath, int iStart, int iDest, int iHull, int afCapMask);
+	int		FindKnownPath ( int *piPath, int iStart, int iDest, int iHull, int afCapMask );
+	void	StorePath ( const int *piPath, int cPathNodes, int iStart, int iDest, int iHull, int afCapMask );
+	int		SearchPath ( PATH_SEARCH *pSearch, int *piPath, int iStart, int iDest, int iHull, int afCapMask, const byte *pLinkUsable );
+	const byte *LinkUsable ( int afCapMask );
+	BOOL	AllocPathSearch ( PATH_SEARCH *pSearch );
+	void	FreePathSearch ( void );
+	void	InvalidatePathCache ( void );
+	void	ReportPathStats ( void );
+	void	ResetPathStats ( void );
 	int		FindNearestNode ( const Vector &vecOrigin, CBaseEntity *pEntity );
 	int		FindNearestNode ( const Vector &vecOrigin, int afNodeTypes );
+	int		FindNearestNodeInGrid ( const Vector &vecOrigin, int afNodeTypes );
+	int		SearchNodeGrid ( const Vector &vecOrigin, const int *q, int afNodeTypes );
+	BOOL	NodeVisibleFrom ( const Vector &vecOrigin, const int *q, int iNode );
+	float	GridShellBound ( const Vector &vecOrigin, const int *c, int r );
+	int		GridCoord ( float value, int axis );
 	//int		FindNearestLink ( const Vector &vecTestPoint, int *piNearestLink, BOOL *pfAlongLine );
 	float	PathLength( int iStart, int iDest, int iHull, int afCapMask );
 	int		NextNodeInRoute( int iCurrentNode, int iDest, int iHull, int iCap );
@@ -188,12 +374,22 @@ public:
 	
 	int		CheckNODFile(const char *szMapName);
 	int		FLoadGraph(const char *szMapName);
+	int		FLoadGraphSections(byte *pFile, int length, const char *szMapName);
+	int		FLoadRetailGraph(byte *pFile, int length);
+	void	FreeGraphFile(void);
 	int		FSaveGraph(const char *szMapName);
 	int		FSetGraphPointers(void);
 	void	CheckNode(Vector vecOrigin, int iNode);
 
 	void    BuildRegionTables(void);
+	void    BuildNodeGrid(void);
+	void    FreeNodeGrid(void);
+	void    ReportNodeGridStats(void);
+	void    ResetNodeGridStats(void);
 	void    ComputeStaticRoutingTables(void);
+	void    BuildRouteTree( int iStart, const byte *pLinkUsable, float *pflClosest, short *pPrevious );
+	int     RouteTreePath( int *piPath, int iStart, int iDest, const short *pPrevious );
+	int     CompressRoutes( int iFrom, const short *pRoutes, signed char *pRoute, int *piCompressedSize, int *piUnsorted );
 	void    TestRoutingTables(void);
 
 	void	HashInsert(int iSrcNode, int iDestNode, int iKey);
@@ -241,6 +437,14 @@ public:
 		return Link( node.m_iFirstLink + iLink );
 	}
 
+	// the entity blocking a link, NULL if none
+	inline entvars_t *LinkEnt( const CLink &link )
+	{
+		if ( !link.m_iLinkEnt )
+			return NULL;
+		return VARS( INDEXENT( link.m_iLinkEnt ) );
+	}
+
 	inline  int	INodeLink ( int iNode, int iLink )
 	{
 		return NodeLink( iNode, iLink ).m_iDestNode;
@@ -379,4 +583,6 @@ enum
 };
 
 extern CGraph WorldGraph;
+
+extern void NodeGraph_Stats_f( void );
 #endif // NODES_H
@@ -5,8 +5,6 @@
 
 //#include "nodes.h"
 
-#if _GRAPH_VERSION != _GRAPH_VERSION_RETAIL
-
 #include "stdint.h"
 
 typedef int32_t PTR32;
@@ -63,46 +61,12 @@ public:
 
 		other->m_di = NULL;
 
-		memcpy( (void *) &other->m_RangeStart, (void *) m_RangeStart,
-				offsetof(class CGraph, m_pHashLinks) - offsetof(class CGraph, m_RangeStart) );
-
-#if 0	          // replacement routine in case a change in CGraph breaks the above memcpy
-		for (int i = 0; i < 3; ++i)
-			for (int j = 0; j < NUM_RANGES; ++j)
-				other->m_RangeStart[i][j] = m_RangeStart[i][j];
-//		m_RangeStart[3][NUM_RANGES]
-		for (int i = 0; i < 3; ++i)
-			for (int j = 0; j < NUM_RANGES; ++j)
-				other->m_RangeEnd[i][j] = m_RangeEnd[i][j];
-//		m_RangeEnd[3][NUM_RANGES]
-		other->m_flShortest	= m_flShortest;
-		other->m_iNearest	= m_iNearest;
-		other->m_minX	= m_minX;
-		other->m_minY	= m_minY;
-		other->m_minZ	= m_minZ;
-		other->m_maxX	= m_maxX;
-		other->m_maxY	= m_maxY;
-		other->m_maxZ	= m_maxZ;
-		other->m_minBoxX	= m_minBoxX;
-		other->m_minBoxY	= m_minBoxY;
-		other->m_minBoxZ	= m_minBoxZ;
-		other->m_maxBoxX	= m_maxBoxX;
-		other->m_maxBoxY	= m_maxBoxY;
-		other->m_maxBoxZ	= m_maxBoxZ;
-		other->m_CheckedCounter	= m_CheckedCounter;
-		for (int i = 0; i < 3; ++i)
-			other->m_RegionMin[i]	= m_RegionMin[i];
-//		m_RegionMin[3]
-		for (int i = 0; i < 3; ++i)
-			other->m_RegionMax[i]	= m_RegionMax[i];
-//		m_RegionMax[3]
-		for (int i = 0; i < CACHE_SIZE; ++i)
-			other->m_Cache[i]	= m_Cache[i];
-//		m_Cache[CACHE_SIZE]
-		for (int i = 0; i < 16; ++i)
-			other->m_HashPrimes[i]	= m_HashPrimes[i];
-//		m_HashPrimes[16]
-#endif
+		// only the tables that are kept, the rest of CGraph is laid out differently
+		memcpy( other->m_RangeStart, m_RangeStart, sizeof( m_RangeStart ) );
+		memcpy( other->m_RangeEnd, m_RangeEnd, sizeof( m_RangeEnd ) );
+		memcpy( other->m_RegionMin, m_RegionMin, sizeof( m_RegionMin ) );
+		memcpy( other->m_RegionMax, m_RegionMax, sizeof( m_RegionMax ) );
+		memcpy( other->m_HashPrimes, m_HashPrimes, sizeof( m_HashPrimes ) );
 
 		other->m_pHashLinks = NULL;
 		other->m_nHashLinks	= m_nHashLinks;
@@ -130,7 +94,7 @@ public:
 	void copyOverTo(CLink* other) {
 		other->m_iSrcNode	= m_iSrcNode;
 		other->m_iDestNode	= m_iDestNode	;
-		other->m_pLinkEnt	= NULL;
+		other->m_iLinkEnt	= m_pLinkEnt ? 1 : 0; // resolved by model name in FSetGraphPointers
 		for (int i = 0; i < 4; ++i)
 			other->m_szLinkEntModelname[i]	= m_szLinkEntModelname[i];
 //		m_szLinkEntModelname[ 4 ]
@@ -140,4 +104,3 @@ public:
 };
 
 #endif
-#endif
@@ -21,6 +21,7 @@
 #include	"player.h"
 #include	"weapons.h"
 #include	"pm_shared.h"
+#include	"playerroster.h"
 
 extern int gmsgCurWeapon;
 extern int gmsgSetFOV;
@@ -280,6 +281,8 @@ void CBasePlayer::StopObserver()
 	GetClassPtr( (CBasePlayer *)pev )->Spawn();
 	pev->nextthink = -1;
 
+	g_PlayerRoster.UpdateObserver( this );
+
 	// Update Team Status
 	MESSAGE_BEGIN( MSG_ALL, gmsgTeamInfo );
 		WRITE_BYTE( ENTINDEX( edict() ) ); // index number of primary entity
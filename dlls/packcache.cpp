@@ -0,0 +1,290 @@
+/***
+*
+*   Per frame cache of the host independent entity state sent by AddToFullPack
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "entity_state.h"
+#include "packcache.h"
+
+CPackCache g_PackCache;
+
+/*
+PackEntityState
+
+Copies everything the client gets about ent into state, nothing in here depends on the host
+*/
+void PackEntityState( struct entity_state_s *state, int e, edict_t *ent, int player )
+{
+	int i;
+	CBaseEntity *Entity;
+
+	memset( state, 0, sizeof(*state) );
+
+	// Assign index so we can track this entity from frame to frame and
+	//  delta from it.
+	state->number = e;
+	state->entityType = ENTITY_NORMAL;
+
+	// Flag custom entities.
+	if( ent->v.flags & FL_CUSTOMENTITY )
+	{
+		state->entityType = ENTITY_BEAM;
+	}
+
+	//
+	// Copy state data
+	//
+
+	// Round animtime to nearest millisecond
+	state->animtime = (int)( 1000.0f * ent->v.animtime ) / 1000.0f;
+
+	memcpy( state->origin, ent->v.origin, 3 * sizeof(float) );
+	memcpy( state->angles, ent->v.angles, 3 * sizeof(float) );
+	memcpy( state->mins, ent->v.mins, 3 * sizeof(float) );
+	memcpy( state->maxs, ent->v.maxs, 3 * sizeof(float) );
+
+	memcpy( state->startpos, ent->v.startpos, 3 * sizeof(float) );
+	memcpy( state->endpos, ent->v.endpos, 3 * sizeof(float) );
+	memcpy( state->velocity, ent->v.velocity, 3 * sizeof(float) );
+
+	state->impacttime = ent->v.impacttime;
+	state->starttime = ent->v.starttime;
+
+	state->modelindex = ent->v.modelindex;
+
+	state->frame = ent->v.frame;
+
+	state->skin = ent->v.skin;
+	state->effects = ent->v.effects;
+
+	// This non-player entity is being moved by the game .dll and not the physics simulation system
+	//  make sure that we interpolate it's position on the client if it moves
+	if( !player &&
+		 ent->v.animtime &&
+		 ent->v.velocity[0] == 0 &&
+		 ent->v.velocity[1] == 0 &&
+		 ent->v.velocity[2] == 0 )
+	{
+		state->eflags |= EFLAG_SLERP;
+	}
+
+	state->scale		= ent->v.scale;
+	state->solid		= ent->v.solid;
+	state->colormap		= ent->v.colormap;
+
+	state->movetype		= ent->v.movetype;
+	state->sequence		= ent->v.sequence;
+	state->framerate	= ent->v.framerate;
+	state->body		= ent->v.body;
+
+	for( i = 0; i < 4; i++ )
+	{
+		state->controller[i] = ent->v.controller[i];
+	}
+
+	for( i = 0; i < 2; i++ )
+	{
+		state->blending[i] = ent->v.blending[i];
+	}
+
+	state->rendermode	= ent->v.rendermode;
+	state->renderamt	= (int)ent->v.renderamt;
+	state->renderfx		= ent->v.renderfx;
+	state->rendercolor.r	= (byte)ent->v.rendercolor.x;
+	state->rendercolor.g	= (byte)ent->v.rendercolor.y;
+	state->rendercolor.b	= (byte)ent->v.rendercolor.z;
+
+	state->aiment = 0;
+	if( ent->v.aiment )
+	{
+		state->aiment = ENTINDEX( ent->v.aiment );
+	}
+
+	state->owner = 0;
+	if( ent->v.owner )
+	{
+		int owner = ENTINDEX( ent->v.owner );
+
+		// Only care if owned by a player
+		if( owner >= 1 && owner <= gpGlobals->maxClients )
+		{
+			state->owner = owner;
+		}
+	}
+
+	state->onground = 0;
+	if( ent->v.groundentity )
+	{
+		state->onground = ENTINDEX( ent->v.groundentity );
+	}
+
+	// HACK:  Somewhat...
+	// Class is overridden for non-players to signify a breakable glass object ( sort of a class? )
+	if( !player )
+	{
+		state->playerclass  = ent->v.playerclass;
+	}
+
+	// Special stuff for players only
+	if( player )
+	{
+		memcpy( state->basevelocity, ent->v.basevelocity, 3 * sizeof(float) );
+
+		state->weaponmodel	= MODEL_INDEX( STRING( ent->v.weaponmodel ) );
+		state->gaitsequence	= ent->v.gaitsequence;
+		state->spectator	= ent->v.flags & FL_SPECTATOR;
+		state->friction		= ent->v.friction;
+
+		state->gravity		= ent->v.gravity;
+		//state->team		= ent->v.team;
+
+		state->usehull		= ( ent->v.flags & FL_DUCKING ) ? 1 : 0;
+		state->health		= (int)ent->v.health;
+	}
+
+	if( ( Entity = CBaseEntity::Instance( ent )) != NULL )
+	{
+		int classify = Entity->Classify();
+
+		if( classify != CLASS_NONE && classify != CLASS_MACHINE )
+			SetBits( state->eflags, EFLAG_FLESH_SOUND );
+	}
+}
+
+CPackCache::CPackCache()
+{
+	m_pStates = NULL;
+	m_pOwners = NULL;
+	m_pFrames = NULL;
+	m_pSky = NULL;
+	m_iMaxEntities = 0;
+	m_iFrame = 1;
+
+	ResetStats();
+}
+
+CPackCache::~CPackCache()
+{
+	Free();
+}
+
+void CPackCache::Free( void )
+{
+	free( m_pStates );
+	free( m_pOwners );
+	free( m_pFrames );
+	free( m_pSky );
+
+	m_pStates = NULL;
+	m_pOwners = NULL;
+	m_pFrames = NULL;
+	m_pSky = NULL;
+	m_iMaxEntities = 0;
+}
+
+BOOL CPackCache::Init( void )
+{
+	int maxEntities = gpGlobals->maxEntities;
+
+	if( maxEntities <= 0 )
+		return FALSE;
+
+	if( maxEntities != m_iMaxEntities )
+	{
+		Free();
+
+		m_pStates = (entity_state_t *)malloc( maxEntities * sizeof( entity_state_t ));
+		m_pOwners = (edict_t **)malloc( maxEntities * sizeof( edict_t * ));
+		m_pFrames = (int *)malloc( maxEntities * sizeof( int ));
+		m_pSky = (byte *)malloc( maxEntities * sizeof( byte ));
+
+		if( !m_pStates || !m_pOwners || !m_pFrames || !m_pSky )
+		{
+			ALERT( at_error, "CPackCache: out of memory for %d entities\n", maxEntities );
+			Free();
+			return FALSE;
+		}
+
+		m_iMaxEntities = maxEntities;
+	}
+
+	return TRUE;
+}
+
+void CPackCache::Clear( void )
+{
+	if( !Init() )
+		return;
+
+	memset( m_pOwners, 0, m_iMaxEntities * sizeof( edict_t * ));
+	memset( m_pFrames, 0, m_iMaxEntities * sizeof( int ));
+	m_iFrame = 1;
+}
+
+BOOL CPackCache::Lookup( int e, edict_t *ent, int player )
+{
+	if( !sv_packcache.value || e < 0 || e >= m_iMaxEntities )
+		return FALSE;
+
+	if( m_pFrames[e] == m_iFrame && m_pOwners[e] == ent )
+		return TRUE;
+
+	PackEntityState( &m_pStates[e], e, ent, player );
+	m_pSky[e] = FClassnameIs( ent, "env_sky" ) ? TRUE : FALSE;
+	m_pOwners[e] = ent;
+	m_pFrames[e] = m_iFrame;
+	m_iBuilt++;
+
+	return TRUE;
+}
+
+BOOL CPackCache::Copy( struct entity_state_s *state, int e, edict_t *ent, int player )
+{
+	if( !Lookup( e, ent, player ))
+		return FALSE;
+
+	memcpy( state, &m_pStates[e], sizeof( *state ));
+	m_iCopied++;
+
+	return TRUE;
+}
+
+BOOL CPackCache::IsSky( int e, edict_t *ent, int player )
+{
+	if( !Lookup( e, ent, player ))
+		return FClassnameIs( ent, "env_sky" );
+
+	return m_pSky[e];
+}
+
+void CPackCache::ReportStats( void )
+{
+	if( !m_pStates )
+	{
+		ALERT( at_console, "Pack cache is not initialized\n" );
+		return;
+	}
+
+	ALERT( at_console, "Pack cache: %s, %d edicts, %d kB\n", sv_packcache.value ? "enabled" : "disabled",
+		m_iMaxEntities, (int)( m_iMaxEntities * sizeof( entity_state_t ) / 1024 ));
+	ALERT( at_console, "  states built %u, copied %u, %.2f copies per build\n",
+		m_iBuilt, m_iCopied, m_iBuilt ? (float)m_iCopied / m_iBuilt : 0.0f );
+}
+
+// sv_packstats [reset]
+void PackCache_Stats_f( void )
+{
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ))
+	{
+		g_PackCache.ResetStats();
+		ALERT( at_console, "Pack cache statistics reset\n" );
+		return;
+	}
+
+	g_PackCache.ReportStats();
+}
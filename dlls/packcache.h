@@ -0,0 +1,57 @@
+/***
+*
+*   Per frame cache of the host independent entity state sent by AddToFullPack
+*
+***/
+#pragma once
+#if !defined(PACKCACHE_H)
+#define PACKCACHE_H
+
+//=========================================================
+// CPackCache - AddToFullPack runs for every entity and
+// client pair, but apart from the visibility tests and the
+// host overrides the state it fills in is the same for all
+// clients.  The state is built the first time an entity is
+// packed in a server frame and copied for the other hosts.
+//
+// StartFrame starts a new frame, so nothing built before
+// the game code ran again is ever reused.
+//=========================================================
+class CPackCache
+{
+public:
+	CPackCache();
+	~CPackCache();
+
+	void Clear( void );		// new edict list, drop all states
+	void StartFrame( void ) { m_iFrame++; }
+
+	// fills in state from the cache, FALSE if the caller has to pack it itself
+	BOOL Copy( struct entity_state_s *state, int e, edict_t *ent, int player );
+	BOOL IsSky( int e, edict_t *ent, int player );
+
+	void ReportStats( void );
+	void ResetStats( void ) { m_iBuilt = m_iCopied = 0; }
+
+private:
+	BOOL Init( void );
+	void Free( void );
+	BOOL Lookup( int e, edict_t *ent, int player );
+
+	struct entity_state_s *m_pStates;
+	edict_t **m_pOwners;	// the edict each state was built for
+	int *m_pFrames;		// frame each state was built in
+	byte *m_pSky;
+	int m_iMaxEntities;
+	int m_iFrame;
+
+	// statistics
+	unsigned int m_iBuilt;
+	unsigned int m_iCopied;
+};
+
+extern CPackCache g_PackCache;
+
+extern void PackEntityState( struct entity_state_s *state, int e, edict_t *ent, int player );
+extern void PackCache_Stats_f( void );
+#endif // PACKCACHE_H
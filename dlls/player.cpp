@@ -36,6 +36,9 @@
 #include "game.h"
 #include "pm_shared.h"
 #include "hltv.h"
+#include "spawnpoints.h"
+#include "playerroster.h"
+#include "playerstate.h"
 
 // #define DUCKFIX
 
@@ -184,6 +187,7 @@ int gmsgTeamNames = 0;
 
 int gmsgStatusText = 0;
 int gmsgStatusValue = 0;
+int gmsgPlayerState = 0;
 
 void LinkUserMessages( void )
 {
@@ -230,6 +234,8 @@ void LinkUserMessages( void )
 
 	gmsgStatusText = REG_USER_MSG( "StatusText", -1 );
 	gmsgStatusValue = REG_USER_MSG( "StatusValue", 3 );
+
+	gmsgPlayerState = REG_USER_MSG( "PlayerState", -1 );
 }
 
 LINK_ENTITY_TO_CLASS( player, CBasePlayer )
@@ -1479,6 +1485,8 @@ void CBasePlayer::StartObserver( Vector vecPosition, Vector vecViewAngle )
 	// Find a player to watch
 	m_flNextObserverInput = 0;
 	Observer_SetMode( m_iObserverLastMode );
+
+	g_PlayerRoster.UpdateObserver( this );
 }
 
 //
@@ -2770,26 +2778,6 @@ pt_end:
 #endif
 }
 
-// checks if the spot is clear of players
-BOOL IsSpawnPointValid( CBaseEntity *pPlayer, CBaseEntity *pSpot )
-{
-	CBaseEntity *ent = NULL;
-
-	if( !pSpot->IsTriggered( pPlayer ) )
-	{
-		return FALSE;
-	}
-
-	while( ( ent = UTIL_FindEntityInSphere( ent, pSpot->pev->origin, 128 ) ) != NULL )
-	{
-		// if ent is a client, don't spawn on 'em
-		if( ent->IsPlayer() && ent != pPlayer )
-			return FALSE;
-	}
-
-	return TRUE;
-}
-
 DLL_GLOBAL CBaseEntity	*g_pLastSpawn;
 inline int FNullEnt( CBaseEntity *ent ) { return ( ent == NULL ) || FNullEnt( ent->edict() ); }
 
@@ -2805,11 +2793,6 @@ USES AND SETS GLOBAL g_pLastSpawn
 edict_t *EntSelectSpawnPoint( CBaseEntity *pPlayer )
 {
 	CBaseEntity *pSpot;
-	edict_t *player;
-
-	int nNumRandomSpawnsToTry = 10;
-
-	player = pPlayer->edict();
 
 	// choose a info_player_deathmatch point
 	if( g_pGameRules->IsCoOp() )
@@ -2823,57 +2806,9 @@ edict_t *EntSelectSpawnPoint( CBaseEntity *pPlayer )
 	}
 	else if( g_pGameRules->IsDeathmatch() )
 	{
-		if( !g_pLastSpawn )
-		{
-			nNumRandomSpawnsToTry = 0;
-			CBaseEntity* pEnt = 0;
-
-			while( ( pEnt = UTIL_FindEntityByClassname( pEnt, "info_player_deathmatch" )))
-				nNumRandomSpawnsToTry++;
-		}
-
-		pSpot = g_pLastSpawn;
-		// Randomize the start spot
-		for( int i = RANDOM_LONG( 1, nNumRandomSpawnsToTry - 1 ); i > 0; i-- )
-			pSpot = UTIL_FindEntityByClassname( pSpot, "info_player_deathmatch" );
-		if( FNullEnt( pSpot ) )  // skip over the null point
-			pSpot = UTIL_FindEntityByClassname( pSpot, "info_player_deathmatch" );
-
-		CBaseEntity *pFirstSpot = pSpot;
-
-		do 
-		{
-			if( pSpot )
-			{
-				// check if pSpot is valid
-				if( IsSpawnPointValid( pPlayer, pSpot ) )
-				{
-					if( pSpot->pev->origin == Vector( 0, 0, 0 ) )
-					{
-						pSpot = UTIL_FindEntityByClassname( pSpot, "info_player_deathmatch" );
-						continue;
-					}
-
-					// if so, go to pSpot
-					goto ReturnSpot;
-				}
-			}
-			// increment pSpot
-			pSpot = UTIL_FindEntityByClassname( pSpot, "info_player_deathmatch" );
-		} while( pSpot != pFirstSpot ); // loop if we're not back to the start
-
-		// we haven't found a place to spawn yet,  so kill any guy at the first spawn point and spawn there
+		pSpot = g_SpawnPoints.SelectDeathmatch( (CBasePlayer *)pPlayer );
 		if( !FNullEnt( pSpot ) )
-		{
-			CBaseEntity *ent = NULL;
-			while( ( ent = UTIL_FindEntityInSphere( ent, pSpot->pev->origin, 128 ) ) != NULL )
-			{
-				// if ent is a client, kill em (unless they are ourselves)
-				if( ent->IsPlayer() && !(ent->edict() == player) )
-					ent->TakeDamage( VARS( INDEXENT( 0 ) ), VARS( INDEXENT( 0 ) ), 300, DMG_GENERIC );
-			}
 			goto ReturnSpot;
-		}
 	}
 
 	// If startspot is set, (re)spawn there.
@@ -3125,6 +3060,9 @@ int CBasePlayer::Restore( CRestore &restore )
 
 	m_nCustomSprayFrames = -1;
 
+	// ClientPutInServer isn't called for a restored player
+	g_PlayerRoster.Add( this );
+
 	return status;
 }
 
@@ -3967,10 +3905,7 @@ void CBasePlayer::SendAmmoUpdate( void )
 			ASSERT( m_rgAmmo[i] < 255 );
 
 			// send "Ammo" update message
-			MESSAGE_BEGIN( MSG_ONE, gmsgAmmoX, NULL, pev );
-				WRITE_BYTE( i );
-				WRITE_BYTE( Q_max( Q_min( m_rgAmmo[i], 254 ), 0 ) );  // clamp the value to one byte
-			MESSAGE_END();
+			g_PlayerStateMsg.Ammo( this, i, Q_max( Q_min( m_rgAmmo[i], 254 ), 0 ) );  // clamp the value to one byte
 		}
 	}
 }
@@ -3988,6 +3923,9 @@ reflecting all of the HUD state info.
 */
 void CBasePlayer::UpdateClientData( void )
 {
+	// clients that understand it get the HUD values below in one message
+	g_PlayerStateMsg.Begin( this );
+
 	if( m_fInitHUD )
 	{
 		m_fInitHUD = FALSE;
@@ -4016,10 +3954,7 @@ void CBasePlayer::UpdateClientData( void )
 		FireTargets( "game_playerspawn", this, this, USE_TOGGLE, 0 );
 
 		// Send flashlight status
-		MESSAGE_BEGIN( MSG_ONE, gmsgFlashlight, NULL, pev );
-			WRITE_BYTE( FlashlightIsOn() ? 1 : 0 );
-			WRITE_BYTE( m_iFlashBattery );
-		MESSAGE_END();
+		g_PlayerStateMsg.Flashlight( this, FlashlightIsOn() ? 1 : 0, m_iFlashBattery );
 
 		// Vit_amiN: the geiger state could run out of sync, too
 		MESSAGE_BEGIN( MSG_ONE, gmsgGeigerRange, NULL, pev );
@@ -4031,18 +3966,14 @@ void CBasePlayer::UpdateClientData( void )
 
 	if( m_iHideHUD != m_iClientHideHUD )
 	{
-		MESSAGE_BEGIN( MSG_ONE, gmsgHideWeapon, NULL, pev );
-			WRITE_BYTE( m_iHideHUD );
-		MESSAGE_END();
+		g_PlayerStateMsg.HideHUD( this, m_iHideHUD );
 
 		m_iClientHideHUD = m_iHideHUD;
 	}
 
 	if( m_iFOV != m_iClientFOV )
 	{
-		MESSAGE_BEGIN( MSG_ONE, gmsgSetFOV, NULL, pev );
-			WRITE_BYTE( m_iFOV );
-		MESSAGE_END();
+		g_PlayerStateMsg.FOV( this, m_iFOV );
 
 		// cache FOV change at end of function, so weapon updates can see that FOV has changed
 	}
@@ -4064,9 +3995,7 @@ void CBasePlayer::UpdateClientData( void )
 			iHealth = 1;
 
 		// send "health" update message
-		MESSAGE_BEGIN( MSG_ONE, gmsgHealth, NULL, pev );
-			WRITE_BYTE( iHealth );
-		MESSAGE_END();
+		g_PlayerStateMsg.Health( this, iHealth );
 
 		m_iClientHealth = (int)pev->health;
 	}
@@ -4078,9 +4007,7 @@ void CBasePlayer::UpdateClientData( void )
 		ASSERT( gmsgBattery > 0 );
 
 		// send "health" update message
-		MESSAGE_BEGIN( MSG_ONE, gmsgBattery, NULL, pev );
-			WRITE_SHORT( (int)pev->armorvalue );
-		MESSAGE_END();
+		g_PlayerStateMsg.Battery( this, (int)pev->armorvalue );
 	}
 
 	if( pev->dmg_take || pev->dmg_save || m_bitsHUDDamage != m_bitsDamageType )
@@ -4100,14 +4027,7 @@ void CBasePlayer::UpdateClientData( void )
 		// only send down damage type that have hud art
 		int visibleDamageBits = m_bitsDamageType & DMG_SHOWNHUD;
 
-		MESSAGE_BEGIN( MSG_ONE, gmsgDamage, NULL, pev );
-			WRITE_BYTE( (int)pev->dmg_save );
-			WRITE_BYTE( (int)pev->dmg_take );
-			WRITE_LONG( visibleDamageBits );
-			WRITE_COORD( damageOrigin.x );
-			WRITE_COORD( damageOrigin.y );
-			WRITE_COORD( damageOrigin.z );
-		MESSAGE_END();
+		g_PlayerStateMsg.Damage( this, (int)pev->dmg_save, (int)pev->dmg_take, visibleDamageBits, damageOrigin );
 
 		pev->dmg_take = 0;
 		pev->dmg_save = 0;
@@ -4142,9 +4062,7 @@ void CBasePlayer::UpdateClientData( void )
 				m_flFlashLightTime = 0;
 		}
 
-		MESSAGE_BEGIN( MSG_ONE, gmsgFlashBattery, NULL, pev );
-			WRITE_BYTE( m_iFlashBattery );
-		MESSAGE_END();
+		g_PlayerStateMsg.FlashBattery( this, m_iFlashBattery );
 	}
 
 	if( m_iTrain & TRAIN_NEW )
@@ -4218,6 +4136,8 @@ void CBasePlayer::UpdateClientData( void )
 			m_rgpPlayerItems[i]->UpdateClientData( this );
 	}
 
+	g_PlayerStateMsg.End();
+
 	// Cache and client weapon change
 	m_pClientActiveItem = m_pActiveItem;
 	m_iClientFOV = m_iFOV;
@@ -4283,6 +4203,10 @@ void CBasePlayer::SetPrefsFromUserinfo( char *infobuffer )
 		m_iAutoWepSwitch = atoi( pszKeyVal );
 	else
 		m_iAutoWepSwitch = 1;
+
+	// PlayerState message version the client dll decodes, none for old ones
+	pszKeyVal = g_engfuncs.pfnInfoKeyValue( infobuffer, "cl_playerstate" );
+	m_iPlayerStateVersion = atoi( pszKeyVal );
 }
 
 void CBasePlayer::EnableControl( BOOL fControl )
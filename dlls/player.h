@@ -329,6 +329,7 @@ public:
 	float m_flNextChatTime;
 
 	int m_iAutoWepSwitch;
+	int m_iPlayerStateVersion;
 
 	Vector m_vecLastViewAngles;
 };
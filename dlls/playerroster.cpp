@@ -0,0 +1,134 @@
+/***
+*
+*   Dense list of connected players
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "gamerules.h"
+#include "playerroster.h"
+
+CPlayerRoster g_PlayerRoster;
+
+void CPlayerRoster::Clear( void )
+{
+	memset( m_pSlots, 0, sizeof( m_pSlots ));
+	memset( m_fObserver, 0, sizeof( m_fObserver ));
+	memset( m_iTeamCount, 0, sizeof( m_iTeamCount ));
+	m_iCount = 0;
+	m_iActive = 0;
+	m_iSerial++;
+}
+
+void CPlayerRoster::Rebuild( void )
+{
+	m_iCount = 0;
+	m_iActive = 0;
+
+	// slots are walked in entity order, which keeps both lists sorted
+	for( int i = 1; i <= MAX_CLIENTS; i++ )
+	{
+		CBasePlayer *pPlayer = m_pSlots[i];
+
+		if( !pPlayer )
+			continue;
+
+		m_pPlayers[m_iCount++] = pPlayer;
+
+		if( !m_fObserver[i] )
+			m_pActive[m_iActive++] = pPlayer;
+	}
+
+	m_iSerial++;
+	UpdateTeams();
+}
+
+void CPlayerRoster::Add( CBasePlayer *pPlayer )
+{
+	int index = pPlayer ? pPlayer->entindex() : 0;
+
+	if( index < 1 || index > MAX_CLIENTS )
+		return;
+
+	m_pSlots[index] = pPlayer;
+	m_fObserver[index] = pPlayer->IsObserver() ? TRUE : FALSE;
+	Rebuild();
+}
+
+void CPlayerRoster::Remove( edict_t *pEntity )
+{
+	int index = pEntity ? ENTINDEX( pEntity ) : 0;
+
+	if( index < 1 || index > MAX_CLIENTS || !m_pSlots[index] )
+		return;
+
+	m_pSlots[index] = NULL;
+	m_fObserver[index] = FALSE;
+	Rebuild();
+}
+
+void CPlayerRoster::UpdateObserver( CBasePlayer *pPlayer )
+{
+	int index = pPlayer->entindex();
+
+	if( index < 1 || index > MAX_CLIENTS || m_pSlots[index] != pPlayer )
+		return;
+
+	BOOL observer = pPlayer->IsObserver() ? TRUE : FALSE;
+
+	if( m_fObserver[index] == observer )
+		return;
+
+	m_fObserver[index] = observer;
+	Rebuild();
+}
+
+void CPlayerRoster::UpdateTeams( void )
+{
+	CBasePlayer *pTeams[ROSTER_MAX_TEAMS][MAX_CLIENTS];
+	int iTeamCount[ROSTER_MAX_TEAMS];
+	BOOL changed = FALSE;
+	int team;
+
+	memset( iTeamCount, 0, sizeof( iTeamCount ));
+
+	if( g_pGameRules && g_pGameRules->IsTeamplay() )
+	{
+		for( int i = 0; i < m_iCount; i++ )
+		{
+			CBasePlayer *pPlayer = m_pPlayers[i];
+			team = g_pGameRules->GetTeamIndex( pPlayer->TeamID() );
+
+			if( team < 0 || team >= ROSTER_MAX_TEAMS )
+				continue;
+
+			pTeams[team][iTeamCount[team]++] = pPlayer;
+		}
+	}
+
+	// the rules recount on every kill, only a real change is news
+	for( team = 0; team < ROSTER_MAX_TEAMS; team++ )
+	{
+		if( iTeamCount[team] != m_iTeamCount[team]
+			|| memcmp( pTeams[team], m_pTeams[team], iTeamCount[team] * sizeof( CBasePlayer * )))
+		{
+			memcpy( m_pTeams[team], pTeams[team], iTeamCount[team] * sizeof( CBasePlayer * ));
+			m_iTeamCount[team] = iTeamCount[team];
+			changed = TRUE;
+		}
+	}
+
+	if( changed )
+		m_iSerial++;
+}
+
+int CPlayerRoster::TeamCount( int team )
+{
+	if( team < 0 || team >= ROSTER_MAX_TEAMS )
+		return 0;
+
+	return m_iTeamCount[team];
+}
@@ -0,0 +1,71 @@
+/***
+*
+*   Dense list of connected players
+*
+***/
+#pragma once
+#if !defined(PLAYERROSTER_H)
+#define PLAYERROSTER_H
+
+#include "com_model.h"	// MAX_CLIENTS
+
+#define ROSTER_MAX_TEAMS	32	// same as MAX_TEAMS in teamplay_gamerules.h
+
+class CBasePlayer;
+
+//=========================================================
+// CPlayerRoster - every connected player, sorted by entity
+// index, so per frame loops don't have to go through all
+// maxClients slots and test each edict.  Spectators are kept
+// out of the active list and, in teamplay, players are also
+// grouped by the gamerules team index.
+//
+// Players join in ClientPutInServer and leave in
+// ClientDisconnect or when their private data is freed.
+// Teams are regrouped whenever the teamplay rules recount.
+//=========================================================
+class CPlayerRoster
+{
+public:
+	void Clear( void );
+	void Add( CBasePlayer *pPlayer );
+	void Remove( edict_t *pEntity );
+	void UpdateObserver( CBasePlayer *pPlayer );
+	void UpdateTeams( void );
+
+	// all connected players, spectators included
+	int Count( void ) { return m_iCount; }
+	CBasePlayer *Player( int i ) { return m_pPlayers[i]; }
+
+	// connected players that aren't spectating
+	int ActiveCount( void ) { return m_iActive; }
+	CBasePlayer *ActivePlayer( int i ) { return m_pActive[i]; }
+
+	// team is the gamerules team index, empty when not teamplay
+	int TeamCount( int team );
+	CBasePlayer *TeamPlayer( int team, int i ) { return m_pTeams[team][i]; }
+
+	// changes whenever a player joins, leaves, starts or stops
+	// spectating or the teams are regrouped
+	int Serial( void ) { return m_iSerial; }
+
+private:
+	void Rebuild( void );
+
+	CBasePlayer *m_pSlots[MAX_CLIENTS + 1];	// by entity index
+	BOOL m_fObserver[MAX_CLIENTS + 1];
+
+	CBasePlayer *m_pPlayers[MAX_CLIENTS];
+	int m_iCount;
+
+	CBasePlayer *m_pActive[MAX_CLIENTS];
+	int m_iActive;
+
+	CBasePlayer *m_pTeams[ROSTER_MAX_TEAMS][MAX_CLIENTS];
+	int m_iTeamCount[ROSTER_MAX_TEAMS];
+
+	int m_iSerial;
+};
+
+extern CPlayerRoster g_PlayerRoster;
+#endif // PLAYERROSTER_H
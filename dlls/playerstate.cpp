@@ -0,0 +1,288 @@
+/***
+*
+*   Coalesced, bit packed HUD state updates for a player
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "weapons.h"
+#include "game.h"
+#include "playerstate.h"
+
+extern int gmsgHideWeapon;
+extern int gmsgSetFOV;
+extern int gmsgHealth;
+extern int gmsgBattery;
+extern int gmsgDamage;
+extern int gmsgFlashlight;
+extern int gmsgFlashBattery;
+extern int gmsgAmmoX;
+extern int gmsgCurWeapon;
+extern int gmsgPlayerState;
+
+CPlayerStateMsg g_PlayerStateMsg;
+
+void CPlayerStateMsg::Begin( CBasePlayer *pPlayer )
+{
+	m_pPlayer = NULL;
+	m_iDirty = 0;
+	m_iNumAmmo = 0;
+	m_iNumWeapons = 0;
+
+	// client dlls of any other version, older or newer, drop PlayerState
+	// and only get the separate messages
+	if( sv_playerstate.value && pPlayer->m_iPlayerStateVersion == PLAYERSTATE_VERSION )
+		m_pPlayer = pPlayer;
+}
+
+void CPlayerStateMsg::WriteBits( unsigned int value, int bits )
+{
+	for( int i = 0; i < bits; i++ )
+	{
+		m_iBits |= ( ( value >> i ) & 1 ) << m_iNumBits;
+
+		if( ++m_iNumBits == 8 )
+		{
+			WRITE_BYTE( m_iBits );
+			m_iBits = 0;
+			m_iNumBits = 0;
+		}
+	}
+}
+
+void CPlayerStateMsg::FlushBits( void )
+{
+	if( m_iNumBits )
+		WRITE_BYTE( m_iBits );
+
+	m_iBits = 0;
+	m_iNumBits = 0;
+}
+
+void CPlayerStateMsg::End( void )
+{
+	int i;
+
+	if( !m_pPlayer )
+		return;
+
+	if( !m_iDirty )
+	{
+		m_pPlayer = NULL;
+		return;
+	}
+
+	m_iBits = 0;
+	m_iNumBits = 0;
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgPlayerState, NULL, m_pPlayer->pev );
+		WRITE_BYTE( PLAYERSTATE_VERSION );
+		WriteBits( m_iDirty, PS_NUM_FIELDS );
+
+		if( m_iDirty & PS_HIDEHUD )
+			WriteBits( m_iHideHUD, PS_BITS_BYTE );
+
+		if( m_iDirty & PS_FOV )
+			WriteBits( m_iFOV, PS_BITS_BYTE );
+
+		if( m_iDirty & PS_HEALTH )
+			WriteBits( m_iHealth, PS_BITS_BYTE );
+
+		if( m_iDirty & PS_BATTERY )
+			WriteBits( m_iBattery, PS_BITS_BATTERY );
+
+		if( m_iDirty & PS_DAMAGE )
+		{
+			WriteBits( m_iDmgSave, PS_BITS_BYTE );
+			WriteBits( m_iDmgTake, PS_BITS_BYTE );
+			WriteBits( m_iDmgBits, PS_BITS_DMGTYPE );
+
+			for( i = 0; i < 3; i++ )
+			{
+				int coord = (int)m_vecDmgFrom[i];
+
+				WriteBits( Q_max( Q_min( coord, 32767 ), -32768 ), PS_BITS_COORD );
+			}
+		}
+
+		if( m_iDirty & PS_FLASHLIGHT )
+		{
+			WriteBits( m_fFlashlight ? 1 : 0, 1 );
+			WriteBits( m_iFlashBattery, PS_BITS_FLASHBAT );
+		}
+
+		if( m_iDirty & PS_AMMO )
+		{
+			WriteBits( m_iNumAmmo, PS_BITS_COUNT );
+
+			for( i = 0; i < m_iNumAmmo; i++ )
+			{
+				WriteBits( m_rgAmmo[i][0], PS_BITS_INDEX );
+				WriteBits( m_rgAmmo[i][1], PS_BITS_BYTE );
+			}
+		}
+
+		if( m_iDirty & PS_WEAPONS )
+		{
+			WriteBits( m_iNumWeapons, PS_BITS_COUNT );
+
+			for( i = 0; i < m_iNumWeapons; i++ )
+			{
+				WriteBits( m_rgWeapons[i][0], PS_BITS_WEAPONSTATE );
+				WriteBits( m_rgWeapons[i][1], PS_BITS_INDEX );
+				WriteBits( m_rgWeapons[i][2], PS_BITS_BYTE );
+			}
+		}
+
+		FlushBits();
+	MESSAGE_END();
+
+	m_pPlayer = NULL;
+}
+
+void CPlayerStateMsg::HideHUD( CBasePlayer *pPlayer, int hide )
+{
+	if( IsCoalescing( pPlayer ))
+	{
+		m_iHideHUD = hide;
+		m_iDirty |= PS_HIDEHUD;
+		return;
+	}
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgHideWeapon, NULL, pPlayer->pev );
+		WRITE_BYTE( hide );
+	MESSAGE_END();
+}
+
+void CPlayerStateMsg::FOV( CBasePlayer *pPlayer, int fov )
+{
+	if( IsCoalescing( pPlayer ))
+	{
+		m_iFOV = fov;
+		m_iDirty |= PS_FOV;
+		return;
+	}
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgSetFOV, NULL, pPlayer->pev );
+		WRITE_BYTE( fov );
+	MESSAGE_END();
+}
+
+void CPlayerStateMsg::Health( CBasePlayer *pPlayer, int health )
+{
+	if( IsCoalescing( pPlayer ))
+	{
+		m_iHealth = health;
+		m_iDirty |= PS_HEALTH;
+		return;
+	}
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgHealth, NULL, pPlayer->pev );
+		WRITE_BYTE( health );
+	MESSAGE_END();
+}
+
+void CPlayerStateMsg::Battery( CBasePlayer *pPlayer, int armor )
+{
+	if( IsCoalescing( pPlayer ))
+	{
+		m_iBattery = armor;
+		m_iDirty |= PS_BATTERY;
+		return;
+	}
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgBattery, NULL, pPlayer->pev );
+		WRITE_SHORT( armor );
+	MESSAGE_END();
+}
+
+void CPlayerStateMsg::Damage( CBasePlayer *pPlayer, int save, int take, int bits, const Vector &vecFrom )
+{
+	if( IsCoalescing( pPlayer ))
+	{
+		m_iDmgSave = save;
+		m_iDmgTake = take;
+		m_iDmgBits = bits;
+		m_vecDmgFrom = vecFrom;
+		m_iDirty |= PS_DAMAGE;
+		return;
+	}
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgDamage, NULL, pPlayer->pev );
+		WRITE_BYTE( save );
+		WRITE_BYTE( take );
+		WRITE_LONG( bits );
+		WRITE_COORD( vecFrom.x );
+		WRITE_COORD( vecFrom.y );
+		WRITE_COORD( vecFrom.z );
+	MESSAGE_END();
+}
+
+void CPlayerStateMsg::Flashlight( CBasePlayer *pPlayer, int on, int battery )
+{
+	if( IsCoalescing( pPlayer ))
+	{
+		m_fFlashlight = on;
+		m_iFlashBattery = battery;
+		m_iDirty |= PS_FLASHLIGHT;
+		return;
+	}
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgFlashlight, NULL, pPlayer->pev );
+		WRITE_BYTE( on );
+		WRITE_BYTE( battery );
+	MESSAGE_END();
+}
+
+void CPlayerStateMsg::FlashBattery( CBasePlayer *pPlayer, int battery )
+{
+	// the packed field always carries the switch too
+	if( IsCoalescing( pPlayer ))
+	{
+		Flashlight( pPlayer, pPlayer->FlashlightIsOn() ? 1 : 0, battery );
+		return;
+	}
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgFlashBattery, NULL, pPlayer->pev );
+		WRITE_BYTE( battery );
+	MESSAGE_END();
+}
+
+void CPlayerStateMsg::Ammo( CBasePlayer *pPlayer, int index, int count )
+{
+	if( IsCoalescing( pPlayer ) && m_iNumAmmo < MAX_AMMO_SLOTS )
+	{
+		m_rgAmmo[m_iNumAmmo][0] = index;
+		m_rgAmmo[m_iNumAmmo][1] = count;
+		m_iNumAmmo++;
+		m_iDirty |= PS_AMMO;
+		return;
+	}
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgAmmoX, NULL, pPlayer->pev );
+		WRITE_BYTE( index );
+		WRITE_BYTE( count );
+	MESSAGE_END();
+}
+
+void CPlayerStateMsg::CurWeapon( CBasePlayer *pPlayer, int state, int id, int clip )
+{
+	if( IsCoalescing( pPlayer ) && m_iNumWeapons < MAX_WEAPONS )
+	{
+		m_rgWeapons[m_iNumWeapons][0] = ( state == WEAPON_IS_ONTARGET ) ? 2 : state;
+		m_rgWeapons[m_iNumWeapons][1] = id;
+		m_rgWeapons[m_iNumWeapons][2] = clip;
+		m_iNumWeapons++;
+		m_iDirty |= PS_WEAPONS;
+		return;
+	}
+
+	MESSAGE_BEGIN( MSG_ONE, gmsgCurWeapon, NULL, pPlayer->pev );
+		WRITE_BYTE( state );
+		WRITE_BYTE( id );
+		WRITE_BYTE( clip );
+	MESSAGE_END();
+}
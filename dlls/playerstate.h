@@ -0,0 +1,64 @@
+/***
+*
+*   Coalesced, bit packed HUD state updates for a player
+*
+***/
+#pragma once
+#if !defined(PLAYERSTATE_H)
+#define PLAYERSTATE_H
+
+//=========================================================
+// CPlayerStateMsg - UpdateClientData hands every HUD value
+// that changed to this instead of sending its own message.
+// Between Begin() and End() the values of a client that
+// understands the PlayerState message are collected and go
+// out as one message with a dirty field mask, for any other
+// client, or outside of Begin() and End(), each one is sent
+// right away as the old message.
+//=========================================================
+class CPlayerStateMsg
+{
+public:
+	void Begin( CBasePlayer *pPlayer );
+	void End( void );
+
+	void HideHUD( CBasePlayer *pPlayer, int hide );
+	void FOV( CBasePlayer *pPlayer, int fov );
+	void Health( CBasePlayer *pPlayer, int health );
+	void Battery( CBasePlayer *pPlayer, int armor );
+	void Damage( CBasePlayer *pPlayer, int save, int take, int bits, const Vector &vecFrom );
+	void Flashlight( CBasePlayer *pPlayer, int on, int battery );
+	void FlashBattery( CBasePlayer *pPlayer, int battery );
+	void Ammo( CBasePlayer *pPlayer, int index, int count );
+	void CurWeapon( CBasePlayer *pPlayer, int state, int id, int clip );
+
+private:
+	BOOL IsCoalescing( CBasePlayer *pPlayer ) { return m_pPlayer && m_pPlayer == pPlayer; }
+	void WriteBits( unsigned int value, int bits );
+	void FlushBits( void );
+
+	CBasePlayer *m_pPlayer;		// collecting for this player
+	int m_iDirty;
+
+	int m_iHideHUD;
+	int m_iFOV;
+	int m_iHealth;
+	int m_iBattery;
+	int m_iDmgSave;
+	int m_iDmgTake;
+	int m_iDmgBits;
+	Vector m_vecDmgFrom;
+	int m_fFlashlight;
+	int m_iFlashBattery;
+
+	int m_iNumAmmo;
+	int m_rgAmmo[MAX_AMMO_SLOTS][2];	// index, count
+	int m_iNumWeapons;
+	int m_rgWeapons[MAX_WEAPONS][3];	// state, id, clip
+
+	unsigned int m_iBits;
+	int m_iNumBits;
+};
+
+extern CPlayerStateMsg g_PlayerStateMsg;
+#endif // PLAYERSTATE_H
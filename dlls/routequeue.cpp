@@ -0,0 +1,214 @@
+/***
+*
+*   Monster node routes searched on the worker threads between frames
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "monsters.h"
+#include "nodes.h"
+#include "game.h"
+#include "routequeue.h"
+
+CRouteQueue g_RouteQueue;
+
+typedef struct
+{
+	ROUTE_REQUEST *pRequests[ROUTEQUEUE_SIZE];
+} routebatch_t;
+
+static void RouteQueue_SearchJob( void *data, int index, int thread )
+{
+	ROUTE_REQUEST *pRequest = ( (routebatch_t *)data )->pRequests[index];
+
+	pRequest->cPathNodes = WorldGraph.SearchPath( &WorldGraph.m_PathSearch[thread], pRequest->iPath,
+		pRequest->iStart, pRequest->iDest, pRequest->iHull, pRequest->afCapMask, pRequest->pLinkUsable );
+}
+
+CRouteQueue::CRouteQueue()
+{
+	for( int i = 0; i < ROUTEQUEUE_SIZE; i++ )
+		m_Requests[i].iSerial = 0;
+	m_cUsed = 0;
+	m_iSerial = 0;
+
+	ResetStats();
+}
+
+void CRouteQueue::Clear( void )
+{
+	for( int i = 0; i < ROUTEQUEUE_SIZE; i++ )
+		m_Requests[i].iSerial = 0;
+	m_cUsed = 0;
+
+	g_WorkerPool.Stop();
+}
+
+ROUTE_REQUEST *CRouteQueue::Find( int iSerial )
+{
+	if( iSerial <= 0 || !m_cUsed )
+		return NULL;
+
+	for( int i = 0; i < ROUTEQUEUE_SIZE; i++ )
+	{
+		if( m_Requests[i].iSerial == iSerial )
+			return &m_Requests[i];
+	}
+
+	return NULL;
+}
+
+int CRouteQueue::Queue( CBaseMonster *pMonster, int iStart, int iDest, int iHull, int afCapMask )
+{
+	ROUTE_REQUEST *pRequest = NULL;
+	int i;
+
+	for( i = 0; i < ROUTEQUEUE_SIZE; i++ )
+	{
+		if( !m_Requests[i].iSerial )
+		{
+			pRequest = &m_Requests[i];
+			break;
+		}
+	}
+
+	if( !pRequest )
+	{
+		m_iFull++;
+		return 0;
+	}
+
+	if( ++m_iSerial <= 0 )
+		m_iSerial = 1;
+
+	pRequest->iSerial = m_iSerial;
+	pRequest->hMonster = pMonster;
+	pRequest->iStart = iStart;
+	pRequest->iDest = iDest;
+	pRequest->iHull = iHull;
+	pRequest->afCapMask = afCapMask;
+	pRequest->pLinkUsable = NULL;
+	pRequest->cPathNodes = -1;
+
+	m_cUsed++;
+	m_iQueued++;
+	return m_iSerial;
+}
+
+int CRouteQueue::Fetch( int iSerial, int *piPath )
+{
+	ROUTE_REQUEST *pRequest = Find( iSerial );
+	int cPathNodes;
+
+	if( !pRequest )
+	{
+		// dropped by Clear, there's no path to give
+		return 0;
+	}
+
+	if( pRequest->cPathNodes < 0 )
+		return -1;
+
+	cPathNodes = pRequest->cPathNodes;
+	memcpy( piPath, pRequest->iPath, cPathNodes * sizeof(int) );
+
+	pRequest->iSerial = 0;
+	m_cUsed--;
+	return cPathNodes;
+}
+
+void CRouteQueue::Cancel( int iSerial )
+{
+	ROUTE_REQUEST *pRequest = Find( iSerial );
+
+	if( pRequest )
+	{
+		pRequest->iSerial = 0;
+		m_cUsed--;
+	}
+}
+
+//=========================================================
+// StartFrame - runs before the entities think, on the main
+// thread. Requests whose monster is gone or has asked for
+// something else since are dropped, the rest are searched
+// together and the results go into the path cache as well.
+//=========================================================
+void CRouteQueue::StartFrame( void )
+{
+	routebatch_t batch;
+	ROUTE_REQUEST *pRequest;
+	CBaseMonster *pMonster;
+	int cBatch = 0;
+	int cThreads;
+	int i;
+
+	if( !m_cUsed )
+		return;
+
+	for( i = 0; i < ROUTEQUEUE_SIZE; i++ )
+	{
+		pRequest = &m_Requests[i];
+
+		if( !pRequest->iSerial )
+			continue;
+
+		pMonster = pRequest->hMonster != 0 ? pRequest->hMonster->MyMonsterPointer() : NULL;
+		if( !pMonster || pMonster->m_iRouteRequest != pRequest->iSerial )
+		{
+			pRequest->iSerial = 0;
+			m_cUsed--;
+			continue;
+		}
+
+		// searched, waiting for the monster to think
+		if( pRequest->cPathNodes >= 0 )
+			continue;
+
+		pRequest->pLinkUsable = WorldGraph.LinkUsable( pRequest->afCapMask );
+		if( !pRequest->pLinkUsable )
+		{
+			// the workers can't tell which brush ents are in the way
+			pRequest->cPathNodes = WorldGraph.FindShortestPath( pRequest->iPath, pRequest->iStart,
+				pRequest->iDest, pRequest->iHull, pRequest->afCapMask );
+			continue;
+		}
+
+		batch.pRequests[cBatch++] = pRequest;
+	}
+
+	if( !cBatch )
+		return;
+
+	// -1 is one less than the number of CPUs, the main thread works too
+	cThreads = (int)sv_routethreads.value;
+	if( cThreads < 0 )
+		cThreads = CWorkerPool::NumCPUs() - 1;
+	cThreads = Q_min( Q_max( cThreads, 0 ), WORKER_MAX_THREADS );
+
+	if( g_WorkerPool.NumThreads() != cThreads )
+		g_WorkerPool.Start( cThreads );
+
+	g_WorkerPool.Run( RouteQueue_SearchJob, &batch, cBatch );
+
+	for( i = 0; i < cBatch; i++ )
+	{
+		pRequest = batch.pRequests[i];
+		WorldGraph.StorePath( pRequest->iPath, pRequest->cPathNodes, pRequest->iStart,
+			pRequest->iDest, pRequest->iHull, pRequest->afCapMask );
+	}
+
+	m_iBatches++;
+	m_iSearched += cBatch;
+	if( cBatch > m_iLargestBatch )
+		m_iLargestBatch = cBatch;
+}
+
+void CRouteQueue::ReportStats( void )
+{
+	ALERT( at_console, "Route queue: %s, %d threads, queued %u, searched %u in %u frames, largest batch %d, queue full %u\n",
+		sv_routequeue.value ? "enabled" : "disabled", g_WorkerPool.NumThreads(), m_iQueued, m_iSearched,
+		m_iBatches, m_iLargestBatch, m_iFull );
+}
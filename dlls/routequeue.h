@@ -0,0 +1,71 @@
+/***
+*
+*   Monster node routes searched on the worker threads between frames
+*
+***/
+#pragma once
+#if !defined(ROUTEQUEUE_H)
+#define ROUTEQUEUE_H
+
+#define ROUTEQUEUE_SIZE		128
+
+typedef struct
+{
+	int iSerial;		// 0 if the slot is free
+	EHANDLE hMonster;	// who asked, the slot is dropped once it moves on
+	int iStart;
+	int iDest;
+	int iHull;
+	int afCapMask;
+	const byte *pLinkUsable;
+	int cPathNodes;		// -1 until searched
+	int iPath[MAX_PATH_SIZE];
+} ROUTE_REQUEST;
+
+//=========================================================
+// CRouteQueue - node searches that can't be answered from
+// the routing tables or the path cache are handed to the
+// queue by FGetNodeRoute instead of running in the think
+// that asked. StartFrame searches everything queued since
+// the last frame on g_WorkerPool, before any entity thinks
+// again, so the path is ready by the monster's next think.
+//
+// Only the graph search runs on the workers. The nearest
+// node lookups before it and RouteSimplify after it trace,
+// and stay in the monster's think.
+//=========================================================
+class CRouteQueue
+{
+public:
+	CRouteQueue();
+
+	void Clear( void );		// drop every request and stop the workers
+	void StartFrame( void );
+
+	// serial for Fetch, 0 if the queue is full
+	int Queue( CBaseMonster *pMonster, int iStart, int iDest, int iHull, int afCapMask );
+
+	// copies the path and frees the slot, -1 while it hasn't been searched
+	int Fetch( int iSerial, int *piPath );
+	void Cancel( int iSerial );
+
+	void ReportStats( void );
+	void ResetStats( void ) { m_iQueued = m_iFull = m_iBatches = m_iSearched = 0; m_iLargestBatch = 0; }
+
+private:
+	ROUTE_REQUEST *Find( int iSerial );
+
+	ROUTE_REQUEST m_Requests[ROUTEQUEUE_SIZE];
+	int m_cUsed;		// slots in use, searched or not
+	int m_iSerial;		// last serial handed out
+
+	// statistics
+	unsigned int m_iQueued;
+	unsigned int m_iFull;		// ran in the think, no free slot
+	unsigned int m_iBatches;
+	unsigned int m_iSearched;
+	int m_iLargestBatch;
+};
+
+extern CRouteQueue g_RouteQueue;
+#endif // ROUTEQUEUE_H
@@ -212,6 +212,10 @@ void CBaseMonster::MaintainSchedule( void )
 	// UNDONE: Tune/fix this 10... This is just here so infinite loops are impossible
 	for( i = 0; i < 10; i++ )
 	{
+		// hold the schedule until the node route it asked for has been searched
+		if( FRouteQueued() )
+			return;
+
 		if( m_pSchedule != NULL && TaskIsComplete() )
 		{
 			NextScheduledTask();                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                   
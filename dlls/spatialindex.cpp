@@ -0,0 +1,398 @@
+/***
+*
+*   Uniform grid spatial index for server entity box/sphere queries
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "game.h"
+#include "spatialindex.h"
+
+CSpatialIndex g_SpatialIndex;
+
+static int CompareIndex( const void *a, const void *b )
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static inline int CellHash( int x, int y )
+{
+	// unsigned, so the multiplies wrap instead of overflowing
+	unsigned int hash = ( (unsigned int)x * 73856093u ) ^ ( (unsigned int)y * 19349663u );
+
+	return (int)( hash & ( SPATIAL_HASH_SIZE - 1 ));
+}
+
+static inline int CellCoord( float value )
+{
+	value = floor( value / SPATIAL_CELL_SIZE );
+
+	// keep garbage bounds from overflowing, such boxes end up oversized anyway
+	if( value < -32768.0f )
+		return -32768;
+	if( value > 32767.0f )
+		return 32767;
+	return (int)value;
+}
+
+CSpatialIndex::CSpatialIndex()
+{
+	m_pBucketHead = NULL;
+	m_pLinkNext = m_pLinkPrev = m_pLinkBucket = NULL;
+	m_pNumLinks = NULL;
+	m_pRect = NULL;
+	m_pOversizedNext = m_pOversizedPrev = NULL;
+	m_pQueryStamp = NULL;
+	m_pCandidates = NULL;
+	m_pEdicts = NULL;
+	m_iMaxEntities = 0;
+	m_iOversizedHead = -1;
+	m_iQueryStamp = 0;
+
+	ResetStats();
+}
+
+CSpatialIndex::~CSpatialIndex()
+{
+	Free();
+}
+
+void CSpatialIndex::Free( void )
+{
+	free( m_pBucketHead );
+	free( m_pLinkNext );
+	free( m_pLinkPrev );
+	free( m_pLinkBucket );
+	free( m_pNumLinks );
+	free( m_pRect );
+	free( m_pOversizedNext );
+	free( m_pOversizedPrev );
+	free( m_pQueryStamp );
+	free( m_pCandidates );
+
+	m_pBucketHead = NULL;
+	m_pLinkNext = m_pLinkPrev = m_pLinkBucket = NULL;
+	m_pNumLinks = NULL;
+	m_pRect = NULL;
+	m_pOversizedNext = m_pOversizedPrev = NULL;
+	m_pQueryStamp = NULL;
+	m_pCandidates = NULL;
+	m_pEdicts = NULL;
+	m_iMaxEntities = 0;
+}
+
+BOOL CSpatialIndex::Init( void )
+{
+	int i, maxEntities = gpGlobals->maxEntities;
+	edict_t *pEdicts = ENT( 0 );
+
+	if( maxEntities <= 0 || !pEdicts )
+		return FALSE;
+
+	if( maxEntities != m_iMaxEntities )
+	{
+		Free();
+
+		int numLinks = maxEntities * SPATIAL_MAX_LINKS;
+
+		m_pBucketHead = (int *)malloc( SPATIAL_HASH_SIZE * sizeof( int ));
+		m_pLinkNext = (int *)malloc( numLinks * sizeof( int ));
+		m_pLinkPrev = (int *)malloc( numLinks * sizeof( int ));
+		m_pLinkBucket = (int *)malloc( numLinks * sizeof( int ));
+		m_pNumLinks = (short *)malloc( maxEntities * sizeof( short ));
+		m_pRect = (int *)malloc( maxEntities * 4 * sizeof( int ));
+		m_pOversizedNext = (int *)malloc( maxEntities * sizeof( int ));
+		m_pOversizedPrev = (int *)malloc( maxEntities * sizeof( int ));
+		m_pQueryStamp = (int *)malloc( maxEntities * sizeof( int ));
+		m_pCandidates = (int *)malloc( maxEntities * sizeof( int ));
+
+		if( !m_pBucketHead || !m_pLinkNext || !m_pLinkPrev || !m_pLinkBucket || !m_pNumLinks
+			|| !m_pRect || !m_pOversizedNext || !m_pOversizedPrev || !m_pQueryStamp || !m_pCandidates )
+		{
+			ALERT( at_error, "CSpatialIndex: out of memory for %d entities\n", maxEntities );
+			Free();
+			return FALSE;
+		}
+
+		m_iMaxEntities = maxEntities;
+	}
+
+	m_pEdicts = pEdicts;
+
+	for( i = 0; i < SPATIAL_HASH_SIZE; i++ )
+		m_pBucketHead[i] = -1;
+
+	memset( m_pNumLinks, 0, m_iMaxEntities * sizeof( short ));
+	memset( m_pQueryStamp, 0, m_iMaxEntities * sizeof( int ));
+	m_iOversizedHead = -1;
+	m_iQueryStamp = 0;
+	m_iLinked = 0;
+	m_iOversized = 0;
+
+	return TRUE;
+}
+
+void CSpatialIndex::Reset( void )
+{
+	if( !Init() )
+		return;
+
+	// the world is never indexed, callers skip edict 0 as well
+	for( int i = 1; i < m_iMaxEntities; i++ )
+	{
+		if( !m_pEdicts[i].free )
+			Link( &m_pEdicts[i] );
+	}
+}
+
+int CSpatialIndex::EntityIndex( edict_t *pent )
+{
+	if( !pent )
+		return -1;
+
+	if( !m_pEdicts && !Init() )
+		return -1;
+
+	int index = pent - m_pEdicts;
+
+	if( index < 0 || index >= m_iMaxEntities )
+		return -1;
+
+	return index;
+}
+
+void CSpatialIndex::CellRect( const Vector &mins, const Vector &maxs, int *pRect )
+{
+	pRect[0] = CellCoord( mins.x );
+	pRect[1] = CellCoord( mins.y );
+	pRect[2] = CellCoord( maxs.x );
+	pRect[3] = CellCoord( maxs.y );
+}
+
+void CSpatialIndex::UnlinkIndex( int ent )
+{
+	int numLinks = m_pNumLinks[ent];
+
+	if( numLinks < 0 )
+	{
+		int next = m_pOversizedNext[ent];
+		int prev = m_pOversizedPrev[ent];
+
+		if( prev >= 0 )
+			m_pOversizedNext[prev] = next;
+		else
+			m_iOversizedHead = next;
+
+		if( next >= 0 )
+			m_pOversizedPrev[next] = prev;
+
+		m_iOversized--;
+		m_iLinked--;
+	}
+	else if( numLinks > 0 )
+	{
+		int link = ent * SPATIAL_MAX_LINKS;
+
+		for( int i = 0; i < numLinks; i++, link++ )
+		{
+			int next = m_pLinkNext[link];
+			int prev = m_pLinkPrev[link];
+
+			if( prev >= 0 )
+				m_pLinkNext[prev] = next;
+			else
+				m_pBucketHead[m_pLinkBucket[link]] = next;
+
+			if( next >= 0 )
+				m_pLinkPrev[next] = prev;
+		}
+
+		m_iLinked--;
+	}
+
+	m_pNumLinks[ent] = 0;
+}
+
+void CSpatialIndex::Link( edict_t *pent )
+{
+	int ent = EntityIndex( pent );
+	int rect[4];
+
+	if( ent <= 0 )
+		return;
+
+	if( pent->free )
+	{
+		UnlinkIndex( ent );
+		return;
+	}
+
+	CellRect( pent->v.absmin, pent->v.absmax, rect );
+
+	int *pRect = &m_pRect[ent * 4];
+
+	// still in the same cells, nothing to do
+	if( m_pNumLinks[ent] != 0 && !memcmp( rect, pRect, sizeof( rect )))
+		return;
+
+	UnlinkIndex( ent );
+	memcpy( pRect, rect, sizeof( rect ));
+
+	int numCells = ( rect[2] - rect[0] + 1 ) * ( rect[3] - rect[1] + 1 );
+
+	m_iLinked++;
+
+	if( numCells <= 0 || numCells > SPATIAL_MAX_LINKS )
+	{
+		m_pOversizedPrev[ent] = -1;
+		m_pOversizedNext[ent] = m_iOversizedHead;
+		if( m_iOversizedHead >= 0 )
+			m_pOversizedPrev[m_iOversizedHead] = ent;
+		m_iOversizedHead = ent;
+		m_pNumLinks[ent] = -1;
+		m_iOversized++;
+		return;
+	}
+
+	int link = ent * SPATIAL_MAX_LINKS;
+
+	for( int x = rect[0]; x <= rect[2]; x++ )
+	{
+		for( int y = rect[1]; y <= rect[3]; y++, link++ )
+		{
+			int bucket = CellHash( x, y );
+			int head = m_pBucketHead[bucket];
+
+			m_pLinkBucket[link] = bucket;
+			m_pLinkPrev[link] = -1;
+			m_pLinkNext[link] = head;
+			if( head >= 0 )
+				m_pLinkPrev[head] = link;
+			m_pBucketHead[bucket] = link;
+		}
+	}
+
+	m_pNumLinks[ent] = numCells;
+}
+
+void CSpatialIndex::Unlink( edict_t *pent )
+{
+	int ent = EntityIndex( pent );
+
+	if( ent > 0 )
+		UnlinkIndex( ent );
+}
+
+int CSpatialIndex::Query( const Vector &mins, const Vector &maxs, const int **ppCandidates )
+{
+	int rect[4];
+	int count = 0;
+
+	if( !sv_spatialindex.value || !m_pEdicts )
+		return -1;
+
+	m_iQueries++;
+
+	CellRect( mins, maxs, rect );
+
+	int numCells = ( rect[2] - rect[0] + 1 ) * ( rect[3] - rect[1] + 1 );
+
+	if( numCells <= 0 || numCells > SPATIAL_MAX_QUERY_CELLS )
+	{
+		m_iFallbacks++;
+		return -1;
+	}
+
+	if( ++m_iQueryStamp <= 0 )
+	{
+		memset( m_pQueryStamp, 0, m_iMaxEntities * sizeof( int ));
+		m_iQueryStamp = 1;
+	}
+
+	// hash collisions may return entities from far away cells, callers
+	// test the real bounds anyway
+	for( int x = rect[0]; x <= rect[2]; x++ )
+	{
+		for( int y = rect[1]; y <= rect[3]; y++ )
+		{
+			for( int link = m_pBucketHead[CellHash( x, y )]; link >= 0; link = m_pLinkNext[link] )
+			{
+				int ent = link / SPATIAL_MAX_LINKS;
+
+				if( m_pQueryStamp[ent] == m_iQueryStamp )
+					continue;
+
+				m_pQueryStamp[ent] = m_iQueryStamp;
+				m_pCandidates[count++] = ent;
+			}
+		}
+	}
+
+	for( int ent = m_iOversizedHead; ent >= 0; ent = m_pOversizedNext[ent] )
+		m_pCandidates[count++] = ent;
+
+	// keep the edict order of the linear walk, callers stop at listMax
+	if( count > 1 )
+		qsort( m_pCandidates, count, sizeof( int ), CompareIndex );
+
+	m_flCandidates += count;
+	*ppCandidates = m_pCandidates;
+
+	return count;
+}
+
+void CSpatialIndex::ResetStats( void )
+{
+	m_iQueries = 0;
+	m_iFallbacks = 0;
+	m_flCandidates = 0.0;
+}
+
+void CSpatialIndex::ReportStats( void )
+{
+	if( !m_pEdicts )
+	{
+		ALERT( at_console, "Spatial index is not initialized\n" );
+		return;
+	}
+
+	int usedBuckets = 0, maxChain = 0, totalLinks = 0;
+
+	for( int i = 0; i < SPATIAL_HASH_SIZE; i++ )
+	{
+		int chain = 0;
+
+		for( int link = m_pBucketHead[i]; link >= 0; link = m_pLinkNext[link] )
+			chain++;
+
+		if( chain )
+			usedBuckets++;
+		if( chain > maxChain )
+			maxChain = chain;
+		totalLinks += chain;
+	}
+
+	unsigned int indexed = m_iQueries - m_iFallbacks;
+
+	ALERT( at_console, "Spatial index: %s, %d edicts, %.0f unit cells\n",
+		sv_spatialindex.value ? "enabled" : "disabled", m_iMaxEntities, SPATIAL_CELL_SIZE );
+	ALERT( at_console, "  linked %d (%d oversized), %d cell links\n", m_iLinked, m_iOversized, totalLinks );
+	ALERT( at_console, "  buckets used %d/%d, longest chain %d\n", usedBuckets, SPATIAL_HASH_SIZE, maxChain );
+	ALERT( at_console, "  queries %u, linear fallbacks %u, avg candidates %.2f\n",
+		m_iQueries, m_iFallbacks, indexed ? m_flCandidates / indexed : 0.0 );
+}
+
+// sv_spatialstats [reset]
+void SpatialIndex_Stats_f( void )
+{
+	if( CMD_ARGC() > 1 && FStrEq( CMD_ARGV( 1 ), "reset" ))
+	{
+		g_SpatialIndex.ResetStats();
+		ALERT( at_console, "Spatial index statistics reset\n" );
+		return;
+	}
+
+	g_SpatialIndex.ReportStats();
+}
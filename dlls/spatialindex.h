@@ -0,0 +1,81 @@
+/***
+*
+*   Uniform grid spatial index for server entity box/sphere queries
+*
+***/
+#pragma once
+#if !defined(SPATIALINDEX_H)
+#define SPATIALINDEX_H
+
+#define SPATIAL_CELL_SIZE		256.0f
+#define SPATIAL_HASH_SIZE		4096	// must be power of two
+#define SPATIAL_MAX_LINKS		16	// entities covering more cells than this go to the oversized list
+#define SPATIAL_MAX_QUERY_CELLS		1024	// bigger queries fall back to a linear edict walk
+
+//=========================================================
+// CSpatialIndex - hashes every linked edict into the 2D
+// (x,y) cells its absmin/absmax cover.  It is updated from
+// DispatchObjectCollsionBox, which the engine calls each
+// time it relinks an edict, so physics moves are covered
+// too.  Queries return edict indices in ascending order,
+// the same order a full edict walk would produce.
+//=========================================================
+class CSpatialIndex
+{
+public:
+	CSpatialIndex();
+	~CSpatialIndex();
+
+	void Reset( void );		// drop everything and relink all edicts in use
+	void Link( edict_t *pent );
+	void Unlink( edict_t *pent );
+
+	// Fills m_pCandidates with edicts that may touch the box, returns
+	// the count, or -1 if the caller should walk all edicts instead.
+	int Query( const Vector &mins, const Vector &maxs, const int **ppCandidates );
+
+	edict_t *Edict( int index ) { return m_pEdicts + index; }
+
+	void ReportStats( void );
+	void ResetStats( void );
+
+private:
+	BOOL Init( void );
+	void Free( void );
+	int EntityIndex( edict_t *pent );
+	void CellRect( const Vector &mins, const Vector &maxs, int *pRect );
+	void UnlinkIndex( int ent );
+
+	int *m_pBucketHead;	// SPATIAL_HASH_SIZE heads into the link pool
+
+	// link pool, SPATIAL_MAX_LINKS slots per edict
+	int *m_pLinkNext;
+	int *m_pLinkPrev;
+	int *m_pLinkBucket;
+
+	// per edict state
+	short *m_pNumLinks;	// -1 for oversized, 0 when unlinked
+	int *m_pRect;		// x0, y0, x1, y1 cell rect the edict is linked with
+	int *m_pOversizedNext;
+	int *m_pOversizedPrev;
+	int *m_pQueryStamp;
+	int m_iOversizedHead;
+
+	int *m_pCandidates;
+	int m_iQueryStamp;
+
+	edict_t *m_pEdicts;
+	int m_iMaxEntities;
+
+	// statistics
+	int m_iLinked;
+	int m_iOversized;
+	unsigned int m_iQueries;
+	unsigned int m_iFallbacks;
+	double m_flCandidates;
+};
+
+extern CSpatialIndex g_SpatialIndex;
+
+extern void SpatialIndex_Stats_f( void );
+#endif // SPATIALINDEX_H
@@ -0,0 +1,165 @@
+/***
+*
+*   Deathmatch spawn point registry
+*
+***/
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "gamerules.h"
+#include "game.h"
+#include "spawnpoints.h"
+#include "playerroster.h"
+
+CSpawnPoints g_SpawnPoints;
+
+// players only block a spot while they can actually be telefragged
+static inline BOOL BlocksSpawn( CBasePlayer *pPlayer, CBaseEntity *pOther )
+{
+	return pOther != pPlayer && pOther->IsAlive() && pOther->pev->solid != SOLID_NOT;
+}
+
+// same point the engine's FIND_ENTITY_IN_SPHERE measures from
+static inline Vector PlayerCenter( CBaseEntity *pOther )
+{
+	return pOther->pev->origin + ( pOther->pev->mins + pOther->pev->maxs ) * 0.5f;
+}
+
+void CSpawnPoints::Clear( void )
+{
+	for( int i = 0; i < m_iCount; i++ )
+		m_hSpots[i] = NULL;
+
+	m_iCount = 0;
+}
+
+void CSpawnPoints::Build( void )
+{
+	CBaseEntity *pSpot = NULL;
+
+	Clear();
+
+	while( ( pSpot = UTIL_FindEntityByClassname( pSpot, "info_player_deathmatch" )) != NULL )
+	{
+		// spots left at the world origin were never used
+		if( pSpot->pev->origin == g_vecZero )
+			continue;
+
+		if( m_iCount >= MAX_SPAWN_POINTS )
+		{
+			ALERT( at_console, "Too many info_player_deathmatch, only %d used\n", MAX_SPAWN_POINTS );
+			break;
+		}
+
+		m_hSpots[m_iCount] = pSpot;
+		m_vecOrigins[m_iCount] = pSpot->pev->origin;
+		m_iCount++;
+	}
+}
+
+void CSpawnPoints::ClearSpot( CBasePlayer *pPlayer, int spot )
+{
+	for( int i = 0; i < g_PlayerRoster.ActiveCount(); i++ )
+	{
+		CBasePlayer *pOther = g_PlayerRoster.ActivePlayer( i );
+
+		if( !BlocksSpawn( pPlayer, pOther ))
+			continue;
+
+		Vector delta = PlayerCenter( pOther ) - m_vecOrigins[spot];
+
+		if( DotProduct( delta, delta ) < SPAWN_CLEAR_RADIUS * SPAWN_CLEAR_RADIUS )
+			pOther->TakeDamage( VARS( INDEXENT( 0 ) ), VARS( INDEXENT( 0 ) ), 300, DMG_GENERIC );
+	}
+}
+
+CBaseEntity *CSpawnPoints::SelectDeathmatch( CBasePlayer *pPlayer )
+{
+	int candidates[MAX_SPAWN_POINTS];
+	float scores[MAX_SPAWN_POINTS];
+	int i, j, numCandidates = 0;
+	float best = 0.0f;
+
+	if( !m_iCount )
+		return NULL;
+
+	for( i = 0; i < m_iCount; i++ )
+	{
+		CBaseEntity *pSpot = m_hSpots[i];
+
+		if( !pSpot || !pSpot->IsTriggered( pPlayer ))
+			continue;
+
+		// squared distance to the nearest enemy, occupancy check in the same pass
+		float nearest = 8192.0f * 8192.0f * 3.0f;
+		BOOL occupied = FALSE;
+
+		for( j = 0; j < g_PlayerRoster.ActiveCount(); j++ )
+		{
+			CBasePlayer *pOther = g_PlayerRoster.ActivePlayer( j );
+
+			if( !BlocksSpawn( pPlayer, pOther ))
+				continue;
+
+			Vector delta = PlayerCenter( pOther ) - m_vecOrigins[i];
+			float dist = DotProduct( delta, delta );
+
+			if( dist < SPAWN_CLEAR_RADIUS * SPAWN_CLEAR_RADIUS )
+			{
+				occupied = TRUE;
+				break;
+			}
+
+			if( g_pGameRules->PlayerRelationship( pPlayer, pOther ) == GR_TEAMMATE )
+				continue;
+
+			if( dist < nearest )
+				nearest = dist;
+		}
+
+		if( occupied )
+			continue;
+
+		candidates[numCandidates] = i;
+		scores[numCandidates] = nearest;
+		numCandidates++;
+
+		if( nearest > best )
+			best = nearest;
+	}
+
+	if( !numCandidates )
+	{
+		// we haven't found a place to spawn yet, so kill any guy at a random spot and spawn there
+		for( i = 0; i < m_iCount; i++ )
+		{
+			int spot = RANDOM_LONG( 0, m_iCount - 1 );
+
+			if( !m_hSpots[spot] )
+				continue;
+
+			ClearSpot( pPlayer, spot );
+			return m_hSpots[spot];
+		}
+
+		return NULL;
+	}
+
+	// keep some randomness, but prefer spots far away from enemies
+	if( spawnweighted.value )
+	{
+		float threshold = best * SPAWN_SCORE_SLACK;
+
+		for( i = j = 0; i < numCandidates; i++ )
+		{
+			if( scores[i] >= threshold )
+				candidates[j++] = candidates[i];
+		}
+
+		numCandidates = j;
+	}
+
+	return m_hSpots[candidates[RANDOM_LONG( 0, numCandidates - 1 )]];
+}
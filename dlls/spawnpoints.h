@@ -0,0 +1,40 @@
+/***
+*
+*   Deathmatch spawn point registry
+*
+***/
+#pragma once
+#if !defined(SPAWNPOINTS_H)
+#define SPAWNPOINTS_H
+
+#define MAX_SPAWN_POINTS	256
+#define SPAWN_CLEAR_RADIUS	128.0f	// no other live player may be this close to the spot
+#define SPAWN_SCORE_SLACK	0.5f	// pick among spots at least this good, in squared distance, as the best one
+
+//=========================================================
+// CSpawnPoints - dense array of info_player_deathmatch spots
+// collected once at ServerActivate.  Occupancy and enemy
+// distance only look at the active player roster, so respawning
+// doesn't depend on the number of edicts.
+//=========================================================
+class CSpawnPoints
+{
+public:
+	void Clear( void );
+	void Build( void );
+
+	int Count( void ) { return m_iCount; }
+
+	// NULL if the map has no deathmatch spots
+	CBaseEntity *SelectDeathmatch( CBasePlayer *pPlayer );
+
+private:
+	void ClearSpot( CBasePlayer *pPlayer, int spot );
+
+	EHANDLE m_hSpots[MAX_SPAWN_POINTS];
+	Vector m_vecOrigins[MAX_SPAWN_POINTS];
+	int m_iCount;
+};
+
+extern CSpawnPoints g_SpawnPoints;
+#endif // SPAWNPOINTS_H
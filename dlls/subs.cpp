@@ -97,12 +97,14 @@ void CBaseEntity::UpdateOnRemove( void )
 		// the graph since we are removing it from the world.
 		for( i = 0; i < WorldGraph.m_cLinks; i++ )
 		{
-			if( WorldGraph.m_pLinkPool[i].m_pLinkEnt == pev )
+			if( WorldGraph.m_pLinkPool[i].m_iLinkEnt == entindex() )
 			{
 				// if this link has a link ent which is the same ent that is removing itself, remove it!
-				WorldGraph.m_pLinkPool[i].m_pLinkEnt = NULL;
+				WorldGraph.m_pLinkPool[i].m_iLinkEnt = 0;
 			}
 		}
+
+		WorldGraph.InvalidatePathCache();
 	}
 
 	if( pev->globalname )
@@ -24,6 +24,7 @@
 #include	"gamerules.h"
 #include	"teamplay_gamerules.h"
 #include	"game.h"
+#include	"playerroster.h"
 
 static char team_names[MAX_TEAMS][MAX_TEAMNAME_LENGTH];
 static int team_scores[MAX_TEAMS];
@@ -243,10 +244,10 @@ void CHalfLifeTeamplay::InitHUD( CBasePlayer *pPlayer )
 	RecountTeams();
 	// update this player with all the other players team info
 	// loop through all active players and send their team info to the new client
-	for( i = 1; i <= gpGlobals->maxClients; i++ )
+	for( i = 0; i < g_PlayerRoster.Count(); i++ )
 	{
-		CBaseEntity *plr = UTIL_PlayerByIndex( i );
-		if( plr && IsValidTeam( plr->TeamID() ) )
+		CBasePlayer *plr = g_PlayerRoster.Player( i );
+		if( IsValidTeam( plr->TeamID() ) )
 		{
 			MESSAGE_BEGIN( MSG_ONE, gmsgTeamInfo, NULL, pPlayer->edict() );
 				WRITE_BYTE( plr->entindex() );
@@ -286,6 +287,7 @@ void CHalfLifeTeamplay::ChangePlayerTeam( CBasePlayer *pPlayer, const char *pTea
 	// copy out the team name from the model
 	if( pPlayer->m_szTeamName != pTeamName )
 		strlcpy( pPlayer->m_szTeamName, pTeamName, TEAM_NAME_LENGTH );
+	g_PlayerRoster.UpdateTeams();
 	g_engfuncs.pfnSetClientKeyValue( clientIndex, g_engfuncs.pfnGetInfoKeyBuffer( pPlayer->edict() ), "model", pPlayer->m_szTeamName );
 	g_engfuncs.pfnSetClientKeyValue( clientIndex, g_engfuncs.pfnGetInfoKeyBuffer( pPlayer->edict() ), "team", pPlayer->m_szTeamName );
 
@@ -517,28 +519,16 @@ const char *CHalfLifeTeamplay::TeamWithFewestPlayers( void )
 {
 	int i;
 	int minPlayers = MAX_TEAMS;
-	int teamCount[MAX_TEAMS] = {0};
 	char *pTeamName = NULL;
 
-	// loop through all clients, count number of players on each team
-	for( i = 1; i <= gpGlobals->maxClients; i++ )
-	{
-		CBaseEntity *plr = UTIL_PlayerByIndex( i );
-
-		if( plr )
-		{
-			int team = GetTeamIndex( plr->TeamID() );
-			if( team >= 0 )
-				teamCount[team]++;
-		}
-	}
-
 	// Find team with least players
 	for( i = 0; i < num_teams; i++ )
 	{
-		if( teamCount[i] < minPlayers )
+		int teamCount = g_PlayerRoster.TeamCount( i );
+
+		if( teamCount < minPlayers )
 		{
-			minPlayers = teamCount[i];
+			minPlayers = teamCount;
 			pTeamName = team_names[i];
 		}
 	}
@@ -581,44 +571,44 @@ void CHalfLifeTeamplay::RecountTeams( bool bResendInfo )
 	memset( team_scores, 0, sizeof(team_scores) );
 
 	// loop through all clients
-	for( int i = 1; i <= gpGlobals->maxClients; i++ )
+	for( int i = 0; i < g_PlayerRoster.Count(); i++ )
 	{
-		CBaseEntity *plr = UTIL_PlayerByIndex( i );
+		CBasePlayer *plr = g_PlayerRoster.Player( i );
 
-		if( plr )
-		{
-			const char *pTeamName = plr->TeamID();
-
-			// try add to existing team
-			int tm = GetTeamIndex( pTeamName );
-
-			if( tm < 0 ) // no team match found
-			{ 
-				if( !m_teamLimit )
-				{
-					// add to new team
-					tm = num_teams;
-					num_teams++;
-					team_scores[tm] = 0;
-					strlcpy( team_names[tm], pTeamName, MAX_TEAMNAME_LENGTH );
-				}
-			}
+		const char *pTeamName = plr->TeamID();
 
-			if( tm >= 0 )
+		// try add to existing team
+		int tm = GetTeamIndex( pTeamName );
+
+		if( tm < 0 ) // no team match found
+		{ 
+			if( !m_teamLimit )
 			{
-				team_scores[tm] += (int)plr->pev->frags;
+				// add to new team
+				tm = num_teams;
+				num_teams++;
+				team_scores[tm] = 0;
+				strlcpy( team_names[tm], pTeamName, MAX_TEAMNAME_LENGTH );
 			}
+		}
+
+		if( tm >= 0 )
+		{
+			team_scores[tm] += (int)plr->pev->frags;
+		}
 
-			if( bResendInfo ) //Someone's info changed, let's send the team info again.
+		if( bResendInfo ) //Someone's info changed, let's send the team info again.
+		{
+			if( IsValidTeam( plr->TeamID() ) )
 			{
-				if( plr && IsValidTeam( plr->TeamID() ) )
-				{
-					MESSAGE_BEGIN( MSG_ALL, gmsgTeamInfo, NULL );
-						WRITE_BYTE( plr->entindex() );
-						WRITE_STRING( plr->TeamID() );
-					MESSAGE_END();
-				}
+				MESSAGE_BEGIN( MSG_ALL, gmsgTeamInfo, NULL );
+					WRITE_BYTE( plr->entindex() );
+					WRITE_STRING( plr->TeamID() );
+				MESSAGE_END();
 			}
 		}
 	}
+
+	// team indexes may have changed
+	g_PlayerRoster.UpdateTeams();
 }
@@ -30,6 +30,8 @@
 #include "player.h"
 #include "weapons.h"
 #include "gamerules.h"
+#include "spatialindex.h"
+#include "nameregistry.h"
 
 float UTIL_WeaponTimeBase( void )
 {
@@ -394,31 +396,67 @@ void UTIL_MoveToOrigin( edict_t *pent, const Vector &vecGoal, float flDist, int
 	MOVE_TO_ORIGIN( pent, rgfl, flDist, iMoveType ); 
 }
 
+static inline BOOL UTIL_EdictInBox( edict_t *pEdict, const Vector &mins, const Vector &maxs, int flagMask )
+{
+	if( pEdict->free )	// Not in use
+		return FALSE;
+
+	if( flagMask && !( pEdict->v.flags & flagMask ) )	// Does it meet the criteria?
+		return FALSE;
+
+	if( mins.x > pEdict->v.absmax.x ||
+		mins.y > pEdict->v.absmax.y ||
+		mins.z > pEdict->v.absmax.z ||
+		maxs.x < pEdict->v.absmin.x ||
+		maxs.y < pEdict->v.absmin.y ||
+		maxs.z < pEdict->v.absmin.z )
+		return FALSE;
+
+	return TRUE;
+}
+
 int UTIL_EntitiesInBox( CBaseEntity **pList, int listMax, const Vector &mins, const Vector &maxs, int flagMask )
 {
-	edict_t *pEdict = g_engfuncs.pfnPEntityOfEntIndex( 1 );
+	edict_t *pEdict;
 	CBaseEntity *pEntity;
+	const int *pCandidates;
 	int count;
 
 	count = 0;
 
+	int numCandidates = g_SpatialIndex.Query( mins, maxs, &pCandidates );
+
+	if( numCandidates >= 0 )
+	{
+		for( int i = 0; i < numCandidates; i++ )
+		{
+			pEdict = g_SpatialIndex.Edict( pCandidates[i] );
+
+			if( !UTIL_EdictInBox( pEdict, mins, maxs, flagMask ) )
+				continue;
+
+			pEntity = CBaseEntity::Instance( pEdict );
+			if( !pEntity )
+				continue;
+
+			pList[count] = pEntity;
+			count++;
+
+			if( count >= listMax )
+				return count;
+		}
+
+		return count;
+	}
+
+	pEdict = g_engfuncs.pfnPEntityOfEntIndex( 1 );
+
 	if( !pEdict )
 		return count;
 
 	for( int i = 1; i < gpGlobals->maxEntities; i++, pEdict++ )
 	{
-		if( pEdict->free )	// Not in use
-			continue;
-
-		if( flagMask && !( pEdict->v.flags & flagMask ) )	// Does it meet the criteria?
-			continue;
-
-		if( mins.x > pEdict->v.absmax.x ||
-			mins.y > pEdict->v.absmax.y ||
-			mins.z > pEdict->v.absmax.z ||
-			maxs.x < pEdict->v.absmin.x ||
-			maxs.y < pEdict->v.absmin.y ||
-			maxs.z < pEdict->v.absmin.z )
+		if( !UTIL_EdictInBox( pEdict, mins, maxs, flagMask ) )
 			continue;
 
 		pEntity = CBaseEntity::Instance( pEdict );
@@ -435,50 +473,90 @@ int UTIL_EntitiesInBox( CBaseEntity **pList, int listMax, const Vector &mins, co
 	return count;
 }
 
+static inline BOOL UTIL_EdictInSphere( edict_t *pEdict, const Vector &center, float radiusSquared )
+{
+	float distance, delta;
+
+	if( pEdict->free )	// Not in use
+		return FALSE;
+
+	if( !( pEdict->v.flags & ( FL_CLIENT | FL_MONSTER ) ) )	// Not a client/monster ?
+		return FALSE;
+
+	// Use origin for X & Y since they are centered for all monsters
+	// Now X
+	delta = center.x - pEdict->v.origin.x;//( pEdict->v.absmin.x + pEdict->v.absmax.x ) * 0.5f;
+	delta *= delta;
+
+	if( delta > radiusSquared )
+		return FALSE;
+	distance = delta;
+
+	// Now Y
+	delta = center.y - pEdict->v.origin.y;//( pEdict->v.absmin.y + pEdict->v.absmax.y ) * 0.5f;
+	delta *= delta;
+
+	distance += delta;
+	if( distance > radiusSquared )
+		return FALSE;
+
+	// Now Z
+	delta = center.z - ( pEdict->v.absmin.z + pEdict->v.absmax.z ) * 0.5f;
+	delta *= delta;
+
+	distance += delta;
+	if( distance > radiusSquared )
+		return FALSE;
+
+	return TRUE;
+}
+
 int UTIL_MonstersInSphere( CBaseEntity **pList, int listMax, const Vector &center, float radius )
 {
-	edict_t *pEdict = g_engfuncs.pfnPEntityOfEntIndex( 1 );
+	edict_t *pEdict;
 	CBaseEntity *pEntity;
+	const int *pCandidates;
 	int		count;
-	float		distance, delta;
 
 	count = 0;
 	float radiusSquared = radius * radius;
 
-	if( !pEdict )
-		return count;
+	// origin is always inside absmin/absmax, so the bounding box of the sphere
+	// catches every edict the distance test below can accept
+	Vector delta( radius, radius, radius );
+	int numCandidates = g_SpatialIndex.Query( center - delta, center + delta, &pCandidates );
 
-	for( int i = 1; i < gpGlobals->maxEntities; i++, pEdict++ )
+	if( numCandidates >= 0 )
 	{
-		if( pEdict->free )	// Not in use
-			continue;
+		for( int i = 0; i < numCandidates; i++ )
+		{
+			pEdict = g_SpatialIndex.Edict( pCandidates[i] );
 
-		if( !( pEdict->v.flags & ( FL_CLIENT | FL_MONSTER ) ) )	// Not a client/monster ?
-			continue;
+			if( !UTIL_EdictInSphere( pEdict, center, radiusSquared ) )
+				continue;
 
-		// Use origin for X & Y since they are centered for all monsters
-		// Now X
-		delta = center.x - pEdict->v.origin.x;//( pEdict->v.absmin.x + pEdict->v.absmax.x ) * 0.5f;
-		delta *= delta;
+			pEntity = CBaseEntity::Instance( pEdict );
+			if( !pEntity )
+				continue;
 
-		if( delta > radiusSquared )
-			continue;
-		distance = delta;
+			pList[count] = pEntity;
+			count++;
 
-		// Now Y
-		delta = center.y - pEdict->v.origin.y;//( pEdict->v.absmin.y + pEdict->v.absmax.y ) * 0.5f;
-		delta *= delta;
+			if( count >= listMax )
+				return count;
+		}
 
-		distance += delta;
-		if( distance > radiusSquared )
-			continue;
+		return count;
+	}
+
+	pEdict = g_engfuncs.pfnPEntityOfEntIndex( 1 );
 
-		// Now Z
-		delta = center.z - ( pEdict->v.absmin.z + pEdict->v.absmax.z ) * 0.5f;
-		delta *= delta;
+	if( !pEdict )
+		return count;
 
-		distance += delta;
-		if( distance > radiusSquared )
+	for( int i = 1; i < gpGlobals->maxEntities; i++, pEdict++ )
+	{
+		if( !UTIL_EdictInSphere( pEdict, center, radiusSquared ) )
 			continue;
 
 		pEntity = CBaseEntity::Instance( pEdict );
@@ -520,7 +598,12 @@ CBaseEntity *UTIL_FindEntityByString( CBaseEntity *pStartEntity, const char *szK
 	else
 		pentEntity = NULL;
 
-	pentEntity = FIND_ENTITY_BY_STRING( pentEntity, szKeyword, szValue );
+	if( FStrEq( szKeyword, "classname" ))
+		pentEntity = FIND_ENTITY_BY_CLASSNAME( pentEntity, szValue );
+	else if( FStrEq( szKeyword, "targetname" ))
+		pentEntity = FIND_ENTITY_BY_TARGETNAME( pentEntity, szValue );
+	else
+		pentEntity = FIND_ENTITY_BY_STRING( pentEntity, szKeyword, szValue );
 
 	if( !FNullEnt( pentEntity ) )
 		return CBaseEntity::Instance( pentEntity );
@@ -529,12 +612,30 @@ CBaseEntity *UTIL_FindEntityByString( CBaseEntity *pStartEntity, const char *szK
 
 CBaseEntity *UTIL_FindEntityByClassname( CBaseEntity *pStartEntity, const char *szName )
 {
-	return UTIL_FindEntityByString( pStartEntity, "classname", szName );
+	edict_t *pentEntity = FIND_ENTITY_BY_CLASSNAME( pStartEntity ? pStartEntity->edict() : NULL, szName );
+
+	if( !FNullEnt( pentEntity ) )
+		return CBaseEntity::Instance( pentEntity );
+	return NULL;
 }
 
 CBaseEntity *UTIL_FindEntityByTargetname( CBaseEntity *pStartEntity, const char *szName )
 {
-	return UTIL_FindEntityByString( pStartEntity, "targetname", szName );
+	edict_t *pentEntity = FIND_ENTITY_BY_TARGETNAME( pStartEntity ? pStartEntity->edict() : NULL, szName );
+
+	if( !FNullEnt( pentEntity ) )
+		return CBaseEntity::Instance( pentEntity );
+	return NULL;
+}
+
+edict_t *UTIL_FindEdictByName( int field, edict_t *entStart, const char *pszName )
+{
+	return g_NameRegistry.Find( field, entStart, pszName );
+}
+
+void UTIL_NameRegistryTouch( edict_t *pent )
+{
+	g_NameRegistry.Touch( pent );
 }
 
 CBaseEntity *UTIL_FindEntityGeneric( const char *szWhatever, Vector &vecSrc, float flRadius )
@@ -1499,6 +1600,7 @@ void UTIL_Remove( CBaseEntity *pEntity )
 	pEntity->UpdateOnRemove();
 	pEntity->pev->flags |= FL_KILLME;
 	pEntity->pev->targetname = 0;
+	g_NameRegistry.Update( pEntity->edict() );
 }
 
 BOOL UTIL_IsValidEntity( edict_t *pent )
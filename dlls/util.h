@@ -48,14 +48,22 @@ static inline int MAKE_STRING(const char *szValue)
 }
 #endif
 
+// classname and targetname searches go through the DLL side hash tables in nameregistry.cpp
+#define NAMEREG_CLASSNAME	0
+#define NAMEREG_TARGETNAME	1
+#define NAMEREG_FIELDS		2
+
+extern edict_t *UTIL_FindEdictByName( int field, edict_t *entStart, const char *pszName );
+extern void UTIL_NameRegistryTouch( edict_t *pent );
+
 inline edict_t *FIND_ENTITY_BY_CLASSNAME(edict_t *entStart, const char *pszName) 
 {
-	return FIND_ENTITY_BY_STRING(entStart, "classname", pszName);
+	return UTIL_FindEdictByName(NAMEREG_CLASSNAME, entStart, pszName);
 }
 
 inline edict_t *FIND_ENTITY_BY_TARGETNAME(edict_t *entStart, const char *pszName) 
 {
-	return FIND_ENTITY_BY_STRING(entStart, "targetname", pszName);
+	return UTIL_FindEdictByName(NAMEREG_TARGETNAME, entStart, pszName);
 }
 
 // for doing a reverse lookup. Say you have a door, and want to find its button.
@@ -30,6 +30,7 @@
 #include "soundent.h"
 #include "decals.h"
 #include "gamerules.h"
+#include "playerstate.h"
 
 extern CGraph WorldGraph;
 extern int gEvilImpulse101;
@@ -49,8 +50,6 @@ DLL_GLOBAL	short g_sModelIndexBloodSpray;// holds the sprite index for splattere
 ItemInfo CBasePlayerItem::ItemInfoArray[MAX_WEAPONS];
 AmmoInfo CBasePlayerItem::AmmoInfoArray[MAX_AMMO_SLOTS];
 
-extern int gmsgCurWeapon;
-
 MULTIDAMAGE gMultiDamage;
 
 #define TRACER_FREQ		4			// Tracers fire every fourth bullet
@@ -89,45 +88,73 @@ Collects multiple small damages into a single damage
 //
 void ClearMultiDamage( void )
 {
-	gMultiDamage.pEntity = NULL;
-	gMultiDamage.amount = 0;
+	gMultiDamage.count = 0;
 	gMultiDamage.type = 0;
+	gMultiDamage.pevInflictor = NULL;
 }
 
 //
-// ApplyMultiDamage - inflicts contents of global multi damage register on gMultiDamage.pEntity
+// ApplyMultiDamage - inflicts the damage collected for each victim in gMultiDamage,
+// one TakeDamage per victim in the order they were first hit
 //
 // GLOBALS USED:
 //		gMultiDamage
 void ApplyMultiDamage( entvars_t *pevInflictor, entvars_t *pevAttacker )
 {
-	Vector vecSpot1;//where blood comes from
-	Vector vecDir;//direction blood should go
-	TraceResult tr;
+	MULTIDAMAGEVICTIM victims[MAX_MULTIDAMAGE];
+	int count = gMultiDamage.count;
+	int type = gMultiDamage.type;
 
-	if( !gMultiDamage.pEntity )
+	if( !count )
 		return;
 
-	gMultiDamage.pEntity->TakeDamage( pevInflictor, pevAttacker, gMultiDamage.amount, gMultiDamage.type );
+	// TakeDamage can explode things and start another multi damage, so work on a copy
+	memcpy( victims, gMultiDamage.victims, count * sizeof( MULTIDAMAGEVICTIM ));
+	gMultiDamage.count = 0;
+
+	for( int i = 0; i < count; i++ )
+		victims[i].pEntity->TakeDamage( pevInflictor, pevAttacker, victims[i].amount, victims[i].type | type );
 }
 
 // GLOBALS USED:
 //		gMultiDamage
 void AddMultiDamage( entvars_t *pevInflictor, CBaseEntity *pEntity, float flDamage, int bitsDamageType )
 {
+	MULTIDAMAGEVICTIM *pVictim;
+	int i;
+
 	if( !pEntity )
 		return;
 
-	gMultiDamage.type |= bitsDamageType;
+	for( i = 0; i < gMultiDamage.count; i++ )
+	{
+		if( gMultiDamage.victims[i].pEntity == pEntity )
+			break;
+	}
+
+	if( i == MAX_MULTIDAMAGE )
+	{
+		// out of room, hurt everyone collected so far and start over
+		int type = gMultiDamage.type;
+
+		ApplyMultiDamage( gMultiDamage.pevInflictor, gMultiDamage.pevInflictor ); // UNDONE: wrong attacker!
+		gMultiDamage.type = type;
+		i = gMultiDamage.count;
+	}
+
+	pVictim = &gMultiDamage.victims[i];
 
-	if( pEntity != gMultiDamage.pEntity )
+	if( i == gMultiDamage.count )
 	{
-		ApplyMultiDamage( pevInflictor,pevInflictor ); // UNDONE: wrong attacker!
-		gMultiDamage.pEntity = pEntity;
-		gMultiDamage.amount = 0;
+		pVictim->pEntity = pEntity;
+		pVictim->amount = 0;
+		pVictim->type = 0;
+		gMultiDamage.count++;
 	}
 
-	gMultiDamage.amount += flDamage;
+	pVictim->amount += flDamage;
+	pVictim->type |= bitsDamageType;
+	gMultiDamage.pevInflictor = pevInflictor;
 }
 
 /*
@@ -793,11 +820,7 @@ int CBasePlayerWeapon::UpdateClientData( CBasePlayer *pPlayer )
 
 	if( bSend )
 	{
-		MESSAGE_BEGIN( MSG_ONE, gmsgCurWeapon, NULL, pPlayer->pev );
-			WRITE_BYTE( state );
-			WRITE_BYTE( m_iId );
-			WRITE_BYTE( m_iClip );
-		MESSAGE_END();
+		g_PlayerStateMsg.CurWeapon( pPlayer, state, m_iId, m_iClip );
 
 		m_iClientClip = m_iClip;
 		m_iClientWeaponState = state;
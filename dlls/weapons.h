@@ -342,11 +342,21 @@ extern void SpawnBlood(Vector vecSpot, int bloodColor, float flDamage);
 extern int DamageDecal( CBaseEntity *pEntity, int bitsDamageType );
 extern void RadiusDamage( Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacker, float flDamage, float flRadius, int iClassIgnore, int bitsDamageType );
 
-typedef struct 
+#define MAX_MULTIDAMAGE		32	// victims held before the list is applied early
+
+typedef struct
 {
 	CBaseEntity		*pEntity;
 	float			amount;
 	int				type;
+} MULTIDAMAGEVICTIM;
+
+typedef struct 
+{
+	MULTIDAMAGEVICTIM	victims[MAX_MULTIDAMAGE];
+	int				count;
+	int				type;			// added to every victim
+	entvars_t		*pevInflictor;	// of the last AddMultiDamage, used when the list overflows
 } MULTIDAMAGE;
 
 extern MULTIDAMAGE gMultiDamage;
@@ -712,5 +722,8 @@ public:
 		return FALSE;
 	#endif
 	}
+
+private:
+	unsigned short m_usFireAwp;
 };
 #endif // WEAPONS_H
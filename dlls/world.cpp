@@ -33,6 +33,16 @@
 #include "weapons.h"
 #include "gamerules.h"
 #include "teamplay_gamerules.h"
+#include "spatialindex.h"
+#include "nameregistry.h"
+#include "spawnpoints.h"
+#include "playerroster.h"
+#include "lagcomp.h"
+#include "packcache.h"
+#include "netlod.h"
+#include "frameprof.h"
+#include "msgstats.h"
+#include "bot.h"
 
 extern CGraph WorldGraph;
 extern CSoundEnt *pSoundEnt;
@@ -459,6 +469,18 @@ void CWorld::Spawn( void )
 void CWorld::Precache( void )
 {
 	g_pLastSpawn = NULL;
+
+	// new edict list, forget whatever was linked on the previous map
+	g_SpatialIndex.Reset();
+	g_NameRegistry.Reset();
+	g_SpawnPoints.Clear();
+	g_PlayerRoster.Clear();
+	g_LagCompensation.Clear();
+	g_PackCache.Clear();
+	g_NetLOD.Clear();
+	g_FrameProf.Reset();
+	g_MessageStats.NewMap();
+	g_BotManager.NewMap();
 #if 1
 	CVAR_SET_STRING( "sv_gravity", "800" ); // 67ft/sec
 	CVAR_SET_STRING( "sv_stepsize", "18" );
@@ -9,8 +9,9 @@
 #define VOICE_COMMON_H
 
 #include "bitvec.h"
+#include "com_model.h"	// MAX_CLIENTS
 
-#define VOICE_MAX_PLAYERS		32	// (todo: this should just be set to MAX_CLIENTS).
+#define VOICE_MAX_PLAYERS		MAX_CLIENTS
 #define VOICE_MAX_PLAYERS_DW		((VOICE_MAX_PLAYERS / 32) + !!(VOICE_MAX_PLAYERS & 31))
 
 typedef CBitVec<VOICE_MAX_PLAYERS> CPlayerBitVec;
@@ -5,18 +5,18 @@
 // $NoKeywords: $
 //=============================================================================
 
-#include "archtypes.h"     // DAL
-#include "voice_gamemgr.h"
 #include <string.h>
 #include <assert.h>
 #include "extdll.h"
 #include "util.h"
 #include "cbase.h"
 #include "player.h"
+#include "playerroster.h"
+#include "voice_gamemgr.h"
 
 
 
-#define UPDATE_INTERVAL	0.3
+#define UPDATE_INTERVAL	0.3	// how often clients that haven't sent VModEnable are asked for it
 
 
 // These are stored off as CVoiceGameMgr is created and deleted.
@@ -32,6 +32,9 @@ CPlayerBitVec	g_SentGameRulesMasks[VOICE_MAX_PLAYERS];	// These store the masks
 CPlayerBitVec	g_SentBanMasks[VOICE_MAX_PLAYERS];			// we need to resend them.
 CPlayerBitVec	g_bWantModEnable;
 
+CPlayerBitVec	g_SentListenMasks[VOICE_MAX_PLAYERS];		// What the engine was last told each client can hear.
+CPlayerBitVec	g_ForceListenMasks[VOICE_MAX_PLAYERS];		// Pairs the engine has to be told again, whatever was sent.
+
 cvar_t voice_serverdebug = {"voice_serverdebug", "0"};
 
 // Set game rules to allow all clients to talk to each other.
@@ -92,6 +95,9 @@ CVoiceGameMgr::CVoiceGameMgr()
 {
 	m_UpdateInterval = 0;
 	m_nMaxPlayers = 0;
+	m_bMasksDirty = true;
+	m_bAllTalk = false;
+	m_iRosterSerial = 0;
 }
 
 
@@ -110,6 +116,8 @@ bool CVoiceGameMgr::Init(
 
 	m_msgPlayerVoiceMask = REG_USER_MSG( "VoiceMask", VOICE_MAX_PLAYERS_DW*4 * 2 );
 	m_msgRequestState = REG_USER_MSG( "ReqState", 0 );
+
+	m_bMasksDirty = true;
 	
 	// register voice_serverdebug if it hasn't been registered already
 	if ( !CVAR_GET_POINTER( "voice_serverdebug" ) )
@@ -130,23 +138,45 @@ void CVoiceGameMgr::SetHelper(IVoiceGameMgrHelper *pHelper)
 
 void CVoiceGameMgr::Update(double frametime)
 {
-	// Only update periodically.
+	if(g_PlayerRoster.Serial() != m_iRosterSerial)
+	{
+		// Ask anyone who just came in right away.
+		m_bMasksDirty = true;
+		m_UpdateInterval = UPDATE_INTERVAL;
+	}
+
+	if(m_bAllTalk != !!(sv_alltalk.value))
+		m_bMasksDirty = true;
+
+	if(m_bMasksDirty)
+		UpdateMasks();
+
 	m_UpdateInterval += frametime;
 	if(m_UpdateInterval < UPDATE_INTERVAL)
 		return;
 
-	UpdateMasks();
+	m_UpdateInterval = 0;
+	RequestState();
 }
 
 
 void CVoiceGameMgr::ClientConnected(edict_t *pEdict)
 {
 	int index = ENTINDEX(pEdict) - 1;
+	if(index < 0 || index >= m_nMaxPlayers)
+		return;
 	
 	// Clear out everything we use for deltas on this guy.
 	g_bWantModEnable[index] = true;
 	g_SentGameRulesMasks[index].Init(0);
 	g_SentBanMasks[index].Init(0);
+
+	// The engine may still have the last client in this slot, tell it everything again.
+	g_ForceListenMasks[index].Init(1);
+	for(int i=0; i < m_nMaxPlayers; i++)
+		g_ForceListenMasks[i][index] = 1;
+
+	m_bMasksDirty = true;
 }
 
 // Called to determine if the Receiver has muted (blocked) the Sender
@@ -181,13 +211,17 @@ bool CVoiceGameMgr::ClientCommand(CBasePlayer *pPlayer, const char *cmd)
 	{
 		for(int i=1; i < CMD_ARGC(); i++)
 		{
-			uint32 mask = 0;
+			unsigned int mask = 0;
 			sscanf(CMD_ARGV(i), "%x", &mask);
 
 			if(i <= VOICE_MAX_PLAYERS_DW)
 			{
 				VoiceServerDebug( "CVoiceGameMgr::ClientCommand: vban (0x%x) from %d\n", mask, playerClientIndex );
-				g_BanMasks[playerClientIndex].SetDWord(i-1, mask);
+				if(g_BanMasks[playerClientIndex].GetDWord(i-1) != mask)
+				{
+					g_BanMasks[playerClientIndex].SetDWord(i-1, mask);
+					m_bMasksDirty = true;
+				}
 			}
 			else
 			{
@@ -195,8 +229,6 @@ bool CVoiceGameMgr::ClientCommand(CBasePlayer *pPlayer, const char *cmd)
 			}
 		}
 
-		// Force it to update the masks now.
-		// UpdateMasks();		
 		return true;
 	}
 	else if(stricmp(cmd, "VModEnable") == 0 && CMD_ARGC() >= 2)
@@ -204,7 +236,7 @@ bool CVoiceGameMgr::ClientCommand(CBasePlayer *pPlayer, const char *cmd)
 		VoiceServerDebug( "CVoiceGameMgr::ClientCommand: VModEnable (%d)\n", !!atoi(CMD_ARGV(1)) );
 		g_PlayerModEnable[playerClientIndex] = !!atoi(CMD_ARGV(1));
 		g_bWantModEnable[playerClientIndex] = false;
-		// UpdateMasks();
+		m_bMasksDirty = true;
 		return true;
 	}
 	else
@@ -214,37 +246,92 @@ bool CVoiceGameMgr::ClientCommand(CBasePlayer *pPlayer, const char *cmd)
 }
 
 
-void CVoiceGameMgr::UpdateMasks()
+void CVoiceGameMgr::RequestState()
 {
-	m_UpdateInterval = 0;
+	int dw;
+	for(dw=0; dw < VOICE_MAX_PLAYERS_DW; dw++)
+	{
+		if(g_bWantModEnable.GetDWord(dw))
+			break;
+	}
 
-	bool bAllTalk = !!(sv_alltalk.value);
+	if(dw == VOICE_MAX_PLAYERS_DW)
+		return;
 
-	for(int iClient=0; iClient < m_nMaxPlayers; iClient++)
+	for(int i=0; i < g_PlayerRoster.Count(); i++)
 	{
-		CBaseEntity *pEnt = UTIL_PlayerByIndex(iClient+1);
-		if(!pEnt || !pEnt->IsPlayer())
-			continue;
+		CBasePlayer *pPlayer = g_PlayerRoster.Player(i);
+		int iClient = pPlayer->entindex() - 1;
 
 		// Request the state of their "VModEnable" cvar.
-		if(g_bWantModEnable[iClient])
+		if(iClient < m_nMaxPlayers && g_bWantModEnable[iClient])
 		{
-			MESSAGE_BEGIN(MSG_ONE, m_msgRequestState, NULL, pEnt->pev);
+			MESSAGE_BEGIN(MSG_ONE, m_msgRequestState, NULL, pPlayer->pev);
 			MESSAGE_END();
 		}
+	}
+}
 
-		CBasePlayer *pPlayer = (CBasePlayer*)pEnt;
+
+void CVoiceGameMgr::UpdateMasks()
+{
+	m_bMasksDirty = false;
+	m_bAllTalk = !!(sv_alltalk.value);
+	m_iRosterSerial = g_PlayerRoster.Serial();
+
+	// Everyone in a voice group hears the same players, so build one mask per group.
+	CPlayerBitVec allMask;
+	CPlayerBitVec groupMasks[VOICE_MAX_GROUPS];
+	int groups[VOICE_MAX_PLAYERS];
+
+	int i;
+	for(i=0; i < g_PlayerRoster.Count(); i++)
+	{
+		CBasePlayer *pPlayer = g_PlayerRoster.Player(i);
+		int iClient = pPlayer->entindex() - 1;
+		if(iClient >= m_nMaxPlayers)
+			continue;
+
+		int group = m_bAllTalk ? VOICE_GROUP_ALL : m_pHelper->GetPlayerVoiceGroup(pPlayer);
+		if(group >= VOICE_MAX_GROUPS || group < VOICE_GROUP_NONE)
+			group = VOICE_GROUP_NONE;
+
+		allMask[iClient] = 1;
+		if(group >= 0)
+			groupMasks[group][iClient] = 1;
+
+		groups[iClient] = group;
+	}
+
+	for(i=0; i < g_PlayerRoster.Count(); i++)
+	{
+		CBasePlayer *pPlayer = g_PlayerRoster.Player(i);
+		int iClient = pPlayer->entindex() - 1;
+		if(iClient >= m_nMaxPlayers)
+			continue;
 
 		CPlayerBitVec gameRulesMask;
 		if( g_PlayerModEnable[iClient] )
 		{
 			// Build a mask of who they can hear based on the game rules.
-			for(int iOtherClient=0; iOtherClient < m_nMaxPlayers; iOtherClient++)
+			if(groups[iClient] == VOICE_GROUP_ALL)
+			{
+				gameRulesMask = allMask;
+			}
+			else if(groups[iClient] >= 0)
 			{
-				CBaseEntity *pEnt = UTIL_PlayerByIndex(iOtherClient+1);
-				if(pEnt && (bAllTalk || m_pHelper->CanPlayerHearPlayer(pPlayer, (CBasePlayer*)pEnt)) )
+				gameRulesMask = groupMasks[groups[iClient]];
+			}
+			else
+			{
+				for(int j=0; j < g_PlayerRoster.Count(); j++)
 				{
-					gameRulesMask[iOtherClient] = true;
+					CBasePlayer *pOther = g_PlayerRoster.Player(j);
+					int iOtherClient = pOther->entindex() - 1;
+					if(iOtherClient < m_nMaxPlayers && m_pHelper->CanPlayerHearPlayer(pPlayer, pOther))
+					{
+						gameRulesMask[iOtherClient] = true;
+					}
 				}
 			}
 		}
@@ -266,11 +353,20 @@ void CVoiceGameMgr::UpdateMasks()
 			MESSAGE_END();
 		}
 
-		// Tell the engine.
-		for(int iOtherClient=0; iOtherClient < m_nMaxPlayers; iOtherClient++)
+		// Tell the engine about the pairs that changed.
+		for(int dw=0; dw < VOICE_MAX_PLAYERS_DW; dw++)
 		{
-			bool bCanHear = gameRulesMask[iOtherClient] && !g_BanMasks[iClient][iOtherClient];
-			g_engfuncs.pfnVoice_SetClientListening(iClient+1, iOtherClient+1, bCanHear);
+			unsigned long canHear = gameRulesMask.GetDWord(dw) & ~g_BanMasks[iClient].GetDWord(dw);
+			unsigned long changed = (canHear ^ g_SentListenMasks[iClient].GetDWord(dw)) | g_ForceListenMasks[iClient].GetDWord(dw);
+
+			for(int iOtherClient=dw*32; changed && iOtherClient < m_nMaxPlayers; iOtherClient++, changed >>= 1)
+			{
+				if(changed & 1)
+					g_engfuncs.pfnVoice_SetClientListening(iClient+1, iOtherClient+1, (canHear >> (iOtherClient & 31)) & 1);
+			}
+
+			g_SentListenMasks[iClient].SetDWord(dw, canHear);
+			g_ForceListenMasks[iClient].SetDWord(dw, 0);
 		}
 	}
 }
@@ -19,6 +19,11 @@ class CGameRules;
 class CBasePlayer;
 
 
+#define VOICE_GROUP_ALL		-1	// hears every player
+#define VOICE_GROUP_NONE	-2	// CanPlayerHearPlayer is asked for each talker
+#define VOICE_MAX_GROUPS	32	// same as MAX_TEAMS
+
+
 class IVoiceGameMgrHelper
 {
 public:
@@ -27,6 +32,10 @@ public:
 	// Called each frame to determine which players are allowed to hear each other.	This overrides
 	// whatever squelch settings players have.
 	virtual bool		CanPlayerHearPlayer(CBasePlayer *pListener, CBasePlayer *pTalker) = 0;
+
+	// Players can hear exactly the players in their own voice group (usually their team), so the
+	// masks can be built once per group instead of once per pair. Must agree with CanPlayerHearPlayer.
+	virtual int			GetPlayerVoiceGroup(CBasePlayer *pPlayer) { return VOICE_GROUP_NONE; }
 };
 
 
@@ -48,6 +57,8 @@ public:
 	// If gameplay mode is DM, then only players within the PVS can hear each other.
 	// If gameplay mode is teamplay, then only players on the same team can hear each other.
 	// Player masks are always applied.
+	// The masks are only rebuilt after something they depend on changed: a player joining, leaving
+	// or changing teams (see CPlayerRoster::Serial), a ban list, VModEnable or sv_alltalk.
 	void				Update(double frametime);
 
 	// Called when a new client connects (unsquelches its entity for everyone).
@@ -67,13 +78,20 @@ private:
 	// Force it to update the client masks.
 	void				UpdateMasks();
 
+	// Ask clients that haven't reported their VModEnable yet.
+	void				RequestState();
+
 
 	int					m_msgPlayerVoiceMask;
 	int					m_msgRequestState;
 
 	IVoiceGameMgrHelper	*m_pHelper;
 	int					m_nMaxPlayers;
-	double				m_UpdateInterval;						// How long since the last update.
+	double				m_UpdateInterval;						// How long since the last state request.
+
+	bool				m_bMasksDirty;
+	bool				m_bAllTalk;								// sv_alltalk and roster serial the masks were built for
+	int					m_iRosterSerial;
 };
 
 
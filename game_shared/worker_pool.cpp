@@ -0,0 +1,326 @@
+//========= Copyright (c) 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Small pool of worker threads for parallel jobs
+//
+// $NoKeywords: $
+//=============================================================================
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "worker_pool.h"
+
+CWorkerPool g_WorkerPool;
+
+typedef struct workerarg_s
+{
+	CWorkerPool	*pPool;
+	int		thread;
+} workerarg_t;
+
+#if _WIN32
+typedef struct workersys_s
+{
+	HANDLE		threads[WORKER_MAX_THREADS];
+	workerarg_t	args[WORKER_MAX_THREADS];
+	HANDLE		start;		// semaphore, one count per worker per job
+	HANDLE		done;		// set by the last worker to finish
+} workersys_t;
+
+static DWORD WINAPI Worker_ThreadMain( LPVOID arg )
+{
+	workerarg_t *pArg = (workerarg_t *)arg;
+
+	pArg->pPool->ThreadMain( pArg->thread );
+	return 0;
+}
+#else
+typedef struct workersys_s
+{
+	pthread_t	threads[WORKER_MAX_THREADS];
+	workerarg_t	args[WORKER_MAX_THREADS];
+	pthread_mutex_t	lock;
+	pthread_cond_t	start;
+	pthread_cond_t	done;
+	int		generation;	// bumped for every job
+} workersys_t;
+
+static void *Worker_ThreadMain( void *arg )
+{
+	workerarg_t *pArg = (workerarg_t *)arg;
+
+	pArg->pPool->ThreadMain( pArg->thread );
+	return NULL;
+}
+#endif
+
+// returns the new value
+static inline long Worker_Increment( volatile long *p )
+{
+#if _WIN32
+	return InterlockedIncrement( p );
+#else
+	return __sync_add_and_fetch( p, 1 );
+#endif
+}
+
+CWorkerMutex::CWorkerMutex( void )
+{
+#if _WIN32
+	m_pLock = malloc( sizeof( CRITICAL_SECTION ) );
+	InitializeCriticalSection( (CRITICAL_SECTION *)m_pLock );
+#else
+	m_pLock = malloc( sizeof( pthread_mutex_t ) );
+	pthread_mutex_init( (pthread_mutex_t *)m_pLock, NULL );
+#endif
+}
+
+CWorkerMutex::~CWorkerMutex( void )
+{
+#if _WIN32
+	DeleteCriticalSection( (CRITICAL_SECTION *)m_pLock );
+#else
+	pthread_mutex_destroy( (pthread_mutex_t *)m_pLock );
+#endif
+	free( m_pLock );
+}
+
+void CWorkerMutex::Lock( void )
+{
+#if _WIN32
+	EnterCriticalSection( (CRITICAL_SECTION *)m_pLock );
+#else
+	pthread_mutex_lock( (pthread_mutex_t *)m_pLock );
+#endif
+}
+
+void CWorkerMutex::Unlock( void )
+{
+#if _WIN32
+	LeaveCriticalSection( (CRITICAL_SECTION *)m_pLock );
+#else
+	pthread_mutex_unlock( (pthread_mutex_t *)m_pLock );
+#endif
+}
+
+CWorkerPool::CWorkerPool( void )
+{
+	m_iNumThreads = 0;
+	m_iStop = 0;
+	m_pfnJob = NULL;
+	m_pData = NULL;
+	m_iCount = 0;
+	m_iNext = 0;
+	m_iBusy = 0;
+	m_pSys = NULL;
+}
+
+int CWorkerPool::NumCPUs( void )
+{
+#if _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+	return (int)info.dwNumberOfProcessors;
+#else
+	long count = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return count > 0 ? (int)count : 1;
+#endif
+}
+
+void CWorkerPool::Start( int numthreads )
+{
+	workersys_t *sys;
+	int i;
+
+	Stop();
+
+	if( numthreads > WORKER_MAX_THREADS )
+		numthreads = WORKER_MAX_THREADS;
+
+	if( numthreads <= 0 )
+		return;
+
+	sys = (workersys_t *)calloc( 1, sizeof( workersys_t ) );
+	if( !sys )
+		return;
+
+	m_pSys = sys;
+	m_iStop = 0;
+
+#if _WIN32
+	sys->start = CreateSemaphore( NULL, 0, WORKER_MAX_THREADS, NULL );
+	sys->done = CreateEvent( NULL, FALSE, FALSE, NULL );
+#else
+	pthread_mutex_init( &sys->lock, NULL );
+	pthread_cond_init( &sys->start, NULL );
+	pthread_cond_init( &sys->done, NULL );
+#endif
+
+	for( i = 0; i < numthreads; i++ )
+	{
+		sys->args[i].pPool = this;
+		sys->args[i].thread = i + 1;
+#if _WIN32
+		sys->threads[i] = CreateThread( NULL, 0, Worker_ThreadMain, &sys->args[i], 0, NULL );
+		if( !sys->threads[i] )
+			break;
+#else
+		if( pthread_create( &sys->threads[i], NULL, Worker_ThreadMain, &sys->args[i] ) )
+			break;
+#endif
+	}
+
+	// whatever could be created
+	m_iNumThreads = i;
+}
+
+void CWorkerPool::Stop( void )
+{
+	workersys_t *sys = (workersys_t *)m_pSys;
+	int i;
+
+	if( !sys )
+		return;
+
+#if _WIN32
+	m_iStop = 1;
+	if( m_iNumThreads )
+	{
+		ReleaseSemaphore( sys->start, m_iNumThreads, NULL );
+		WaitForMultipleObjects( m_iNumThreads, sys->threads, TRUE, INFINITE );
+	}
+
+	for( i = 0; i < m_iNumThreads; i++ )
+		CloseHandle( sys->threads[i] );
+	CloseHandle( sys->start );
+	CloseHandle( sys->done );
+#else
+	pthread_mutex_lock( &sys->lock );
+	m_iStop = 1;
+	pthread_cond_broadcast( &sys->start );
+	pthread_mutex_unlock( &sys->lock );
+
+	for( i = 0; i < m_iNumThreads; i++ )
+		pthread_join( sys->threads[i], NULL );
+
+	pthread_cond_destroy( &sys->done );
+	pthread_cond_destroy( &sys->start );
+	pthread_mutex_destroy( &sys->lock );
+#endif
+
+	free( sys );
+	m_pSys = NULL;
+	m_iNumThreads = 0;
+}
+
+void CWorkerPool::Run( pfnWorkerJob pfnJob, void *data, int count )
+{
+	workersys_t *sys = (workersys_t *)m_pSys;
+	int i;
+
+	if( count <= 0 )
+		return;
+
+	if( !m_iNumThreads || count == 1 )
+	{
+		for( i = 0; i < count; i++ )
+			pfnJob( data, i, 0 );
+		return;
+	}
+
+	m_pfnJob = pfnJob;
+	m_pData = data;
+	m_iCount = count;
+	m_iNext = 0;
+
+#if _WIN32
+	m_iBusy = m_iNumThreads;
+	ReleaseSemaphore( sys->start, m_iNumThreads, NULL );
+
+	Work( 0 );
+
+	WaitForSingleObject( sys->done, INFINITE );
+#else
+	pthread_mutex_lock( &sys->lock );
+	m_iBusy = m_iNumThreads;
+	sys->generation++;
+	pthread_cond_broadcast( &sys->start );
+	pthread_mutex_unlock( &sys->lock );
+
+	Work( 0 );
+
+	pthread_mutex_lock( &sys->lock );
+	while( m_iBusy )
+		pthread_cond_wait( &sys->done, &sys->lock );
+	pthread_mutex_unlock( &sys->lock );
+#endif
+	m_pfnJob = NULL;
+	m_pData = NULL;
+}
+
+void CWorkerPool::Work( int thread )
+{
+	for( ;; )
+	{
+		long index = Worker_Increment( &m_iNext ) - 1;
+
+		if( index >= m_iCount )
+			break;
+
+		m_pfnJob( m_pData, (int)index, thread );
+	}
+}
+
+void CWorkerPool::ThreadMain( int thread )
+{
+	workersys_t *sys = (workersys_t *)m_pSys;
+#if _WIN32
+	for( ;; )
+	{
+		WaitForSingleObject( sys->start, INFINITE );
+		if( m_iStop )
+			break;
+
+		Work( thread );
+
+		if( InterlockedDecrement( &m_iBusy ) == 0 )
+			SetEvent( sys->done );
+	}
+#else
+	// not read from sys, a job may have started before this thread did
+	int generation = 0;
+
+	for( ;; )
+	{
+		pthread_mutex_lock( &sys->lock );
+		while( !m_iStop && sys->generation == generation )
+			pthread_cond_wait( &sys->start, &sys->lock );
+
+		if( m_iStop )
+		{
+			pthread_mutex_unlock( &sys->lock );
+			break;
+		}
+
+		generation = sys->generation;
+		pthread_mutex_unlock( &sys->lock );
+
+		Work( thread );
+
+		pthread_mutex_lock( &sys->lock );
+		if( --m_iBusy == 0 )
+			pthread_cond_signal( &sys->done );
+		pthread_mutex_unlock( &sys->lock );
+	}
+#endif
+}
@@ -0,0 +1,77 @@
+//========= Copyright (c) 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Small pool of worker threads for parallel jobs
+//
+// $NoKeywords: $
+//=============================================================================
+#pragma once
+#if !defined( WORKER_POOL_H )
+#define WORKER_POOL_H
+
+#define WORKER_MAX_THREADS	16
+
+// thread is 0 for the caller of Run, 1..NumThreads() for the workers
+typedef void (*pfnWorkerJob)( void *data, int index, int thread );
+
+/*
+====================
+CWorkerMutex
+
+====================
+*/
+class CWorkerMutex
+{
+public:
+	CWorkerMutex( void );
+	~CWorkerMutex( void );
+
+	void Lock( void );
+	void Unlock( void );
+
+private:
+	void	*m_pLock;	// CRITICAL_SECTION or pthread_mutex_t
+};
+
+/*
+====================
+CWorkerPool
+
+Runs a job over a range of indices on the workers and the calling
+thread together, and returns when every index is done.  Indices are
+handed out one at a time, so uneven jobs still spread out.
+====================
+*/
+class CWorkerPool
+{
+public:
+	CWorkerPool( void );
+
+	void Start( int numthreads );	// stops the running workers first
+	void Stop( void );
+
+	int NumThreads( void ) { return m_iNumThreads; }
+
+	void Run( pfnWorkerJob pfnJob, void *data, int count );
+
+	static int NumCPUs( void );
+
+	// entry point of the threads, public for the platform glue only
+	void ThreadMain( int thread );
+
+private:
+	void Work( int thread );
+
+	int		m_iNumThreads;
+	int		m_iStop;
+
+	pfnWorkerJob	m_pfnJob;
+	void		*m_pData;
+	int		m_iCount;
+	volatile long	m_iNext;	// next index to hand out
+	volatile long	m_iBusy;	// workers still on the current job
+
+	void		*m_pSys;	// threads and signalling, see worker_pool.cpp
+};
+
+extern CWorkerPool g_WorkerPool;
+#endif // WORKER_POOL_H
@@ -60,9 +60,12 @@ playermove_t *pmove = NULL;
 #define VEC_VIEW		28
 #define	STOP_EPSILON		0.1f
 
-#define CTEXTURESMAX		512			// max number of textures loaded
 #include "pm_materials.h"
 
+#define CTEXTURESINIT		512			// materials.txt entries allocated up front, grows as needed
+#define CTEXTURECACHE		1024		// texture name -> type cache slots, must be power of two
+#define CTEXTURECACHEFILL	768			// cache is flushed once this many names are in it
+
 #define STEP_CONCRETE		0		// default step sound
 #define STEP_METAL		1		// metal floor
 #define STEP_DIRT		2		// dirt, sand, rock
@@ -111,10 +114,21 @@ playermove_t *pmove = NULL;
 static vec3_t rgv3tStuckTable[54];
 static int rgStuckLast[MAX_CLIENTS][2];
 
-// Texture names
+typedef struct pmtexture_s
+{
+	char	name[CBTEXTURENAMEMAX];
+	char	type;
+} pmtexture_t;
+
+// Texture names, sorted for the binary search
 static int gcTextures = 0;
-static char grgszTextureName[CTEXTURESMAX][CBTEXTURENAMEMAX];	
-static char grgchTextureType[CTEXTURESMAX];
+static int gcTexturesMax = 0;
+static pmtexture_t *gpTextures = NULL;
+
+// Every name that was looked up, hashed, so each BSP texture
+// is resolved with the binary search only once
+static int gcTextureCache = 0;
+static pmtexture_t grgTextureCache[CTEXTURECACHE];
 
 int g_onladder = 0;
 
@@ -132,39 +146,29 @@ static void PM_TraceModel( physent_t *pe, float *start, float *end, trace_t *tra
 	pmove->PM_TraceModel(pe, start, end, trace);
 }
 
-void PM_SwapTextures( int i, int j )
+static int PM_CompareTextures( const void *a, const void *b )
 {
-	char chTemp;
-	char szTemp[CBTEXTURENAMEMAX];
-
-	strcpy( szTemp, grgszTextureName[i] );
-	chTemp = grgchTextureType[i];
-	
-	strcpy( grgszTextureName[i], grgszTextureName[j] );
-	grgchTextureType[i] = grgchTextureType[j];
-
-	strcpy( grgszTextureName[j], szTemp );
-	grgchTextureType[j] = chTemp;
+	return stricmp( ((const pmtexture_t *)a)->name, ((const pmtexture_t *)b)->name );
 }
 
 void PM_SortTextures( void )
 {
-	// Bubble sort, yuck, but this only occurs at startup and it's only 512 elements...
-	//
-	int i, j;
+	qsort( gpTextures, gcTextures, sizeof( pmtexture_t ), PM_CompareTextures );
+}
+
+static unsigned int PM_HashTextureName( const char *name )
+{
+	unsigned int hash = 2166136261u;
+	int i;
 
-	for( i = 0; i < gcTextures; i++ )
+	// same length and case rules as the strnicmp in PM_FindTextureType
+	for( i = 0; i < CBTEXTURENAMEMAX - 1 && name[i]; i++ )
 	{
-		for( j = i + 1; j < gcTextures; j++ )
-		{
-			if( stricmp( grgszTextureName[i], grgszTextureName[j] ) > 0 )
-			{
-				// Swap
-				//
-				PM_SwapTextures( i, j );
-			}
-		}
+		hash ^= (unsigned char)tolower( name[i] );
+		hash *= 16777619u;
 	}
+
+	return hash;
 }
 
 void PM_InitTextureTypes( void )
@@ -178,10 +182,9 @@ void PM_InitTextureTypes( void )
 	if( bTextureTypeInit )
 		return;
 
-	memset(&( grgszTextureName[0][0] ), 0, sizeof( grgszTextureName ) );
-	memset( grgchTextureType, 0, sizeof( grgchTextureType ) );
-
 	gcTextures = 0;
+	gcTextureCache = 0;
+	memset( grgTextureCache, 0, sizeof( grgTextureCache ));
 
 	pMemFile = pmove->COM_LoadFile( "sound/materials.txt", 5, &fileSize );
 	if( !pMemFile )
@@ -190,8 +193,20 @@ void PM_InitTextureTypes( void )
 	memset( buffer, 0, sizeof( buffer ) );
 
 	// for each line in the file...
-	while( pmove->memfgets( pMemFile, fileSize, &filePos, buffer, 511 ) != NULL && (gcTextures < CTEXTURESMAX ) )
+	while( pmove->memfgets( pMemFile, fileSize, &filePos, buffer, 511 ) != NULL )
 	{
+		if( gcTextures == gcTexturesMax )
+		{
+			int newMax = gcTexturesMax ? gcTexturesMax * 2 : CTEXTURESINIT;
+			pmtexture_t *pNew = (pmtexture_t *)realloc( gpTextures, newMax * sizeof( pmtexture_t ));
+
+			if( !pNew )
+				break;
+
+			gpTextures = pNew;
+			gcTexturesMax = newMax;
+		}
+
 		// skip whitespace
 		i = 0;
 		while( buffer[i] && isspace( buffer[i] ) )
@@ -205,7 +220,7 @@ void PM_InitTextureTypes( void )
 			continue;
 
 		// get texture type
-		grgchTextureType[gcTextures] = toupper( buffer[i++] );
+		gpTextures[gcTextures].type = toupper( buffer[i++] );
 
 		// skip whitespace
 		while( buffer[i] && isspace( buffer[i] ) )
@@ -225,7 +240,7 @@ void PM_InitTextureTypes( void )
 		// null-terminate name and save in sentences array
 		j = min( j, CBTEXTURENAMEMAX - 1 + i );
 		buffer[j] = 0;
-		strcpy( &( grgszTextureName[gcTextures++][0] ), &( buffer[i] ) );
+		strcpy( gpTextures[gcTextures++].name, &( buffer[i] ) );
 	}
 
 	// Must use engine to free since we are in a .dll
@@ -236,13 +251,11 @@ void PM_InitTextureTypes( void )
 	bTextureTypeInit = true;
 }
 
-char PM_FindTextureType( char *name )
+static char PM_SearchTextureType( const char *name )
 {
 	int left, right, pivot;
 	int val;
 
-	assert( pm_shared_initialized );
-
 	left = 0;
 	right = gcTextures - 1;
 
@@ -250,10 +263,10 @@ char PM_FindTextureType( char *name )
 	{
 		pivot = ( left + right ) / 2;
 
-		val = strnicmp( name, grgszTextureName[pivot], CBTEXTURENAMEMAX - 1 );
+		val = strnicmp( name, gpTextures[pivot].name, CBTEXTURENAMEMAX - 1 );
 		if( val == 0 )
 		{
-			return grgchTextureType[pivot];
+			return gpTextures[pivot].type;
 		}
 		else if( val > 0 )
 		{
@@ -268,6 +281,41 @@ char PM_FindTextureType( char *name )
 	return CHAR_TEX_CONCRETE;
 }
 
+char PM_FindTextureType( char *name )
+{
+	unsigned int slot;
+	pmtexture_t *pEntry;
+
+	assert( pm_shared_initialized );
+
+	slot = PM_HashTextureName( name ) & ( CTEXTURECACHE - 1 );
+
+	// linear probing, empty slots have type 0
+	while( grgTextureCache[slot].type )
+	{
+		if( !strnicmp( name, grgTextureCache[slot].name, CBTEXTURENAMEMAX - 1 ) )
+			return grgTextureCache[slot].type;
+
+		slot = ( slot + 1 ) & ( CTEXTURECACHE - 1 );
+	}
+
+	if( gcTextureCache >= CTEXTURECACHEFILL )
+	{
+		// a single map never gets here, but keep the probes short on long running servers
+		memset( grgTextureCache, 0, sizeof( grgTextureCache ));
+		gcTextureCache = 0;
+		slot = PM_HashTextureName( name ) & ( CTEXTURECACHE - 1 );
+	}
+
+	pEntry = &grgTextureCache[slot];
+	strncpy( pEntry->name, name, CBTEXTURENAMEMAX - 1 );
+	pEntry->name[CBTEXTURENAMEMAX - 1] = 0;
+	pEntry->type = PM_SearchTextureType( name );
+	gcTextureCache++;
+
+	return pEntry->type;
+}
+
 void PM_PlayStepSound( int step, float fvol )
 {
 	static int iSkipStep = 0;
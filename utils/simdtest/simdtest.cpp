@@ -0,0 +1,436 @@
+/***
+*
+*   simdtest - studio math SIMD check
+*
+*   Builds cl_dll/studio_util.cpp twice, once the way the client
+*   does and once with only its plain C code, and checks that the
+*   SIMD versions give the same results as the C ones on random
+*   input. The AVX2 ConcatTransforms is checked as well when the
+*   cpu has it. Inputs are deliberately not 16 byte aligned, and
+*   the bone blend runs every bone count up to SIMD_MAX_BONES so
+*   QuaternionSlerpX4 sees each remainder.
+*
+*   simdtest [-seed N] [-count N] [-v]
+*
+***/
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio_util.h"
+#include "build.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined __SSE2__ || defined _M_X64 || ( defined _M_IX86_FP && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#if defined __GNUC__
+#include <immintrin.h>
+#endif
+#endif
+
+// every header it includes is in already, so each copy only adds the functions
+namespace simd
+{
+#include "studio_util.cpp"
+}
+
+#if XASH_SIMD_SSE2
+#define SIMDTEST_SSE2	1
+#endif
+#if XASH_SIMD_AVX2
+#define SIMDTEST_AVX2	1
+#endif
+
+#undef XASH_SIMD_NEON
+#undef XASH_SIMD_SSE2
+#undef XASH_SIMD_AVX2
+#undef SIMD_TARGET_AVX2
+#define STUDIO_UTIL_SCALAR	1
+
+namespace scalar
+{
+#include "studio_util.cpp"
+}
+
+#define SIMD_EPSILON		1e-5f	// relative to the larger of the result and the input scale
+#define SIMD_MAX_ORIGIN		4096.0f
+#define SIMD_TIE_EPSILON	1e-4f
+#define SIMD_MAX_BONES		35
+#define SIMD_MAX_FAILURES	8	// reported per check
+
+typedef struct
+{
+	const char *name;
+	int tests;
+	int failed;
+	float maxerror;
+} simdcheck_t;
+
+static unsigned int s_iSeed = 1;
+static int s_iCount = 20000;
+static int s_iVerbose;
+static int s_iFailed;
+
+static float Test_Random( float flLow, float flHigh )
+{
+	s_iSeed = s_iSeed * 1664525 + 1013904223;
+
+	return flLow + ( s_iSeed >> 8 ) * ( 1.0f / 16777216.0f ) * ( flHigh - flLow );
+}
+
+static void Test_RandomQuaternion( float *q )
+{
+	float len;
+
+	do
+	{
+		for( int i = 0; i < 4; i++ )
+			q[i] = Test_Random( -1.0f, 1.0f );
+		len = sqrt( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3] );
+	} while( len < 0.01f );
+
+	for( int i = 0; i < 4; i++ )
+		q[i] /= len;
+}
+
+// at right angles q and -q are equally near p, and the C and SIMD
+// code can round their way to different ones, both of them right
+static void Test_RandomOther( float *q, const float *p )
+{
+	do
+	{
+		Test_RandomQuaternion( q );
+	} while( fabs( p[0] * q[0] + p[1] * q[1] + p[2] * q[2] + p[3] * q[3] ) < SIMD_TIE_EPSILON );
+}
+
+static void Test_RandomAngles( float *angles )
+{
+	// radians, the way the studio code hands them to AngleQuaternion
+	for( int i = 0; i < 3; i++ )
+		angles[i] = Test_Random( -M_PI_F, M_PI_F );
+}
+
+static void Test_RandomTransform( float (*matrix)[4] )
+{
+	float angles[3];
+
+	Test_RandomAngles( angles );
+	scalar::AngleMatrix( angles, matrix );
+
+	for( int i = 0; i < 3; i++ )
+		matrix[i][3] = Test_Random( -SIMD_MAX_ORIGIN, SIMD_MAX_ORIGIN );
+}
+
+// somewhere inside buf that isn't 16 byte aligned
+static float *Test_Unaligned( float *buf, int i )
+{
+	float *p = (float *)( ( (size_t)buf + 15 ) & ~(size_t)15 );
+
+	return p + 1 + i % 3;
+}
+
+// flScale is how big the inputs get, sums of those can cancel down to
+// small results that only keep the precision of the inputs
+static void Test_Compare( simdcheck_t *check, const float *expected, const float *result, int count, float flScale )
+{
+	for( int i = 0; i < count; i++ )
+	{
+		float error = fabs( result[i] - expected[i] ) / Q_max( flScale, (float)fabs( expected[i] ));
+
+		// NaN fails too
+		if( !( error <= SIMD_EPSILON ))
+		{
+			if( check->failed++ < SIMD_MAX_FAILURES )
+				printf( "%s: test %d, element %d: expected %.9g, got %.9g\n", check->name, check->tests, i, expected[i], result[i] );
+		}
+		else if( error > check->maxerror )
+			check->maxerror = error;
+	}
+}
+
+static void Test_BeginCheck( simdcheck_t *check, const char *name )
+{
+	check->name = name;
+	check->tests = 0;
+	check->failed = 0;
+	check->maxerror = 0.0f;
+}
+
+static void Test_EndCheck( simdcheck_t *check )
+{
+	if( check->failed )
+	{
+		printf( "%-28s FAILED, %d of %d tests\n", check->name, check->failed, check->tests );
+		s_iFailed++;
+	}
+	else if( s_iVerbose )
+		printf( "%-28s ok, %d tests, max error %g\n", check->name, check->tests, check->maxerror );
+	else
+		printf( "%-28s ok\n", check->name );
+}
+
+/*
+==============================================================================
+
+CHECKS
+
+==============================================================================
+*/
+typedef void (*pfnConcatTransforms_t)( float in1[3][4], float in2[3][4], float out[3][4] );
+
+static void Check_ConcatTransforms( const char *name, pfnConcatTransforms_t pfnConcat )
+{
+	float buf[3][24];
+	float (*in1)[4], (*in2)[4], (*out)[4];
+	float expected[3][4];
+	simdcheck_t check;
+
+	Test_BeginCheck( &check, name );
+
+	for( int i = 0; i < s_iCount; i++, check.tests++ )
+	{
+		in1 = (float (*)[4])Test_Unaligned( buf[0], i );
+		in2 = (float (*)[4])Test_Unaligned( buf[1], i + 1 );
+		out = (float (*)[4])Test_Unaligned( buf[2], i + 2 );
+
+		Test_RandomTransform( in1 );
+		Test_RandomTransform( in2 );
+
+		scalar::ConcatTransforms( in1, in2, expected );
+		pfnConcat( in1, in2, out );
+
+		Test_Compare( &check, expected[0], out[0], 12, SIMD_MAX_ORIGIN );
+	}
+
+	Test_EndCheck( &check );
+}
+
+static void Check_VectorTransform( void )
+{
+	float buf[2][24];
+	float (*matrix)[4], *in;
+	float expected[3], out[3];
+	simdcheck_t check;
+
+	Test_BeginCheck( &check, "VectorTransform" );
+
+	for( int i = 0; i < s_iCount; i++, check.tests++ )
+	{
+		matrix = (float (*)[4])Test_Unaligned( buf[0], i );
+		in = Test_Unaligned( buf[1], i + 1 );
+
+		Test_RandomTransform( matrix );
+		for( int j = 0; j < 3; j++ )
+			in[j] = Test_Random( -SIMD_MAX_ORIGIN, SIMD_MAX_ORIGIN );
+
+		scalar::VectorTransform( in, matrix, expected );
+		simd::VectorTransform( in, matrix, out );
+
+		Test_Compare( &check, expected, out, 3, SIMD_MAX_ORIGIN );
+	}
+
+	Test_EndCheck( &check );
+}
+
+static void Check_AngleQuaternion( void )
+{
+	float angles[3];
+	vec4_t expected, out;
+	simdcheck_t check;
+
+	Test_BeginCheck( &check, "AngleQuaternion" );
+
+	for( int i = 0; i < s_iCount; i++, check.tests++ )
+	{
+		Test_RandomAngles( angles );
+
+		scalar::AngleQuaternion( angles, expected );
+		simd::AngleQuaternion( angles, out );
+
+		Test_Compare( &check, expected, out, 4, 1.0f );
+	}
+
+	Test_EndCheck( &check );
+}
+
+static void Check_QuaternionMatrix( void )
+{
+	float buf[2][24];
+	float (*out)[4];
+	float *q;
+	float expected[3][4];
+	simdcheck_t check;
+
+	Test_BeginCheck( &check, "QuaternionMatrix" );
+
+	for( int i = 0; i < s_iCount; i++, check.tests++ )
+	{
+		q = Test_Unaligned( buf[0], i );
+		out = (float (*)[4])Test_Unaligned( buf[1], i + 1 );
+
+		Test_RandomQuaternion( q );
+
+		// column 3 is left alone by both
+		for( int j = 0; j < 3; j++ )
+			expected[j][3] = out[j][3] = Test_Random( -SIMD_MAX_ORIGIN, SIMD_MAX_ORIGIN );
+
+		scalar::QuaternionMatrix( q, expected );
+		simd::QuaternionMatrix( q, out );
+
+		Test_Compare( &check, expected[0], out[0], 12, 1.0f );
+	}
+
+	Test_EndCheck( &check );
+}
+
+static void Check_QuaternionSlerp( void )
+{
+	float buf[3][24];
+	float *p, *q, *out;
+	vec4_t q1, expected;
+	float t;
+	simdcheck_t check;
+
+	Test_BeginCheck( &check, "QuaternionSlerp" );
+
+	for( int i = 0; i < s_iCount; i++, check.tests++ )
+	{
+		p = Test_Unaligned( buf[0], i );
+		q = Test_Unaligned( buf[1], i + 1 );
+		out = Test_Unaligned( buf[2], i + 2 );
+
+		Test_RandomQuaternion( p );
+		t = Test_Random( 0.0f, 1.0f );
+
+		// the same and opposite rotations take the 1 - cosom branch
+		switch( i % 8 )
+		{
+		case 0:
+			memcpy( q, p, sizeof( vec4_t ));
+			break;
+		case 1:
+			for( int j = 0; j < 4; j++ )
+				q[j] = -p[j];
+			break;
+		default:
+			Test_RandomOther( q, p );
+			break;
+		}
+
+		// both flip q in place when it's backwards
+		memcpy( q1, q, sizeof( vec4_t ));
+		scalar::QuaternionSlerp( p, q1, t, expected );
+		simd::QuaternionSlerp( p, q, t, out );
+
+		Test_Compare( &check, expected, out, 4, 1.0f );
+		Test_Compare( &check, q1, q, 4, 1.0f );
+	}
+
+	Test_EndCheck( &check );
+}
+
+typedef void (*pfnQuaternionSlerp_t)( vec4_t p, vec4_t q, float t, vec4_t qt );
+typedef void (*pfnQuaternionSlerpX4_t)( vec4_t p[4], vec4_t q[4], float t, vec4_t qt[4] );
+
+// the loop from CStudioModelRenderer::StudioSlerpBones, remainder first
+static void Test_SlerpBones( vec4_t *q1, vec4_t *q2, int numbones, float s, pfnQuaternionSlerp_t pfnSlerp, pfnQuaternionSlerpX4_t pfnSlerpX4 )
+{
+	int i;
+
+	for( i = 0; i < numbones % 4; i++ )
+		pfnSlerp( q1[i], q2[i], s, q1[i] );
+
+	for( ; i < numbones; i += 4 )
+		pfnSlerpX4( q1 + i, q2 + i, s, q1 + i );
+}
+
+static void Check_SlerpBones( void )
+{
+	float buf[4][SIMD_MAX_BONES * 4 + 8];
+	vec4_t *q1, *q2, *expected, *scratch;
+	float s;
+	simdcheck_t check;
+
+	Test_BeginCheck( &check, "QuaternionSlerpX4" );
+
+	for( int i = 0; i < s_iCount / SIMD_MAX_BONES + 1; i++ )
+	{
+		for( int numbones = 1; numbones <= SIMD_MAX_BONES; numbones++, check.tests++ )
+		{
+			q1 = (vec4_t *)Test_Unaligned( buf[0], numbones );
+			q2 = (vec4_t *)Test_Unaligned( buf[1], numbones + 1 );
+			expected = (vec4_t *)Test_Unaligned( buf[2], numbones + 2 );
+			scratch = (vec4_t *)Test_Unaligned( buf[3], numbones );
+
+			for( int j = 0; j < numbones; j++ )
+			{
+				Test_RandomQuaternion( q1[j] );
+				Test_RandomOther( q2[j], q1[j] );
+			}
+			s = Test_Random( 0.0f, 1.0f );
+
+			// the scalar QuaternionSlerp flips q2 in place, the SIMD X4 doesn't
+			memcpy( expected, q1, numbones * sizeof( vec4_t ));
+			memcpy( scratch, q2, numbones * sizeof( vec4_t ));
+			Test_SlerpBones( expected, scratch, numbones, s, scalar::QuaternionSlerp, scalar::QuaternionSlerpX4 );
+			Test_SlerpBones( q1, q2, numbones, s, simd::QuaternionSlerp, simd::QuaternionSlerpX4 );
+
+			Test_Compare( &check, expected[0], q1[0], numbones * 4, 1.0f );
+		}
+	}
+
+	Test_EndCheck( &check );
+}
+
+static void Test_ParseArgs( int argc, char **argv )
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "-seed" ) && i + 1 < argc )
+			s_iSeed = strtoul( argv[++i], NULL, 10 );
+		else if( !strcmp( argv[i], "-count" ) && i + 1 < argc )
+			s_iCount = atoi( argv[++i] );
+		else if( !strcmp( argv[i], "-v" ))
+			s_iVerbose = 1;
+		else
+		{
+			fprintf( stderr, "usage: simdtest [-seed N] [-count N] [-v]\n" );
+			exit( 2 );
+		}
+	}
+
+	if( s_iCount < 1 )
+		s_iCount = 1;
+}
+
+int main( int argc, char **argv )
+{
+	Test_ParseArgs( argc, argv );
+
+	printf( "seed %u, %d tests per check\n", s_iSeed, s_iCount );
+
+#if SIMDTEST_SSE2
+	Check_ConcatTransforms( "ConcatTransforms SSE2", simd::ConcatTransforms_SSE2 );
+#if SIMDTEST_AVX2
+	__builtin_cpu_init();
+
+	if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ))
+		Check_ConcatTransforms( "ConcatTransforms AVX2", simd::ConcatTransforms_AVX2 );
+	else
+		printf( "%-28s skipped, no AVX2 or FMA\n", "ConcatTransforms AVX2" );
+#endif
+#else
+	printf( "no SIMD in this build, checking the plain C code against itself\n" );
+#endif
+	Check_ConcatTransforms( "ConcatTransforms", simd::ConcatTransforms );
+	Check_VectorTransform();
+	Check_AngleQuaternion();
+	Check_QuaternionMatrix();
+	Check_QuaternionSlerp();
+	Check_SlerpBones();
+
+	return s_iFailed ? 1 : 0;
+}
@@ -0,0 +1,1817 @@
+/***
+*
+*   svbench - engine functions handed to the game dll
+*
+*   Everything is deterministic: no file system beyond the game
+*   directory, no network, random numbers come from one seed and
+*   time only moves when the benchmark steps a frame.
+*
+***/
+
+#include "svbench.h"
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+server_t sv;
+enginefuncs_t g_svEngineFuncs;
+
+char sv_gameDir[MAX_PATH] = "valve";
+int sv_currentPlayer = -1;
+
+static char s_StringPool[SVB_STRING_POOL];
+static int s_iStringPoolUsed;
+static int s_StringHash[65536];		// pool offsets of the strings handed out, for reuse
+
+static cvar_t *s_pCvars[SVB_MAX_CVARS];
+static int s_iNumCvars;
+
+typedef struct svcommand_s
+{
+	char	name[64];
+	void	( *function )( void );
+} svcommand_t;
+
+static svcommand_t s_Commands[SVB_MAX_COMMANDS];
+static int s_iNumCommands;
+
+static char s_CommandBuffer[8192];
+
+static char s_ArgBuffer[1024];
+static char s_Args[1024];
+static char *s_pArgv[SVB_MAX_ARGS];
+static int s_iArgc;
+
+static char s_ModelNames[SVB_MAX_PRECACHE][64];
+static int s_iNumModels;
+static char s_SoundNames[SVB_MAX_PRECACHE][64];
+static int s_iNumSounds;
+static char s_GenericNames[SVB_MAX_PRECACHE][64];
+static int s_iNumGeneric;
+static char s_EventNames[SVB_MAX_PRECACHE][64];
+static int s_iNumEvents;
+static char s_DecalNames[SVB_MAX_PRECACHE][64];
+static int s_iNumDecals;
+static int s_iNumUserMsgs;
+
+static char s_ServerInfo[SVB_INFO_STRING];
+static char s_ClientInfo[SVB_MAX_CLIENTS + 1][SVB_INFO_STRING];
+static char s_PhysInfo[SVB_MAX_CLIENTS + 1][SVB_INFO_STRING];
+static char s_EmptyInfo[1];
+
+static unsigned int s_VoiceListening[SVB_MAX_CLIENTS + 1];
+
+static byte s_FatPVS[8192];
+
+// engine cvars the game dll looks up, everything else defaults to "0"
+static const char *s_szEngineCvars[][2] =
+{
+	{ "sv_gravity", "800" },
+	{ "sv_maxspeed", "320" },
+	{ "sv_stepsize", "18" },
+	{ "sv_friction", "4" },
+	{ "edgefriction", "2" },
+	{ "sv_accelerate", "10" },
+	{ "sv_airaccelerate", "10" },
+	{ "sv_wateraccelerate", "10" },
+	{ "sv_waterfriction", "1" },
+	{ "sv_stopspeed", "100" },
+	{ "sv_maxvelocity", "2000" },
+	{ "sv_bounce", "1" },
+	{ "sv_zmax", "4096" },
+	{ "sv_skyname", "desert" },
+	{ "sv_cheats", "0" },
+	{ "deathmatch", "1" },
+	{ "coop", "0" },
+	{ "hostname", "svbench" },
+	{ "sv_lan", "1" },
+	{ "sv_clienttrace", "1" },
+	{ NULL, NULL },
+};
+
+// the player side of the stock skill.cfg, used when the game directory has none
+static const char *s_szDefaultSkill =
+	"sk_plr_crowbar1 10; sk_plr_9mm_bullet1 8; sk_plr_357_bullet1 40; sk_plr_9mmAR_bullet1 5;"
+	"sk_plr_9mmAR_grenade1 100; sk_plr_buckshot1 5; sk_plr_rpg1 100; sk_plr_hand_grenade1 100;"
+	"sk_12mm_bullet1 8; sk_9mmAR_bullet1 3; sk_9mm_bullet1 5; sk_suitcharger1 75; sk_battery1 15;"
+	"sk_healthcharger1 50; sk_healthkit1 15; sk_player_head1 3; sk_player_chest1 1;"
+	"sk_player_stomach1 1; sk_player_arm1 1; sk_player_leg1 1; sk_monster_head1 3;"
+	"sk_monster_chest1 1; sk_monster_stomach1 1; sk_monster_arm1 1; sk_monster_leg1 1";
+
+static byte *PF_LoadFileForMe( const char *filename, int *pLength );
+
+/*
+==============================================================================
+
+STRINGS, EDICTS
+
+==============================================================================
+*/
+static unsigned int SV_HashString( const char *s )
+{
+	unsigned int hash = 2166136261U;
+
+	while( *s )
+		hash = ( hash ^ (byte)*s++ ) * 16777619U;
+
+	return hash;
+}
+
+string_t SV_AllocString( const char *s )
+{
+	if( !s || !*s )
+		return 0;
+
+	// the same few names come back over and over, share them
+	int slot = SV_HashString( s ) & 65535;
+
+	while( s_StringHash[slot] )
+	{
+		if( !strcmp( s_StringPool + s_StringHash[slot], s ))
+			return s_StringHash[slot];
+
+		slot = ( slot + 1 ) & 65535;
+	}
+
+	int len = strlen( s ) + 1;
+
+	if( s_iStringPoolUsed + len > SVB_STRING_POOL )
+		Sys_Error( "SV_AllocString: string pool is full\n" );
+
+	int offset = s_iStringPoolUsed;
+
+	memcpy( s_StringPool + offset, s, len );
+	s_iStringPoolUsed += len;
+	s_StringHash[slot] = offset;
+
+	return offset;
+}
+
+const char *SV_String( string_t s )
+{
+	return s_StringPool + s;
+}
+
+edict_t *SV_EdictNum( int n )
+{
+	if( n < 0 || n >= sv.maxEdicts )
+		Sys_Error( "SV_EdictNum: bad number %d\n", n );
+
+	return &sv.edicts[n];
+}
+
+int SV_NumForEdict( const edict_t *e )
+{
+	int n = e - sv.edicts;
+
+	if( n < 0 || n >= sv.maxEdicts )
+		Sys_Error( "SV_NumForEdict: bad pointer\n" );
+
+	return n;
+}
+
+static void SV_InitEdict( edict_t *e )
+{
+	memset( &e->v, 0, sizeof( e->v ));
+	e->free = false;
+	e->pvPrivateData = NULL;
+	e->v.pContainingEntity = e;
+}
+
+edict_t *SV_AllocEdict( void )
+{
+	int i;
+
+	for( i = sv.maxClients + 1; i < sv.numEdicts; i++ )
+	{
+		edict_t *e = &sv.edicts[i];
+
+		// the engine lets the clients forget an entity before it reuses the slot
+		if( e->free && ( e->freetime < 2.0f || sv.time - e->freetime > 0.5 ))
+		{
+			SV_InitEdict( e );
+			return e;
+		}
+	}
+
+	if( i >= sv.maxEdicts )
+		Sys_Error( "SV_AllocEdict: no free edicts\n" );
+
+	sv.numEdicts++;
+	SV_InitEdict( &sv.edicts[i] );
+
+	return &sv.edicts[i];
+}
+
+static void SV_FreePrivateData( edict_t *e )
+{
+	if( !e->pvPrivateData )
+		return;
+
+	if( sv.newDllFuncs.pfnOnFreeEntPrivateData )
+		sv.newDllFuncs.pfnOnFreeEntPrivateData( e );
+
+	free( e->pvPrivateData );
+	e->pvPrivateData = NULL;
+}
+
+void SV_FreeEdict( edict_t *e )
+{
+	if( e->free )
+		return;
+
+	SV_FreePrivateData( e );
+
+	memset( &e->v, 0, sizeof( e->v ));
+	e->free = true;
+	e->freetime = sv.time;
+	e->serialnumber++;
+}
+
+edict_t *SV_CreateNamedEntity( const char *pszClassname )
+{
+	typedef void ( *LINK_ENTITY_FUNC )( entvars_t *pev );
+	LINK_ENTITY_FUNC pfnSpawn = (LINK_ENTITY_FUNC)dlsym( sv.hGameDll, pszClassname );
+
+	if( !pfnSpawn )
+	{
+		if( sv.verbose )
+			printf( "no spawn function for %s\n", pszClassname );
+		return NULL;
+	}
+
+	edict_t *e = SV_AllocEdict();
+
+	e->v.classname = SV_AllocString( pszClassname );
+	pfnSpawn( &e->v );
+
+	return e;
+}
+
+/*
+==============================================================================
+
+CVARS AND COMMANDS
+
+==============================================================================
+*/
+static cvar_t *SV_FindCvar( const char *pszName )
+{
+	for( int i = 0; i < s_iNumCvars; i++ )
+	{
+		if( !strcmp( s_pCvars[i]->name, pszName ))
+			return s_pCvars[i];
+	}
+
+	return NULL;
+}
+
+static void SV_RegisterCvar( cvar_t *pCvar )
+{
+	if( SV_FindCvar( pCvar->name ))
+		return;
+
+	if( s_iNumCvars >= SVB_MAX_CVARS )
+		Sys_Error( "SV_RegisterCvar: too many cvars\n" );
+
+	// from here on the engine owns the string
+	pCvar->string = strdup( pCvar->string );
+	pCvar->value = atof( pCvar->string );
+	s_pCvars[s_iNumCvars++] = pCvar;
+}
+
+static cvar_t *SV_GetCvarPointer( const char *pszName )
+{
+	cvar_t *pCvar = SV_FindCvar( pszName );
+
+	if( pCvar )
+		return pCvar;
+
+	const char *pszValue = "0";
+
+	for( int i = 0; s_szEngineCvars[i][0]; i++ )
+	{
+		if( !strcmp( s_szEngineCvars[i][0], pszName ))
+			pszValue = s_szEngineCvars[i][1];
+	}
+
+	pCvar = (cvar_t *)calloc( 1, sizeof( cvar_t ));
+	pCvar->name = strdup( pszName );
+	pCvar->string = pszValue;
+	pCvar->flags = FCVAR_SERVER;
+	SV_RegisterCvar( pCvar );
+
+	return pCvar;
+}
+
+static void SV_DirectSetCvar( cvar_t *pCvar, const char *pszValue )
+{
+	free( (char *)pCvar->string );
+	pCvar->string = strdup( pszValue );
+	pCvar->value = atof( pszValue );
+}
+
+void SV_SetCvar( const char *pszName, const char *pszValue )
+{
+	SV_DirectSetCvar( SV_GetCvarPointer( pszName ), pszValue );
+}
+
+void SV_SetArgs( const char *pszText )
+{
+	char *p = s_ArgBuffer;
+	const char *s = pszText;
+
+	s_iArgc = 0;
+	s_Args[0] = '\0';
+	strncpy( s_ArgBuffer, pszText, sizeof( s_ArgBuffer ) - 1 );
+	s_ArgBuffer[sizeof( s_ArgBuffer ) - 1] = '\0';
+
+	while( *p && s_iArgc < SVB_MAX_ARGS )
+	{
+		while( *p == ' ' || *p == '\t' )
+			p++;
+
+		if( !*p )
+			break;
+
+		// everything after the command name
+		if( s_iArgc == 1 )
+		{
+			strncpy( s_Args, s + ( p - s_ArgBuffer ), sizeof( s_Args ) - 1 );
+			s_Args[sizeof( s_Args ) - 1] = '\0';
+		}
+
+		if( *p == '"' )
+		{
+			s_pArgv[s_iArgc++] = ++p;
+
+			while( *p && *p != '"' )
+				p++;
+		}
+		else
+		{
+			s_pArgv[s_iArgc++] = p;
+
+			while( *p && *p != ' ' && *p != '\t' )
+				p++;
+		}
+
+		if( *p )
+			*p++ = '\0';
+	}
+}
+
+static void SV_ExecuteLine( const char *pszLine )
+{
+	int i;
+
+	SV_SetArgs( pszLine );
+
+	if( !s_iArgc || !strncmp( s_pArgv[0], "//", 2 ))
+		return;
+
+	for( i = 0; i < s_iNumCommands; i++ )
+	{
+		if( !strcasecmp( s_Commands[i].name, s_pArgv[0] ))
+		{
+			s_Commands[i].function();
+			return;
+		}
+	}
+
+	if( !strcasecmp( s_pArgv[0], "kick" ) && s_iArgc > 1 )
+	{
+		for( i = 1; i <= sv.maxClients; i++ )
+		{
+			edict_t *e = &sv.edicts[i];
+
+			if( !e->free && e->v.netname && !strcmp( SV_String( e->v.netname ), s_pArgv[1] ))
+			{
+				sv.dllFuncs.pfnClientDisconnect( e );
+				SV_FreeEdict( e );
+				break;
+			}
+		}
+		return;
+	}
+
+	if( !strcasecmp( s_pArgv[0], "exec" ) && s_iArgc > 1 )
+	{
+		byte *pFile = PF_LoadFileForMe( s_pArgv[1], NULL );
+
+		if( pFile )
+		{
+			SV_Command( (char *)pFile );
+			free( pFile );
+		}
+		else if( !strcasecmp( s_pArgv[1], "skill.cfg" ))
+			SV_Command( s_szDefaultSkill );
+		else if( sv.verbose )
+			printf( "couldn't exec %s\n", s_pArgv[1] );
+		return;
+	}
+
+	cvar_t *pCvar = SV_FindCvar( s_pArgv[0] );
+
+	if( pCvar )
+	{
+		if( s_iArgc > 1 )
+			SV_DirectSetCvar( pCvar, s_pArgv[1] );
+		else
+			printf( "\"%s\" is \"%s\"\n", pCvar->name, pCvar->string );
+		return;
+	}
+
+	if( sv.verbose )
+		printf( "unknown command: %s\n", pszLine );
+}
+
+void SV_Command( const char *pszText )
+{
+	char line[1024];
+	const char *p = pszText;
+
+	while( *p )
+	{
+		int len = 0;
+
+		while( *p && *p != '\n' && *p != ';' && len < (int)sizeof( line ) - 1 )
+			line[len++] = *p++;
+
+		line[len] = '\0';
+
+		if( *p )
+			p++;
+
+		SV_ExecuteLine( line );
+	}
+}
+
+/*
+==============================================================================
+
+INFO STRINGS
+
+==============================================================================
+*/
+static char *Info_ValueForKey( char *s, const char *key )
+{
+	static char value[4][SVB_INFO_STRING];
+	static int valueIndex;
+	char pkey[SVB_INFO_STRING];
+
+	valueIndex = ( valueIndex + 1 ) & 3;
+
+	if( *s == '\\' )
+		s++;
+
+	while( *s )
+	{
+		char *o = pkey;
+
+		while( *s && *s != '\\' )
+			*o++ = *s++;
+		*o = '\0';
+
+		if( !*s )
+			break;
+		s++;
+
+		o = value[valueIndex];
+
+		while( *s && *s != '\\' )
+			*o++ = *s++;
+		*o = '\0';
+
+		if( !strcmp( key, pkey ))
+			return value[valueIndex];
+
+		if( !*s )
+			break;
+		s++;
+	}
+
+	value[valueIndex][0] = '\0';
+	return value[valueIndex];
+}
+
+static void Info_RemoveKey( char *s, const char *key )
+{
+	char pkey[SVB_INFO_STRING];
+
+	while( *s )
+	{
+		char *start = s;
+		char *o = pkey;
+
+		if( *s == '\\' )
+			s++;
+
+		while( *s && *s != '\\' )
+			*o++ = *s++;
+		*o = '\0';
+
+		if( *s )
+			s++;
+
+		while( *s && *s != '\\' )
+			s++;
+
+		if( !strcmp( key, pkey ))
+		{
+			memmove( start, s, strlen( s ) + 1 );
+			return;
+		}
+	}
+}
+
+static void Info_SetValueForKey( char *s, const char *key, const char *value )
+{
+	Info_RemoveKey( s, key );
+
+	if( !value || !*value )
+		return;
+
+	int len = strlen( s );
+
+	snprintf( s + len, SVB_INFO_STRING - len, "\\%s\\%s", key, value );
+}
+
+char *SV_ClientInfo( int client )
+{
+	return s_ClientInfo[client];
+}
+
+static int SV_ClientIndex( const edict_t *e )
+{
+	if( !e )
+		return 0;
+
+	int n = SV_NumForEdict( e );
+
+	return ( n >= 1 && n <= sv.maxClients ) ? n : 0;
+}
+
+/*
+==============================================================================
+
+MATH
+
+==============================================================================
+*/
+static void SV_AngleVectors( const float *angles, float *forward, float *right, float *up )
+{
+	float sr, sp, sy, cr, cp, cy;
+	float angle;
+
+	angle = angles[YAW] * ( M_PI * 2 / 360 );
+	sy = sin( angle );
+	cy = cos( angle );
+	angle = angles[PITCH] * ( M_PI * 2 / 360 );
+	sp = sin( angle );
+	cp = cos( angle );
+	angle = angles[ROLL] * ( M_PI * 2 / 360 );
+	sr = sin( angle );
+	cr = cos( angle );
+
+	if( forward )
+	{
+		forward[0] = cp * cy;
+		forward[1] = cp * sy;
+		forward[2] = -sp;
+	}
+
+	if( right )
+	{
+		right[0] = -1 * sr * sp * cy + -1 * cr * -sy;
+		right[1] = -1 * sr * sp * sy + -1 * cr * cy;
+		right[2] = -1 * sr * cp;
+	}
+
+	if( up )
+	{
+		up[0] = cr * sp * cy + -sr * -sy;
+		up[1] = cr * sp * sy + -sr * cy;
+		up[2] = cr * cp;
+	}
+}
+
+static float SV_VecToYaw( const float *v )
+{
+	if( v[1] == 0 && v[0] == 0 )
+		return 0;
+
+	float yaw = (int)( atan2( v[1], v[0] ) * 180 / M_PI );
+
+	if( yaw < 0 )
+		yaw += 360;
+
+	return yaw;
+}
+
+static void SV_VecToAngles( const float *v, float *angles )
+{
+	float yaw, pitch;
+
+	if( v[1] == 0 && v[0] == 0 )
+	{
+		yaw = 0;
+		pitch = v[2] > 0 ? 90 : 270;
+	}
+	else
+	{
+		yaw = atan2( v[1], v[0] ) * 180 / M_PI;
+		if( yaw < 0 )
+			yaw += 360;
+
+		pitch = atan2( v[2], sqrt( v[0] * v[0] + v[1] * v[1] )) * 180 / M_PI;
+		if( pitch < 0 )
+			pitch += 360;
+	}
+
+	angles[0] = pitch;
+	angles[1] = yaw;
+	angles[2] = 0;
+}
+
+static float SV_AngleMod( float a )
+{
+	return ( 360.0f / 65536 ) * ((int)( a * ( 65536 / 360.0f )) & 65535 );
+}
+
+static float SV_ApproachAngle( float current, float ideal, float speed )
+{
+	current = SV_AngleMod( current );
+
+	float move = ideal - current;
+
+	if( ideal > current )
+	{
+		if( move >= 180 )
+			move -= 360;
+	}
+	else if( move <= -180 )
+		move += 360;
+
+	if( move > speed )
+		move = speed;
+	else if( move < -speed )
+		move = -speed;
+
+	return SV_AngleMod( current + move );
+}
+
+/*
+==============================================================================
+
+ENGINE FUNCTIONS
+
+==============================================================================
+*/
+static int SV_PrecacheName( char names[][64], int *pCount, const char *s )
+{
+	int i;
+
+	if( !s || !*s )
+		return 0;
+
+	for( i = 1; i <= *pCount; i++ )
+	{
+		if( !strcasecmp( names[i], s ))
+			return i;
+	}
+
+	if( *pCount >= SVB_MAX_PRECACHE - 1 )
+		Sys_Error( "SV_PrecacheName: too many resources (%s)\n", s );
+
+	i = ++( *pCount );
+	strncpy( names[i], s, 63 );
+
+	return i;
+}
+
+static int PF_PrecacheModel( const char *s ) { return SV_PrecacheName( s_ModelNames, &s_iNumModels, s ); }
+static int PF_PrecacheSound( const char *s ) { return SV_PrecacheName( s_SoundNames, &s_iNumSounds, s ); }
+static int PF_PrecacheGeneric( const char *s ) { return SV_PrecacheName( s_GenericNames, &s_iNumGeneric, s ); }
+static int PF_DecalIndex( const char *s ) { return SV_PrecacheName( s_DecalNames, &s_iNumDecals, s ) - 1; }
+
+static unsigned short PF_PrecacheEvent( int type, const char *psz )
+{
+	return SV_PrecacheName( s_EventNames, &s_iNumEvents, psz );
+}
+
+static int PF_ModelIndex( const char *m )
+{
+	return SV_PrecacheName( s_ModelNames, &s_iNumModels, m );
+}
+
+static int PF_ModelFrames( int modelIndex )
+{
+	return 1;
+}
+
+static void PF_SetModel( edict_t *e, const char *m )
+{
+	e->v.modelindex = PF_ModelIndex( m );
+	e->v.model = SV_AllocString( m );
+
+	// studio and sprite models get no size from the engine, brush models have no file here
+	memset( e->v.mins, 0, sizeof( e->v.mins ));
+	memset( e->v.maxs, 0, sizeof( e->v.maxs ));
+	memset( e->v.size, 0, sizeof( e->v.size ));
+	SV_LinkEdict( e, FALSE );
+}
+
+static void PF_SetSize( edict_t *e, const float *rgflMin, const float *rgflMax )
+{
+	VectorCopy( rgflMin, e->v.mins );
+	VectorCopy( rgflMax, e->v.maxs );
+	VectorSubtract( rgflMax, rgflMin, e->v.size );
+	SV_LinkEdict( e, FALSE );
+}
+
+static void PF_SetOrigin( edict_t *e, const float *rgflOrigin )
+{
+	VectorCopy( rgflOrigin, e->v.origin );
+	SV_LinkEdict( e, FALSE );
+}
+
+static void PF_ChangeLevel( const char *s1, const char *s2 )
+{
+	if( sv.verbose )
+		printf( "changelevel %s ignored\n", s1 );
+}
+
+static void PF_GetSpawnParms( edict_t *ent ) {}
+static void PF_SaveSpawnParms( edict_t *ent ) {}
+
+static float PF_VecToYaw( const float *rgflVector )
+{
+	return SV_VecToYaw( rgflVector );
+}
+
+static void PF_VecToAngles( const float *rgflVectorIn, float *rgflVectorOut )
+{
+	SV_VecToAngles( rgflVectorIn, rgflVectorOut );
+}
+
+static void PF_MoveToOrigin( edict_t *ent, const float *pflGoal, float dist, int iMoveType )
+{
+	vec3_t dir, end;
+	TraceResult tr;
+
+	VectorSubtract( pflGoal, ent->v.origin, dir );
+	dir[2] = 0;
+
+	float len = sqrt( dir[0] * dir[0] + dir[1] * dir[1] );
+
+	if( len < 0.001f )
+		return;
+
+	if( dist > len )
+		dist = len;
+
+	VectorMA( ent->v.origin, dist / len, dir, end );
+	SV_TraceBox( ent->v.origin, end, ent->v.mins, ent->v.maxs, 0, ent, &tr );
+
+	if( !tr.fStartSolid )
+	{
+		VectorCopy( tr.vecEndPos, ent->v.origin );
+		SV_LinkEdict( ent, FALSE );
+	}
+}
+
+static void PF_ChangeYaw( edict_t *ent )
+{
+	ent->v.angles[YAW] = SV_ApproachAngle( ent->v.angles[YAW], ent->v.ideal_yaw, ent->v.yaw_speed );
+}
+
+static void PF_ChangePitch( edict_t *ent )
+{
+	ent->v.angles[PITCH] = SV_ApproachAngle( ent->v.angles[PITCH], ent->v.idealpitch, ent->v.pitch_speed );
+}
+
+static edict_t *PF_FindEntityByString( edict_t *pEdictStartSearchAfter, const char *pszField, const char *pszValue )
+{
+	static const struct { const char *name; int offset; } fields[] =
+	{
+		{ "classname", offsetof( entvars_t, classname ) },
+		{ "model", offsetof( entvars_t, model ) },
+		{ "viewmodel", offsetof( entvars_t, viewmodel ) },
+		{ "weaponmodel", offsetof( entvars_t, weaponmodel ) },
+		{ "netname", offsetof( entvars_t, netname ) },
+		{ "target", offsetof( entvars_t, target ) },
+		{ "targetname", offsetof( entvars_t, targetname ) },
+		{ "message", offsetof( entvars_t, message ) },
+		{ "noise", offsetof( entvars_t, noise ) },
+		{ "noise1", offsetof( entvars_t, noise1 ) },
+		{ "noise2", offsetof( entvars_t, noise2 ) },
+		{ "noise3", offsetof( entvars_t, noise3 ) },
+		{ "globalname", offsetof( entvars_t, globalname ) },
+	};
+	int i, offset = -1;
+
+	for( i = 0; i < (int)( sizeof( fields ) / sizeof( fields[0] )); i++ )
+	{
+		if( !strcmp( fields[i].name, pszField ))
+			offset = fields[i].offset;
+	}
+
+	if( offset == -1 || !pszValue )
+		return sv.edicts;
+
+	i = pEdictStartSearchAfter ? SV_NumForEdict( pEdictStartSearchAfter ) : 0;
+
+	for( i++; i < sv.numEdicts; i++ )
+	{
+		edict_t *e = &sv.edicts[i];
+
+		if( e->free )
+			continue;
+
+		string_t value = *(string_t *)( (byte *)&e->v + offset );
+
+		if( value && !strcmp( SV_String( value ), pszValue ))
+			return e;
+	}
+
+	return sv.edicts;
+}
+
+static int PF_GetEntityIllum( edict_t *pEnt )
+{
+	return 128;
+}
+
+static edict_t *PF_FindEntityInSphere( edict_t *pEdictStartSearchAfter, const float *org, float rad )
+{
+	int i = pEdictStartSearchAfter ? SV_NumForEdict( pEdictStartSearchAfter ) : 0;
+
+	for( i++; i < sv.numEdicts; i++ )
+	{
+		edict_t *e = &sv.edicts[i];
+		float distSquared = 0;
+
+		if( e->free || !e->v.classname )
+			continue;
+
+		for( int j = 0; j < 3; j++ )
+		{
+			float d = org[j] - ( e->v.origin[j] + ( e->v.mins[j] + e->v.maxs[j] ) * 0.5f );
+
+			distSquared += d * d;
+		}
+
+		if( distSquared <= rad * rad )
+			return e;
+	}
+
+	return sv.edicts;
+}
+
+// there is no vis, every client is potentially visible
+static edict_t *PF_FindClientInPVS( edict_t *pEdict )
+{
+	static int lastCheck;
+
+	for( int i = 0; i < sv.maxClients; i++ )
+	{
+		lastCheck = ( lastCheck % sv.maxClients ) + 1;
+
+		edict_t *e = &sv.edicts[lastCheck];
+
+		if( !e->free && e->pvPrivateData && e->v.health > 0 && !( e->v.flags & FL_NOTARGET ))
+			return e;
+	}
+
+	return sv.edicts;
+}
+
+static edict_t *PF_EntitiesInPVS( edict_t *pplayer )
+{
+	edict_t *chain = sv.edicts;
+
+	for( int i = 1; i < sv.numEdicts; i++ )
+	{
+		edict_t *e = &sv.edicts[i];
+
+		if( e->free )
+			continue;
+
+		e->v.chain = chain;
+		chain = e;
+	}
+
+	return chain;
+}
+
+static void PF_MakeVectors( const float *rgflVector )
+{
+	SV_AngleVectors( rgflVector, sv.globals.v_forward, sv.globals.v_right, sv.globals.v_up );
+}
+
+static void PF_AngleVectors( const float *rgflVector, float *forward, float *right, float *up )
+{
+	SV_AngleVectors( rgflVector, forward, right, up );
+}
+
+static edict_t *PF_CreateEntity( void )
+{
+	return SV_AllocEdict();
+}
+
+static void PF_RemoveEntity( edict_t *e )
+{
+	SV_FreeEdict( e );
+}
+
+static edict_t *PF_CreateNamedEntity( int className )
+{
+	return SV_CreateNamedEntity( SV_String( className ));
+}
+
+// static entities only exist on the clients
+static void PF_MakeStatic( edict_t *ent )
+{
+	SV_FreeEdict( ent );
+}
+
+static int PF_EntIsOnFloor( edict_t *e )
+{
+	return ( e->v.flags & FL_ONGROUND ) ? 1 : 0;
+}
+
+static int PF_DropToFloor( edict_t *e )
+{
+	vec3_t end;
+	TraceResult tr;
+
+	VectorCopy( e->v.origin, end );
+	end[2] -= 256;
+
+	SV_TraceBox( e->v.origin, end, e->v.mins, e->v.maxs, 0, e, &tr );
+
+	if( tr.flFraction == 1.0f || tr.fAllSolid )
+		return 0;
+
+	VectorCopy( tr.vecEndPos, e->v.origin );
+	SV_LinkEdict( e, FALSE );
+	e->v.flags |= FL_ONGROUND;
+	e->v.groundentity = tr.pHit;
+
+	return 1;
+}
+
+static int PF_WalkMove( edict_t *ent, float yaw, float dist, int iMode )
+{
+	vec3_t end;
+	TraceResult tr;
+
+	yaw = yaw * M_PI * 2 / 360;
+
+	end[0] = ent->v.origin[0] + cos( yaw ) * dist;
+	end[1] = ent->v.origin[1] + sin( yaw ) * dist;
+	end[2] = ent->v.origin[2];
+
+	SV_TraceBox( ent->v.origin, end, ent->v.mins, ent->v.maxs, 0, ent, &tr );
+
+	if( tr.flFraction < 1.0f || tr.fStartSolid )
+		return 0;
+
+	if( iMode != WALKMOVE_CHECKONLY )
+	{
+		VectorCopy( end, ent->v.origin );
+		SV_LinkEdict( ent, FALSE );
+	}
+
+	return 1;
+}
+
+static void PF_EmitSound( edict_t *entity, int channel, const char *sample, float volume, float attenuation, int fFlags, int pitch )
+{
+	sv.numSounds++;
+}
+
+static void PF_EmitAmbientSound( edict_t *entity, const float *pos, const char *samp, float vol, float attenuation, int fFlags, int pitch )
+{
+	sv.numSounds++;
+}
+
+static void PF_TraceToss( edict_t *pent, edict_t *pentToIgnore, TraceResult *ptr )
+{
+	memset( ptr, 0, sizeof( *ptr ));
+	ptr->flFraction = 1.0f;
+	ptr->fInOpen = 1;
+	ptr->pHit = sv.edicts;
+	VectorCopy( pent->v.origin, ptr->vecEndPos );
+}
+
+static int PF_TraceMonsterHull( edict_t *pEdict, const float *v1, const float *v2, int fNoMonsters, edict_t *pentToSkip, TraceResult *ptr )
+{
+	SV_TraceBox( v1, v2, pEdict->v.mins, pEdict->v.maxs, fNoMonsters, pentToSkip, ptr );
+
+	return ( ptr->fAllSolid || ptr->flFraction != 1.0f ) ? 1 : 0;
+}
+
+static const char *PF_TraceTexture( edict_t *pTextureEntity, const float *v1, const float *v2 )
+{
+	return NULL;
+}
+
+static void PF_TraceSphere( const float *v1, const float *v2, int fNoMonsters, float radius, edict_t *pentToSkip, TraceResult *ptr )
+{
+	SV_TraceLine( v1, v2, fNoMonsters, pentToSkip, ptr );
+}
+
+static void PF_GetAimVector( edict_t *ent, float speed, float *rgflReturn )
+{
+	SV_AngleVectors( ent->v.v_angle, rgflReturn, NULL, NULL );
+}
+
+static void PF_ServerCommand( const char *str )
+{
+	strncat( s_CommandBuffer, str, sizeof( s_CommandBuffer ) - strlen( s_CommandBuffer ) - 1 );
+}
+
+static void PF_ServerExecute( void )
+{
+	char buffer[sizeof( s_CommandBuffer )];
+
+	// commands may queue more commands
+	strcpy( buffer, s_CommandBuffer );
+	s_CommandBuffer[0] = '\0';
+
+	SV_Command( buffer );
+}
+
+static void PF_ClientCommand( edict_t *pEdict, const char *szFmt, ... ) {}
+static void PF_ParticleEffect( const float *org, const float *dir, float color, float count ) {}
+static void PF_LightStyle( int style, const char *val ) {}
+
+static int PF_PointContents( const float *rgflVector )
+{
+	return SV_PointContents( rgflVector );
+}
+
+// messages only get counted, there is nobody to send them to
+static void PF_MessageBegin( int msg_dest, int msg_type, const float *pOrigin, edict_t *ed )
+{
+	sv.messageBytes++;
+
+	if( sv.reqStateMsg && msg_type == sv.reqStateMsg && ed )
+	{
+		int client = SV_NumForEdict( ed );
+
+		if( client >= 1 && client <= sv.maxClients )
+			sv.wantVoiceState |= 1U << ( client - 1 );
+	}
+}
+
+static void PF_MessageEnd( void )
+{
+	sv.numMessages++;
+}
+
+static void PF_WriteByte( int iValue ) { sv.messageBytes++; }
+static void PF_WriteChar( int iValue ) { sv.messageBytes++; }
+static void PF_WriteShort( int iValue ) { sv.messageBytes += 2; }
+static void PF_WriteLong( int iValue ) { sv.messageBytes += 4; }
+static void PF_WriteAngle( float flValue ) { sv.messageBytes++; }
+static void PF_WriteCoord( float flValue ) { sv.messageBytes += 2; }
+static void PF_WriteString( const char *sz ) { sv.messageBytes += ( sz ? strlen( sz ) : 0 ) + 1; }
+static void PF_WriteEntity( int iValue ) { sv.messageBytes += 2; }
+
+static float PF_CVarGetFloat( const char *szVarName )
+{
+	return SV_GetCvarPointer( szVarName )->value;
+}
+
+static const char *PF_CVarGetString( const char *szVarName )
+{
+	return SV_GetCvarPointer( szVarName )->string;
+}
+
+static void PF_CVarSetFloat( const char *szVarName, float flValue )
+{
+	char value[32];
+
+	if( flValue == (int)flValue )
+		snprintf( value, sizeof( value ), "%d", (int)flValue );
+	else
+		snprintf( value, sizeof( value ), "%f", flValue );
+
+	SV_SetCvar( szVarName, value );
+}
+
+static void PF_CVarSetString( const char *szVarName, const char *szValue )
+{
+	SV_SetCvar( szVarName, szValue );
+}
+
+static void PF_AlertMessage( ALERT_TYPE atype, const char *szFmt, ... )
+{
+	va_list args;
+
+	// the console and errors are what a server admin would see
+	if( !sv.verbose && (( atype == at_console && sv.loading ) || ( atype != at_console && atype != at_error && atype != at_warning )))
+		return;
+
+	if( atype == at_error )
+		printf( "ERROR: " );
+	else if( atype == at_warning )
+		printf( "WARNING: " );
+
+	va_start( args, szFmt );
+	vprintf( szFmt, args );
+	va_end( args );
+}
+
+static void PF_EngineFprintf( FILE *pfile, const char *szFmt, ... )
+{
+	va_list args;
+
+	va_start( args, szFmt );
+	vfprintf( pfile, szFmt, args );
+	va_end( args );
+}
+
+static void *PF_PvAllocEntPrivateData( edict_t *pEdict, int cb )
+{
+	SV_FreePrivateData( pEdict );
+	pEdict->pvPrivateData = calloc( 1, cb );
+
+	return pEdict->pvPrivateData;
+}
+
+static void *PF_PvEntPrivateData( edict_t *pEdict )
+{
+	return pEdict ? pEdict->pvPrivateData : NULL;
+}
+
+static void PF_FreeEntPrivateData( edict_t *pEdict )
+{
+	SV_FreePrivateData( pEdict );
+}
+
+static const char *PF_SzFromIndex( int iString )
+{
+	return SV_String( iString );
+}
+
+static int PF_AllocString( const char *szValue )
+{
+	return SV_AllocString( szValue );
+}
+
+static entvars_t *PF_GetVarsOfEnt( edict_t *pEdict )
+{
+	return &pEdict->v;
+}
+
+static edict_t *PF_PEntityOfEntOffset( int iEntOffset )
+{
+	return (edict_t *)( (byte *)sv.edicts + iEntOffset );
+}
+
+static int PF_EntOffsetOfPEntity( const edict_t *pEdict )
+{
+	return (const byte *)pEdict - (const byte *)sv.edicts;
+}
+
+static int PF_IndexOfEdict( const edict_t *pEdict )
+{
+	return pEdict ? SV_NumForEdict( pEdict ) : 0;
+}
+
+static edict_t *PF_PEntityOfEntIndex( int iEntIndex )
+{
+	if( iEntIndex < 0 || iEntIndex >= sv.numEdicts )
+		return NULL;
+
+	edict_t *e = &sv.edicts[iEntIndex];
+
+	if( e->free && iEntIndex > sv.maxClients )
+		return NULL;
+
+	return e;
+}
+
+static edict_t *PF_PEntityOfEntIndexAllEntities( int iEntIndex )
+{
+	if( iEntIndex < 0 || iEntIndex >= sv.numEdicts )
+		return NULL;
+
+	return &sv.edicts[iEntIndex];
+}
+
+static edict_t *PF_FindEntityByVars( entvars_t *pvars )
+{
+	for( int i = 0; i < sv.numEdicts; i++ )
+	{
+		if( &sv.edicts[i].v == pvars )
+			return &sv.edicts[i];
+	}
+
+	return NULL;
+}
+
+// no model files, the game falls back to its defaults without studio headers
+static void *PF_GetModelPtr( edict_t *pEdict )
+{
+	return NULL;
+}
+
+static int PF_RegUserMsg( const char *pszName, int iSize )
+{
+	int msg = 64 + s_iNumUserMsgs++;
+
+	if( !strcmp( pszName, "ReqState" ))
+		sv.reqStateMsg = msg;
+
+	return msg;
+}
+
+static void PF_AnimationAutomove( const edict_t *pEdict, float flTime ) {}
+
+static void PF_GetBonePosition( const edict_t *pEdict, int iBone, float *rgflOrigin, float *rgflAngles )
+{
+	VectorCopy( pEdict->v.origin, rgflOrigin );
+	if( rgflAngles )
+		VectorCopy( pEdict->v.angles, rgflAngles );
+}
+
+static void *PF_FunctionFromName( const char *pName )
+{
+	return dlsym( sv.hGameDll, pName );
+}
+
+static const char *PF_NameForFunction( void *function )
+{
+	Dl_info info;
+
+	if( dladdr( function, &info ) && info.dli_sname )
+		return info.dli_sname;
+
+	return NULL;
+}
+
+static void PF_ClientPrintf( edict_t *pEdict, PRINT_TYPE ptype, const char *szMsg )
+{
+	if( sv.verbose )
+		printf( "to client %d: %s", PF_IndexOfEdict( pEdict ), szMsg );
+}
+
+// only chat echoes come through here
+static void PF_ServerPrint( const char *szMsg )
+{
+	if( sv.verbose )
+		printf( "%s", szMsg );
+}
+
+static const char *PF_Cmd_Args( void )
+{
+	return s_Args;
+}
+
+static const char *PF_Cmd_Argv( int argc )
+{
+	return ( argc >= 0 && argc < s_iArgc ) ? s_pArgv[argc] : "";
+}
+
+static int PF_Cmd_Argc( void )
+{
+	return s_iArgc;
+}
+
+static void PF_GetAttachment( const edict_t *pEdict, int iAttachment, float *rgflOrigin, float *rgflAngles )
+{
+	VectorCopy( pEdict->v.origin, rgflOrigin );
+	if( rgflAngles )
+		VectorCopy( pEdict->v.angles, rgflAngles );
+}
+
+static void PF_CRC32_Init( CRC32_t *pulCRC )
+{
+	*pulCRC = 0xFFFFFFFF;
+}
+
+static void PF_CRC32_ProcessByte( CRC32_t *pulCRC, unsigned char ch )
+{
+	CRC32_t crc = *pulCRC ^ ch;
+
+	for( int i = 0; i < 8; i++ )
+		crc = ( crc >> 1 ) ^ ( 0xEDB88320 & ( 0 - ( crc & 1 )));
+
+	*pulCRC = crc;
+}
+
+static void PF_CRC32_ProcessBuffer( CRC32_t *pulCRC, void *p, int len )
+{
+	for( int i = 0; i < len; i++ )
+		PF_CRC32_ProcessByte( pulCRC, ((unsigned char *)p)[i] );
+}
+
+static CRC32_t PF_CRC32_Final( CRC32_t pulCRC )
+{
+	return pulCRC ^ 0xFFFFFFFF;
+}
+
+static unsigned int SV_Random( void )
+{
+	sv.randSeed = sv.randSeed * 1103515245 + 12345;
+
+	return ( sv.randSeed >> 1 ) & 0x7FFFFFFF;
+}
+
+static int PF_RandomLong( int lLow, int lHigh )
+{
+	if( lHigh <= lLow )
+		return lLow;
+
+	return lLow + (int)( SV_Random() % (unsigned int)( lHigh - lLow + 1 ));
+}
+
+static float PF_RandomFloat( float flLow, float flHigh )
+{
+	return flLow + ( flHigh - flLow ) * ( SV_Random() / 2147483648.0f );
+}
+
+static void PF_SetView( const edict_t *pClient, const edict_t *pViewent ) {}
+
+static float PF_Time( void )
+{
+	return (float)sv.time;
+}
+
+static void PF_CrosshairAngle( const edict_t *pClient, float pitch, float yaw ) {}
+
+static byte *PF_LoadFileForMe( const char *filename, int *pLength )
+{
+	char path[MAX_PATH * 2];
+	FILE *f;
+
+	if( pLength )
+		*pLength = 0;
+
+	snprintf( path, sizeof( path ), "%s/%s", sv_gameDir, filename );
+
+	if( !( f = fopen( path, "rb" )))
+		return NULL;
+
+	fseek( f, 0, SEEK_END );
+	int len = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	byte *buffer = (byte *)malloc( len + 1 );
+
+	if( fread( buffer, 1, len, f ) != (size_t)len )
+		len = 0;
+
+	buffer[len] = 0;
+	fclose( f );
+
+	if( pLength )
+		*pLength = len;
+
+	return buffer;
+}
+
+static void PF_FreeFile( void *buffer )
+{
+	free( buffer );
+}
+
+static void PF_EndSection( const char *pszSectionName ) {}
+
+static int PF_CompareFileTime( char *filename1, char *filename2, int *iCompare )
+{
+	*iCompare = 0;
+	return 0;
+}
+
+static void PF_GetGameDir( char *szGetGameDir )
+{
+	strcpy( szGetGameDir, sv_gameDir );
+}
+
+static void PF_FadeClientVolume( const edict_t *pEdict, int fadePercent, int fadeOutSeconds, int holdTime, int fadeInSeconds ) {}
+
+static void PF_SetClientMaxspeed( const edict_t *pEdict, float fNewMaxspeed )
+{
+	((edict_t *)pEdict)->v.maxspeed = fNewMaxspeed;
+}
+
+static edict_t *PF_CreateFakeClient( const char *netname )
+{
+	for( int i = 1; i <= sv.maxClients; i++ )
+	{
+		edict_t *e = &sv.edicts[i];
+
+		if( !e->free || e->pvPrivateData )
+			continue;
+
+		SV_InitEdict( e );
+		e->v.netname = SV_AllocString( netname );
+		e->v.flags = FL_FAKECLIENT | FL_CLIENT;
+
+		snprintf( s_ClientInfo[i], SVB_INFO_STRING, "\\name\\%s\\model\\gordon\\topcolor\\0\\bottomcolor\\0", netname );
+		s_PhysInfo[i][0] = '\0';
+
+		return e;
+	}
+
+	return NULL;
+}
+
+static void PF_RunPlayerMove( edict_t *fakeclient, const float *viewangles, float forwardmove, float sidemove, float upmove, unsigned short buttons, byte impulse, byte msec )
+{
+	usercmd_t cmd;
+
+	memset( &cmd, 0, sizeof( cmd ));
+	VectorCopy( viewangles, cmd.viewangles );
+	cmd.forwardmove = forwardmove;
+	cmd.sidemove = sidemove;
+	cmd.upmove = upmove;
+	cmd.buttons = buttons;
+	cmd.impulse = impulse;
+	cmd.msec = msec;
+
+	SV_RunCmd( fakeclient, &cmd, PF_RandomLong( 0, 0x7FFFFFFF ));
+}
+
+static int PF_NumberOfEntities( void )
+{
+	int count = 0;
+
+	for( int i = 0; i < sv.numEdicts; i++ )
+	{
+		if( !sv.edicts[i].free )
+			count++;
+	}
+
+	return count;
+}
+
+static char *PF_GetInfoKeyBuffer( edict_t *e )
+{
+	if( !e )
+		return s_ServerInfo;
+
+	int client = SV_ClientIndex( e );
+
+	return client ? s_ClientInfo[client] : s_EmptyInfo;
+}
+
+static char *PF_InfoKeyValue( char *infobuffer, const char *key )
+{
+	return Info_ValueForKey( infobuffer, key );
+}
+
+static void PF_SetKeyValue( char *infobuffer, const char *key, const char *value )
+{
+	if( infobuffer != s_EmptyInfo )
+		Info_SetValueForKey( infobuffer, key, value );
+}
+
+static void PF_SetClientKeyValue( int clientIndex, char *infobuffer, const char *key, const char *value )
+{
+	if( infobuffer != s_EmptyInfo )
+		Info_SetValueForKey( infobuffer, key, value );
+}
+
+static int PF_IsMapValid( const char *filename ) { return 1; }
+static void PF_StaticDecal( const float *origin, int decalIndex, int entityIndex, int modelIndex ) {}
+
+static int PF_GetPlayerUserId( edict_t *e )
+{
+	int client = SV_ClientIndex( e );
+
+	return client ? client : -1;
+}
+
+static void PF_BuildSoundMsg( edict_t *entity, int channel, const char *sample, float volume, float attenuation, int fFlags, int pitch, int msg_dest, int msg_type, const float *pOrigin, edict_t *ed )
+{
+	sv.numSounds++;
+}
+
+static int PF_IsDedicatedServer( void ) { return 1; }
+
+static cvar_t *PF_CVarGetPointer( const char *szVarName )
+{
+	return SV_GetCvarPointer( szVarName );
+}
+
+static unsigned int PF_GetPlayerWONId( edict_t *e )
+{
+	return PF_GetPlayerUserId( e );
+}
+
+static void PF_Info_RemoveKey( char *s, const char *key )
+{
+	Info_RemoveKey( s, key );
+}
+
+static const char *PF_GetPhysicsKeyValue( const edict_t *pClient, const char *key )
+{
+	return Info_ValueForKey( s_PhysInfo[SV_ClientIndex( pClient )], key );
+}
+
+static void PF_SetPhysicsKeyValue( const edict_t *pClient, const char *key, const char *value )
+{
+	int client = SV_ClientIndex( pClient );
+
+	if( client )
+		Info_SetValueForKey( s_PhysInfo[client], key, value );
+}
+
+static const char *PF_GetPhysicsInfoString( const edict_t *pClient )
+{
+	return s_PhysInfo[SV_ClientIndex( pClient )];
+}
+
+static void PF_PlaybackEvent( int flags, const edict_t *pInvoker, unsigned short eventindex, float delay, const float *origin, const float *angles, float fparam1, float fparam2, int iparam1, int iparam2, int bparam1, int bparam2 )
+{
+	sv.numEvents++;
+}
+
+static unsigned char *PF_SetFatPVS( const float *org )
+{
+	return s_FatPVS;
+}
+
+static unsigned char *PF_SetFatPAS( const float *org )
+{
+	return s_FatPVS;
+}
+
+static int PF_CheckVisibility( const edict_t *entity, unsigned char *pset )
+{
+	return 1;
+}
+
+static void PF_DeltaSetField( struct delta_s *pFields, const char *fieldname ) {}
+static void PF_DeltaUnsetField( struct delta_s *pFields, const char *fieldname ) {}
+static void PF_DeltaAddEncoder( const char *name, void ( *conditionalencode )( struct delta_s *pFields, const unsigned char *from, const unsigned char *to )) {}
+
+static int PF_GetCurrentPlayer( void )
+{
+	return sv_currentPlayer;
+}
+
+static int PF_CanSkipPlayer( const edict_t *player )
+{
+	int client = SV_ClientIndex( player );
+
+	return client ? atoi( Info_ValueForKey( s_ClientInfo[client], "cl_lw" )) : 0;
+}
+
+static int PF_DeltaFindField( struct delta_s *pFields, const char *fieldname ) { return -1; }
+static void PF_DeltaSetFieldByIndex( struct delta_s *pFields, int fieldNumber ) {}
+static void PF_DeltaUnsetFieldByIndex( struct delta_s *pFields, int fieldNumber ) {}
+static void PF_SetGroupMask( int mask, int op ) {}
+static int PF_CreateInstancedBaseline( int classname, struct entity_state_s *baseline ) { return 0; }
+
+static void PF_Cvar_DirectSet( struct cvar_s *var, const char *value )
+{
+	SV_DirectSetCvar( var, value );
+}
+
+static void PF_ForceUnmodified( FORCE_TYPE type, const float *mins, const float *maxs, const char *filename ) {}
+
+static void PF_GetPlayerStats( const edict_t *pClient, int *ping, int *packet_loss )
+{
+	*ping = 0;
+	*packet_loss = 0;
+}
+
+static void PF_AddServerCommand( const char *cmd_name, void ( *function )( void ))
+{
+	if( s_iNumCommands >= SVB_MAX_COMMANDS )
+		Sys_Error( "PF_AddServerCommand: too many commands\n" );
+
+	strncpy( s_Commands[s_iNumCommands].name, cmd_name, sizeof( s_Commands[0].name ) - 1 );
+	s_Commands[s_iNumCommands].function = function;
+	s_iNumCommands++;
+}
+
+static qboolean PF_Voice_GetClientListening( int iReceiver, int iSender )
+{
+	if( iReceiver < 1 || iReceiver > sv.maxClients || iSender < 1 || iSender > sv.maxClients )
+		return false;
+
+	return ( s_VoiceListening[iReceiver] >> ( iSender - 1 )) & 1;
+}
+
+static qboolean PF_Voice_SetClientListening( int iReceiver, int iSender, qboolean bListen )
+{
+	if( iReceiver < 1 || iReceiver > sv.maxClients || iSender < 1 || iSender > sv.maxClients )
+		return false;
+
+	if( bListen )
+		s_VoiceListening[iReceiver] |= 1U << ( iSender - 1 );
+	else
+		s_VoiceListening[iReceiver] &= ~( 1U << ( iSender - 1 ));
+
+	return true;
+}
+
+static const char *PF_GetPlayerAuthId( edict_t *e )
+{
+	return SV_ClientIndex( e ) ? "STEAM_ID_LAN" : "";
+}
+
+static void *PF_SequenceGet( const char *fileName, const char *entryName ) { return NULL; }
+static void *PF_SequencePickSentence( const char *groupName, int pickMethod, int *picked ) { return NULL; }
+
+static int PF_GetFileSize( const char *filename )
+{
+	char path[MAX_PATH * 2];
+	struct stat st;
+
+	snprintf( path, sizeof( path ), "%s/%s", sv_gameDir, filename );
+
+	return stat( path, &st ) ? -1 : (int)st.st_size;
+}
+
+static unsigned int PF_GetApproxWavePlayLen( const char *filepath ) { return 0; }
+static int PF_IsCareerMatch( void ) { return 0; }
+static int PF_GetLocalizedStringLength( const char *label ) { return 0; }
+static void PF_RegisterTutorMessageShown( int mid ) {}
+static int PF_GetTimesTutorMessageShown( int mid ) { return 0; }
+static void PF_ProcessTutorMessageDecayBuffer( int *buffer, int bufferLength ) {}
+static void PF_ConstructTutorMessageDecayBuffer( int *buffer, int bufferLength ) {}
+static void PF_ResetTutorMessageDecayData( void ) {}
+static void PF_QueryClientCvarValue( const edict_t *player, const char *cvarName ) {}
+static void PF_QueryClientCvarValue2( const edict_t *player, const char *cvarName, int requestID ) {}
+static int PF_CheckParm( char *parm, char **ppnext ) { return 0; }
+
+void SV_InitEngine( void )
+{
+	enginefuncs_t *e = &g_svEngineFuncs;
+
+	memset( e, 0, sizeof( *e ));
+	memset( s_FatPVS, 0xFF, sizeof( s_FatPVS ));
+
+	e->pfnPrecacheModel = PF_PrecacheModel;
+	e->pfnPrecacheSound = PF_PrecacheSound;
+	e->pfnSetModel = PF_SetModel;
+	e->pfnModelIndex = PF_ModelIndex;
+	e->pfnModelFrames = PF_ModelFrames;
+	e->pfnSetSize = PF_SetSize;
+	e->pfnChangeLevel = PF_ChangeLevel;
+	e->pfnGetSpawnParms = PF_GetSpawnParms;
+	e->pfnSaveSpawnParms = PF_SaveSpawnParms;
+	e->pfnVecToYaw = PF_VecToYaw;
+	e->pfnVecToAngles = PF_VecToAngles;
+	e->pfnMoveToOrigin = PF_MoveToOrigin;
+	e->pfnChangeYaw = PF_ChangeYaw;
+	e->pfnChangePitch = PF_ChangePitch;
+	e->pfnFindEntityByString = PF_FindEntityByString;
+	e->pfnGetEntityIllum = PF_GetEntityIllum;
+	e->pfnFindEntityInSphere = PF_FindEntityInSphere;
+	e->pfnFindClientInPVS = PF_FindClientInPVS;
+	e->pfnEntitiesInPVS = PF_EntitiesInPVS;
+	e->pfnMakeVectors = PF_MakeVectors;
+	e->pfnAngleVectors = PF_AngleVectors;
+	e->pfnCreateEntity = PF_CreateEntity;
+	e->pfnRemoveEntity = PF_RemoveEntity;
+	e->pfnCreateNamedEntity = PF_CreateNamedEntity;
+	e->pfnMakeStatic = PF_MakeStatic;
+	e->pfnEntIsOnFloor = PF_EntIsOnFloor;
+	e->pfnDropToFloor = PF_DropToFloor;
+	e->pfnWalkMove = PF_WalkMove;
+	e->pfnSetOrigin = PF_SetOrigin;
+	e->pfnEmitSound = PF_EmitSound;
+	e->pfnEmitAmbientSound = PF_EmitAmbientSound;
+	e->pfnTraceLine = SV_TraceLine;
+	e->pfnTraceToss = PF_TraceToss;
+	e->pfnTraceMonsterHull = PF_TraceMonsterHull;
+	e->pfnTraceHull = SV_TraceHull;
+	e->pfnTraceModel = SV_TraceModel;
+	e->pfnTraceTexture = PF_TraceTexture;
+	e->pfnTraceSphere = PF_TraceSphere;
+	e->pfnGetAimVector = PF_GetAimVector;
+	e->pfnServerCommand = PF_ServerCommand;
+	e->pfnServerExecute = PF_ServerExecute;
+	e->pfnClientCommand = PF_ClientCommand;
+	e->pfnParticleEffect = PF_ParticleEffect;
+	e->pfnLightStyle = PF_LightStyle;
+	e->pfnDecalIndex = PF_DecalIndex;
+	e->pfnPointContents = PF_PointContents;
+	e->pfnMessageBegin = PF_MessageBegin;
+	e->pfnMessageEnd = PF_MessageEnd;
+	e->pfnWriteByte = PF_WriteByte;
+	e->pfnWriteChar = PF_WriteChar;
+	e->pfnWriteShort = PF_WriteShort;
+	e->pfnWriteLong = PF_WriteLong;
+	e->pfnWriteAngle = PF_WriteAngle;
+	e->pfnWriteCoord = PF_WriteCoord;
+	e->pfnWriteString = PF_WriteString;
+	e->pfnWriteEntity = PF_WriteEntity;
+	e->pfnCVarRegister = SV_RegisterCvar;
+	e->pfnCVarGetFloat = PF_CVarGetFloat;
+	e->pfnCVarGetString = PF_CVarGetString;
+	e->pfnCVarSetFloat = PF_CVarSetFloat;
+	e->pfnCVarSetString = PF_CVarSetString;
+	e->pfnAlertMessage = PF_AlertMessage;
+	e->pfnEngineFprintf = PF_EngineFprintf;
+	e->pfnPvAllocEntPrivateData = PF_PvAllocEntPrivateData;
+	e->pfnPvEntPrivateData = PF_PvEntPrivateData;
+	e->pfnFreeEntPrivateData = PF_FreeEntPrivateData;
+	e->pfnSzFromIndex = PF_SzFromIndex;
+	e->pfnAllocString = PF_AllocString;
+	e->pfnGetVarsOfEnt = PF_GetVarsOfEnt;
+	e->pfnPEntityOfEntOffset = PF_PEntityOfEntOffset;
+	e->pfnEntOffsetOfPEntity = PF_EntOffsetOfPEntity;
+	e->pfnIndexOfEdict = PF_IndexOfEdict;
+	e->pfnPEntityOfEntIndex = PF_PEntityOfEntIndex;
+	e->pfnFindEntityByVars = PF_FindEntityByVars;
+	e->pfnGetModelPtr = PF_GetModelPtr;
+	e->pfnRegUserMsg = PF_RegUserMsg;
+	e->pfnAnimationAutomove = PF_AnimationAutomove;
+	e->pfnGetBonePosition = PF_GetBonePosition;
+	e->pfnFunctionFromName = PF_FunctionFromName;
+	e->pfnNameForFunction = PF_NameForFunction;
+	e->pfnClientPrintf = PF_ClientPrintf;
+	e->pfnServerPrint = PF_ServerPrint;
+	e->pfnCmd_Args = PF_Cmd_Args;
+	e->pfnCmd_Argv = PF_Cmd_Argv;
+	e->pfnCmd_Argc = PF_Cmd_Argc;
+	e->pfnGetAttachment = PF_GetAttachment;
+	e->pfnCRC32_Init = PF_CRC32_Init;
+	e->pfnCRC32_ProcessBuffer = PF_CRC32_ProcessBuffer;
+	e->pfnCRC32_ProcessByte = PF_CRC32_ProcessByte;
+	e->pfnCRC32_Final = PF_CRC32_Final;
+	e->pfnRandomLong = PF_RandomLong;
+	e->pfnRandomFloat = PF_RandomFloat;
+	e->pfnSetView = PF_SetView;
+	e->pfnTime = PF_Time;
+	e->pfnCrosshairAngle = PF_CrosshairAngle;
+	e->pfnLoadFileForMe = PF_LoadFileForMe;
+	e->pfnFreeFile = PF_FreeFile;
+	e->pfnEndSection = PF_EndSection;
+	e->pfnCompareFileTime = PF_CompareFileTime;
+	e->pfnGetGameDir = PF_GetGameDir;
+	e->pfnCvar_RegisterVariable = SV_RegisterCvar;
+	e->pfnFadeClientVolume = PF_FadeClientVolume;
+	e->pfnSetClientMaxspeed = PF_SetClientMaxspeed;
+	e->pfnCreateFakeClient = PF_CreateFakeClient;
+	e->pfnRunPlayerMove = PF_RunPlayerMove;
+	e->pfnNumberOfEntities = PF_NumberOfEntities;
+	e->pfnGetInfoKeyBuffer = PF_GetInfoKeyBuffer;
+	e->pfnInfoKeyValue = PF_InfoKeyValue;
+	e->pfnSetKeyValue = PF_SetKeyValue;
+	e->pfnSetClientKeyValue = PF_SetClientKeyValue;
+	e->pfnIsMapValid = PF_IsMapValid;
+	e->pfnStaticDecal = PF_StaticDecal;
+	e->pfnPrecacheGeneric = PF_PrecacheGeneric;
+	e->pfnGetPlayerUserId = PF_GetPlayerUserId;
+	e->pfnBuildSoundMsg = PF_BuildSoundMsg;
+	e->pfnIsDedicatedServer = PF_IsDedicatedServer;
+	e->pfnCVarGetPointer = PF_CVarGetPointer;
+	e->pfnGetPlayerWONId = PF_GetPlayerWONId;
+	e->pfnInfo_RemoveKey = PF_Info_RemoveKey;
+	e->pfnGetPhysicsKeyValue = PF_GetPhysicsKeyValue;
+	e->pfnSetPhysicsKeyValue = PF_SetPhysicsKeyValue;
+	e->pfnGetPhysicsInfoString = PF_GetPhysicsInfoString;
+	e->pfnPrecacheEvent = PF_PrecacheEvent;
+	e->pfnPlaybackEvent = PF_PlaybackEvent;
+	e->pfnSetFatPVS = PF_SetFatPVS;
+	e->pfnSetFatPAS = PF_SetFatPAS;
+	e->pfnCheckVisibility = PF_CheckVisibility;
+	e->pfnDeltaSetField = PF_DeltaSetField;
+	e->pfnDeltaUnsetField = PF_DeltaUnsetField;
+	e->pfnDeltaAddEncoder = PF_DeltaAddEncoder;
+	e->pfnGetCurrentPlayer = PF_GetCurrentPlayer;
+	e->pfnCanSkipPlayer = PF_CanSkipPlayer;
+	e->pfnDeltaFindField = PF_DeltaFindField;
+	e->pfnDeltaSetFieldByIndex = PF_DeltaSetFieldByIndex;
+	e->pfnDeltaUnsetFieldByIndex = PF_DeltaUnsetFieldByIndex;
+	e->pfnSetGroupMask = PF_SetGroupMask;
+	e->pfnCreateInstancedBaseline = PF_CreateInstancedBaseline;
+	e->pfnCvar_DirectSet = PF_Cvar_DirectSet;
+	e->pfnForceUnmodified = PF_ForceUnmodified;
+	e->pfnGetPlayerStats = PF_GetPlayerStats;
+	e->pfnAddServerCommand = PF_AddServerCommand;
+	e->pfnVoice_GetClientListening = PF_Voice_GetClientListening;
+	e->pfnVoice_SetClientListening = PF_Voice_SetClientListening;
+	e->pfnGetPlayerAuthId = PF_GetPlayerAuthId;
+	e->pfnSequenceGet = PF_SequenceGet;
+	e->pfnSequencePickSentence = PF_SequencePickSentence;
+	e->pfnGetFileSize = PF_GetFileSize;
+	e->pfnGetApproxWavePlayLen = PF_GetApproxWavePlayLen;
+	e->pfnIsCareerMatch = PF_IsCareerMatch;
+	e->pfnGetLocalizedStringLength = PF_GetLocalizedStringLength;
+	e->pfnRegisterTutorMessageShown = PF_RegisterTutorMessageShown;
+	e->pfnGetTimesTutorMessageShown = PF_GetTimesTutorMessageShown;
+	e->pfnProcessTutorMessageDecayBuffer = PF_ProcessTutorMessageDecayBuffer;
+	e->pfnConstructTutorMessageDecayBuffer = PF_ConstructTutorMessageDecayBuffer;
+	e->pfnResetTutorMessageDecayData = PF_ResetTutorMessageDecayData;
+	e->pfnQueryClientCvarValue = PF_QueryClientCvarValue;
+	e->pfnQueryClientCvarValue2 = PF_QueryClientCvarValue2;
+	e->CheckParm = PF_CheckParm;
+	e->pfnPEntityOfEntIndexAllEntities = PF_PEntityOfEntIndexAllEntities;
+
+	// offset 0 is the empty string
+	s_iStringPoolUsed = 1;
+	sv.globals.pStringBase = s_StringPool;
+}
@@ -0,0 +1,746 @@
+/***
+*
+*   svbench - collision and entity physics
+*
+*   There is no bsp, the map is a closed box and every entity
+*   collides as its bounding box.  That is enough to keep the
+*   game code on its usual paths: traces hit players, grenades
+*   land and bounce, triggers get touched.
+*
+***/
+
+#include "svbench.h"
+
+#define DIST_EPSILON	( 1.0f / 32.0f )
+#define STOP_EPSILON	0.1f
+#define MAX_TOUCHES	256
+
+// fNoMonsters of the traces
+#define MOVE_NORMAL	0
+#define MOVE_NOMONSTERS	1
+
+static const float s_HullMins[4][3] =
+{
+	{ 0, 0, 0 },
+	{ -16, -16, -36 },
+	{ -32, -32, -32 },
+	{ -16, -16, -18 },
+};
+
+static const float s_HullMaxs[4][3] =
+{
+	{ 0, 0, 0 },
+	{ 16, 16, 36 },
+	{ 32, 32, 32 },
+	{ 16, 16, 18 },
+};
+
+static void SV_ClearTrace( const float *end, TraceResult *ptr )
+{
+	memset( ptr, 0, sizeof( *ptr ));
+	ptr->flFraction = 1.0f;
+	ptr->fInOpen = 1;
+	ptr->pHit = sv.edicts;
+	VectorCopy( end, ptr->vecEndPos );
+}
+
+/*
+==================
+SV_ClipToBox
+
+Sweeps the box mins/maxs from start to end against the solid
+box boxmins/boxmaxs, shortening the trace on a hit.
+==================
+*/
+static BOOL SV_ClipToBox( const float *start, const float *end, const float *mins, const float *maxs,
+	const float *boxmins, const float *boxmaxs, TraceResult *ptr )
+{
+	float enterFrac = -1.0f, leaveFrac = 1.0f;
+	int enterAxis = -1;
+	float enterSign = 0;
+	BOOL startOut = FALSE;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		// grow the box by the moving one, then it's a line test
+		float lo = boxmins[i] - maxs[i];
+		float hi = boxmaxs[i] - mins[i];
+		float d = end[i] - start[i];
+
+		if( start[i] < lo || start[i] > hi )
+			startOut = TRUE;
+
+		if( d == 0.0f )
+		{
+			if( start[i] <= lo || start[i] >= hi )
+				return FALSE;
+			continue;
+		}
+
+		float t1 = ( lo - start[i] ) / d;
+		float t2 = ( hi - start[i] ) / d;
+		float sign = -1.0f;
+
+		if( t1 > t2 )
+		{
+			float t = t1;
+			t1 = t2;
+			t2 = t;
+			sign = 1.0f;
+		}
+
+		if( t1 > enterFrac )
+		{
+			enterFrac = t1;
+			enterAxis = i;
+			enterSign = sign;
+		}
+
+		if( t2 < leaveFrac )
+			leaveFrac = t2;
+
+		if( enterFrac > leaveFrac )
+			return FALSE;
+	}
+
+	if( !startOut )
+	{
+		ptr->fStartSolid = 1;
+		if( leaveFrac >= 1.0f )
+			ptr->fAllSolid = 1;
+		ptr->flFraction = 0.0f;
+		VectorCopy( start, ptr->vecEndPos );
+		return TRUE;
+	}
+
+	if( enterFrac < 0.0f || enterFrac >= ptr->flFraction || enterAxis == -1 )
+		return FALSE;
+
+	float len = sqrt(( end[0] - start[0] ) * ( end[0] - start[0] ) + ( end[1] - start[1] ) * ( end[1] - start[1] )
+		+ ( end[2] - start[2] ) * ( end[2] - start[2] ));
+	float frac = Q_max( enterFrac - DIST_EPSILON / Q_max( len, 1.0f ), 0.0f );
+
+	ptr->flFraction = frac;
+	ptr->fInOpen = 0;
+	memset( ptr->vecPlaneNormal, 0, sizeof( ptr->vecPlaneNormal ));
+	ptr->vecPlaneNormal[enterAxis] = enterSign;
+	ptr->flPlaneDist = enterSign > 0 ? boxmaxs[enterAxis] : -boxmins[enterAxis];
+
+	for( int i = 0; i < 3; i++ )
+		ptr->vecEndPos[i] = start[i] + frac * ( end[i] - start[i] );
+
+	return TRUE;
+}
+
+// the inside of the world box is empty, everything else is solid
+static void SV_ClipToWorld( const float *start, const float *end, const float *mins, const float *maxs, TraceResult *ptr )
+{
+	const float worldMins[3] = { -SVB_WORLD_SIZE, -SVB_WORLD_SIZE, 0 };
+	const float worldMaxs[3] = { SVB_WORLD_SIZE, SVB_WORLD_SIZE, SVB_WORLD_HEIGHT };
+	float frac = 1.0f;
+	int axis = -1;
+	float sign = 0;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		float lo = worldMins[i] - mins[i];
+		float hi = worldMaxs[i] - maxs[i];
+
+		if( start[i] < lo || start[i] > hi )
+		{
+			ptr->fStartSolid = ptr->fAllSolid = 1;
+			ptr->flFraction = 0.0f;
+			VectorCopy( start, ptr->vecEndPos );
+			return;
+		}
+
+		float d = end[i] - start[i];
+		float t = 1.0f;
+
+		if( d < 0.0f && end[i] < lo )
+			t = ( lo - start[i] ) / d;
+		else if( d > 0.0f && end[i] > hi )
+			t = ( hi - start[i] ) / d;
+
+		if( t < frac )
+		{
+			frac = t;
+			axis = i;
+			sign = d < 0.0f ? 1.0f : -1.0f;
+		}
+	}
+
+	if( axis == -1 )
+		return;
+
+	ptr->flFraction = frac;
+	ptr->fInOpen = 0;
+	ptr->pHit = sv.edicts;
+	memset( ptr->vecPlaneNormal, 0, sizeof( ptr->vecPlaneNormal ));
+	ptr->vecPlaneNormal[axis] = sign;
+	ptr->flPlaneDist = sign > 0 ? worldMins[axis] : -worldMaxs[axis];
+
+	for( int i = 0; i < 3; i++ )
+		ptr->vecEndPos[i] = start[i] + frac * ( end[i] - start[i] );
+}
+
+static BOOL SV_ShouldClip( edict_t *touch, int fNoMonsters, edict_t *passedict )
+{
+	if( touch->free || touch->v.solid == SOLID_NOT || touch->v.solid == SOLID_TRIGGER )
+		return FALSE;
+
+	if( touch == passedict )
+		return FALSE;
+
+	if( fNoMonsters == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP )
+		return FALSE;
+
+	if( passedict && ( touch->v.owner == passedict || passedict->v.owner == touch ))
+		return FALSE;
+
+	// dead bodies and the like
+	if( touch->v.flags & FL_CLIENT && touch->v.deadflag >= DEAD_DEAD )
+		return FALSE;
+
+	return TRUE;
+}
+
+void SV_TraceBox( const float *v1, const float *v2, const float *mins, const float *maxs, int fNoMonsters, edict_t *pentToSkip, TraceResult *ptr )
+{
+	TraceResult tr;
+
+	sv.numTraces++;
+
+	SV_ClearTrace( v1, ptr );
+	ptr->flFraction = 1.0f;
+	VectorCopy( v2, ptr->vecEndPos );
+
+	SV_ClipToWorld( v1, v2, mins, maxs, ptr );
+
+	if( ptr->fAllSolid )
+		return;
+
+	for( int i = 1; i < sv.numEdicts; i++ )
+	{
+		edict_t *touch = &sv.edicts[i];
+
+		if( !SV_ShouldClip( touch, fNoMonsters, pentToSkip ))
+			continue;
+
+		tr = *ptr;
+
+		if( !SV_ClipToBox( v1, v2, mins, maxs, touch->v.absmin, touch->v.absmax, &tr ))
+			continue;
+
+		if( tr.fStartSolid )
+		{
+			// stuck inside something, keep going like the engine does
+			ptr->fStartSolid = 1;
+			ptr->pHit = touch;
+			continue;
+		}
+
+		*ptr = tr;
+		ptr->pHit = touch;
+		ptr->iHitgroup = 0;
+	}
+}
+
+void SV_TraceLine( const float *v1, const float *v2, int fNoMonsters, edict_t *pentToSkip, TraceResult *ptr )
+{
+	SV_TraceBox( v1, v2, s_HullMins[0], s_HullMaxs[0], fNoMonsters & 1, pentToSkip, ptr );
+}
+
+void SV_TraceHull( const float *v1, const float *v2, int fNoMonsters, int hullNumber, edict_t *pentToSkip, TraceResult *ptr )
+{
+	if( hullNumber < 0 || hullNumber > 3 )
+		hullNumber = 0;
+
+	SV_TraceBox( v1, v2, s_HullMins[hullNumber], s_HullMaxs[hullNumber], fNoMonsters, pentToSkip, ptr );
+}
+
+void SV_TraceModel( const float *v1, const float *v2, int hullNumber, edict_t *pent, TraceResult *ptr )
+{
+	if( hullNumber < 0 || hullNumber > 3 )
+		hullNumber = 0;
+
+	sv.numTraces++;
+
+	SV_ClearTrace( v2, ptr );
+
+	if( SV_ClipToBox( v1, v2, s_HullMins[hullNumber], s_HullMaxs[hullNumber], pent->v.absmin, pent->v.absmax, ptr ))
+		ptr->pHit = pent;
+}
+
+int SV_PointContents( const float *p )
+{
+	if( p[0] <= -SVB_WORLD_SIZE || p[0] >= SVB_WORLD_SIZE || p[1] <= -SVB_WORLD_SIZE || p[1] >= SVB_WORLD_SIZE
+		|| p[2] <= 0 || p[2] >= SVB_WORLD_HEIGHT )
+		return CONTENTS_SOLID;
+
+	return CONTENTS_EMPTY;
+}
+
+/*
+==============================================================================
+
+LINKING
+
+==============================================================================
+*/
+static void SV_SetGlobalTrace( TraceResult *ptr )
+{
+	sv.globals.trace_allsolid = ptr->fAllSolid;
+	sv.globals.trace_startsolid = ptr->fStartSolid;
+	sv.globals.trace_fraction = ptr->flFraction;
+	sv.globals.trace_inwater = ptr->fInWater;
+	sv.globals.trace_inopen = ptr->fInOpen;
+	VectorCopy( ptr->vecEndPos, sv.globals.trace_endpos );
+	VectorCopy( ptr->vecPlaneNormal, sv.globals.trace_plane_normal );
+	sv.globals.trace_plane_dist = ptr->flPlaneDist;
+	sv.globals.trace_ent = ptr->pHit;
+	sv.globals.trace_hitgroup = ptr->iHitgroup;
+}
+
+static void SV_TouchTriggers( edict_t *e )
+{
+	edict_t *touches[MAX_TOUCHES];
+	int i, count = 0;
+
+	for( i = 1; i < sv.numEdicts && count < MAX_TOUCHES; i++ )
+	{
+		edict_t *trigger = &sv.edicts[i];
+
+		if( trigger == e || trigger->free || trigger->v.solid != SOLID_TRIGGER )
+			continue;
+
+		if( e->v.absmin[0] > trigger->v.absmax[0] || e->v.absmin[1] > trigger->v.absmax[1] || e->v.absmin[2] > trigger->v.absmax[2]
+			|| e->v.absmax[0] < trigger->v.absmin[0] || e->v.absmax[1] < trigger->v.absmin[1] || e->v.absmax[2] < trigger->v.absmin[2] )
+			continue;
+
+		touches[count++] = trigger;
+	}
+
+	// the touch functions may relink things, so the list is made first
+	for( i = 0; i < count; i++ )
+	{
+		if( touches[i]->free || e->free )
+			continue;
+
+		TraceResult tr;
+
+		SV_ClearTrace( e->v.origin, &tr );
+		tr.pHit = e;
+		SV_SetGlobalTrace( &tr );
+
+		sv.dllFuncs.pfnTouch( touches[i], e );
+	}
+}
+
+void SV_LinkEdict( edict_t *e, BOOL touchTriggers )
+{
+	if( e->free || e == sv.edicts )
+		return;
+
+	sv.dllFuncs.pfnSetAbsBox( e );
+
+	if( touchTriggers && e->v.solid != SOLID_NOT )
+		SV_TouchTriggers( e );
+}
+
+/*
+==============================================================================
+
+PHYSICS
+
+==============================================================================
+*/
+static void SV_Impact( edict_t *e1, edict_t *e2, TraceResult *ptr )
+{
+	sv.globals.time = sv.time;
+
+	if( e1->v.solid != SOLID_NOT && !e1->free )
+	{
+		SV_SetGlobalTrace( ptr );
+		sv.dllFuncs.pfnTouch( e1, e2 );
+	}
+
+	if( e2->v.solid != SOLID_NOT && !e2->free && !e1->free )
+	{
+		SV_SetGlobalTrace( ptr );
+		sv.globals.trace_ent = e1;
+		sv.dllFuncs.pfnTouch( e2, e1 );
+	}
+}
+
+static BOOL SV_RunThink( edict_t *e )
+{
+	float thinktime = e->v.nextthink;
+
+	if( thinktime <= 0.0f || thinktime > sv.time + sv.globals.frametime )
+		return TRUE;
+
+	if( thinktime < sv.time )
+		thinktime = sv.time;
+
+	e->v.nextthink = 0.0f;
+	sv.globals.time = thinktime;
+	sv.dllFuncs.pfnThink( e );
+
+	if( e->v.flags & FL_KILLME )
+		SV_FreeEdict( e );
+
+	return !e->free;
+}
+
+static void SV_CheckVelocity( edict_t *e )
+{
+	float maxVelocity = g_svEngineFuncs.pfnCVarGetFloat( "sv_maxvelocity" );
+
+	for( int i = 0; i < 3; i++ )
+	{
+		if( e->v.velocity[i] > maxVelocity )
+			e->v.velocity[i] = maxVelocity;
+		else if( e->v.velocity[i] < -maxVelocity )
+			e->v.velocity[i] = -maxVelocity;
+	}
+}
+
+static void SV_AddGravity( edict_t *e )
+{
+	float gravity = e->v.gravity ? e->v.gravity : 1.0f;
+
+	e->v.velocity[2] -= gravity * g_svEngineFuncs.pfnCVarGetFloat( "sv_gravity" ) * sv.globals.frametime;
+	e->v.velocity[2] += e->v.basevelocity[2] * sv.globals.frametime;
+	e->v.basevelocity[2] = 0;
+
+	SV_CheckVelocity( e );
+}
+
+static void SV_ClipVelocity( float *in, const float *normal, float *out, float overbounce )
+{
+	float backoff = DotProduct( in, normal ) * overbounce;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		out[i] = in[i] - normal[i] * backoff;
+
+		if( out[i] > -STOP_EPSILON && out[i] < STOP_EPSILON )
+			out[i] = 0;
+	}
+}
+
+// moves e by its velocity, returns the trace of what it ran into
+static void SV_PushEntity( edict_t *e, const float *push, TraceResult *ptr )
+{
+	vec3_t end;
+	int fNoMonsters = ( e->v.solid == SOLID_NOT || e->v.solid == SOLID_TRIGGER ) ? MOVE_NOMONSTERS : MOVE_NORMAL;
+
+	VectorAdd( e->v.origin, push, end );
+	SV_TraceBox( e->v.origin, end, e->v.mins, e->v.maxs, fNoMonsters, e, ptr );
+
+	if( ptr->flFraction != 0.0f )
+		VectorCopy( ptr->vecEndPos, e->v.origin );
+
+	SV_LinkEdict( e, TRUE );
+
+	if( ptr->flFraction != 1.0f && !e->free )
+		SV_Impact( e, ptr->pHit, ptr );
+}
+
+static void SV_Physics_Toss( edict_t *e )
+{
+	vec3_t move;
+	TraceResult tr;
+
+	if( !SV_RunThink( e ))
+		return;
+
+	if( e->v.flags & FL_ONGROUND )
+	{
+		if( e->v.velocity[2] > 0.0f || !e->v.groundentity || ( e->v.groundentity->v.flags & FL_CONVEYOR ))
+			e->v.flags &= ~FL_ONGROUND;
+		else
+			return;
+	}
+
+	SV_CheckVelocity( e );
+
+	if( e->v.movetype != MOVETYPE_FLY && e->v.movetype != MOVETYPE_FLYMISSILE )
+		SV_AddGravity( e );
+
+	VectorMA( e->v.angles, sv.globals.frametime, e->v.avelocity, e->v.angles );
+	VectorScale( e->v.velocity, sv.globals.frametime, move );
+
+	SV_PushEntity( e, move, &tr );
+
+	if( e->free || tr.flFraction == 1.0f || tr.fAllSolid )
+		return;
+
+	float backoff = e->v.movetype == MOVETYPE_BOUNCE ? 2.0f - e->v.friction : 1.0f;
+
+	SV_ClipVelocity( e->v.velocity, tr.vecPlaneNormal, e->v.velocity, backoff );
+
+	// stop if on ground
+	if( tr.vecPlaneNormal[2] > 0.7f )
+	{
+		if( e->v.velocity[2] < 60.0f || e->v.movetype != MOVETYPE_BOUNCE )
+		{
+			e->v.flags |= FL_ONGROUND;
+			e->v.groundentity = tr.pHit;
+			VectorClear( e->v.velocity );
+			VectorClear( e->v.avelocity );
+		}
+	}
+}
+
+static void SV_Physics_Step( edict_t *e )
+{
+	vec3_t move;
+	TraceResult tr;
+
+	if( !( e->v.flags & ( FL_ONGROUND | FL_FLY | FL_SWIM )))
+	{
+		SV_AddGravity( e );
+		VectorScale( e->v.velocity, sv.globals.frametime, move );
+		SV_PushEntity( e, move, &tr );
+
+		if( !e->free && tr.flFraction != 1.0f && tr.vecPlaneNormal[2] > 0.7f )
+		{
+			e->v.flags |= FL_ONGROUND;
+			e->v.groundentity = tr.pHit;
+			VectorClear( e->v.velocity );
+		}
+	}
+
+	if( !e->free )
+		SV_RunThink( e );
+}
+
+static void SV_Physics_Push( edict_t *e )
+{
+	float oldltime = e->v.ltime;
+	float thinktime = e->v.nextthink;
+	float movetime = sv.globals.frametime;
+
+	if( thinktime < e->v.ltime + movetime )
+		movetime = Q_max( thinktime - e->v.ltime, 0.0f );
+
+	// no blocking, pushers just go where they are told
+	if( movetime )
+	{
+		e->v.ltime += movetime;
+		VectorMA( e->v.origin, movetime, e->v.velocity, e->v.origin );
+		VectorMA( e->v.angles, movetime, e->v.avelocity, e->v.angles );
+		SV_LinkEdict( e, TRUE );
+	}
+
+	if( !e->free && thinktime > oldltime && thinktime <= e->v.ltime )
+	{
+		e->v.nextthink = 0;
+		sv.globals.time = sv.time;
+		sv.dllFuncs.pfnThink( e );
+
+		if( e->v.flags & FL_KILLME )
+			SV_FreeEdict( e );
+	}
+}
+
+static void SV_Physics_Noclip( edict_t *e )
+{
+	if( !SV_RunThink( e ))
+		return;
+
+	VectorMA( e->v.angles, sv.globals.frametime, e->v.avelocity, e->v.angles );
+	VectorMA( e->v.origin, sv.globals.frametime, e->v.velocity, e->v.origin );
+	SV_LinkEdict( e, FALSE );
+}
+
+static void SV_Physics_Follow( edict_t *e )
+{
+	if( !SV_RunThink( e ))
+		return;
+
+	edict_t *parent = e->v.aiment;
+
+	if( !parent || parent->free )
+	{
+		e->v.movetype = MOVETYPE_NONE;
+		return;
+	}
+
+	VectorAdd( parent->v.origin, e->v.v_angle, e->v.origin );
+	VectorCopy( parent->v.angles, e->v.angles );
+	SV_LinkEdict( e, TRUE );
+}
+
+/*
+==================
+SV_Physics
+
+Runs the thinks and moves of everything but the players, who
+move in SV_RunCmd when their commands come in.  The caller runs
+StartFrame first, so it can be timed on its own.
+==================
+*/
+void SV_Physics( void )
+{
+	sv.globals.time = sv.time;
+
+	for( int i = 0; i < sv.numEdicts; i++ )
+	{
+		edict_t *e = &sv.edicts[i];
+
+		if( e->free )
+			continue;
+
+		if( sv.globals.force_retouch != 0.0f )
+			SV_LinkEdict( e, TRUE );
+
+		if( e->free )
+			continue;
+
+		if( i > 0 && i <= sv.maxClients )
+		{
+			SV_RunThink( e );
+			continue;
+		}
+
+		switch( (int)e->v.movetype )
+		{
+		case MOVETYPE_PUSH:
+			SV_Physics_Push( e );
+			break;
+		case MOVETYPE_NONE:
+			SV_RunThink( e );
+			break;
+		case MOVETYPE_FOLLOW:
+			SV_Physics_Follow( e );
+			break;
+		case MOVETYPE_NOCLIP:
+			SV_Physics_Noclip( e );
+			break;
+		case MOVETYPE_STEP:
+		case MOVETYPE_PUSHSTEP:
+			SV_Physics_Step( e );
+			break;
+		case MOVETYPE_TOSS:
+		case MOVETYPE_BOUNCE:
+		case MOVETYPE_BOUNCEMISSILE:
+		case MOVETYPE_FLY:
+		case MOVETYPE_FLYMISSILE:
+			SV_Physics_Toss( e );
+			break;
+		default:
+			SV_RunThink( e );
+			break;
+		}
+
+		if( !e->free && ( e->v.flags & FL_KILLME ))
+			SV_FreeEdict( e );
+	}
+
+	if( sv.globals.force_retouch != 0.0f )
+		sv.globals.force_retouch--;
+}
+
+/*
+==================
+SV_RunCmd
+
+A client command, the way the engine runs one.  Player movement
+is a plain walk with gravity instead of the shared pm code.
+==================
+*/
+void SV_RunCmd( edict_t *e, const usercmd_t *cmd, unsigned int random_seed )
+{
+	float frametime = cmd->msec / 1000.0f;
+	vec3_t forward, right, move;
+	TraceResult tr;
+
+	if( e->free || !e->pvPrivateData )
+		return;
+
+	sv_currentPlayer = SV_NumForEdict( e ) - 1;
+	sv.globals.time = sv.time;
+	sv.globals.frametime = frametime;
+
+	sv.dllFuncs.pfnCmdStart( e, cmd, random_seed );
+
+	if( cmd->impulse )
+		e->v.impulse = cmd->impulse;
+
+	VectorCopy( cmd->viewangles, e->v.v_angle );
+	e->v.button = cmd->buttons;
+
+	if( !e->v.fixangle )
+	{
+		e->v.angles[PITCH] = -e->v.v_angle[PITCH] / 3.0f;
+		e->v.angles[YAW] = e->v.v_angle[YAW];
+	}
+
+	sv.dllFuncs.pfnPlayerPreThink( e );
+	SV_RunThink( e );
+
+	if( !e->free && e->v.movetype == MOVETYPE_WALK && e->v.deadflag == DEAD_NO )
+	{
+		float maxspeed = e->v.maxspeed ? e->v.maxspeed : g_svEngineFuncs.pfnCVarGetFloat( "sv_maxspeed" );
+		float fmove = Q_min( Q_max( cmd->forwardmove, -maxspeed ), maxspeed );
+		float smove = Q_min( Q_max( cmd->sidemove, -maxspeed ), maxspeed );
+		vec3_t angles = { 0, cmd->viewangles[YAW], 0 };
+
+		g_svEngineFuncs.pfnAngleVectors( angles, forward, right, NULL );
+
+		e->v.velocity[0] = forward[0] * fmove + right[0] * smove;
+		e->v.velocity[1] = forward[1] * fmove + right[1] * smove;
+
+		if( !( e->v.flags & FL_ONGROUND ))
+			e->v.velocity[2] -= g_svEngineFuncs.pfnCVarGetFloat( "sv_gravity" ) * frametime;
+		else
+			e->v.velocity[2] = 0;
+
+		VectorScale( e->v.velocity, frametime, move );
+
+		SV_TraceBox( e->v.origin, e->v.origin + Vector( move ), e->v.mins, e->v.maxs, MOVE_NORMAL, e, &tr );
+
+		// slide along walls and other players by keeping the unblocked axes
+		if( tr.flFraction < 1.0f && !tr.fAllSolid )
+		{
+			SV_ClipVelocity( e->v.velocity, tr.vecPlaneNormal, e->v.velocity, 1.0f );
+			VectorCopy( tr.vecEndPos, e->v.origin );
+		}
+		else if( !tr.fStartSolid )
+			VectorAdd( e->v.origin, move, e->v.origin );
+
+		vec3_t down = { e->v.origin[0], e->v.origin[1], e->v.origin[2] - 2.0f };
+
+		SV_TraceBox( e->v.origin, down, e->v.mins, e->v.maxs, MOVE_NORMAL, e, &tr );
+
+		if( tr.flFraction < 1.0f && tr.vecPlaneNormal[2] > 0.7f )
+		{
+			e->v.flags |= FL_ONGROUND;
+			e->v.groundentity = tr.pHit;
+		}
+		else
+		{
+			e->v.flags &= ~FL_ONGROUND;
+			e->v.groundentity = NULL;
+		}
+
+		SV_LinkEdict( e, TRUE );
+	}
+	else if( !e->free && ( e->v.movetype == MOVETYPE_TOSS || e->v.movetype == MOVETYPE_BOUNCE ))
+	{
+		float oldframetime = sv.globals.frametime;
+
+		sv.globals.frametime = frametime;
+		SV_Physics_Toss( e );
+		sv.globals.frametime = oldframetime;
+	}
+
+	if( !e->free )
+		sv.dllFuncs.pfnPlayerPostThink( e );
+
+	sv.dllFuncs.pfnCmdEnd( e );
+	sv_currentPlayer = -1;
+}
@@ -0,0 +1,773 @@
+/***
+*
+*   svbench - headless server dll benchmark
+*
+*   Loads the server dll with a stub engine, puts synthetic
+*   players in a box map and has them run around and shoot at
+*   each other, then reports how long the frames took.
+*
+*   svbench [-dll <path>] [-players N] [-frames N] [-fps N] [-seed N]
+*           [-maxplayers N] [-maxentities N] [-warmup N] [-game <dir>]
+*           [-map <name>] [-deltas] [-v] [+<command> [args]] [-end "<command>"]
+*
+*   -deltas compares every entity state with the one the client got
+*   in its last packet and reports how much of it changed, about what
+*   the engine's delta compression has to send.  The packets times
+*   include that work.
+*
+*   The game's own bots can do the players instead, they run from
+*   StartFrame: svbench -players 0 -maxplayers 16 +bot_add 16
+*
+***/
+
+#include "svbench.h"
+#include <dlfcn.h>
+#include <time.h>
+
+#if !defined(SVBENCH_DEFAULT_DLL)
+#define SVBENCH_DEFAULT_DLL	"hl.so"
+#endif
+
+#define SVB_MAX_SCRIPT		2048
+
+enum
+{
+	PHASE_CMDS = 0,		// client commands, pre/post think and movement
+	PHASE_STARTFRAME,
+	PHASE_PHYSICS,		// entity thinks and moves
+	PHASE_PACKETS,		// what the engine asks for to build client packets
+	PHASE_TOTAL,
+	NUM_PHASES
+};
+
+static const char *s_szPhaseNames[NUM_PHASES] =
+{
+	"commands",
+	"StartFrame",
+	"physics",
+	"packets",
+	"frame",
+};
+
+// the weapons impulse 101 hands out that bots switch between
+static const char *s_szBotWeapons[] =
+{
+	"weapon_9mmAR",
+	"weapon_shotgun",
+	"weapon_357",
+	"weapon_rpg",
+	"weapon_handgrenade",
+	"weapon_9mmhandgun",
+};
+
+#define NUM_BOT_WEAPONS	( sizeof( s_szBotWeapons ) / sizeof( s_szBotWeapons[0] ))
+
+typedef struct benchbot_s
+{
+	float		yaw;
+	float		turnRate;	// degrees per second
+	int		target;		// client index
+	int		fireCycle;	// frames
+	int		fireFrames;	// of the cycle the trigger is held
+	BOOL		altFire;
+	int		weapon;
+	int		nextSwitch;	// frame
+	BOOL		pressedRespawn;
+} benchbot_t;
+
+typedef struct benchopts_s
+{
+	const char	*dll;
+	const char	*map;
+	int		players;
+	int		frames;
+	int		warmup;
+	int		fps;
+	unsigned int	seed;
+	int		maxplayers;
+	int		maxentities;
+	BOOL		deltas;
+	char		script[SVB_MAX_SCRIPT];		// + commands, before the map spawns
+	char		endScript[SVB_MAX_SCRIPT];	// -end commands, after the run
+} benchopts_t;
+
+static benchopts_t s_Opts;
+static benchbot_t s_Bots[SVB_MAX_CLIENTS + 1];
+static unsigned int s_iBotSeed;
+static int s_iFrame;
+
+static double *s_pPhaseTimes[NUM_PHASES];
+static unsigned long long s_iTotalTraces;
+static unsigned long long s_iTotalMessages;
+static unsigned long long s_iTotalMessageBytes;
+static unsigned long long s_iTotalSounds;
+static unsigned long long s_iTotalEvents;
+static unsigned long long s_iTotalEntities;
+static unsigned long long s_iTotalVisible;
+
+// -deltas, what each client got of each entity in its last packet
+typedef struct sentstate_s
+{
+	int		frame;
+	entity_state_t	state;
+} sentstate_t;
+
+static sentstate_t *s_pSent;	// maxplayers rows of maxentities
+static unsigned long long s_iTotalDeltaStates;	// sent in the packet before too
+static unsigned long long s_iTotalDeltaUnchanged;
+static unsigned long long s_iTotalDeltaWords;
+
+void Sys_Error( const char *fmt, ... )
+{
+	va_list args;
+
+	va_start( args, fmt );
+	fprintf( stderr, "svbench: " );
+	vfprintf( stderr, fmt, args );
+	va_end( args );
+
+	exit( 1 );
+}
+
+static double Sys_Time( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+// separate from the engine's random numbers, so the game sees the same sequence whatever the bots do
+static int Bot_Random( int lLow, int lHigh )
+{
+	s_iBotSeed = s_iBotSeed * 1664525 + 1013904223;
+
+	return lLow + (int)(( s_iBotSeed >> 8 ) % (unsigned int)( lHigh - lLow + 1 ));
+}
+
+/*
+==============================================================================
+
+SERVER SETUP
+
+==============================================================================
+*/
+static void SV_LoadGameDll( const char *path )
+{
+	typedef void ( *GIVEFNPTRSTODLL )( enginefuncs_t *pengfuncsFromEngine, globalvars_t *pGlobals );
+	typedef int ( *GETENTITYAPI2 )( DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion );
+	typedef int ( *GETNEWDLLFUNCTIONS )( NEW_DLL_FUNCTIONS *pFunctionTable, int *interfaceVersion );
+
+	sv.hGameDll = dlopen( path, RTLD_NOW );
+	if( !sv.hGameDll )
+		Sys_Error( "couldn't load %s: %s\n", path, dlerror() );
+
+	GIVEFNPTRSTODLL pfnGiveFnptrsToDll = (GIVEFNPTRSTODLL)dlsym( sv.hGameDll, "GiveFnptrsToDll" );
+	GETENTITYAPI2 pfnGetEntityAPI2 = (GETENTITYAPI2)dlsym( sv.hGameDll, "GetEntityAPI2" );
+	GETNEWDLLFUNCTIONS pfnGetNewDLLFunctions = (GETNEWDLLFUNCTIONS)dlsym( sv.hGameDll, "GetNewDLLFunctions" );
+
+	if( !pfnGiveFnptrsToDll || !pfnGetEntityAPI2 )
+		Sys_Error( "%s is not a server dll\n", path );
+
+	pfnGiveFnptrsToDll( &g_svEngineFuncs, &sv.globals );
+
+	int version = INTERFACE_VERSION;
+
+	if( !pfnGetEntityAPI2( &sv.dllFuncs, &version ))
+		Sys_Error( "%s has interface version %d, expected %d\n", path, version, INTERFACE_VERSION );
+
+	version = NEW_DLL_FUNCTIONS_VERSION;
+
+	if( pfnGetNewDLLFunctions )
+		pfnGetNewDLLFunctions( &sv.newDllFuncs, &version );
+}
+
+static void SV_KeyValue( edict_t *e, const char *pszClassname, const char *pszKey, const char *pszValue )
+{
+	KeyValueData kvd;
+
+	kvd.szClassName = pszClassname;
+	kvd.szKeyName = pszKey;
+	kvd.szValue = pszValue;
+	kvd.fHandled = 0;
+
+	sv.dllFuncs.pfnKeyValue( e, &kvd );
+}
+
+// what loading an entity from the map's entity lump does
+static edict_t *SV_SpawnMapEntity( const char *pszClassname, const char *pszOrigin, const char *pszAngles )
+{
+	edict_t *e = SV_CreateNamedEntity( pszClassname );
+
+	if( !e )
+		return NULL;
+
+	if( pszOrigin )
+		SV_KeyValue( e, pszClassname, "origin", pszOrigin );
+	if( pszAngles )
+		SV_KeyValue( e, pszClassname, "angles", pszAngles );
+
+	sv.globals.time = sv.time;
+
+	if( sv.dllFuncs.pfnSpawn( e ) == -1 )
+	{
+		SV_FreeEdict( e );
+		return NULL;
+	}
+
+	return e;
+}
+
+static void SV_SpawnServer( void )
+{
+	typedef void ( *LINK_ENTITY_FUNC )( entvars_t *pev );
+	char buf[64];
+
+	sv.time = 1.0;
+	sv.globals.time = sv.time;
+	sv.globals.frametime = 1.0f / s_Opts.fps;
+	sv.globals.mapname = SV_AllocString( s_Opts.map );
+	sv.globals.startspot = 0;
+	sv.globals.serverflags = 0;
+
+	// the world is edict 0 and doesn't come from CreateNamedEntity
+	edict_t *world = sv.edicts;
+	LINK_ENTITY_FUNC pfnWorldspawn = (LINK_ENTITY_FUNC)dlsym( sv.hGameDll, "worldspawn" );
+
+	if( !pfnWorldspawn )
+		Sys_Error( "no worldspawn in the game dll\n" );
+
+	memset( &world->v, 0, sizeof( world->v ));
+	world->free = false;
+	world->v.pContainingEntity = world;
+	world->v.classname = SV_AllocString( "worldspawn" );
+	world->v.model = SV_AllocString( "maps/svbench.bsp" );
+	world->v.modelindex = 1;
+	world->v.solid = SOLID_BSP;
+	world->v.movetype = MOVETYPE_PUSH;
+	pfnWorldspawn( &world->v );
+	sv.dllFuncs.pfnSpawn( world );
+
+	// the spawn points are a ring around the middle of the box
+	int numSpawns = Q_max( s_Opts.players, 8 );
+
+	for( int i = 0; i < numSpawns; i++ )
+	{
+		float angle = i * ( M_PI * 2 / numSpawns );
+		char origin[64];
+
+		snprintf( origin, sizeof( origin ), "%.0f %.0f 37", cos( angle ) * 1024, sin( angle ) * 1024 );
+		snprintf( buf, sizeof( buf ), "0 %.0f 0", fmod( angle * 180 / M_PI + 180, 360 ));
+
+		SV_SpawnMapEntity( "info_player_deathmatch", origin, buf );
+	}
+
+	// something to pick up on the way
+	for( int i = 0; i < numSpawns; i++ )
+	{
+		static const char *items[] = { "item_healthkit", "item_battery", "ammo_9mmclip", "ammo_buckshot", "weapon_shotgun" };
+		float angle = ( i + 0.5f ) * ( M_PI * 2 / numSpawns );
+		char origin[64];
+
+		snprintf( origin, sizeof( origin ), "%.0f %.0f 16", cos( angle ) * 512, sin( angle ) * 512 );
+		SV_SpawnMapEntity( items[i % 5], origin, NULL );
+	}
+
+	sv.dllFuncs.pfnServerActivate( sv.edicts, sv.numEdicts, sv.maxClients );
+}
+
+static edict_t *SV_ConnectClient( int client )
+{
+	char name[32], reject[128];
+	edict_t *e = &sv.edicts[client];
+
+	snprintf( name, sizeof( name ), "bench%02d", client );
+	snprintf( SV_ClientInfo( client ), SVB_INFO_STRING,
+		"\\name\\%s\\model\\gordon\\topcolor\\%d\\bottomcolor\\%d\\cl_lw\\1\\cl_lc\\1", name, client * 7 % 255, client * 13 % 255 );
+
+	memset( &e->v, 0, sizeof( e->v ));
+	e->free = false;
+	e->v.pContainingEntity = e;
+	e->v.netname = SV_AllocString( name );
+	e->v.flags = FL_CLIENT;
+
+	reject[0] = '\0';
+
+	if( !sv.dllFuncs.pfnClientConnect( e, name, "loopback", reject ))
+		Sys_Error( "%s rejected: %s\n", name, reject );
+
+	sv.globals.time = sv.time;
+	sv.dllFuncs.pfnClientPutInServer( e );
+	sv.dllFuncs.pfnClientUserInfoChanged( e, SV_ClientInfo( client ));
+
+	return e;
+}
+
+static void SV_ClientCommand( edict_t *e, const char *pszCommand )
+{
+	SV_SetArgs( pszCommand );
+	sv.dllFuncs.pfnClientCommand( e );
+}
+
+/*
+==============================================================================
+
+BOTS
+
+==============================================================================
+*/
+static void Bot_Init( int client )
+{
+	benchbot_t *bot = &s_Bots[client];
+
+	bot->yaw = Bot_Random( 0, 359 );
+	bot->turnRate = Bot_Random( 30, 90 ) * ( Bot_Random( 0, 1 ) ? 1 : -1 );
+	bot->target = client % s_Opts.players + 1;
+	bot->fireCycle = Bot_Random( 20, 100 );
+	bot->fireFrames = Bot_Random( 5, bot->fireCycle / 2 );
+	bot->altFire = FALSE;
+	bot->weapon = Bot_Random( 0, NUM_BOT_WEAPONS - 1 );
+	bot->nextSwitch = 0;
+	bot->pressedRespawn = FALSE;
+}
+
+static void Bot_Think( int client, int frame, usercmd_t *cmd )
+{
+	benchbot_t *bot = &s_Bots[client];
+	edict_t *e = &sv.edicts[client];
+	edict_t *target = &sv.edicts[bot->target];
+	float frametime = 1.0f / s_Opts.fps;
+
+	memset( cmd, 0, sizeof( *cmd ));
+	cmd->msec = (byte)Q_max( 1000 / s_Opts.fps, 1 );
+	cmd->lerp_msec = 100;
+
+	// dead, press and release fire until respawned
+	if( e->v.deadflag != DEAD_NO )
+	{
+		bot->pressedRespawn = !bot->pressedRespawn;
+		if( bot->pressedRespawn )
+			cmd->buttons = IN_ATTACK;
+		return;
+	}
+
+	if( frame >= bot->nextSwitch )
+	{
+		bot->weapon = Bot_Random( 0, NUM_BOT_WEAPONS - 1 );
+		bot->altFire = Bot_Random( 0, 3 ) == 0;
+		bot->nextSwitch = frame + Bot_Random( s_Opts.fps * 2, s_Opts.fps * 8 );
+
+		SV_ClientCommand( e, s_szBotWeapons[bot->weapon] );
+	}
+
+	// run in circles
+	bot->yaw = fmod( bot->yaw + bot->turnRate * frametime + 360.0f, 360.0f );
+	cmd->forwardmove = 250;
+	cmd->sidemove = ( frame / 50 ) & 1 ? 100 : -100;
+
+	// and look at the next player in the list
+	if( !target->free && target != e )
+	{
+		vec3_t dir, angles;
+
+		VectorSubtract( target->v.origin, e->v.origin, dir );
+		g_svEngineFuncs.pfnVecToAngles( dir, angles );
+
+		cmd->viewangles[PITCH] = angles[PITCH] > 180 ? 360 - angles[PITCH] : -angles[PITCH];
+		cmd->viewangles[YAW] = angles[YAW];
+		cmd->forwardmove = 250 * cos(( bot->yaw - angles[YAW] ) * M_PI / 180 );
+		cmd->sidemove = 250 * sin(( bot->yaw - angles[YAW] ) * M_PI / 180 );
+	}
+	else
+		cmd->viewangles[YAW] = bot->yaw;
+
+	if( frame % bot->fireCycle < bot->fireFrames )
+		cmd->buttons |= bot->altFire ? IN_ATTACK2 : IN_ATTACK;
+
+	if( cmd->forwardmove > 0 )
+		cmd->buttons |= IN_FORWARD;
+	else if( cmd->forwardmove < 0 )
+		cmd->buttons |= IN_BACK;
+
+	// keep them stocked up
+	if( frame % ( s_Opts.fps * 10 ) == client )
+		cmd->impulse = 101;
+}
+
+/*
+==============================================================================
+
+FRAMES
+
+==============================================================================
+*/
+// 32 bit words of the state that differ from the client's last packet
+static void SV_CountDelta( int client, int e, const entity_state_t *state )
+{
+	sentstate_t *pSent = &s_pSent[( client - 1 ) * s_Opts.maxentities + e];
+
+	if( pSent->frame == s_iFrame - 1 )
+	{
+		const int *a = (const int *)state;
+		const int *b = (const int *)&pSent->state;
+		int changed = 0;
+
+		for( size_t i = 0; i < sizeof( entity_state_t ) / sizeof( int ); i++ )
+		{
+			if( a[i] != b[i] )
+				changed++;
+		}
+
+		s_iTotalDeltaStates++;
+		s_iTotalDeltaWords += changed;
+		if( !changed )
+			s_iTotalDeltaUnchanged++;
+	}
+
+	pSent->frame = s_iFrame;
+	pSent->state = *state;
+}
+
+static void SV_SendClientPackets( void )
+{
+	static entity_state_t states[SVB_MAX_EDICTS];
+	static weapon_data_t weapons[64];
+	clientdata_t cd;
+
+	for( int i = 1; i <= sv.maxClients; i++ )
+	{
+		edict_t *host = &sv.edicts[i];
+		unsigned char *pvs, *pas;
+		int count = 0;
+
+		if( host->free || !host->pvPrivateData )
+			continue;
+
+		int sendweapons = atoi( g_svEngineFuncs.pfnInfoKeyValue( SV_ClientInfo( i ), "cl_lw" ));
+
+		sv.dllFuncs.pfnSetupVisibility( NULL, host, &pvs, &pas );
+
+		memset( &cd, 0, sizeof( cd ));
+		sv.dllFuncs.pfnUpdateClientData( host, sendweapons, &cd );
+
+		if( sendweapons )
+		{
+			memset( weapons, 0, sizeof( weapons ));
+			sv.dllFuncs.pfnGetWeaponData( host, weapons );
+		}
+
+		for( int e = 1; e < sv.numEdicts; e++ )
+		{
+			edict_t *ent = &sv.edicts[e];
+
+			if( ent->free )
+				continue;
+
+			BOOL player = ( e <= sv.maxClients ) ? TRUE : FALSE;
+
+			if( sv.dllFuncs.pfnAddToFullPack( &states[count], e, ent, host, sendweapons, player, pvs ))
+			{
+				if( s_pSent )
+					SV_CountDelta( i, e, &states[count] );
+				count++;
+			}
+		}
+
+		s_iTotalVisible += count;
+	}
+}
+
+static void SV_ResetCounters( void )
+{
+	sv.numTraces = 0;
+	sv.numMessages = 0;
+	sv.messageBytes = 0;
+	sv.numSounds = 0;
+	sv.numEvents = 0;
+}
+
+// sample is where the times go, -1 for warmup frames
+static void SV_Frame( int sample )
+{
+	usercmd_t cmd;
+	double t[NUM_PHASES + 1];
+
+	SV_ResetCounters();
+
+	s_iFrame++;
+	sv.time += 1.0 / s_Opts.fps;
+	sv.globals.frametime = 1.0f / s_Opts.fps;
+
+	t[0] = Sys_Time();
+
+	// what the client dll does when the voice manager sends ReqState
+	for( int i = 1; sv.wantVoiceState; i++ )
+	{
+		if( !( sv.wantVoiceState & ( 1U << ( i - 1 ))))
+			continue;
+
+		sv.wantVoiceState &= ~( 1U << ( i - 1 ));
+		if( !sv.edicts[i].free )
+			SV_ClientCommand( &sv.edicts[i], "VModEnable 1" );
+	}
+
+	for( int i = 1; i <= s_Opts.players; i++ )
+	{
+		if( sv.edicts[i].free )
+			continue;
+
+		Bot_Think( i, s_iFrame, &cmd );
+		SV_RunCmd( &sv.edicts[i], &cmd, g_svEngineFuncs.pfnRandomLong( 0, 0x7FFFFFFF ));
+	}
+
+	sv.globals.frametime = 1.0f / s_Opts.fps;
+	t[1] = Sys_Time();
+
+	sv.globals.time = sv.time;
+	sv.dllFuncs.pfnStartFrame();
+	t[2] = Sys_Time();
+
+	SV_Physics();
+	g_svEngineFuncs.pfnServerExecute();
+	t[3] = Sys_Time();
+
+	SV_SendClientPackets();
+	t[4] = Sys_Time();
+
+	if( sample == -1 )
+		return;
+
+	for( int p = 0; p < PHASE_TOTAL; p++ )
+		s_pPhaseTimes[p][sample] = t[p + 1] - t[p];
+
+	s_pPhaseTimes[PHASE_TOTAL][sample] = t[4] - t[0];
+
+	s_iTotalTraces += sv.numTraces;
+	s_iTotalMessages += sv.numMessages;
+	s_iTotalMessageBytes += sv.messageBytes;
+	s_iTotalSounds += sv.numSounds;
+	s_iTotalEvents += sv.numEvents;
+	s_iTotalEntities += g_svEngineFuncs.pfnNumberOfEntities();
+}
+
+/*
+==============================================================================
+
+REPORT
+
+==============================================================================
+*/
+static int SV_CompareTimes( const void *a, const void *b )
+{
+	double d = *(const double *)a - *(const double *)b;
+
+	return d < 0 ? -1 : d > 0 ? 1 : 0;
+}
+
+static double SV_Percentile( const double *sorted, int count, double fraction )
+{
+	int i = (int)( fraction * ( count - 1 ) + 0.5 );
+
+	return sorted[Q_min( i, count - 1 )];
+}
+
+static void SV_Report( double wallTime )
+{
+	int frames = s_Opts.frames;
+
+	printf( "\n%d players, %d frames at %d fps, seed %u, %.2f seconds\n", s_Opts.players, frames, s_Opts.fps, s_Opts.seed, wallTime );
+	printf( "%-12s %9s %9s %9s %9s %9s %9s   (us)\n", "", "mean", "p50", "p90", "p99", "p99.9", "max" );
+
+	for( int p = 0; p < NUM_PHASES; p++ )
+	{
+		double *times = s_pPhaseTimes[p];
+		double total = 0;
+
+		for( int i = 0; i < frames; i++ )
+			total += times[i];
+
+		qsort( times, frames, sizeof( double ), SV_CompareTimes );
+
+		printf( "%-12s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", s_szPhaseNames[p], total / frames * 1e6,
+			SV_Percentile( times, frames, 0.5 ) * 1e6, SV_Percentile( times, frames, 0.9 ) * 1e6,
+			SV_Percentile( times, frames, 0.99 ) * 1e6, SV_Percentile( times, frames, 0.999 ) * 1e6, times[frames - 1] * 1e6 );
+	}
+
+	printf( "\nper frame: %.1f entities, %.1f traces, %.1f messages (%.0f bytes), %.1f sounds, %.1f events, %.1f states sent\n",
+		(double)s_iTotalEntities / frames, (double)s_iTotalTraces / frames, (double)s_iTotalMessages / frames,
+		(double)s_iTotalMessageBytes / frames, (double)s_iTotalSounds / frames, (double)s_iTotalEvents / frames,
+		(double)s_iTotalVisible / frames );
+
+	if( s_pSent && s_iTotalDeltaStates )
+	{
+		printf( "deltas: %.2f changed words per state, %.1f%% of states unchanged, %llu states compared\n",
+			(double)s_iTotalDeltaWords / s_iTotalDeltaStates, 100.0 * s_iTotalDeltaUnchanged / s_iTotalDeltaStates,
+			s_iTotalDeltaStates );
+	}
+}
+
+/*
+==============================================================================
+
+MAIN
+
+==============================================================================
+*/
+static void SV_Usage( void )
+{
+	printf( "usage: svbench [-dll <path>] [-players N] [-frames N] [-fps N] [-seed N]\n"
+		"               [-maxplayers N] [-maxentities N] [-warmup N] [-game <dir>]\n"
+		"               [-map <name>] [-deltas] [-v] [+<command> [args]] [-end \"<command>\"]\n" );
+	exit( 1 );
+}
+
+static void SV_ParseArgs( int argc, char **argv )
+{
+	s_Opts.dll = SVBENCH_DEFAULT_DLL;
+	s_Opts.map = "svbench";
+	s_Opts.players = 16;
+	s_Opts.frames = 6000;
+	s_Opts.warmup = 200;
+	s_Opts.fps = 100;
+	s_Opts.seed = 1;
+	s_Opts.maxplayers = 0;
+	s_Opts.maxentities = 900;
+
+	for( int i = 1; i < argc; i++ )
+	{
+		const char *arg = argv[i];
+		BOOL hasValue = i + 1 < argc;
+
+		if( arg[0] == '+' )
+		{
+			// +command and its arguments, up to the next option
+			strncat( s_Opts.script, arg + 1, sizeof( s_Opts.script ) - strlen( s_Opts.script ) - 1 );
+
+			while( i + 1 < argc && argv[i + 1][0] != '+' && argv[i + 1][0] != '-' )
+			{
+				strncat( s_Opts.script, " ", sizeof( s_Opts.script ) - strlen( s_Opts.script ) - 1 );
+				strncat( s_Opts.script, argv[++i], sizeof( s_Opts.script ) - strlen( s_Opts.script ) - 1 );
+			}
+
+			strncat( s_Opts.script, "\n", sizeof( s_Opts.script ) - strlen( s_Opts.script ) - 1 );
+		}
+		else if( !strcmp( arg, "-v" ))
+			sv.verbose = TRUE;
+		else if( !strcmp( arg, "-deltas" ))
+			s_Opts.deltas = TRUE;
+		else if( !hasValue )
+			SV_Usage();
+		else if( !strcmp( arg, "-dll" ))
+			s_Opts.dll = argv[++i];
+		else if( !strcmp( arg, "-map" ))
+			s_Opts.map = argv[++i];
+		else if( !strcmp( arg, "-game" ))
+			strncpy( sv_gameDir, argv[++i], sizeof( sv_gameDir ) - 1 );
+		else if( !strcmp( arg, "-players" ))
+			s_Opts.players = atoi( argv[++i] );
+		else if( !strcmp( arg, "-frames" ))
+			s_Opts.frames = atoi( argv[++i] );
+		else if( !strcmp( arg, "-warmup" ))
+			s_Opts.warmup = atoi( argv[++i] );
+		else if( !strcmp( arg, "-fps" ))
+			s_Opts.fps = atoi( argv[++i] );
+		else if( !strcmp( arg, "-seed" ))
+			s_Opts.seed = strtoul( argv[++i], NULL, 10 );
+		else if( !strcmp( arg, "-maxplayers" ))
+			s_Opts.maxplayers = atoi( argv[++i] );
+		else if( !strcmp( arg, "-maxentities" ))
+			s_Opts.maxentities = atoi( argv[++i] );
+		else if( !strcmp( arg, "-end" ))
+		{
+			strncat( s_Opts.endScript, argv[++i], sizeof( s_Opts.endScript ) - strlen( s_Opts.endScript ) - 1 );
+			strncat( s_Opts.endScript, "\n", sizeof( s_Opts.endScript ) - strlen( s_Opts.endScript ) - 1 );
+		}
+		else
+			SV_Usage();
+	}
+
+	if( !s_Opts.maxplayers )
+		s_Opts.maxplayers = Q_max( s_Opts.players, 2 );
+
+	s_Opts.maxplayers = Q_min( Q_max( s_Opts.maxplayers, 1 ), SVB_MAX_CLIENTS );
+	s_Opts.players = Q_min( Q_max( s_Opts.players, 0 ), s_Opts.maxplayers );
+	s_Opts.maxentities = Q_min( Q_max( s_Opts.maxentities, s_Opts.maxplayers + 64 ), SVB_MAX_EDICTS );
+	s_Opts.fps = Q_min( Q_max( s_Opts.fps, 10 ), 1000 );
+	s_Opts.frames = Q_max( s_Opts.frames, 1 );
+	s_Opts.warmup = Q_max( s_Opts.warmup, 0 );
+}
+
+int main( int argc, char **argv )
+{
+	SV_ParseArgs( argc, argv );
+
+	sv.randSeed = s_Opts.seed;
+	s_iBotSeed = s_Opts.seed ^ 0x5EED;
+
+	sv.maxClients = s_Opts.maxplayers;
+	sv.maxEdicts = s_Opts.maxentities;
+	sv.edicts = (edict_t *)calloc( sv.maxEdicts, sizeof( edict_t ));
+	sv.numEdicts = sv.maxClients + 1;
+
+	for( int i = 1; i <= sv.maxClients; i++ )
+		sv.edicts[i].free = true;
+
+	SV_InitEngine();
+
+	sv.globals.maxClients = sv.maxClients;
+	sv.globals.maxEntities = sv.maxEdicts;
+	sv.globals.deathmatch = 1;
+	sv.globals.coop = 0;
+
+	SV_LoadGameDll( s_Opts.dll );
+
+	sv.loading = TRUE;
+
+	sv.dllFuncs.pfnGameInit();
+	g_svEngineFuncs.pfnServerExecute();
+
+	SV_SetCvar( "sv_cheats", "1" );
+	SV_SetCvar( "deathmatch", "1" );
+	char maxplayers[16];
+
+	snprintf( maxplayers, sizeof( maxplayers ), "%d", sv.maxClients );
+	SV_SetCvar( "maxplayers", maxplayers );
+	SV_Command( s_Opts.script );
+
+	SV_SpawnServer();
+
+	for( int i = 1; i <= s_Opts.players; i++ )
+	{
+		edict_t *e = SV_ConnectClient( i );
+
+		Bot_Init( i );
+		e->v.impulse = 101;
+	}
+
+	sv.loading = FALSE;
+
+	for( int p = 0; p < NUM_PHASES; p++ )
+		s_pPhaseTimes[p] = (double *)calloc( s_Opts.frames, sizeof( double ));
+
+	if( s_Opts.deltas )
+		s_pSent = (sentstate_t *)calloc( s_Opts.maxplayers * s_Opts.maxentities, sizeof( sentstate_t ));
+
+	for( int frame = 0; frame < s_Opts.warmup; frame++ )
+		SV_Frame( -1 );
+
+	double start = Sys_Time();
+
+	for( int frame = 0; frame < s_Opts.frames; frame++ )
+		SV_Frame( frame );
+
+	SV_Report( Sys_Time() - start );
+
+	if( s_Opts.endScript[0] )
+	{
+		printf( "\n" );
+		SV_Command( s_Opts.endScript );
+	}
+
+	return 0;
+}
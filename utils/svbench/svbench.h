@@ -0,0 +1,106 @@
+/***
+*
+*   svbench - headless server dll benchmark
+*
+***/
+#pragma once
+#if !defined(SVBENCH_H)
+#define SVBENCH_H
+
+#include <string.h>
+#include <strings.h>
+#include "extdll.h"
+#include "entity_state.h"
+#include "usercmd.h"
+#include "weaponinfo.h"
+#include "cdll_dll.h"
+
+#define SVB_MAX_CLIENTS		32
+#define SVB_MAX_EDICTS		2048
+#define SVB_STRING_POOL		( 1024 * 1024 )
+#define SVB_MAX_CVARS		1024
+#define SVB_MAX_COMMANDS	256
+#define SVB_MAX_PRECACHE	512
+#define SVB_MAX_ARGS		16
+#define SVB_INFO_STRING		512
+
+#define PITCH		0
+#define YAW		1
+#define ROLL		2
+
+// common/mathlib.h can't be mixed with the game's vector.h
+#define DotProduct( x, y )	(( x )[0] * ( y )[0] + ( x )[1] * ( y )[1] + ( x )[2] * ( y )[2] )
+#define VectorCopy( a, b )	{ ( b )[0] = ( a )[0]; ( b )[1] = ( a )[1]; ( b )[2] = ( a )[2]; }
+#define VectorAdd( a, b, c )	{ ( c )[0] = ( a )[0] + ( b )[0]; ( c )[1] = ( a )[1] + ( b )[1]; ( c )[2] = ( a )[2] + ( b )[2]; }
+#define VectorSubtract( a, b, c )	{ ( c )[0] = ( a )[0] - ( b )[0]; ( c )[1] = ( a )[1] - ( b )[1]; ( c )[2] = ( a )[2] - ( b )[2]; }
+#define VectorScale( a, s, c )	{ ( c )[0] = ( a )[0] * ( s ); ( c )[1] = ( a )[1] * ( s ); ( c )[2] = ( a )[2] * ( s ); }
+#define VectorMA( a, s, b, c )	{ ( c )[0] = ( a )[0] + ( s ) * ( b )[0]; ( c )[1] = ( a )[1] + ( s ) * ( b )[1]; ( c )[2] = ( a )[2] + ( s ) * ( b )[2]; }
+#define VectorClear( a )	{ ( a )[0] = 0.0f; ( a )[1] = 0.0f; ( a )[2] = 0.0f; }
+
+// the box every map is: walls at +-SVB_WORLD_SIZE, floor at 0
+#define SVB_WORLD_SIZE		2048.0f
+#define SVB_WORLD_HEIGHT	1024.0f
+
+// server state, the parts of the engine the game dll sees
+typedef struct server_s
+{
+	void		*hGameDll;
+	DLL_FUNCTIONS	dllFuncs;
+	NEW_DLL_FUNCTIONS	newDllFuncs;
+
+	globalvars_t	globals;
+
+	edict_t		*edicts;
+	int		maxEdicts;
+	int		numEdicts;
+	int		maxClients;
+
+	double		time;
+	unsigned int	randSeed;
+	BOOL		verbose;
+	BOOL		loading;	// console output is dropped while the map loads
+
+	// the voice manager asks clients for VModEnable, the client dll answers
+	int		reqStateMsg;	// 0 if the game didn't register ReqState
+	unsigned int	wantVoiceState;	// bit per client asked
+
+	// per frame counters
+	unsigned int	numTraces;
+	unsigned int	numMessages;
+	unsigned int	messageBytes;
+	unsigned int	numSounds;
+	unsigned int	numEvents;
+} server_t;
+
+extern server_t sv;
+extern enginefuncs_t g_svEngineFuncs;
+extern char sv_gameDir[MAX_PATH];
+extern int sv_currentPlayer;
+
+// sv_engine.cpp
+void SV_InitEngine( void );
+edict_t *SV_EdictNum( int n );
+int SV_NumForEdict( const edict_t *e );
+edict_t *SV_AllocEdict( void );
+void SV_FreeEdict( edict_t *e );
+edict_t *SV_CreateNamedEntity( const char *pszClassname );
+string_t SV_AllocString( const char *s );
+const char *SV_String( string_t s );
+void SV_SetCvar( const char *pszName, const char *pszValue );
+void SV_Command( const char *pszText );
+void SV_SetArgs( const char *pszText );
+char *SV_ClientInfo( int client );
+
+// sv_world.cpp
+void SV_LinkEdict( edict_t *e, BOOL touchTriggers );
+void SV_TraceLine( const float *v1, const float *v2, int fNoMonsters, edict_t *pentToSkip, TraceResult *ptr );
+void SV_TraceHull( const float *v1, const float *v2, int fNoMonsters, int hullNumber, edict_t *pentToSkip, TraceResult *ptr );
+void SV_TraceBox( const float *v1, const float *v2, const float *mins, const float *maxs, int fNoMonsters, edict_t *pentToSkip, TraceResult *ptr );
+void SV_TraceModel( const float *v1, const float *v2, int hullNumber, edict_t *pent, TraceResult *ptr );
+int SV_PointContents( const float *p );
+void SV_Physics( void );
+void SV_RunCmd( edict_t *e, const usercmd_t *cmd, unsigned int random_seed );
+
+// svbench.cpp
+void Sys_Error( const char *fmt, ... );
+#endif // SVBENCH_H